@@ -9,13 +9,18 @@
  // Arguments:
  // - cchRowWidth - the length of the default text attribute
  // - attr - the default text attribute
+ // - attributeTable - the table that the attributes of this row are interned in
  // Return Value:
  // - constructed object
  // Note: will throw exception if unable to allocate memory for text attribute storage
-ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr)
+ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr, TextAttributeTable& attributeTable) :
+    _pAttributeTable{ &attributeTable }
 {
-    _list.push_back(TextAttributeRun(cchRowWidth, attr));
+    THROW_HR_IF(E_INVALIDARG, cchRowWidth > SHRT_MAX);
+
+    _list.push_back(InternedAttributeRun(cchRowWidth, attributeTable.Intern(attr)));
     _cchRowWidth = cchRowWidth;
+    _UpdateRunEnds();
 }
 
 // Routine Description:
@@ -24,8 +29,10 @@ ATTR_ROW::ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr)
 // - attr - The default text attributes to use on text in this row.
 void ATTR_ROW::Reset(const TextAttribute attr)
 {
+    const auto attrId = _pAttributeTable->Intern(attr);
     _list.clear();
-    _list.push_back(TextAttributeRun(_cchRowWidth, attr));
+    _list.push_back(InternedAttributeRun(_cchRowWidth, attrId));
+    _UpdateRunEnds();
 }
 
 // Routine Description:
@@ -40,6 +47,7 @@ void ATTR_ROW::Reset(const TextAttribute attr)
 void ATTR_ROW::Resize(const size_t newWidth)
 {
     THROW_HR_IF(E_INVALIDARG, 0 == newWidth);
+    THROW_HR_IF(E_INVALIDARG, newWidth > SHRT_MAX);
 
     // Easy case. If the new row is longer, increase the length of the last run by how much new space there is.
     if (newWidth > _cchRowWidth)
@@ -79,6 +87,8 @@ void ATTR_ROW::Resize(const size_t newWidth)
         // in memory. We're not going to waste time redimensioning the array in the heap. We're just noting that the useful
         // portions of it have changed.
     }
+
+    _UpdateRunEnds();
 }
 
 // Routine Description:
@@ -108,7 +118,7 @@ TextAttribute ATTR_ROW::GetAttrByColumn(const size_t column,
 {
     THROW_HR_IF(E_INVALIDARG, column >= _cchRowWidth);
     const auto runPos = FindAttrIndex(column, pApplies);
-    return _list[runPos].GetAttributes();
+    return _pAttributeTable->Get(_list[runPos].GetAttributeId());
 }
 
 // Routine Description:
@@ -122,6 +132,7 @@ size_t ATTR_ROW::GetNumberOfRuns() const noexcept
 
 // Routine Description:
 // - This routine finds the nth attribute in this ATTR_ROW.
+// - Each run knows the column it ends at, so this is a binary search over the runs.
 // Arguments:
 // - index - which attribute to find
 // - applies - on output, contains corrected length of indexed attr.
@@ -133,33 +144,24 @@ size_t ATTR_ROW::FindAttrIndex(const size_t index, size_t* const pApplies) const
 {
     FAIL_FAST_IF(!(index < _cchRowWidth)); // The requested index cannot be longer than the total length described by this set of Attrs.
 
-    size_t cTotalLength = 0;
-
     FAIL_FAST_IF(!(_list.size() > 0)); // There should be a non-zero and positive number of items in the array.
 
-    // Scan through the internal array from position 0 adding up the lengths that each attribute applies to
-    auto runPos = _list.cbegin();
-    do
-    {
-        cTotalLength += runPos->GetLength();
-
-        if (cTotalLength > index)
-        {
-            // If we've just passed up the requested index with the length we added, break early
-            break;
-        }
-
-        runPos++;
-    } while (runPos < _list.cend());
+    // Find the first run that ends after the requested index. That's the run that covers it.
+    const auto runPos = std::upper_bound(_list.cbegin(),
+                                         _list.cend(),
+                                         index,
+                                         [](const size_t column, const InternedAttributeRun& run) noexcept {
+                                             return column < run.GetEndColumn();
+                                         });
 
-    // we should have broken before falling out the while case.
-    // if we didn't break, then this ATTR_ROW wasn't filled with enough attributes for the entire row of characters
+    // if we didn't find one, then this ATTR_ROW wasn't filled with enough attributes for the entire row of characters
     FAIL_FAST_IF(runPos >= _list.cend());
 
     // The remaining iterator position is the position of the attribute that is applicable at the position requested (index)
     // Calculate its remaining applicability if requested
 
-    // The length on which the found attribute applies is the total length seen so far minus the index we were searching for.
+    // The length on which the found attribute applies is the total length up to the end of the run minus the index we were searching for.
+    const size_t cTotalLength = runPos->GetEndColumn();
     FAIL_FAST_IF(!(cTotalLength > index)); // The length of all attributes we counted up so far should be longer than the index requested or we'll underflow.
 
     if (nullptr != pApplies)
@@ -221,13 +223,20 @@ void ATTR_ROW::ReplaceLegacyAttrs(_In_ WORD wToBeReplacedAttr, _In_ WORD wReplac
 // - <none>
 void ATTR_ROW::ReplaceAttrs(const TextAttribute& toBeReplacedAttr, const TextAttribute& replaceWith) noexcept
 {
-    for (auto& run : _list)
+    try
     {
-        if (run.GetAttributes() == toBeReplacedAttr)
+        // Equal attributes share an ID, so we only need to look the attributes up once.
+        const auto toBeReplacedId = _pAttributeTable->Intern(toBeReplacedAttr);
+        const auto replaceWithId = _pAttributeTable->Intern(replaceWith);
+        for (auto& run : _list)
         {
-            run.SetAttributes(replaceWith);
+            if (run.GetAttributeId() == toBeReplacedId)
+            {
+                run.SetAttributeId(replaceWithId);
+            }
         }
     }
+    CATCH_LOG();
 }
 
 
@@ -268,16 +277,41 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     // Do the -1 math here now so we don't have to have -1s scattered all over this function.
     const size_t iLastBufferCol = cBufferWidth - 1;
 
+    // Look up the IDs of the attributes we're inserting. From here on, runs are
+    // the same color if and only if their IDs are the same.
+    // Most insertions are a single run, which doesn't need the vector.
+    InternedAttributeRun singleInsertRun;
+    std::vector<InternedAttributeRun> insertRuns;
+    std::basic_string_view<InternedAttributeRun> insertAttrs;
+    try
+    {
+        if (newAttrs.size() == 1)
+        {
+            singleInsertRun = _Intern(newAttrs.front());
+            insertAttrs = { &singleInsertRun, 1 };
+        }
+        else
+        {
+            insertRuns.reserve(newAttrs.size());
+            for (const auto& run : newAttrs)
+            {
+                insertRuns.push_back(_Intern(run));
+            }
+            insertAttrs = { insertRuns.data(), insertRuns.size() };
+        }
+    }
+    CATCH_RETURN();
+
     // If the insertion size is 1, do some pre-processing to
     // see if we can get this done quickly.
-    if (newAttrs.size() == 1)
+    if (insertAttrs.size() == 1)
     {
         // Get the new color attribute we're trying to apply
-        const TextAttribute NewAttr = newAttrs.at(0).GetAttributes();
+        const auto NewAttr = insertAttrs.at(0).GetAttributeId();
 
         // If the existing run was only 1 element...
         // ...and the new color is the same as the old, we don't have to do anything and can exit quick.
-        if (_list.size() == 1 && _list.at(0).GetAttributes() == NewAttr)
+        if (_list.size() == 1 && _list.at(0).GetAttributeId() == NewAttr)
         {
             return S_OK;
         }
@@ -291,10 +325,10 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // Check for that circumstance by seeing if we're inserting a single run of the
         // left side color right at the boundary and just adjust the counts in the existing
         // two elements in our internal list.
-        else if (_list.size() == 2 && newAttrs.at(0).GetLength() == 1)
+        else if (_list.size() == 2 && insertAttrs.at(0).GetLength() == 1)
         {
             auto left = _list.begin();
-            if (iStart == left->GetLength() && NewAttr == left->GetAttributes())
+            if (iStart == left->GetLength() && NewAttr == left->GetAttributeId())
             {
                 auto right = left + 1;
                 left->IncrementLength();
@@ -305,6 +339,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
                 {
                     _list.erase(right);
                 }
+                _UpdateRunEnds();
                 return S_OK;
             }
         }
@@ -314,7 +349,8 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     if (iStart == 0 && iEnd == iLastBufferCol)
     {
         // Just dump what we're given over what we have and call it a day.
-        _list.assign(newAttrs.cbegin(), newAttrs.cend());
+        _list.assign(insertAttrs.cbegin(), insertAttrs.cend());
+        _UpdateRunEnds();
 
         return S_OK;
     }
@@ -326,8 +362,8 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     // becomes R3->B2->Y2->B1->G2.
     // The original run was 3 long. The insertion run was 1 long. We need 1 more for the
     // fact that an existing piece of the run was split in half (to hold the latter half).
-    const size_t cNewRun = _list.size() + newAttrs.size() + 1;
-    std::vector<TextAttributeRun> newRun;
+    const size_t cNewRun = _list.size() + insertAttrs.size() + 1;
+    std::vector<InternedAttributeRun> newRun;
     newRun.resize(cNewRun);
 
     // We will start analyzing from the beginning of our existing run.
@@ -337,8 +373,8 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
     const auto existingRun = _list.begin();
     auto pExistingRunPos = existingRun;
     const auto pExistingRunEnd = existingRun + _list.size();
-    auto pInsertRunPos = newAttrs.begin();
-    size_t cInsertRunRemaining = newAttrs.size();
+    auto pInsertRunPos = insertAttrs.begin();
+    size_t cInsertRunRemaining = insertAttrs.size();
     auto pNewRunPos = newRun.begin();
     size_t iExistingRunCoverage = 0;
 
@@ -392,7 +428,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // Now we're still on that "last cell copied" into the new run.
         // If the color of that existing copied cell matches the color of the first segment
         // of the run we're about to insert, we can just increment the length to extend the coverage.
-        if (pNewRunPos->GetAttributes() == pInsertRunPos->GetAttributes())
+        if (pNewRunPos->GetAttributeId() == pInsertRunPos->GetAttributeId())
         {
             length += pInsertRunPos->GetLength();
 
@@ -457,7 +493,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
             // This case is slightly off from the example above. This case is for if the B2 above was actually Y2.
             // That Y2 from the existing run is the same color as the Y2 we just filled a few columns left in the final run
             // so we can just adjust the final run's column count instead of adding another segment here.
-            if (pNewRunPos->GetAttributes() == pExistingRunPos->GetAttributes())
+            if (pNewRunPos->GetAttributeId() == pExistingRunPos->GetAttributeId())
             {
                 size_t length = pNewRunPos->GetLength();
                 length += (iExistingRunCoverage - (iEnd + 1));
@@ -472,7 +508,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
                 pNewRunPos++;
 
                 // Copy the existing run's color information to the new run
-                pNewRunPos->SetAttributes(pExistingRunPos->GetAttributes());
+                pNewRunPos->SetAttributeId(pExistingRunPos->GetAttributeId());
 
                 // Adjust the length of that copied color to cover only the reduced number of columns needed
                 // now that some have been replaced by the insert run.
@@ -494,7 +530,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
         // New Run desired when done = R3 -> B7
         // Existing run pointer is on B2.
         // We want to merge the 2 from the B2 into the B5 so we get B7.
-        else if (pNewRunPos->GetAttributes() == pExistingRunPos->GetAttributes())
+        else if (pNewRunPos->GetAttributeId() == pExistingRunPos->GetAttributeId())
         {
             // Add the value from the existing run into the current new run position.
             size_t length = pNewRunPos->GetLength();
@@ -523,6 +559,7 @@ HRESULT ATTR_ROW::InsertAttrRuns(const std::basic_string_view<TextAttributeRun>
 
     newRun.erase(pNewRunPos, newRun.end());
     _list.swap(newRun);
+    _UpdateRunEnds();
 
     return S_OK;
 }
@@ -555,6 +592,66 @@ std::vector<TextAttributeRun> ATTR_ROW::PackAttrs(const std::vector<TextAttribut
     return runs;
 }
 
+// Routine Description:
+// - gets the attribute runs of this row, with the attributes themselves
+//      instead of their IDs.
+// Return Value:
+// - the runs, covering the whole row
+// Note: will throw exception if unable to allocate the runs
+std::vector<TextAttributeRun> ATTR_ROW::GetRuns() const
+{
+    std::vector<TextAttributeRun> runs;
+    runs.reserve(_list.size());
+    for (const auto& run : _list)
+    {
+        runs.emplace_back(run.GetLength(), _pAttributeTable->Get(run.GetAttributeId()));
+    }
+    return runs;
+}
+
+// Routine Description:
+// - Marks the IDs of the attributes this row uses, so that the text buffer
+//      can release the ones that no row uses anymore.
+// Arguments:
+// - used - indexed by attribute ID, with room for every ID of the row's table
+// Return Value:
+// - <none>
+void ATTR_ROW::MarkUsedAttributes(std::vector<bool>& used) const
+{
+    for (const auto& run : _list)
+    {
+        used.at(run.GetAttributeId()) = true;
+    }
+}
+
+// Routine Description:
+// - Recalculates the column that each run ends at. Call this after changing
+//      the runs, so that finding the run for a column stays a binary search.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void ATTR_ROW::_UpdateRunEnds() noexcept
+{
+    size_t endColumn = 0;
+    for (auto& run : _list)
+    {
+        endColumn += run.GetLength();
+        run.SetEndColumn(endColumn);
+    }
+}
+
+// Routine Description:
+// - Converts a run of attributes into a run of this row's attribute IDs.
+// Arguments:
+// - run - the run to convert
+// Return Value:
+// - the same run, with its attributes interned in this row's table
+InternedAttributeRun ATTR_ROW::_Intern(const TextAttributeRun& run) const
+{
+    return InternedAttributeRun(run.GetLength(), _pAttributeTable->Intern(run.GetAttributes()));
+}
+
 ATTR_ROW::const_iterator ATTR_ROW::begin() const noexcept
 {
     return AttrRowIterator(this);
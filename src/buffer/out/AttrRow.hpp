@@ -28,7 +28,7 @@ class ATTR_ROW final
 public:
     using const_iterator = typename AttrRowIterator;
 
-    ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr);
+    ATTR_ROW(const UINT cchRowWidth, const TextAttribute attr, TextAttributeTable& attributeTable);
 
     void Reset(const TextAttribute attr);
 
@@ -55,6 +55,10 @@ public:
 
     static std::vector<TextAttributeRun> PackAttrs(const std::vector<TextAttribute>& attrs);
 
+    std::vector<TextAttributeRun> GetRuns() const;
+
+    void MarkUsedAttributes(std::vector<bool>& used) const;
+
     const_iterator begin() const noexcept;
     const_iterator end() const noexcept;
 
@@ -66,8 +70,12 @@ public:
 
 private:
 
-    std::vector<TextAttributeRun> _list;
+    std::vector<InternedAttributeRun> _list;
     size_t _cchRowWidth;
+    TextAttributeTable* _pAttributeTable; // non ownership pointer
+
+    InternedAttributeRun _Intern(const TextAttributeRun& run) const;
+    void _UpdateRunEnds() noexcept;
 
 #ifdef UNIT_TESTING
     friend class AttrRowTests;
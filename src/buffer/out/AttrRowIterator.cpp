@@ -84,12 +84,33 @@ AttrRowIterator AttrRowIterator::operator--(int)
 
 const TextAttribute* AttrRowIterator::operator->() const
 {
-    return &_run->GetAttributes();
+    return &_pAttrRow->_pAttributeTable->Get(_run->GetAttributeId());
 }
 
 const TextAttribute& AttrRowIterator::operator*() const
 {
-    return _run->GetAttributes();
+    return _pAttrRow->_pAttributeTable->Get(_run->GetAttributeId());
+}
+
+// Routine Description:
+// - counts how many attributes are left in the current run, including the one
+//      the iterator points to
+// Return Value:
+// - the number of attributes until the next run starts
+size_t AttrRowIterator::GetRunRemaining() const
+{
+    return _run->GetLength() - _currentAttributeIndex;
+}
+
+// Routine Description:
+// - gets the ID the attribute the iterator points to has in the text buffer's
+//      attribute table. Two attributes of the same row are equal if and only
+//      if their IDs are.
+// Return Value:
+// - the ID of the current attribute
+TextAttributeTable::id_type AttrRowIterator::GetAttributeId() const
+{
+    return _run->GetAttributeId();
 }
 
 // Routine Description:
@@ -98,21 +119,7 @@ const TextAttribute& AttrRowIterator::operator*() const
 // - count - the amount to increment by
 void AttrRowIterator::_increment(size_t count)
 {
-    while (count > 0)
-    {
-        const size_t runLength = _run->GetLength();
-        if (count + _currentAttributeIndex < runLength)
-        {
-            _currentAttributeIndex += count;
-            return;
-        }
-        else
-        {
-            count -= runLength - _currentAttributeIndex;
-            ++_run;
-            _currentAttributeIndex = 0;
-        }
-    }
+    _moveToColumn(_getColumn() + count);
 }
 
 // Routine Description:
@@ -121,20 +128,60 @@ void AttrRowIterator::_increment(size_t count)
 // - count - the amount to decrement by
 void AttrRowIterator::_decrement(size_t count)
 {
-    while (count > 0)
+    _moveToColumn(_getColumn() - count);
+}
+
+// Routine Description:
+// - gets the column of the row the iterator points to
+// Return Value:
+// - the column, or the width of the row for the end iterator
+size_t AttrRowIterator::_getColumn() const noexcept
+{
+    if (_run == _pAttrRow->_list.cend())
     {
-        if (count <= _currentAttributeIndex)
-        {
-            _currentAttributeIndex -= count;
-            return;
-        }
-        else
-        {
-            count -= _currentAttributeIndex;
-            --_run;
-            _currentAttributeIndex = _run->GetLength() - 1;
-        }
+        return _pAttrRow->_cchRowWidth;
     }
+    return _run->GetEndColumn() - _run->GetLength() + _currentAttributeIndex;
+}
+
+// Routine Description:
+// - moves the iterator to the given column of the row
+// - Walking a row one cell at a time only ever moves within a run or onto one
+//      of its neighbors, which is checked first. Anything further away is
+//      found with a binary search over the runs.
+// Arguments:
+// - column - the column to point to. The width of the row or more gives the end iterator.
+void AttrRowIterator::_moveToColumn(const size_t column)
+{
+    const auto& list = _pAttrRow->_list;
+    if (column >= _pAttrRow->_cchRowWidth)
+    {
+        _setToEnd();
+        return;
+    }
+
+    const auto covers = [column](const std::vector<InternedAttributeRun>::const_iterator run) noexcept {
+        return column >= run->GetEndColumn() - run->GetLength() && column < run->GetEndColumn();
+    };
+
+    if (_run != list.cend() && covers(_run))
+    {
+        // We're staying in the same run.
+    }
+    else if (_run != list.cend() && _run + 1 != list.cend() && covers(_run + 1))
+    {
+        ++_run;
+    }
+    else if (_run != list.cbegin() && covers(_run - 1))
+    {
+        --_run;
+    }
+    else
+    {
+        _run = list.cbegin() + _pAttrRow->FindAttrIndex(column, nullptr);
+    }
+
+    _currentAttributeIndex = column - (_run->GetEndColumn() - _run->GetLength());
 }
 
 // Routine Description:
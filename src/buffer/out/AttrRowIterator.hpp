@@ -51,12 +51,17 @@ public:
     const TextAttribute* operator->() const;
     const TextAttribute& operator*() const;
 
+    size_t GetRunRemaining() const;
+    TextAttributeTable::id_type GetAttributeId() const;
+
 private:
-    std::vector<TextAttributeRun>::const_iterator _run;
+    std::vector<InternedAttributeRun>::const_iterator _run;
     const ATTR_ROW* _pAttrRow;
     size_t _currentAttributeIndex; // index of TextAttribute within the current TextAttributeRun
     
     void _increment(size_t count);
     void _decrement(size_t count);
+    size_t _getColumn() const noexcept;
+    void _moveToColumn(const size_t column);
     void _setToEnd();
 };
@@ -7,6 +7,27 @@
 #include "unicode.hpp"
 #include "Row.hpp"
 
+#include <array>
+
+// Every ASCII char, so that a cell in an ASCII row can be viewed as a wchar_t
+// glyph without storing one.
+static constexpr std::array<wchar_t, 0x80> s_MakeAsciiGlyphs() noexcept
+{
+    std::array<wchar_t, 0x80> glyphs{};
+    for (size_t i = 0; i < glyphs.size(); ++i)
+    {
+        glyphs[i] = static_cast<wchar_t>(i);
+    }
+    return glyphs;
+}
+
+static constexpr std::array<wchar_t, 0x80> s_asciiGlyphs = s_MakeAsciiGlyphs();
+
+// The attribute of every cell in an ASCII row.
+static const DbcsAttribute s_asciiDbcsAttr{};
+
+static constexpr char s_asciiSpace = static_cast<char>(UNICODE_SPACE);
+
 // Routine Description:
 // - constructor
 // Arguments:
@@ -18,11 +39,33 @@
 CharRow::CharRow(size_t rowWidth, ROW* const pParent) :
     _wrapForced{ false },
     _doubleBytePadded{ false },
-    _data(rowWidth, value_type()),
+    _isAscii{ true },
+    _asciiData(rowWidth, s_asciiSpace),
+    _data{},
     _pParent{ FAIL_FAST_IF_NULL(pParent) }
 {
 }
 
+// Routine Description:
+// - Tells you whether this row is still stored at one byte per cell
+// Return Value:
+// - True if every cell in the row is a single width ASCII char. False if the
+//   row has been upgraded to a full CharRowCell per cell.
+bool CharRow::IsAscii() const noexcept
+{
+    return _isAscii;
+}
+
+// Routine Description:
+// - gets the one byte per cell text of an ASCII row, which has exactly one
+//   char per column
+// Return Value:
+// - the text of the row, or an empty view if the row isn't ASCII only
+std::string_view CharRow::GetAsciiText() const noexcept
+{
+    return _isAscii ? std::string_view{ _asciiData.data(), _asciiData.size() } : std::string_view{};
+}
+
 // Routine Description:
 // - Sets the wrap status for the current row
 // Arguments:
@@ -75,21 +118,30 @@ bool CharRow::WasDoubleBytePadded() const noexcept
 // - the size of the row
 size_t CharRow::size() const noexcept
 {
-    return _data.size();
+    return _isAscii ? _asciiData.size() : _data.size();
 }
 
 // Routine Description:
 // - Sets all properties of the CharRowBase to default values
+// - An upgraded row goes back to being an ASCII row, since it's blank again,
+//   and frees its cells so it only takes a byte per cell again.
 // Arguments:
 // - sRowWidth - The width of the row.
 // Return Value:
 // - <none>
 void CharRow::Reset()
 {
-    for (auto& cell : _data)
+    if (_isAscii)
+    {
+        std::fill(_asciiData.begin(), _asciiData.end(), s_asciiSpace);
+    }
+    else
     {
-        cell.Reset();
+        _asciiData.assign(_data.size(), s_asciiSpace);
+        std::vector<value_type>{}.swap(_data);
+        _isAscii = true;
     }
+    GetUnicodeStorage().Clear();
 
     _wrapForced = false;
     _doubleBytePadded = false;
@@ -106,34 +158,35 @@ HRESULT CharRow::Resize(const size_t newSize) noexcept
 {
     try
     {
-        const value_type insertVals;
-        _data.resize(newSize, insertVals);
+        if (_isAscii)
+        {
+            _asciiData.resize(newSize, s_asciiSpace);
+        }
+        else
+        {
+            const value_type insertVals;
+            _data.resize(newSize, insertVals);
+        }
     }
     CATCH_RETURN();
 
+    GetUnicodeStorage().Resize(newSize);
+
     return S_OK;
 }
 
-typename CharRow::iterator CharRow::begin() noexcept
+typename CharRow::iterator CharRow::begin()
 {
+    _Upgrade();
     return _data.begin();
 }
 
-typename CharRow::const_iterator CharRow::cbegin() const noexcept
-{
-    return _data.cbegin();
-}
-
-typename CharRow::iterator CharRow::end() noexcept
+typename CharRow::iterator CharRow::end()
 {
+    _Upgrade();
     return _data.end();
 }
 
-typename CharRow::const_iterator CharRow::cend() const noexcept
-{
-    return _data.cend();
-}
-
 // Routine Description:
 // - Inspects the current internal string to find the left edge of it
 // Arguments:
@@ -142,6 +195,12 @@ typename CharRow::const_iterator CharRow::cend() const noexcept
 // - The calculated left boundary of the internal string.
 size_t CharRow::MeasureLeft() const
 {
+    if (_isAscii)
+    {
+        const auto it = std::find_if(_asciiData.cbegin(), _asciiData.cend(), [](const char ch) noexcept { return ch != s_asciiSpace; });
+        return it - _asciiData.cbegin();
+    }
+
     std::vector<value_type>::const_iterator it = _data.cbegin();
     while (it != _data.cend() && it->IsSpace())
     {
@@ -158,6 +217,12 @@ size_t CharRow::MeasureLeft() const
 // - The calculated right boundary of the internal string.
 size_t CharRow::MeasureRight() const noexcept
 {
+    if (_isAscii)
+    {
+        const auto it = std::find_if(_asciiData.crbegin(), _asciiData.crend(), [](const char ch) noexcept { return ch != s_asciiSpace; });
+        return _asciiData.crend() - it;
+    }
+
     std::vector<value_type>::const_reverse_iterator it = _data.crbegin();
     while (it != _data.crend() && it->IsSpace())
     {
@@ -168,7 +233,18 @@ size_t CharRow::MeasureRight() const noexcept
 
 void CharRow::ClearCell(const size_t column)
 {
-    _data.at(column).Reset();
+    if (_isAscii)
+    {
+        _asciiData.at(column) = s_asciiSpace;
+        return;
+    }
+
+    auto& cell = _data.at(column);
+    if (cell.DbcsAttr().IsGlyphStored())
+    {
+        GetUnicodeStorage().Erase(column);
+    }
+    cell.Reset();
 }
 
 // Routine Description:
@@ -179,6 +255,11 @@ void CharRow::ClearCell(const size_t column)
 // - True if there is valid text in this row. False otherwise.
 bool CharRow::ContainsText() const noexcept
 {
+    if (_isAscii)
+    {
+        return std::any_of(_asciiData.cbegin(), _asciiData.cend(), [](const char ch) noexcept { return ch != s_asciiSpace; });
+    }
+
     for (const value_type& cell : _data)
     {
         if (!cell.IsSpace())
@@ -198,11 +279,18 @@ bool CharRow::ContainsText() const noexcept
 // Note: will throw exception if column is out of bounds
 const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 {
+    if (_isAscii)
+    {
+        THROW_HR_IF(E_INVALIDARG, column >= _asciiData.size());
+        return s_asciiDbcsAttr;
+    }
     return _data.at(column).DbcsAttr();
 }
 
 // Routine Description:
-// - gets the attribute at the specified column
+// - gets the attribute at the specified column, so that it can be changed.
+// - This upgrades an ASCII row. Use SetDbcsAttrAt to avoid that when the
+//   attribute might stay single width.
 // Arguments:
 // - column - the column to get the attribute for
 // Return Value:
@@ -210,7 +298,34 @@ const DbcsAttribute& CharRow::DbcsAttrAt(const size_t column) const
 // Note: will throw exception if column is out of bounds
 DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 {
-    return const_cast<DbcsAttribute&>(static_cast<const CharRow* const>(this)->DbcsAttrAt(column));
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    _Upgrade();
+    return _data.at(column).DbcsAttr();
+}
+
+// Routine Description:
+// - sets the leading/trailing attribute at the specified column. Whether the
+//   cell's glyph is in UnicodeStorage is tracked by the row itself, and isn't
+//   changed by this.
+// Arguments:
+// - column - the column to set the attribute for
+// - attr - the new attribute
+// Return Value:
+// - <none>
+// Note: will throw exception if column is out of bounds
+void CharRow::SetDbcsAttrAt(const size_t column, const DbcsAttribute attr)
+{
+    THROW_HR_IF(E_INVALIDARG, column >= size());
+    if (_isAscii && attr.IsSingle())
+    {
+        return;
+    }
+
+    _Upgrade();
+    auto& dbcsAttr = _data.at(column).DbcsAttr();
+    const bool glyphStored = dbcsAttr.IsGlyphStored();
+    dbcsAttr = attr;
+    dbcsAttr.SetGlyphStored(glyphStored);
 }
 
 // Routine Description:
@@ -222,7 +337,18 @@ DbcsAttribute& CharRow::DbcsAttrAt(const size_t column)
 // Note: will throw exception if column is out of bounds
 void CharRow::ClearGlyph(const size_t column)
 {
-    _data.at(column).EraseChars();
+    if (_isAscii)
+    {
+        _asciiData.at(column) = s_asciiSpace;
+        return;
+    }
+
+    auto& cell = _data.at(column);
+    if (cell.DbcsAttr().IsGlyphStored())
+    {
+        GetUnicodeStorage().Erase(column);
+    }
+    cell.EraseChars();
 }
 
 // Routine Description:
@@ -234,7 +360,7 @@ void CharRow::ClearGlyph(const size_t column)
 // - Note: will throw exception if column is out of bounds
 const CharRow::reference CharRow::GlyphAt(const size_t column) const
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= size());
     return { const_cast<CharRow&>(*this), column };
 }
 
@@ -247,7 +373,7 @@ const CharRow::reference CharRow::GlyphAt(const size_t column) const
 // - Note: will throw exception if column is out of bounds
 CharRow::reference CharRow::GlyphAt(const size_t column)
 {
-    THROW_HR_IF(E_INVALIDARG, column >= _data.size());
+    THROW_HR_IF(E_INVALIDARG, column >= size());
     return { *this, column };
 }
 
@@ -261,6 +387,11 @@ CharRow::reference CharRow::GlyphAt(const size_t column)
 // - Note: will throw exception if out of memory
 std::wstring CharRow::GetTextRaw() const
 {
+    if (_isAscii)
+    {
+        return { _asciiData.cbegin(), _asciiData.cend() };
+    }
+
     std::wstring wstr;
     wstr.reserve(_data.size());
     for (size_t i = 0;  i < _data.size(); ++i)
@@ -276,6 +407,11 @@ std::wstring CharRow::GetTextRaw() const
 
 std::wstring CharRow::GetText() const
 {
+    if (_isAscii)
+    {
+        return { _asciiData.cbegin(), _asciiData.cend() };
+    }
+
     std::wstring wstr;
     wstr.reserve(_data.size());
 
@@ -304,21 +440,83 @@ const UnicodeStorage& CharRow::GetUnicodeStorage() const
 }
 
 // Routine Description:
-// - calculates the key used by the given column of the char row to store glyph data in UnicodeStorage
+// - Updates the pointer to the parent row (which might change if we shuffle the rows around)
+// Arguments:
+// - pParent - Pointer to the parent row
+void CharRow::UpdateParent(ROW* const pParent) noexcept
+{
+    _pParent = FAIL_FAST_IF_NULL(pParent);
+}
+
+// Routine Description:
+// - Switches an ASCII row over to storing a full CharRowCell per cell, so that
+//   anything can be written to it. Does nothing if the row was already upgraded.
+// Return Value:
+// - <none>
+// Note: will throw exception if unable to allocate the cells. The row is left
+//   unchanged if so.
+void CharRow::_Upgrade()
+{
+    if (!_isAscii)
+    {
+        return;
+    }
+
+    // Only one of the buffers holds on to memory at a time, so an upgraded
+    //      row costs no more than a row did before there were ASCII rows.
+    std::vector<value_type> data;
+    data.reserve(_asciiData.size());
+    for (const auto ch : _asciiData)
+    {
+        data.emplace_back(static_cast<wchar_t>(ch), DbcsAttribute{});
+    }
+
+    _data.swap(data);
+    std::vector<char>{}.swap(_asciiData);
+    _isAscii = false;
+}
+
+// Routine Description:
+// - views the char in a cell of an ASCII row as a glyph
 // Arguments:
-// - column - the column to generate the key for
+// - column - the column to get the glyph for
 // Return Value:
-// - the COORD key for data access from UnicodeStorage for the column
-COORD CharRow::GetStorageKey(const size_t column) const
+// - the glyph, which stays valid for the life of the program
+// Note: will throw exception if column is out of bounds
+std::wstring_view CharRow::_AsciiGlyphAt(const size_t column) const
 {
-    return { gsl::narrow<SHORT>(column), _pParent->GetId() };
+    const auto ch = static_cast<unsigned char>(_asciiData.at(column));
+    return { &s_asciiGlyphs.at(ch), 1 };
 }
 
 // Routine Description:
-// - Updates the pointer to the parent row (which might change if we shuffle the rows around)
+// - compares two rows by their contents, no matter how each of them is stored
 // Arguments:
-// - pParent - Pointer to the parent row
-void CharRow::UpdateParent(ROW* const pParent) noexcept
+// - a - the first row
+// - b - the second row
+// Return Value:
+// - true if the rows hold the same cells and flags
+bool operator==(const CharRow& a, const CharRow& b) noexcept
 {
-    _pParent = FAIL_FAST_IF_NULL(pParent);
+    if (a._wrapForced != b._wrapForced ||
+        a._doubleBytePadded != b._doubleBytePadded ||
+        a.size() != b.size())
+    {
+        return false;
+    }
+
+    if (a._isAscii == b._isAscii)
+    {
+        return a._isAscii ? a._asciiData == b._asciiData : a._data == b._data;
+    }
+
+    // An upgraded row can still hold only single width ASCII chars.
+    const auto& ascii = a._isAscii ? a : b;
+    const auto& upgraded = a._isAscii ? b : a;
+    return std::equal(ascii._asciiData.cbegin(),
+                      ascii._asciiData.cend(),
+                      upgraded._data.cbegin(),
+                      [](const char ch, const CharRow::value_type& cell) noexcept {
+                          return cell.Char() == static_cast<wchar_t>(ch) && cell.DbcsAttr() == s_asciiDbcsAttr;
+                      });
 }
@@ -7,6 +7,9 @@ Module Name:
 
 Abstract:
 - contains data structure for UCS2 encoded character data of a row
+- Rows that only hold single width ASCII chars are kept at one byte per cell,
+    and are upgraded to a full CharRowCell per cell the first time anything else
+    is written to them.
 
 Author(s):
 - Michael Niksa (miniksa) 10-Apr-2014
@@ -48,6 +51,8 @@ public:
 
     CharRow(size_t rowWidth, ROW* const pParent);
 
+    bool IsAscii() const noexcept;
+    std::string_view GetAsciiText() const noexcept;
     void SetWrapForced(const bool wrap) noexcept;
     bool WasWrapForced() const noexcept;
     void SetDoubleBytePadded(const bool doubleBytePadded) noexcept;
@@ -62,6 +67,7 @@ public:
     bool ContainsText() const noexcept;
     const DbcsAttribute& DbcsAttrAt(const size_t column) const;
     DbcsAttribute& DbcsAttrAt(const size_t column);
+    void SetDbcsAttrAt(const size_t column, const DbcsAttribute attr);
     void ClearGlyph(const size_t column);
     std::wstring GetText() const;
 
@@ -72,21 +78,17 @@ public:
     const reference GlyphAt(const size_t column) const;
     reference GlyphAt(const size_t column);
 
-    // iterators
-    iterator begin() noexcept;
-    const_iterator cbegin() const noexcept;
-
-    iterator end() noexcept;
-    const_iterator cend() const noexcept;
+    // iterators. these upgrade an ASCII row, since they hand out the cells themselves.
+    iterator begin();
+    iterator end();
 
     UnicodeStorage& GetUnicodeStorage();
     const UnicodeStorage& GetUnicodeStorage() const;
-    COORD GetStorageKey(const size_t column) const;
 
     void UpdateParent(ROW* const pParent) noexcept;
 
     friend CharRowCellReference;
-    friend constexpr bool operator==(const CharRow& a, const CharRow& b) noexcept;
+    friend bool operator==(const CharRow& a, const CharRow& b) noexcept;
 
 protected:
     // Occurs when the user runs out of text in a given row and we're forced to wrap the cursor to the next line
@@ -95,19 +97,33 @@ protected:
     // Occurs when the user runs out of text to support a double byte character and we're forced to the next line
     bool _doubleBytePadded;
 
-    // storage for glyph data and dbcs attributes
+    // True while every cell is a single width ASCII char, stored in _asciiData.
+    // Otherwise the cells are in _data.
+    bool _isAscii;
+
+    // one byte per cell, while the row is ASCII only
+    std::vector<char> _asciiData;
+
+    // storage for glyph data and dbcs attributes, once the row isn't ASCII only
     std::vector<value_type> _data;
 
     // ROW that this CharRow belongs to
     ROW* _pParent;
+
+    void _Upgrade();
+    std::wstring_view _AsciiGlyphAt(const size_t column) const;
+
+    static constexpr bool s_IsAscii(const wchar_t wch) noexcept
+    {
+        return wch < 0x80;
+    }
+
+#ifdef UNIT_TESTING
+    friend class TextBufferTests;
+#endif
 };
 
-constexpr bool operator==(const CharRow& a, const CharRow& b) noexcept
-{
-    return (a._wrapForced == b._wrapForced &&
-            a._doubleBytePadded == b._doubleBytePadded &&
-            a._data == b._data);
-}
+bool operator==(const CharRow& a, const CharRow& b) noexcept;
 
 template<typename InputIt1, typename InputIt2>
 void OverwriteColumns(InputIt1 startChars, InputIt1 endChars, InputIt2 startAttrs, CharRow::iterator outIt)
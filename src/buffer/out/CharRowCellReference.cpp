@@ -13,16 +13,25 @@
 void CharRowCellReference::operator=(const std::wstring_view chars)
 {
     THROW_HR_IF(E_INVALIDARG, chars.empty());
+    if (_parent._isAscii && chars.size() == 1 && CharRow::s_IsAscii(chars.front()))
+    {
+        _parent._asciiData.at(_index) = static_cast<char>(chars.front());
+        return;
+    }
+
+    _parent._Upgrade();
     if (chars.size() == 1)
     {
+        if (_cellData().DbcsAttr().IsGlyphStored())
+        {
+            _parent.GetUnicodeStorage().Erase(_index);
+            _cellData().DbcsAttr().SetGlyphStored(false);
+        }
         _cellData().Char() = chars.front();
-        _cellData().DbcsAttr().SetGlyphStored(false);
     }
     else
     {
-        auto& storage = _parent.GetUnicodeStorage();
-        const auto key = _parent.GetStorageKey(_index);
-        storage.StoreGlyph(key, { chars.cbegin(), chars.cend() });
+        _parent.GetUnicodeStorage().StoreGlyph(_index, chars);
         _cellData().DbcsAttr().SetGlyphStored(true);
     }
 }
@@ -60,9 +69,13 @@ const CharRowCell& CharRowCellReference::_cellData() const
 // - the glyph data
 std::wstring_view CharRowCellReference::_glyphData() const
 {
-    if (_cellData().DbcsAttr().IsGlyphStored())
+    if (_parent._isAscii)
     {
-        const auto& text = _parent.GetUnicodeStorage().GetText(_parent.GetStorageKey(_index));
+        return _parent._AsciiGlyphAt(_index);
+    }
+    else if (_cellData().DbcsAttr().IsGlyphStored())
+    {
+        const auto& text = _parent.GetUnicodeStorage().GetText(_index);
 
         return { text.data(), text.size() };
     }
@@ -78,14 +91,7 @@ std::wstring_view CharRowCellReference::_glyphData() const
 // - iterator of the glyph data
 CharRowCellReference::const_iterator CharRowCellReference::begin() const
 {
-    if (_cellData().DbcsAttr().IsGlyphStored())
-    {
-        return _parent.GetUnicodeStorage().GetText(_parent.GetStorageKey(_index)).data();
-    }
-    else
-    {
-        return &_cellData().Char();
-    }
+    return _glyphData().data();
 }
 
 // Routine Description:
@@ -94,38 +100,16 @@ CharRowCellReference::const_iterator CharRowCellReference::begin() const
 // - end iterator of the glyph data
 CharRowCellReference::const_iterator CharRowCellReference::end() const
 {
-    if (_cellData().DbcsAttr().IsGlyphStored())
-    {
-
-        const auto& chars = _parent.GetUnicodeStorage().GetText(_parent.GetStorageKey(_index));
-        return chars.data() + chars.size();
-    }
-    else
-    {
-        return &_cellData().Char() + 1;
-    }
+    const auto glyph = _glyphData();
+    return glyph.data() + glyph.size();
 }
 
 bool operator==(const CharRowCellReference& ref, const std::vector<wchar_t>& glyph)
 {
-    const DbcsAttribute& dbcsAttr = ref._cellData().DbcsAttr();
-    if (glyph.size() == 1 && dbcsAttr.IsGlyphStored())
-    {
-        return false;
-    }
-    else if (glyph.size() > 1 && !dbcsAttr.IsGlyphStored())
-    {
-        return false;
-    }
-    else if (glyph.size() == 1 && !dbcsAttr.IsGlyphStored())
-    {
-        return ref._cellData().Char() == glyph.front();
-    }
-    else
-    {
-        const auto& chars = ref._parent.GetUnicodeStorage().GetText(ref._parent.GetStorageKey(ref._index));
-        return chars == glyph;
-    }
+    // Stored glyphs are always longer than one char, so comparing the text
+    // also compares whether the glyph is stored.
+    const auto chars = ref._glyphData();
+    return chars.size() == glyph.size() && std::equal(chars.cbegin(), chars.cend(), glyph.cbegin());
 }
 
 bool operator==(const std::vector<wchar_t>& glyph, const CharRowCellReference& ref)
@@ -20,7 +20,8 @@ ROW::ROW(const SHORT rowId, const short rowWidth, const TextAttribute fillAttrib
     _id{ rowId },
     _rowWidth{ gsl::narrow<size_t>(rowWidth) },
     _charRow{ gsl::narrow<size_t>(rowWidth), this },
-    _attrRow{ gsl::narrow<UINT>(rowWidth), fillAttribute },
+    _unicodeStorage{},
+    _attrRow{ gsl::narrow<UINT>(rowWidth), fillAttribute, pParent->GetAttributeTable() },
     _pParent{ pParent }
 {
 }
@@ -135,12 +136,12 @@ RowCellIterator ROW::AsCellIter(const size_t startIndex, const size_t count) con
 
 UnicodeStorage& ROW::GetUnicodeStorage()
 {
-    return _pParent->GetUnicodeStorage();
+    return _unicodeStorage;
 }
 
 const UnicodeStorage& ROW::GetUnicodeStorage() const
 {
-    return _pParent->GetUnicodeStorage();
+    return _unicodeStorage;
 }
 
 // Routine Description:
@@ -161,16 +162,43 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
     // If we're given a right-side column limit, use it. Otherwise, the write limit is the final column index available in the char row.
     const auto finalColumnInRow = limitRight.value_or(_charRow.size() - 1);
 
+    // Consecutive cells that carry the same color are gathered up into a single run
+    // and merged into the attribute row once, instead of once per cell.
+    // Long runs of printed text usually share one color, so this turns a row's worth of
+    // run insertions into just one.
+    size_t attrRunStart = currentIndex;
+    TextAttributeRun attrRun;
+    const auto flushAttrRun = [&]()
+    {
+        if (attrRun.GetLength() > 0)
+        {
+            LOG_IF_FAILED(_attrRow.InsertAttrRuns({ &attrRun, 1 },
+                                                  attrRunStart,
+                                                  attrRunStart + attrRun.GetLength() - 1,
+                                                  _charRow.size()));
+            attrRun.SetLength(0);
+        }
+    };
+
     while (it && currentIndex <= finalColumnInRow)
     {
         // Fill the color if the behavior isn't set to keeping the current color.
         if (it->TextAttrBehavior() != TextAttributeBehavior::Current)
         {
-            const TextAttributeRun attrRun{ 1, it->TextAttr() };
-            LOG_IF_FAILED(_attrRow.InsertAttrRuns({ &attrRun, 1 },
-                                                  currentIndex,
-                                                  currentIndex,
-                                                  _charRow.size()));
+            const auto& attr = it->TextAttr();
+            if (attrRun.GetLength() > 0 &&
+                attrRunStart + attrRun.GetLength() == currentIndex &&
+                attrRun.GetAttributes() == attr)
+            {
+                attrRun.IncrementLength();
+            }
+            else
+            {
+                flushAttrRun();
+                attrRunStart = currentIndex;
+                attrRun.SetAttributes(attr);
+                attrRun.SetLength(1);
+            }
         }
 
         // Fill the text if the behavior isn't set to saying there's only a color stored in this iterator.
@@ -198,7 +226,7 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
             // Otherwise, copy the data given and increment the iterator.
             else
             {
-                _charRow.DbcsAttrAt(currentIndex) = it->DbcsAttr();
+                _charRow.SetDbcsAttrAt(currentIndex, it->DbcsAttr());
                 _charRow.GlyphAt(currentIndex) = it->Chars();
                 ++it;
             }
@@ -218,5 +246,8 @@ OutputCellIterator ROW::WriteCells(OutputCellIterator it, const size_t index, co
         ++currentIndex;
     }
 
+    // Apply whatever color run is still pending from the final cells written.
+    flushAttrRun();
+
     return it;
 }
@@ -68,6 +68,8 @@ public:
 
 private:
     CharRow _charRow;
+    // glyphs in this row that don't fit in a single CharRowCell, by column
+    UnicodeStorage _unicodeStorage;
     ATTR_ROW _attrRow;
     SHORT _id;
     size_t _rowWidth;
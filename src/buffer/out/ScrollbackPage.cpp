@@ -0,0 +1,544 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ScrollbackPage.hpp"
+#include "TextAttributeTable.hpp"
+
+// The shortest copy of earlier text that the compressor will use.
+static constexpr size_t s_minMatch = 4;
+
+// The compressor remembers where it last saw each of 2^12 hashes of s_minMatch chars.
+static constexpr size_t s_hashBits = 12;
+
+// Routine Description:
+// - writes a number in as few bytes as it takes, 7 bits at a time
+// Arguments:
+// - data - where to write the number
+// - value - the number
+static void s_WriteVarint(std::vector<BYTE>& data, size_t value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back(static_cast<BYTE>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<BYTE>(value));
+}
+
+// Routine Description:
+// - gets how many bytes s_WriteVarint writes a number in
+static size_t s_VarintSize(size_t value) noexcept
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// Routine Description:
+// - reads a number written by s_WriteVarint
+// Arguments:
+// - it - where to read from. Moved past the number on return.
+// - end - the end of the data
+// Return Value:
+// - the number
+// Note: will throw exception if the data ends in the middle of the number
+static size_t s_ReadVarint(const BYTE*& it, const BYTE* const end)
+{
+    size_t value = 0;
+    for (unsigned int shift = 0;; shift += 7)
+    {
+        THROW_HR_IF(E_UNEXPECTED, it == end || shift >= sizeof(size_t) * CHAR_BIT);
+        const auto byte = *it++;
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
+
+// Routine Description:
+// - hashes the s_minMatch chars at the start of the given text
+static size_t s_HashText(const wchar_t* const text) noexcept
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < s_minMatch; ++i)
+    {
+        value = value * 31 + text[i];
+    }
+    return (value * 2654435761u) >> (32 - s_hashBits);
+}
+
+ScrollbackPage::ScrollbackPage() :
+    _lines{},
+    _compression{},
+    _size{ 0 },
+    _attributes{},
+    _lineData{},
+    _textData{},
+    _compressed{ false },
+    _spillFile{ nullptr },
+    _spillRecord{}
+{
+}
+
+// Routine Description:
+// - gets how many lines are in the page, including any that were evicted
+// Return Value:
+// - the number of lines
+size_t ScrollbackPage::size() const noexcept
+{
+    return _size;
+}
+
+// Routine Description:
+// - tells you whether the page has room for another line
+// Return Value:
+// - true if the page is full
+bool ScrollbackPage::IsFull() const noexcept
+{
+    return _size == Capacity;
+}
+
+// Routine Description:
+// - tells you whether the page is being compressed, which it isn't anymore
+//   once FinishCompressing has put the compressed data in place
+// Return Value:
+// - true if the page is being compressed
+bool ScrollbackPage::IsCompressing() const noexcept
+{
+    return _compression != nullptr;
+}
+
+// Routine Description:
+// - tells you whether the page has been compressed
+// Return Value:
+// - true if the page is compressed
+bool ScrollbackPage::IsCompressed() const noexcept
+{
+    return _compressed;
+}
+
+// Routine Description:
+// - tells you whether the page has been spilled into a file
+// Return Value:
+// - true if the page is spilled
+bool ScrollbackPage::IsSpilled() const noexcept
+{
+    return _spillFile != nullptr;
+}
+
+// Routine Description:
+// - adds a line to the end of a hot page
+// Arguments:
+// - line - the line to add
+// Note: will throw exception if the page is full or compressed, or if unable
+//   to allocate memory for the line
+void ScrollbackPage::Append(ScrollbackLine&& line)
+{
+    THROW_HR_IF(E_NOT_VALID_STATE, _compressed || IsCompressing() || IsFull());
+    if (_lines.capacity() == 0)
+    {
+        _lines.reserve(Capacity);
+    }
+    _lines.push_back(std::move(line));
+    _size++;
+}
+
+// Routine Description:
+// - frees the memory used by a line that's been evicted from the store. A
+//   page that's compressed, or being compressed, can't free single lines, and
+//   keeps everything until the whole page is freed.
+// Arguments:
+// - index - the line to free
+void ScrollbackPage::Evict(const size_t index) noexcept
+{
+    if (!_compressed && index < _lines.size())
+    {
+        _lines[index] = ScrollbackLine{};
+    }
+}
+
+// Routine Description:
+// - fetches a line from a page that isn't compressed yet
+// Arguments:
+// - index - the line to fetch
+// Return Value:
+// - the line
+// Note: will throw exception if the page is compressed or the line isn't in it
+const ScrollbackLine& ScrollbackPage::GetLine(const size_t index) const
+{
+    THROW_HR_IF(E_NOT_VALID_STATE, _compressed);
+    if (_compression)
+    {
+        // Nobody changes the lines while they're being compressed.
+        return _compression->lines.at(index);
+    }
+    return _lines.at(index);
+}
+
+// Routine Description:
+// - decodes every line in a compressed page
+// Return Value:
+// - the lines
+// Note: will throw exception if the page isn't compressed, or if unable to
+//   allocate memory for the lines
+std::vector<ScrollbackLine> ScrollbackPage::Decompress() const
+{
+    THROW_HR_IF(E_NOT_VALID_STATE, !_compressed);
+
+    const std::vector<TextAttribute>* pAttributes = &_attributes;
+    const BYTE* it = _lineData.data();
+    const BYTE* end = it + _lineData.size();
+    const BYTE* textIt = _textData.data();
+    const BYTE* textEnd = textIt + _textData.size();
+
+    // A spilled page's record is laid out like Spill writes it.
+    std::vector<TextAttribute> spilledAttributes;
+    if (IsSpilled())
+    {
+        const auto record = _spillFile->Read(_spillRecord);
+        const BYTE* recordIt = record.data();
+        const BYTE* const recordEnd = recordIt + record.size();
+
+        const auto attributeCount = s_ReadVarint(recordIt, recordEnd);
+        THROW_HR_IF(E_UNEXPECTED, attributeCount > static_cast<size_t>(recordEnd - recordIt) / sizeof(TextAttribute));
+        spilledAttributes.resize(attributeCount);
+        memcpy(spilledAttributes.data(), recordIt, attributeCount * sizeof(TextAttribute));
+        recordIt += attributeCount * sizeof(TextAttribute);
+
+        const auto lineDataSize = s_ReadVarint(recordIt, recordEnd);
+        THROW_HR_IF(E_UNEXPECTED, lineDataSize > static_cast<size_t>(recordEnd - recordIt));
+
+        pAttributes = &spilledAttributes;
+        it = recordIt;
+        end = recordIt + lineDataSize;
+        textIt = end;
+        textEnd = recordEnd;
+    }
+
+    const auto text = s_DecompressText(textIt, textEnd);
+    size_t textOffset = 0;
+
+    std::vector<ScrollbackLine> lines;
+    lines.reserve(_size);
+
+    for (size_t i = 0; i < _size; ++i)
+    {
+        ScrollbackLine line{};
+
+        const auto textLength = s_ReadVarint(it, end);
+        THROW_HR_IF(E_UNEXPECTED, textLength > text.size() - textOffset);
+        line.text = text.substr(textOffset, textLength);
+        textOffset += textLength;
+
+        line.columns = s_ReadVarint(it, end);
+        line.wrapForced = s_ReadVarint(it, end) != 0;
+
+        const auto runs = s_ReadVarint(it, end);
+        line.attributes.reserve(runs);
+        for (size_t run = 0; run < runs; ++run)
+        {
+            const auto length = s_ReadVarint(it, end);
+            const auto attribute = s_ReadVarint(it, end);
+            line.attributes.emplace_back(length, pAttributes->at(attribute));
+        }
+
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// Routine Description:
+// - compresses the page, freeing the hot lines, on this thread. Does nothing
+//   if the page was already compressed.
+// Note: will throw exception if the page is being compressed already, or if
+//   unable to allocate memory for the compressed data. The page is left hot
+//   if so.
+void ScrollbackPage::Compress()
+{
+    if (_compressed)
+    {
+        return;
+    }
+
+    const auto compression = StartCompressing();
+    compression->Run();
+    FinishCompressing();
+    THROW_HR_IF(E_OUTOFMEMORY, !_compressed);
+}
+
+// Routine Description:
+// - hands the lines of a hot page over to be compressed. Until the
+//   compression is finished, the page keeps reading them from there, and
+//   can't be changed.
+// Return Value:
+// - the compression, to Run on any thread. Afterwards, FinishCompressing
+//   puts its result in place.
+// Note: will throw exception if the page isn't hot, or if unable to allocate
+//   the compression. The page is left hot if so.
+std::shared_ptr<ScrollbackPage::Compression> ScrollbackPage::StartCompressing()
+{
+    THROW_HR_IF(E_NOT_VALID_STATE, _compressed || IsCompressing());
+
+    auto compression = std::make_shared<Compression>();
+    compression->lines.swap(_lines);
+    _compression = compression;
+    return compression;
+}
+
+// Routine Description:
+// - puts the result of the page's compression in place, if it's done. If it
+//   failed, the page goes back to being hot.
+// Return Value:
+// - true if the compression was done, false if it's still going or the page
+//   wasn't being compressed
+bool ScrollbackPage::FinishCompressing() noexcept
+{
+    if (!_compression || !_compression->done.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    if (_compression->succeeded)
+    {
+        _attributes.swap(_compression->attributes);
+        _lineData.swap(_compression->lineData);
+        _textData.swap(_compression->textData);
+        _compressed = true;
+    }
+    else
+    {
+        _lines.swap(_compression->lines);
+    }
+    _compression.reset();
+    return true;
+}
+
+// Routine Description:
+// - compresses the lines. This doesn't touch the page, so it can run on any
+//   thread while the page is being read.
+void ScrollbackPage::Compression::Run() noexcept
+{
+    try
+    {
+        _Run();
+    }
+    CATCH_LOG();
+    done.store(true, std::memory_order_release);
+}
+
+// Routine Description:
+// - compresses the lines for Run
+// Note: will throw exception if unable to allocate memory for the compressed
+//   data. Nothing is kept if so.
+void ScrollbackPage::Compression::_Run()
+{
+    std::vector<TextAttribute> attributes;
+    std::unordered_map<TextAttribute, size_t> indexes;
+    std::vector<BYTE> lineData;
+    std::wstring text;
+    for (const auto& line : lines)
+    {
+        text.append(line.text);
+
+        s_WriteVarint(lineData, line.text.size());
+        s_WriteVarint(lineData, line.columns);
+        s_WriteVarint(lineData, line.wrapForced ? 1 : 0);
+        s_WriteVarint(lineData, line.attributes.size());
+        for (const auto& run : line.attributes)
+        {
+            const auto attr = run.GetAttributes();
+            const auto found = indexes.emplace(attr, attributes.size());
+            if (found.second)
+            {
+                attributes.push_back(attr);
+            }
+            s_WriteVarint(lineData, run.GetLength());
+            s_WriteVarint(lineData, found.first->second);
+        }
+    }
+
+    auto textData = s_CompressText(text);
+
+    attributes.shrink_to_fit();
+    lineData.shrink_to_fit();
+    textData.shrink_to_fit();
+
+    this->attributes.swap(attributes);
+    this->lineData.swap(lineData);
+    this->textData.swap(textData);
+    succeeded = true;
+}
+
+// Routine Description:
+// - moves a compressed page into a file, freeing its memory. Does nothing if
+//   the page was already spilled.
+// - The record is the attribute table, then the line data, then the text.
+// Arguments:
+// - file - the file to write the page to. It has to outlive the page, or at
+//      least last until the page's record is released.
+// Return Value:
+// - false if the record wouldn't fit in a chunk of the file, in which case
+//   the page stays in memory. true otherwise.
+// Note: will throw exception if the page isn't compressed, or if unable to
+//   write it. The page is left in memory if so.
+bool ScrollbackPage::Spill(ScrollbackSpillFile& file)
+{
+    static_assert(std::is_trivially_copyable_v<TextAttribute>, "TextAttributes are written to the file as they are in memory.");
+
+    THROW_HR_IF(E_NOT_VALID_STATE, !_compressed);
+    if (IsSpilled())
+    {
+        return true;
+    }
+
+    const auto recordSize = s_VarintSize(_attributes.size()) +
+                            _attributes.size() * sizeof(TextAttribute) +
+                            s_VarintSize(_lineData.size()) +
+                            _lineData.size() +
+                            _textData.size();
+    if (recordSize > ScrollbackSpillFile::ChunkSize)
+    {
+        return false;
+    }
+
+    std::vector<BYTE> record;
+    record.reserve(recordSize);
+    const auto attributeBytes = reinterpret_cast<const BYTE*>(_attributes.data());
+    s_WriteVarint(record, _attributes.size());
+    record.insert(record.end(), attributeBytes, attributeBytes + _attributes.size() * sizeof(TextAttribute));
+    s_WriteVarint(record, _lineData.size());
+    record.insert(record.end(), _lineData.cbegin(), _lineData.cend());
+    record.insert(record.end(), _textData.cbegin(), _textData.cend());
+
+    _spillRecord = file.Write(record);
+    _spillFile = &file;
+
+    std::vector<TextAttribute>{}.swap(_attributes);
+    std::vector<BYTE>{}.swap(_lineData);
+    std::vector<BYTE>{}.swap(_textData);
+    return true;
+}
+
+// Routine Description:
+// - gets where a spilled page is in its file
+// Return Value:
+// - the page's record
+const ScrollbackSpillFile::Record& ScrollbackPage::GetSpillRecord() const noexcept
+{
+    return _spillRecord;
+}
+
+// Routine Description:
+// - gets how many bytes the compressed lines take up, in memory or in the
+//   spill file
+// Return Value:
+// - the size in bytes, or 0 if the page isn't compressed
+size_t ScrollbackPage::GetCompressedSize() const noexcept
+{
+    return IsSpilled() ? _spillRecord.size : _lineData.size() + _textData.size();
+}
+
+// Routine Description:
+// - compresses text with a simple LZ77 scheme. The output is a series of
+//   tokens, each either a run of literal chars, or a copy of text that came
+//   earlier. Literal chars are written as varints, so ASCII takes a byte.
+// Arguments:
+// - text - the text to compress
+// Return Value:
+// - the compressed text
+// Note: will throw exception if unable to allocate memory
+std::vector<BYTE> ScrollbackPage::s_CompressText(const std::wstring_view text)
+{
+    std::vector<BYTE> data;
+    std::vector<size_t> lastSeen(size_t{ 1 } << s_hashBits, SIZE_MAX);
+
+    const auto writeLiterals = [&](const size_t start, const size_t end) {
+        if (start < end)
+        {
+            s_WriteVarint(data, (end - start) << 1);
+            for (auto i = start; i < end; ++i)
+            {
+                s_WriteVarint(data, text[i]);
+            }
+        }
+    };
+
+    size_t literalStart = 0;
+    size_t pos = 0;
+    while (pos + s_minMatch <= text.size())
+    {
+        const auto hash = s_HashText(&text[pos]);
+        const auto candidate = lastSeen[hash];
+        lastSeen[hash] = pos;
+
+        if (candidate == SIZE_MAX || text.compare(candidate, s_minMatch, text, pos, s_minMatch) != 0)
+        {
+            ++pos;
+            continue;
+        }
+
+        auto length = s_minMatch;
+        while (pos + length < text.size() && text[candidate + length] == text[pos + length])
+        {
+            ++length;
+        }
+
+        writeLiterals(literalStart, pos);
+        s_WriteVarint(data, ((length - s_minMatch) << 1) | 1);
+        s_WriteVarint(data, pos - candidate);
+
+        pos += length;
+        literalStart = pos;
+    }
+    writeLiterals(literalStart, text.size());
+
+    return data;
+}
+
+// Routine Description:
+// - decompresses text written by s_CompressText
+// Arguments:
+// - it - the start of the compressed text
+// - end - the end of the compressed text
+// Return Value:
+// - the text
+// Note: will throw exception if the data is corrupt, or if unable to allocate memory
+std::wstring ScrollbackPage::s_DecompressText(const BYTE* it, const BYTE* const end)
+{
+    std::wstring text;
+    while (it != end)
+    {
+        const auto token = s_ReadVarint(it, end);
+        if (token & 1)
+        {
+            const auto length = (token >> 1) + s_minMatch;
+            const auto distance = s_ReadVarint(it, end);
+            THROW_HR_IF(E_UNEXPECTED, distance == 0 || distance > text.size());
+
+            // The copy can overlap the text it's producing, so it has to go a char at a time.
+            auto from = text.size() - distance;
+            for (size_t i = 0; i < length; ++i)
+            {
+                text.push_back(text[from++]);
+            }
+        }
+        else
+        {
+            const auto count = token >> 1;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto wch = s_ReadVarint(it, end);
+                THROW_HR_IF(E_UNEXPECTED, wch > WCHAR_MAX);
+                text.push_back(static_cast<wchar_t>(wch));
+            }
+        }
+    }
+    return text;
+}
@@ -0,0 +1,129 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScrollbackPage.hpp
+
+Abstract:
+- One page of lines in a ScrollbackStore.
+- A page starts out hot, with every line kept as-is. Once it's far enough
+    above the newest line that it won't be looked at much, the store
+    compresses it: the attribute runs are written as indexes into a small
+    table of the page's attributes, and the text of every line is run through
+    a simple LZ77 compressor. Reading a line from a compressed page decodes the
+    whole page.
+- Compressing can happen on another thread. The page hands its lines over to
+    a Compression, which the other thread runs, and keeps reading its lines
+    from there until it's finished.
+- A compressed page can also be spilled into a ScrollbackSpillFile, after
+    which it only keeps where its record is in the file. A page that
+    compresses to more than a chunk of the file stays in memory.
+--*/
+
+#pragma once
+
+#include "TextAttributeRun.hpp"
+#include "ScrollbackSpillFile.hpp"
+
+#include <atomic>
+#include <memory>
+
+// One line that has scrolled out of a TextBuffer.
+struct ScrollbackLine
+{
+    // The text of the row, without the trailing halves of wide glyphs or
+    // any trailing spaces.
+    std::wstring text;
+
+    // The attributes of the row, by column.
+    std::vector<TextAttributeRun> attributes;
+
+    // How many columns the row had.
+    size_t columns;
+
+    // Whether the row wrapped onto the next one.
+    bool wrapForced;
+};
+
+class ScrollbackPage final
+{
+public:
+    // How many lines fit in a page.
+    static constexpr size_t Capacity = 256;
+
+    // The lines of a page that's being compressed, and what they compress to.
+    // Only Run touches it until done is set, apart from reading the lines.
+    struct Compression
+    {
+        std::vector<ScrollbackLine> lines;
+
+        std::vector<TextAttribute> attributes;
+        std::vector<BYTE> lineData;
+        std::vector<BYTE> textData;
+        bool succeeded = false;
+
+        std::atomic<bool> done{ false };
+
+        void Run() noexcept;
+
+    private:
+        void _Run();
+    };
+
+    ScrollbackPage();
+
+    size_t size() const noexcept;
+    bool IsFull() const noexcept;
+    bool IsCompressing() const noexcept;
+    bool IsCompressed() const noexcept;
+    bool IsSpilled() const noexcept;
+
+    void Append(ScrollbackLine&& line);
+    void Evict(const size_t index) noexcept;
+
+    const ScrollbackLine& GetLine(const size_t index) const;
+    std::vector<ScrollbackLine> Decompress() const;
+
+    void Compress();
+    std::shared_ptr<Compression> StartCompressing();
+    bool FinishCompressing() noexcept;
+
+    bool Spill(ScrollbackSpillFile& file);
+    const ScrollbackSpillFile::Record& GetSpillRecord() const noexcept;
+
+    size_t GetCompressedSize() const noexcept;
+
+private:
+    // the lines, while the page is hot
+    std::vector<ScrollbackLine> _lines;
+
+    // while the page is being compressed: the lines, and the compressed data
+    // once it's there
+    std::shared_ptr<Compression> _compression;
+
+    // how many lines are in the page, hot or compressed
+    size_t _size;
+
+    // once compressed: every distinct attribute used by the page's lines
+    std::vector<TextAttribute> _attributes;
+
+    // once compressed: the length, width, wrap flag and attribute runs of each line
+    std::vector<BYTE> _lineData;
+
+    // once compressed: the text of every line, one after the other
+    std::vector<BYTE> _textData;
+
+    bool _compressed;
+
+    // once spilled: the file, and where the compressed page is in it
+    const ScrollbackSpillFile* _spillFile;
+    ScrollbackSpillFile::Record _spillRecord;
+
+    static std::vector<BYTE> s_CompressText(const std::wstring_view text);
+    static std::wstring s_DecompressText(const BYTE* it, const BYTE* const end);
+
+#ifdef UNIT_TESTING
+    friend class ScrollbackStoreTests;
+#endif
+};
@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ScrollbackSpillFile.hpp"
+
+// Routine Description:
+// - creates the temp file
+// Note: will throw exception if unable to create the file
+ScrollbackSpillFile::ScrollbackSpillFile() :
+    _file{},
+    _chunks{},
+    _current{ SIZE_MAX },
+    _freeChunks{}
+{
+    wchar_t tempPath[MAX_PATH + 1];
+    THROW_LAST_ERROR_IF(GetTempPathW(ARRAYSIZE(tempPath), tempPath) == 0);
+
+    wchar_t tempFile[MAX_PATH];
+    THROW_LAST_ERROR_IF(GetTempFileNameW(tempPath, L"wts", 0, tempFile) == 0);
+
+    _file.reset(CreateFileW(tempFile,
+                            GENERIC_READ | GENERIC_WRITE,
+                            0,
+                            nullptr,
+                            CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                            nullptr));
+    if (!_file)
+    {
+        const auto error = GetLastError();
+        LOG_IF_WIN32_BOOL_FALSE(DeleteFileW(tempFile));
+        THROW_WIN32(error);
+    }
+}
+
+// Routine Description:
+// - appends a record to the file
+// Arguments:
+// - data - the bytes of the record
+// Return Value:
+// - where the record was written
+// Note: will throw exception if the record is bigger than a chunk, or if
+//   unable to grow or map the file
+ScrollbackSpillFile::Record ScrollbackSpillFile::Write(const gsl::span<const BYTE> data)
+{
+    const auto size = gsl::narrow<size_t>(data.size());
+    THROW_HR_IF(E_INVALIDARG, size > ChunkSize);
+
+    if (_current == SIZE_MAX || _chunks[_current].used + size > ChunkSize)
+    {
+        _current = _NextChunk();
+    }
+
+    auto& chunk = _chunks[_current];
+    const Record record{ _current, chunk.used, size };
+    std::copy(data.cbegin(), data.cend(), chunk.view.get() + chunk.used);
+    chunk.used += size;
+    chunk.records++;
+    return record;
+}
+
+// Routine Description:
+// - gets a view of a record in the file
+// Arguments:
+// - record - the record to read
+// Return Value:
+// - the bytes of the record. They stay valid until the record is released.
+gsl::span<const BYTE> ScrollbackSpillFile::Read(const Record& record) const
+{
+    const auto& chunk = _chunks.at(record.chunk);
+    THROW_HR_IF(E_INVALIDARG, record.offset + record.size > chunk.used);
+    return { chunk.view.get() + record.offset, gsl::narrow<std::ptrdiff_t>(record.size) };
+}
+
+// Routine Description:
+// - frees a record. Its chunk is reused once all of its records are freed.
+// Arguments:
+// - record - the record to free
+void ScrollbackSpillFile::Release(const Record& record) noexcept
+{
+    auto& chunk = _chunks[record.chunk];
+    chunk.records--;
+    if (chunk.records == 0 && record.chunk != _current)
+    {
+        // Reserved up front in _NextChunk, so this can't throw.
+        _freeChunks.push_back(record.chunk);
+    }
+}
+
+// Routine Description:
+// - gets how many chunks the file has been grown to
+// Return Value:
+// - the number of chunks
+size_t ScrollbackSpillFile::GetChunkCount() const noexcept
+{
+    return _chunks.size();
+}
+
+// Routine Description:
+// - picks the chunk to write new records to: a chunk whose records have all
+//   been released, or else a new chunk at the end of the file.
+// - The chunk being left behind is freed right away if all of its records
+//   were already released.
+// Return Value:
+// - the index of the chunk
+// Note: will throw exception if unable to grow or map the file
+size_t ScrollbackSpillFile::_NextChunk()
+{
+    size_t next;
+    if (!_freeChunks.empty())
+    {
+        next = _freeChunks.back();
+        _freeChunks.pop_back();
+        _chunks[next].used = 0;
+    }
+    else
+    {
+        _chunks.reserve(_chunks.size() + 1);
+        _freeChunks.reserve(_chunks.size() + 1);
+
+        const uint64_t offset = static_cast<uint64_t>(_chunks.size()) * ChunkSize;
+        const uint64_t end = offset + ChunkSize;
+
+        Chunk chunk{};
+        chunk.mapping.reset(CreateFileMappingW(_file.get(),
+                                               nullptr,
+                                               PAGE_READWRITE,
+                                               static_cast<DWORD>(end >> 32),
+                                               static_cast<DWORD>(end),
+                                               nullptr));
+        THROW_LAST_ERROR_IF_NULL(chunk.mapping.get());
+
+        chunk.view.reset(static_cast<BYTE*>(MapViewOfFile(chunk.mapping.get(),
+                                                          FILE_MAP_READ | FILE_MAP_WRITE,
+                                                          static_cast<DWORD>(offset >> 32),
+                                                          static_cast<DWORD>(offset),
+                                                          ChunkSize)));
+        THROW_LAST_ERROR_IF_NULL(chunk.view.get());
+
+        next = _chunks.size();
+        _chunks.push_back(std::move(chunk));
+    }
+
+    if (_current != SIZE_MAX && _chunks[_current].records == 0)
+    {
+        _freeChunks.push_back(_current);
+    }
+    return next;
+}
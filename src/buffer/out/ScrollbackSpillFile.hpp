@@ -0,0 +1,70 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScrollbackSpillFile.hpp
+
+Abstract:
+- A temp file that a ScrollbackStore moves its oldest compressed pages into,
+    so that a very long history doesn't have to stay in memory.
+- The file is mapped into memory in fixed-size chunks. Records are appended
+    to the current chunk and read straight out of its view, so the OS can page
+    them in and out as needed without counting them against the process.
+- Once every record in a chunk has been released, the chunk is reused for new
+    records, so the file only grows as big as the history that's kept.
+- The file is deleted when it's closed, including if the process goes away.
+--*/
+
+#pragma once
+
+class ScrollbackSpillFile final
+{
+public:
+    // Where a record was written, to read it back or release it.
+    struct Record
+    {
+        size_t chunk;
+        size_t offset;
+        size_t size;
+    };
+
+    // How big each mapped chunk of the file is. A record can't be bigger.
+    static constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
+    ScrollbackSpillFile();
+
+    Record Write(const gsl::span<const BYTE> data);
+    gsl::span<const BYTE> Read(const Record& record) const;
+    void Release(const Record& record) noexcept;
+
+    size_t GetChunkCount() const noexcept;
+
+private:
+    struct Chunk
+    {
+        wil::unique_handle mapping;
+        wil::unique_mapview_ptr<BYTE> view;
+
+        // how many bytes have been written to the chunk
+        size_t used;
+
+        // how many records in the chunk haven't been released yet
+        size_t records;
+    };
+
+    wil::unique_hfile _file;
+    std::vector<Chunk> _chunks;
+
+    // the chunk that records are being written to
+    size_t _current;
+
+    // chunks whose records have all been released
+    std::vector<size_t> _freeChunks;
+
+    size_t _NextChunk();
+
+#ifdef UNIT_TESTING
+    friend class ScrollbackStoreTests;
+#endif
+};
@@ -0,0 +1,380 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "ScrollbackStore.hpp"
+
+ScrollbackStore::ScrollbackStore() :
+    _pages{},
+    _frontOffset{ 0 },
+    _size{ 0 },
+    _capacity{ 0 },
+    _endLine{ 0 },
+    _spillFile{},
+    _memoryPages{ 0 },
+    _compressingPages{ 0 },
+    _compactionQueue{},
+    _compactionWork{}
+{
+}
+
+// Routine Description:
+// - sets how many lines the store keeps, evicting the oldest lines if there
+//   are already more than that.
+// Arguments:
+// - lines - the most lines to keep. 0 keeps nothing, but still counts the
+//      lines that are appended.
+void ScrollbackStore::SetCapacity(const size_t lines) noexcept
+{
+    _capacity = lines;
+    while (_size > _capacity)
+    {
+        _EvictFront();
+    }
+}
+
+// Routine Description:
+// - gets how many lines the store keeps at most
+// Return Value:
+// - the capacity, in lines
+size_t ScrollbackStore::GetCapacity() const noexcept
+{
+    return _capacity;
+}
+
+// Routine Description:
+// - makes the store keep at most the given number of compressed pages in
+//   memory, moving older ones out to a temp file.
+// Arguments:
+// - memoryPages - how many compressed pages to keep in memory, on top of the
+//      HotPages
+// Note: will throw exception if unable to create the temp file. The store
+//   keeps every page in memory if so.
+void ScrollbackStore::EnableSpilling(const size_t memoryPages)
+{
+    if (!_spillFile)
+    {
+        _spillFile = std::make_unique<ScrollbackSpillFile>();
+    }
+    _memoryPages = memoryPages;
+    _SpillColdPages();
+}
+
+// Routine Description:
+// - adds a line after the newest one, evicting the oldest line if the store
+//   is full.
+// - The line gets the next line number even if it isn't kept, so the numbers
+//   always count every line that was scrolled out of the buffer.
+// Arguments:
+// - line - the line to add
+// Note: will throw exception if unable to allocate a page. Every line in the
+//   store is dropped if so, since the numbering would skip over this line.
+void ScrollbackStore::Append(Line&& line)
+{
+    _endLine++;
+    if (_capacity == 0)
+    {
+        return;
+    }
+
+    _FinishCompaction();
+
+    try
+    {
+        if (_pages.empty() || _pages.back().IsFull())
+        {
+            _pages.emplace_back();
+            _CompressColdPage();
+            _SpillColdPages();
+        }
+        _pages.back().Append(std::move(line));
+        _size++;
+    }
+    catch (...)
+    {
+        Clear();
+        throw;
+    }
+
+    if (_size > _capacity)
+    {
+        _EvictFront();
+    }
+}
+
+// Routine Description:
+// - drops every line in the store. The numbering carries on from where it was.
+void ScrollbackStore::Clear() noexcept
+{
+    if (_spillFile)
+    {
+        for (const auto& page : _pages)
+        {
+            if (page.IsSpilled())
+            {
+                _spillFile->Release(page.GetSpillRecord());
+            }
+        }
+    }
+    _pages.clear();
+    _frontOffset = 0;
+    _size = 0;
+
+    // The compressions that haven't started are of no use anymore. The ones
+    // that have just finish, and are thrown away.
+    _compressingPages = 0;
+    if (_compactionQueue)
+    {
+        std::lock_guard<std::mutex> guard{ _compactionQueue->lock };
+        _compactionQueue->compressions.clear();
+    }
+}
+
+// Routine Description:
+// - gets how many lines are kept in the store
+// Return Value:
+// - the number of lines
+size_t ScrollbackStore::size() const noexcept
+{
+    return _size;
+}
+
+// Routine Description:
+// - tells you whether the store has no lines in it
+// Return Value:
+// - true if there are no lines
+bool ScrollbackStore::empty() const noexcept
+{
+    return _size == 0;
+}
+
+// Routine Description:
+// - gets the number of the oldest line in the store
+// Return Value:
+// - the line number. Equal to EndLine() if the store is empty.
+ScrollbackStore::line_number ScrollbackStore::FirstLine() const noexcept
+{
+    return _endLine - _size;
+}
+
+// Routine Description:
+// - gets the number one past the newest line in the store. This is also the
+//   number of lines that have ever been appended, and the line number of the
+//   first row of the buffer that the store belongs to.
+// Return Value:
+// - the line number
+ScrollbackStore::line_number ScrollbackStore::EndLine() const noexcept
+{
+    return _endLine;
+}
+
+// Routine Description:
+// - makes a reader for the lines in the given store. The reader must not be
+//   used anymore once the store has changed.
+// Arguments:
+// - store - the store to read
+ScrollbackStore::Reader::Reader(const ScrollbackStore& store) noexcept :
+    _store{ store },
+    _decodedPage{},
+    _decodedLines{}
+{
+}
+
+// Routine Description:
+// - fetches a line from the store
+// Arguments:
+// - line - the number of the line, from FirstLine() up to EndLine()
+// Return Value:
+// - the line. It's only valid until the next call, or until the store changes.
+// Note: will throw exception if the line isn't in the store, or if unable to
+//   decode the page it's in
+const ScrollbackStore::Line& ScrollbackStore::Reader::GetLine(const line_number line)
+{
+    THROW_HR_IF(E_INVALIDARG, line < _store.FirstLine() || line >= _store.EndLine());
+
+    const auto index = gsl::narrow_cast<size_t>(line - _store.FirstLine()) + _store._frontOffset;
+    const auto& page = _store._pages.at(index / PageSize);
+    if (!page.IsCompressed())
+    {
+        return page.GetLine(index % PageSize);
+    }
+
+    // A compressed page's lines don't change, so they only need decoding
+    // once for as long as it's the page being read.
+    const auto pageStart = line - index % PageSize;
+    if (_decodedPage != pageStart)
+    {
+        _decodedPage.reset();
+        _decodedLines = page.Decompress();
+        _decodedPage = pageStart;
+    }
+    return _decodedLines.at(index % PageSize);
+}
+
+// Routine Description:
+// - evicts the oldest line in the store, freeing its page once every line in
+//   it has been evicted.
+void ScrollbackStore::_EvictFront() noexcept
+{
+    auto& page = _pages.front();
+
+    // Free the line's memory now, rather than when the whole page goes.
+    page.Evict(_frontOffset);
+    _frontOffset++;
+    _size--;
+
+    if (_frontOffset == page.size())
+    {
+        if (page.IsCompressing())
+        {
+            _compressingPages--;
+        }
+        if (page.IsSpilled())
+        {
+            _spillFile->Release(page.GetSpillRecord());
+        }
+        _pages.pop_front();
+        _frontOffset = 0;
+    }
+}
+
+// Routine Description:
+// - starts compressing the newest page that isn't one of the HotPages, on the
+//   threadpool. Pages only ever go cold one at a time, as a new page is
+//   started, so this keeps up with every page that needs it.
+// - If the threadpool can't be used, the page is compressed right here. If the
+//   page can't be compressed at all, it's left as it is. It still works, it
+//   just takes more memory.
+void ScrollbackStore::_CompressColdPage() noexcept
+{
+    if (_pages.size() <= HotPages)
+    {
+        return;
+    }
+
+    auto& page = _pages[_pages.size() - HotPages - 1];
+    try
+    {
+        if (!_compactionWork)
+        {
+            _compactionQueue = std::make_unique<CompactionQueue>();
+            _compactionWork.reset(CreateThreadpoolWork([](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+                                                           auto& queue = *static_cast<CompactionQueue*>(context);
+                                                           std::shared_ptr<ScrollbackPage::Compression> compression;
+                                                           {
+                                                               std::lock_guard<std::mutex> guard{ queue.lock };
+                                                               if (queue.compressions.empty())
+                                                               {
+                                                                   return;
+                                                               }
+                                                               compression = std::move(queue.compressions.front());
+                                                               queue.compressions.pop_front();
+                                                           }
+                                                           compression->Run();
+                                                       },
+                                                       _compactionQueue.get(),
+                                                       nullptr));
+            LOG_LAST_ERROR_IF(!_compactionWork);
+        }
+
+        if (!_compactionWork)
+        {
+            page.Compress();
+            return;
+        }
+
+        const auto compression = page.StartCompressing();
+        try
+        {
+            std::lock_guard<std::mutex> guard{ _compactionQueue->lock };
+            _compactionQueue->compressions.push_back(compression);
+        }
+        catch (...)
+        {
+            // Finish it here, rather than leave the page waiting for it forever.
+            compression->Run();
+            page.FinishCompressing();
+            throw;
+        }
+        _compressingPages++;
+        SubmitThreadpoolWork(_compactionWork.get());
+    }
+    CATCH_LOG();
+}
+
+// Routine Description:
+// - puts the pages that the threadpool is done compressing in place, and
+//   spills the ones that are past the newest _memoryPages.
+// - Compressions can finish out of order, so this looks through the cold
+//   pages until it's seen every page that's being compressed. Those are the
+//   ones that went cold last, so it doesn't have to look far.
+void ScrollbackStore::_FinishCompaction() noexcept
+{
+    auto remaining = _compressingPages;
+    bool finished = false;
+    for (auto i = _pages.size(); i > 0 && remaining > 0; --i)
+    {
+        auto& page = _pages[i - 1];
+        if (!page.IsCompressing())
+        {
+            continue;
+        }
+
+        remaining--;
+        if (!page.FinishCompressing())
+        {
+            continue;
+        }
+
+        _compressingPages--;
+        finished = true;
+
+        // _SpillColdPages stops at the first page that was spilled already,
+        // which a page that took its time to compress might be older than.
+        if (_spillFile && page.IsCompressed() && i + HotPages + _memoryPages <= _pages.size())
+        {
+            try
+            {
+                page.Spill(*_spillFile);
+            }
+            CATCH_LOG();
+        }
+    }
+
+    if (finished)
+    {
+        _SpillColdPages();
+    }
+}
+
+// Routine Description:
+// - spills the compressed pages that are past the newest _memoryPages of them,
+//   newest first. Pages are spilled in order, so this stops at the first page
+//   that was spilled already. A page too big for the file is kept in memory,
+//   and the pages before it are still spilled.
+// - If a page can't be spilled, it stays in memory, and the next call will try
+//   again.
+void ScrollbackStore::_SpillColdPages() noexcept
+{
+    if (!_spillFile || _pages.size() <= HotPages + _memoryPages)
+    {
+        return;
+    }
+
+    try
+    {
+        for (auto i = _pages.size() - HotPages - _memoryPages; i > 0; --i)
+        {
+            auto& page = _pages[i - 1];
+            if (page.IsSpilled())
+            {
+                break;
+            }
+            if (page.IsCompressed())
+            {
+                page.Spill(*_spillFile);
+            }
+        }
+    }
+    CATCH_LOG();
+}
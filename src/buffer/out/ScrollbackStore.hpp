@@ -0,0 +1,132 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- ScrollbackStore.hpp
+
+Abstract:
+- Keeps the lines that have scrolled off the top of a TextBuffer's circular
+    buffer, instead of throwing them away.
+- The circular buffer is addressed with SHORTs, like every other COORD, so it
+    can't grow past 32767 rows. The store numbers its lines with 64 bits and
+    keeps them in fixed-size pages, so it can hold millions of lines. Appending
+    a line and evicting the oldest one are both constant time.
+- Lines are kept as their text plus their attribute runs, rather than as full
+    ROWs, so that a line only costs about as much as the text it holds.
+- Only the newest few pages are kept as-is. Older pages are compressed as
+    new ones fill up, and decoded again when a line in them is read. The
+    compressing is done on the threadpool, so that it doesn't hold up the
+    thread that appends lines, which has the console locked. Each compressed
+    page is put in place by the next Append after it's done.
+- Lines are read through a ScrollbackStore::Reader, which keeps the lines of
+    the last page it decoded. Each reader has its own, so readers never share
+    anything but the store itself, which they don't change. A reader can be
+    kept while lines are appended and evicted, so that reading the same page
+    again later doesn't decode it again.
+- If spilling is enabled, only so many compressed pages are kept in memory,
+    and older ones are moved out to a ScrollbackSpillFile.
+--*/
+
+#pragma once
+
+#include "ScrollbackPage.hpp"
+
+#include <deque>
+#include <mutex>
+
+class ScrollbackStore final
+{
+public:
+    using line_number = typename uint64_t;
+
+    using Line = typename ScrollbackLine;
+
+    // Lines are kept in pages of this many, so that the store only allocates or
+    // frees memory a page at a time.
+    static constexpr size_t PageSize = ScrollbackPage::Capacity;
+
+    // How many of the newest pages are left uncompressed.
+    static constexpr size_t HotPages = 2;
+
+    ScrollbackStore();
+
+    void SetCapacity(const size_t lines) noexcept;
+    size_t GetCapacity() const noexcept;
+
+    void EnableSpilling(const size_t memoryPages);
+
+    void Append(Line&& line);
+    void Clear() noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    line_number FirstLine() const noexcept;
+    line_number EndLine() const noexcept;
+
+    // Reads lines out of a store. Reading the lines of a compressed page one
+    // after another only decodes the page once.
+    class Reader final
+    {
+    public:
+        explicit Reader(const ScrollbackStore& store) noexcept;
+
+        const Line& GetLine(const line_number line);
+
+    private:
+        const ScrollbackStore& _store;
+
+        // The number of the first line of the compressed page that was read
+        // last, and its lines. Line numbers are never reused, so this still
+        // tells the page apart once pages have come and gone.
+        std::optional<line_number> _decodedPage;
+        std::vector<Line> _decodedLines;
+    };
+
+private:
+    std::deque<ScrollbackPage> _pages;
+
+    // How many lines at the start of the first page have been evicted already.
+    size_t _frontOffset;
+
+    // How many lines are kept in the pages.
+    size_t _size;
+
+    // The most lines to keep. Older lines are evicted to stay under this.
+    size_t _capacity;
+
+    // The number that the next line to be appended will get.
+    line_number _endLine;
+
+    // Where compressed pages go once there are more than _memoryPages of
+    // them. Null unless spilling was enabled.
+    std::unique_ptr<ScrollbackSpillFile> _spillFile;
+    size_t _memoryPages;
+
+    // How many pages are being compressed on the threadpool.
+    size_t _compressingPages;
+
+    // The compressions waiting for a threadpool thread, oldest first. The
+    // work is submitted once for each of them.
+    struct CompactionQueue
+    {
+        std::mutex lock;
+        std::deque<std::shared_ptr<ScrollbackPage::Compression>> compressions;
+    };
+    std::unique_ptr<CompactionQueue> _compactionQueue;
+
+    // Declared after the queue, so that it's closed first, which waits for
+    // the callbacks that use the queue.
+    wil::unique_threadpool_work _compactionWork;
+
+    void _EvictFront() noexcept;
+    void _CompressColdPage() noexcept;
+    void _FinishCompaction() noexcept;
+    void _SpillColdPages() noexcept;
+
+#ifdef UNIT_TESTING
+    friend class ScrollbackStoreTests;
+    friend class TextBufferTests;
+#endif
+};
@@ -148,6 +148,14 @@ public:
         return _foreground.IsRgb() || _background.IsRgb();
     }
 
+    constexpr size_t GetHash() const noexcept
+    {
+        size_t hash = _foreground.GetHashKey();
+        hash = hash * 31 + _background.GetHashKey();
+        hash = hash * 31 + _wAttrLegacy;
+        return hash * 2 + (_isBold ? 1 : 0);
+    }
+
 private:
     COLORREF _GetRgbForeground(std::basic_string_view<COLORREF> colorTable,
                                COLORREF defaultColor) const;
@@ -56,3 +56,57 @@ void TextAttributeRun::SetAttributesFromLegacy(const WORD wNew) noexcept
 {
     _attributes.SetFromLegacy(wNew);
 }
+
+InternedAttributeRun::InternedAttributeRun() noexcept :
+    _cchLength(0),
+    _endColumn(0),
+    _attrId(0)
+{
+}
+
+InternedAttributeRun::InternedAttributeRun(const size_t cchLength, const TextAttributeTable::id_type attrId) noexcept :
+    _cchLength(static_cast<uint16_t>(cchLength)),
+    _endColumn(0),
+    _attrId(attrId)
+{
+}
+
+size_t InternedAttributeRun::GetLength() const noexcept
+{
+    return _cchLength;
+}
+
+void InternedAttributeRun::SetLength(const size_t cchLength) noexcept
+{
+    _cchLength = static_cast<uint16_t>(cchLength);
+}
+
+void InternedAttributeRun::IncrementLength() noexcept
+{
+    _cchLength++;
+}
+
+void InternedAttributeRun::DecrementLength() noexcept
+{
+    _cchLength--;
+}
+
+TextAttributeTable::id_type InternedAttributeRun::GetAttributeId() const noexcept
+{
+    return _attrId;
+}
+
+void InternedAttributeRun::SetAttributeId(const TextAttributeTable::id_type attrId) noexcept
+{
+    _attrId = attrId;
+}
+
+size_t InternedAttributeRun::GetEndColumn() const noexcept
+{
+    return _endColumn;
+}
+
+void InternedAttributeRun::SetEndColumn(const size_t endColumn) noexcept
+{
+    _endColumn = static_cast<uint16_t>(endColumn);
+}
@@ -21,6 +21,7 @@ Revision History:
 #pragma once
 
 #include "TextAttribute.hpp"
+#include "TextAttributeTable.hpp"
 
 class TextAttributeRun final
 {
@@ -45,3 +46,35 @@ private:
     friend class AttrRowTests;
 #endif
 };
+
+// This is how an ATTR_ROW stores its runs. The attributes themselves live in
+// the text buffer's TextAttributeTable, and the run only keeps their ID, so
+// that the run stays small and two runs compare with one integer compare.
+class InternedAttributeRun final
+{
+public:
+    InternedAttributeRun() noexcept;
+    InternedAttributeRun(const size_t cchLength, const TextAttributeTable::id_type attrId) noexcept;
+
+    size_t GetLength() const noexcept;
+    void SetLength(const size_t cchLength) noexcept;
+    void IncrementLength() noexcept;
+    void DecrementLength() noexcept;
+
+    TextAttributeTable::id_type GetAttributeId() const noexcept;
+    void SetAttributeId(const TextAttributeTable::id_type attrId) noexcept;
+
+    size_t GetEndColumn() const noexcept;
+    void SetEndColumn(const size_t endColumn) noexcept;
+
+private:
+    // Rows are never wider than a SHORT, so none of these need more than 16 bits.
+    uint16_t _cchLength;
+
+    // One past the last column of the row that this run covers. These sums of
+    // the lengths let ATTR_ROW binary search for the run covering a column.
+    // ATTR_ROW keeps them up to date whenever it changes its runs.
+    uint16_t _endColumn;
+
+    TextAttributeTable::id_type _attrId;
+};
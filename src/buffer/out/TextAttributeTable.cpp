@@ -0,0 +1,149 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "TextAttributeTable.hpp"
+
+TextAttributeTable::TextAttributeTable() :
+    _attributes{},
+    _ids{},
+    _freeIds{}
+{
+}
+
+// Routine Description:
+// - finds the ID of the given attribute, adding it to the table if it isn't
+//      there yet.
+// Arguments:
+// - attr - the attribute to look up
+// Return Value:
+// - the ID of the attribute, which is the same for every equal attribute
+// Note: will throw exception if the table is full, or if unable to allocate
+//      memory for the new attribute
+TextAttributeTable::id_type TextAttributeTable::Intern(const TextAttribute& attr)
+{
+    const auto found = _ids.find(attr);
+    if (found != _ids.end())
+    {
+        return found->second;
+    }
+
+    // A released ID keeps its slot in the table, so it's reused in place. It
+    //      stays released until the attribute has been added to the index.
+    if (!_freeIds.empty())
+    {
+        const auto id = _freeIds.back();
+        _attributes[id] = attr;
+        _ids.emplace(attr, id);
+        _freeIds.pop_back();
+        return id;
+    }
+
+    THROW_HR_IF(E_OUTOFMEMORY, _attributes.size() >= Capacity);
+
+    const auto id = static_cast<id_type>(_attributes.size());
+    _attributes.push_back(attr);
+    try
+    {
+        _ids.emplace(attr, id);
+    }
+    catch (...)
+    {
+        _attributes.pop_back();
+        throw;
+    }
+    return id;
+}
+
+// Routine Description:
+// - fetches the attribute with the given ID
+// Arguments:
+// - id - an ID returned by Intern
+// Return Value:
+// - the attribute. The reference stays valid until the ID is released.
+const TextAttribute& TextAttributeTable::Get(const id_type id) const noexcept
+{
+    return _attributes[id];
+}
+
+// Routine Description:
+// - reports how many distinct attributes have been interned, and not released
+// Return Value:
+// - the number of attributes in the table
+size_t TextAttributeTable::Size() const noexcept
+{
+    return _attributes.size() - _freeIds.size();
+}
+
+// Routine Description:
+// - reports how many more distinct attributes fit in the table
+// Return Value:
+// - the number of IDs left to hand out
+size_t TextAttributeTable::Remaining() const noexcept
+{
+    return Capacity - Size();
+}
+
+// Routine Description:
+// - reports how many IDs are in use or released, which is one past the
+//      largest ID that was handed out
+// Return Value:
+// - the number of IDs that ReleaseUnused needs to know about
+size_t TextAttributeTable::IdLimit() const noexcept
+{
+    return _attributes.size();
+}
+
+// Routine Description:
+// - releases the ID of every attribute that isn't used anymore, so that it
+//      can be handed out again. The attributes that are still used keep
+//      their IDs, and stay where they are.
+// Arguments:
+// - used - for each ID below IdLimit, whether something still uses it
+// Return Value:
+// - <none>, throws exceptions on failures. The table is unchanged if it does.
+void TextAttributeTable::ReleaseUnused(const std::vector<bool>& used)
+{
+    const auto isUsed = [&](const size_t id) {
+        return id < used.size() && used[id];
+    };
+
+    std::vector<id_type> freeIds;
+    freeIds.reserve(_attributes.size());
+
+    // Released IDs at the end of the table are taken out of it altogether,
+    //      so that the table shrinks again.
+    auto end = _attributes.size();
+    while (end > 0 && !isUsed(end - 1))
+    {
+        --end;
+    }
+
+    for (auto id = end; id > 0; --id)
+    {
+        if (!isUsed(id - 1))
+        {
+            freeIds.push_back(static_cast<id_type>(id - 1));
+        }
+    }
+
+    // Nothing below can fail, so the table can't be left half done.
+    const auto forget = [&](const size_t id) noexcept {
+        const auto found = _ids.find(_attributes[id]);
+        if (found != _ids.end() && found->second == id)
+        {
+            _ids.erase(found);
+        }
+    };
+
+    for (const auto id : freeIds)
+    {
+        forget(id);
+    }
+    while (_attributes.size() > end)
+    {
+        forget(_attributes.size() - 1);
+        _attributes.pop_back();
+    }
+    _freeIds.swap(freeIds);
+}
@@ -0,0 +1,75 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- TextAttributeTable.hpp
+
+Abstract:
+- Interns the text attributes used by one text buffer. Every distinct
+    TextAttribute is stored once, and the attribute rows only keep its ID.
+- This keeps attribute runs small, and lets two runs be compared by their IDs
+    instead of field by field.
+- Attributes are never moved, so a reference to an interned attribute stays
+    valid for as long as its ID does. The IDs of attributes that nothing uses
+    anymore are freed by ReleaseUnused, and handed out again for new ones.
+--*/
+
+#pragma once
+
+#include "TextAttribute.hpp"
+
+#include <deque>
+#include <unordered_map>
+
+// std::unordered_map needs help to know how to hash a TextAttribute
+namespace std
+{
+    template <>
+    struct hash<TextAttribute>
+    {
+        // Routine Description:
+        // - hashes a text attribute, from all of its colors and flags.
+        // Arguments:
+        // - attr - the text attribute to hash
+        // Return Value:
+        // - the hashed text attribute
+        constexpr size_t operator()(const TextAttribute& attr) const noexcept
+        {
+            return attr.GetHash();
+        }
+    };
+}
+
+class TextAttributeTable final
+{
+public:
+    using id_type = uint32_t;
+
+    // The number of distinct attributes a table can hold. Far more than a
+    // buffer has cells, so that every cell can have an attribute of its own.
+    static constexpr size_t Capacity = std::numeric_limits<id_type>::max();
+
+    TextAttributeTable();
+
+    id_type Intern(const TextAttribute& attr);
+    const TextAttribute& Get(const id_type id) const noexcept;
+
+    size_t Size() const noexcept;
+    size_t Remaining() const noexcept;
+    size_t IdLimit() const noexcept;
+
+    void ReleaseUnused(const std::vector<bool>& used);
+
+private:
+    std::deque<TextAttribute> _attributes;
+    std::unordered_map<TextAttribute, id_type> _ids;
+
+    // IDs that were released, to be reused before the table grows. The
+    // lowest ID is at the back, so it's reused first.
+    std::vector<id_type> _freeIds;
+
+#ifdef UNIT_TESTING
+    friend class TextAttributeTableTests;
+#endif
+};
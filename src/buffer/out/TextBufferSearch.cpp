@@ -0,0 +1,384 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "TextBufferSearch.hpp"
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <emmintrin.h>
+#endif
+
+// Routine Description:
+// - Prepares a search for the given string
+// Arguments:
+// - needle - the text to search for
+// - caseInsensitive - true to ignore the case of the text when matching
+TextBufferSearch::TextBufferSearch(const std::wstring_view needle, const bool caseInsensitive) :
+    _needle{ needle },
+    _asciiNeedle{},
+    _caseInsensitive{ caseInsensitive }
+{
+    if (_caseInsensitive)
+    {
+        std::transform(_needle.begin(), _needle.end(), _needle.begin(), [](const wchar_t wch) {
+            return static_cast<wchar_t>(::towlower(wch));
+        });
+    }
+
+    // ASCII only rows can only ever match an ASCII only needle, so that's the
+    // only case where we need a one byte per char copy of the needle.
+    if (std::all_of(_needle.cbegin(), _needle.cend(), [](const wchar_t wch) { return wch < 0x80; }))
+    {
+        _asciiNeedle.reserve(_needle.size());
+        std::transform(_needle.cbegin(), _needle.cend(), std::back_inserter(_asciiNeedle), [](const wchar_t wch) {
+            return static_cast<char>(wch);
+        });
+    }
+}
+
+// Routine Description:
+// - Finds every occurrence of the needle in the text buffer. Overlapping
+//   occurrences are all reported.
+// Arguments:
+// - textBuffer - the buffer to search
+// Return Value:
+// - the first and last cell of each match, in buffer order
+// Note: will throw exception if unable to allocate memory for the matches
+std::vector<TextBufferSearch::Match> TextBufferSearch::FindAll(const TextBuffer& textBuffer) const
+{
+    std::vector<Match> matches;
+    if (_needle.empty())
+    {
+        return matches;
+    }
+
+    // Split the buffer into logical lines, so that matches can span wrapped rows.
+    const size_t height = textBuffer.TotalRowCount();
+    std::vector<Line> lines;
+    size_t first = 0;
+    for (size_t row = 0; row < height; ++row)
+    {
+        if (row + 1 == height || !textBuffer.GetRowByOffset(row).GetCharRow().WasWrapForced())
+        {
+            lines.push_back({ first, row - first + 1 });
+            first = row + 1;
+        }
+    }
+
+    // Every batch gets its own list of matches, so that the workers don't
+    // have to share anything but the index of the next batch to search.
+    const size_t batchCount = (lines.size() + s_BatchLines - 1) / s_BatchLines;
+    std::vector<std::vector<Match>> batches(batchCount);
+    std::vector<std::exception_ptr> errors(batchCount);
+    std::atomic<size_t> nextBatch{ 0 };
+
+    const auto searchBatches = [&]() noexcept {
+        for (size_t batch = nextBatch++; batch < batchCount; batch = nextBatch++)
+        {
+            try
+            {
+                const size_t begin = batch * s_BatchLines;
+                const size_t end = std::min(begin + s_BatchLines, lines.size());
+                _SearchLines(textBuffer, lines, begin, end, batches.at(batch));
+            }
+            catch (...)
+            {
+                errors.at(batch) = std::current_exception();
+            }
+        }
+    };
+
+    // The other threads come from the threadpool, rather than being started
+    // for every search. If we can't get any, this thread does it all.
+    wil::unique_threadpool_work_nocancel work;
+    if (height >= s_ParallelRows)
+    {
+        work.reset(CreateThreadpoolWork([](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+                                            (*static_cast<decltype(searchBatches)*>(context))();
+                                        },
+                                        const_cast<void*>(static_cast<const void*>(&searchBatches)),
+                                        nullptr));
+        LOG_LAST_ERROR_IF(!work);
+    }
+
+    if (work)
+    {
+        const size_t threadCount = std::min<size_t>(batchCount, std::thread::hardware_concurrency());
+        for (size_t i = 1; i < threadCount; ++i)
+        {
+            SubmitThreadpoolWork(work.get());
+        }
+    }
+
+    searchBatches();
+    if (work)
+    {
+        WaitForThreadpoolWorkCallbacks(work.get(), FALSE);
+    }
+
+    for (const auto& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t total = 0;
+    for (const auto& batch : batches)
+    {
+        total += batch.size();
+    }
+    matches.reserve(total);
+    for (const auto& batch : batches)
+    {
+        matches.insert(matches.end(), batch.cbegin(), batch.cend());
+    }
+    return matches;
+}
+
+// Routine Description:
+// - Searches a range of logical lines
+// Arguments:
+// - textBuffer - the buffer to search
+// - lines - all of the logical lines in the buffer
+// - begin - the first line to search
+// - end - one past the last line to search
+// - matches - receives the matches found, in buffer order
+void TextBufferSearch::_SearchLines(const TextBuffer& textBuffer,
+                                    const std::vector<Line>& lines,
+                                    const size_t begin,
+                                    const size_t end,
+                                    std::vector<Match>& matches) const
+{
+    // These are only kept here so that their memory is reused from line to line.
+    std::string asciiScratch;
+    std::wstring scratch;
+    std::vector<Match> cells;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        const auto line = lines.at(i);
+
+        bool isAscii = true;
+        for (size_t row = line.first; row < line.first + line.count && isAscii; ++row)
+        {
+            isAscii = textBuffer.GetRowByOffset(row).GetCharRow().IsAscii();
+        }
+
+        if (isAscii)
+        {
+            _SearchAsciiLine(textBuffer, line, asciiScratch, matches);
+        }
+        else
+        {
+            _SearchLine(textBuffer, line, scratch, cells, matches);
+        }
+    }
+}
+
+// Routine Description:
+// - Searches a logical line made only of rows stored at one byte per cell.
+//   Every char is one column there, so the text is searched as it's stored,
+//   and the position of a match gives its cells directly.
+// Arguments:
+// - textBuffer - the buffer to search
+// - line - the line to search
+// - scratch - used to join the rows of a wrapped line
+// - matches - receives the matches found
+void TextBufferSearch::_SearchAsciiLine(const TextBuffer& textBuffer,
+                                        const Line line,
+                                        std::string& scratch,
+                                        std::vector<Match>& matches) const
+{
+    // An ASCII row can't contain any of the chars of a non-ASCII needle.
+    if (_asciiNeedle.empty())
+    {
+        return;
+    }
+
+    std::string_view text;
+    if (line.count == 1)
+    {
+        text = textBuffer.GetRowByOffset(line.first).GetCharRow().GetAsciiText();
+    }
+    else
+    {
+        scratch.clear();
+        for (size_t row = line.first; row < line.first + line.count; ++row)
+        {
+            scratch.append(textBuffer.GetRowByOffset(row).GetCharRow().GetAsciiText());
+        }
+        text = scratch;
+    }
+
+    const size_t width = textBuffer.GetRowByOffset(line.first).GetCharRow().size();
+    const auto toCoord = [&](const size_t index) {
+        return COORD{ gsl::narrow_cast<SHORT>(index % width), gsl::narrow_cast<SHORT>(line.first + index / width) };
+    };
+
+    s_FindEach<char>(text, _asciiNeedle, _caseInsensitive, [&](const size_t index) {
+        matches.push_back({ toCoord(index), toCoord(index + _asciiNeedle.size() - 1) });
+    });
+}
+
+// Routine Description:
+// - Searches a logical line that has non-ASCII text in it. The text of the
+//   line is built up along with the cells that each of its code units came
+//   from, so that the matches can be mapped back to the buffer.
+// - The trailing half of a double width glyph is skipped, since it has the
+//   same glyph as its leading half.
+// Arguments:
+// - textBuffer - the buffer to search
+// - line - the line to search
+// - scratch - receives the text of the line
+// - cells - receives the first and last cell of each code unit of the text
+// - matches - receives the matches found
+void TextBufferSearch::_SearchLine(const TextBuffer& textBuffer,
+                                   const Line line,
+                                   std::wstring& scratch,
+                                   std::vector<Match>& cells,
+                                   std::vector<Match>& matches) const
+{
+    scratch.clear();
+    cells.clear();
+
+    for (size_t row = line.first; row < line.first + line.count; ++row)
+    {
+        const auto& charRow = textBuffer.GetRowByOffset(row).GetCharRow();
+        const size_t width = charRow.size();
+        const auto y = gsl::narrow_cast<SHORT>(row);
+        for (size_t column = 0; column < width; ++column)
+        {
+            const auto& dbcsAttr = charRow.DbcsAttrAt(column);
+            if (dbcsAttr.IsTrailing())
+            {
+                continue;
+            }
+
+            const auto lastColumn = dbcsAttr.IsLeading() && column + 1 < width ? column + 1 : column;
+            const Match cell{ { gsl::narrow_cast<SHORT>(column), y }, { gsl::narrow_cast<SHORT>(lastColumn), y } };
+
+            const std::wstring_view glyph = charRow.GlyphAt(column);
+            for (const auto wch : glyph)
+            {
+                scratch.push_back(_caseInsensitive ? static_cast<wchar_t>(::towlower(wch)) : wch);
+                cells.push_back(cell);
+            }
+        }
+    }
+
+    s_FindEach<wchar_t>(scratch, _needle, false, [&](const size_t index) {
+        matches.push_back({ cells.at(index).first, cells.at(index + _needle.size() - 1).second });
+    });
+}
+
+// Routine Description:
+// - Calls onMatch with the position of every occurrence of needle in text.
+//   Candidates are found by their first char, and then verified.
+// Arguments:
+// - text - the text to search
+// - needle - the text to search for. Must not be empty. If foldAscii is set,
+//   it must already be lowercase.
+// - foldAscii - true to ignore the case of ASCII letters in text
+// - onMatch - called with the index in text of each match
+template<typename T, typename F>
+void TextBufferSearch::s_FindEach(const std::basic_string_view<T> text,
+                                  const std::basic_string_view<T> needle,
+                                  const bool foldAscii,
+                                  F onMatch)
+{
+    if (needle.size() > text.size())
+    {
+        return;
+    }
+
+    const T first = needle.front();
+    const T firstUpper = (foldAscii && first >= 'a' && first <= 'z') ? static_cast<T>(first - ('a' - 'A')) : first;
+
+    // A match can't start any later than this.
+    const T* const begin = text.data();
+    const T* const end = begin + (text.size() - needle.size()) + 1;
+
+    for (auto it = s_FindFirst(begin, end, first, firstUpper); it != end; it = s_FindFirst(it + 1, end, first, firstUpper))
+    {
+        const bool isMatch = foldAscii ?
+                                 std::equal(it + 1, it + needle.size(), needle.cbegin() + 1, [](const T a, const T b) {
+                                     return s_FoldAscii(a) == b;
+                                 }) :
+                                 std::char_traits<T>::compare(it + 1, needle.data() + 1, needle.size() - 1) == 0;
+        if (isMatch)
+        {
+            onMatch(static_cast<size_t>(it - begin));
+        }
+    }
+}
+
+// Routine Description:
+// - Finds the first char in a range that is either of two values. On x86/x64
+//   this checks 16 bytes at a time with SSE2, and only falls back to the
+//   scalar check for the tail of the range.
+// Arguments:
+// - it - the start of the range to scan
+// - end - one past the end of the range to scan
+// - a - a char to look for
+// - b - another char to look for. Pass a again to look for just one char.
+// Return Value:
+// - Pointer to the first char that is a or b, or end if there is none.
+template<typename T>
+const T* TextBufferSearch::s_FindFirst(const T* it, const T* const end, const T a, const T b) noexcept
+{
+    static_assert(sizeof(T) == sizeof(uint8_t) || sizeof(T) == sizeof(uint16_t));
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+    constexpr size_t charsPerVector = sizeof(__m128i) / sizeof(T);
+
+    __m128i vectorA;
+    __m128i vectorB;
+    if constexpr (sizeof(T) == sizeof(uint8_t))
+    {
+        vectorA = _mm_set1_epi8(static_cast<char>(a));
+        vectorB = _mm_set1_epi8(static_cast<char>(b));
+    }
+    else
+    {
+        vectorA = _mm_set1_epi16(static_cast<short>(a));
+        vectorB = _mm_set1_epi16(static_cast<short>(b));
+    }
+
+    while (static_cast<size_t>(end - it) >= charsPerVector)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+
+        __m128i isCandidate;
+        if constexpr (sizeof(T) == sizeof(uint8_t))
+        {
+            isCandidate = _mm_or_si128(_mm_cmpeq_epi8(chars, vectorA), _mm_cmpeq_epi8(chars, vectorB));
+        }
+        else
+        {
+            isCandidate = _mm_or_si128(_mm_cmpeq_epi16(chars, vectorA), _mm_cmpeq_epi16(chars, vectorB));
+        }
+
+        // One mask bit per byte, so wide chars have two bits each.
+        const unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(isCandidate));
+        if (mask != 0)
+        {
+            unsigned long bitIndex;
+            _BitScanForward(&bitIndex, mask);
+            return it + (bitIndex / sizeof(T));
+        }
+
+        it += charsPerVector;
+    }
+#endif
+
+    for (; it != end; ++it)
+    {
+        if (*it == a || *it == b)
+        {
+            return it;
+        }
+    }
+    return end;
+}
@@ -0,0 +1,85 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- TextBufferSearch.hpp
+
+Abstract:
+- Finds every occurrence of a string in a text buffer in one pass.
+- The buffer is searched a logical line at a time, where a logical line is a
+    run of rows joined by forced wraps, so a match can span wrapped rows.
+- Rows stored at one byte per cell are searched in place, without building a
+    string per row. The candidates for a match are found with SSE2 where it's
+    available.
+- Large buffers are split into batches of lines that are searched on several
+    threads of the process's threadpool at once. The matches are still
+    returned in buffer order.
+--*/
+
+#pragma once
+
+#include "textBuffer.hpp"
+
+class TextBufferSearch final
+{
+public:
+    // The first and the last cell of a match, both inclusive.
+    using Match = typename std::pair<COORD, COORD>;
+
+    TextBufferSearch(const std::wstring_view needle, const bool caseInsensitive);
+
+    std::vector<Match> FindAll(const TextBuffer& textBuffer) const;
+
+private:
+    // The logical line made of the rows [first, first + count).
+    struct Line
+    {
+        size_t first;
+        size_t count;
+    };
+
+    // Lines are searched in batches of this many.
+    static constexpr size_t s_BatchLines = 512;
+
+    // Buffers with at least this many rows are searched on several threads.
+    // Anything up to the default scrollback is searched quicker than it takes
+    // to get other threads going.
+    static constexpr size_t s_ParallelRows = 16384;
+
+    std::wstring _needle;
+    std::string _asciiNeedle;
+    bool _caseInsensitive;
+
+    void _SearchLines(const TextBuffer& textBuffer,
+                      const std::vector<Line>& lines,
+                      const size_t begin,
+                      const size_t end,
+                      std::vector<Match>& matches) const;
+
+    void _SearchAsciiLine(const TextBuffer& textBuffer,
+                          const Line line,
+                          std::string& scratch,
+                          std::vector<Match>& matches) const;
+
+    void _SearchLine(const TextBuffer& textBuffer,
+                     const Line line,
+                     std::wstring& scratch,
+                     std::vector<Match>& cells,
+                     std::vector<Match>& matches) const;
+
+    template<typename T, typename F>
+    static void s_FindEach(const std::basic_string_view<T> text,
+                           const std::basic_string_view<T> needle,
+                           const bool foldAscii,
+                           F onMatch);
+
+    template<typename T>
+    static const T* s_FindFirst(const T* it, const T* const end, const T a, const T b) noexcept;
+
+    template<typename T>
+    static constexpr T s_FoldAscii(const T ch) noexcept
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<T>(ch + ('a' - 'A')) : ch;
+    }
+};
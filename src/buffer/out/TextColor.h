@@ -105,6 +105,12 @@ public:
         return _index;
     }
 
+    // Packs every field of the color into one value, for hashing.
+    constexpr DWORD GetHashKey() const noexcept
+    {
+        return (static_cast<DWORD>(_meta) << 24) | (_red << 16) | (_green << 8) | _blue;
+    }
+
 
 private:
     ColorType _meta : 2;
@@ -5,94 +5,95 @@
 #include "UnicodeStorage.hpp"
 
 UnicodeStorage::UnicodeStorage() :
-    _map{}
+    _glyphs{}
 {
 }
 
 // Routine Description:
 // - fetches the text associated with key
 // Arguments:
-// - key - the key into the storage
+// - key - the column of the glyph in its row
 // Return Value:
 // - the glyph data associated with key
 // Note: will throw exception if key is not stored yet
 const UnicodeStorage::mapped_type& UnicodeStorage::GetText(const key_type key) const
 {
-    return _map.at(key);
+    const auto it = _Find(key);
+    THROW_HR_IF(E_INVALIDARG, it == _glyphs.cend() || it->first != key);
+    return it->second;
 }
 
 // Routine Description:
 // - stores glyph data associated with key.
 // Arguments:
-// - key - the key into the storage
+// - key - the column of the glyph in its row
 // - glyph - the glyph data to store
-void UnicodeStorage::StoreGlyph(const key_type key, const mapped_type& glyph)
+void UnicodeStorage::StoreGlyph(const key_type key, const std::wstring_view glyph)
 {
-    _map.insert_or_assign(key, glyph);
+    const auto it = _Find(key);
+    if (it != _glyphs.end() && it->first == key)
+    {
+        it->second.assign(glyph);
+    }
+    else
+    {
+        _glyphs.emplace(it, key, mapped_type{ glyph });
+    }
 }
 
 // Routine Description:
 // - erases key and it's associated data from the storage
 // Arguments:
-// - key - the key to remove
+// - key - the column to remove
 void UnicodeStorage::Erase(const key_type key) noexcept
 {
-    _map.erase(key);
+    const auto it = _Find(key);
+    if (it != _glyphs.end() && it->first == key)
+    {
+        _glyphs.erase(it);
+    }
 }
 
 // Routine Description:
-// - Remaps all of the stored items to new coordinate positions
-//   based on a bulk rearrangement of row IDs and potential row width resize.
+// - drops every glyph that no longer fits in a row of the given width
 // Arguments:
-// - rowMap - A map of the old row IDs to the new row IDs.
-// - width - The width of the new row. Remove any items that are beyond the row width.
-//         - Use nullopt if we're not resizing the width of the row, just renumbering the rows.
-void UnicodeStorage::Remap(const std::map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width)
+// - width - The new width of the row. Anything at or beyond it is removed.
+void UnicodeStorage::Resize(const size_t width) noexcept
 {
-    // Make a temporary map to hold all the new row positioning
-    std::unordered_map<key_type, mapped_type> newMap;
-
-    // Walk through every stored item.
-    for (const auto& pair : _map)
-    {
-        // Extract the old coordinate position
-        const auto oldCoord = pair.first;
-
-        // Only try to short-circuit based on width if we were told it changed
-        // by being given a new width value.
-        if (width.has_value())
-        {
-            // Get the column ID
-            const auto oldColId = oldCoord.X;
-
-            // If the column index is at/beyond the row width, don't bother copying it to the new map.
-            if (oldColId >= width.value())
-            {
-                continue;
-            }
-        }
-
-        // Get the row ID from the position as that's what we need to remap
-        const auto oldRowId = oldCoord.Y;
-
-        // Use the mapping given to convert the old row ID to the new row ID
-        const auto mapIter = rowMap.find(oldRowId);
-
-        // If there's no mapping to a new row, don't bother copying it to the new map. The row is gone.
-        if (mapIter == rowMap.end())
-        {
-            continue;
-        }
-
-        const auto newRowId = mapIter->second;
+    _glyphs.erase(_Find(width), _glyphs.end());
+}
 
-        // Generate a new coordinate with the same X as the old one, but a new Y value.
-        const auto newCoord = COORD{ oldCoord.X, newRowId };
+// Routine Description:
+// - removes all of the stored glyphs
+void UnicodeStorage::Clear() noexcept
+{
+    _glyphs.clear();
+}
 
-        // Put the adjusted coordinate into the map with the original value.
-        newMap.emplace(newCoord, pair.second);
-    }
+// Routine Description:
+// - finds the first stored glyph at or after the given column
+// Arguments:
+// - key - the column to look for
+// Return Value:
+// - iterator to the glyph, or to where it would be inserted
+std::vector<UnicodeStorage::value_type>::iterator UnicodeStorage::_Find(const key_type key) noexcept
+{
+    return std::lower_bound(_glyphs.begin(),
+                            _glyphs.end(),
+                            key,
+                            [](const value_type& glyph, const key_type column) noexcept { return glyph.first < column; });
+}
 
-    // Swap into the stored map, free the temporary when we exit.
-    _map.swap(newMap);
+// Routine Description:
+// - finds the first stored glyph at or after the given column
+// Arguments:
+// - key - the column to look for
+// Return Value:
+// - iterator to the glyph, or to where it would be inserted
+std::vector<UnicodeStorage::value_type>::const_iterator UnicodeStorage::_Find(const key_type key) const noexcept
+{
+    return std::lower_bound(_glyphs.cbegin(),
+                            _glyphs.cend(),
+                            key,
+                            [](const value_type& glyph, const key_type column) noexcept { return glyph.first < column; });
 }
@@ -7,6 +7,10 @@ Module Name:
 
 Abstract:
 - dynamic storage location for glyphs that can't normally fit in the output buffer
+- Each ROW owns one of these, keyed by column, so that scrolling the circular
+    buffer or renumbering rows never has to touch the stored glyphs.
+- Rows rarely hold more than a handful of these glyphs, so they're kept in a
+    vector sorted by column rather than in a hash map.
 
 Author(s):
 - Austin Diviness (AustDi) 02-May-2018
@@ -15,51 +19,33 @@ Author(s):
 #pragma once
 
 #include <vector>
-#include <unordered_map>
-#include <climits>
-
-// std::unordered_map needs help to know how to hash a COORD
-namespace std
-{
-    template <>
-    struct hash<COORD>
-    {
-
-        // Routine Description:
-        // - hashes a coord. coord will be hashed by storing the x and y values consecutively in the lower
-        // bits of a size_t.
-        // Arguments:
-        // - coord - the coord to hash
-        // Return Value:
-        // - the hashed coord
-        constexpr size_t operator()(const COORD& coord) const noexcept
-        {
-            size_t retVal = coord.Y;
-            const size_t xCoord = coord.X;
-            retVal |= xCoord << (sizeof(coord.Y) * CHAR_BIT);
-            return retVal;
-        }
-    };
-}
 
 class UnicodeStorage final
 {
 public:
-    using key_type = typename COORD;
-    using mapped_type = typename std::vector<wchar_t>;
+    using key_type = typename size_t;
+    using mapped_type = typename std::wstring;
 
     UnicodeStorage();
 
     const mapped_type& GetText(const key_type key) const;
 
-    void StoreGlyph(const key_type key, const mapped_type& glyph);
+    void StoreGlyph(const key_type key, const std::wstring_view glyph);
 
     void Erase(const key_type key) noexcept;
 
-    void Remap(const std::map<SHORT, SHORT>& rowMap, const std::optional<SHORT> width);
+    void Resize(const size_t width) noexcept;
+
+    void Clear() noexcept;
 
 private:
-    std::unordered_map<key_type, mapped_type> _map;
+    using value_type = typename std::pair<key_type, mapped_type>;
+
+    // sorted by column
+    std::vector<value_type> _glyphs;
+
+    std::vector<value_type>::iterator _Find(const key_type key) noexcept;
+    std::vector<value_type>::const_iterator _Find(const key_type key) const noexcept;
 
 #ifdef UNIT_TESTING
     friend class UnicodeStorageTests;
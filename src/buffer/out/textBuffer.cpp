@@ -30,7 +30,10 @@ TextBuffer::TextBuffer(const COORD screenBufferSize,
     _currentAttributes{ defaultAttributes },
     _cursor{ cursorSize, *this },
     _storage{},
-    _unicodeStorage{},
+    _attributeTable{},
+    _attributeSweepSize{ MinAttributeSweepSize },
+    _scrollback{},
+    _unreflowedRows{},
     _renderTarget{ renderTarget }
 {
     // initialize ROWs
@@ -182,7 +185,7 @@ bool TextBuffer::_AssertValidDoubleByteSequence(const DbcsAttribute dbcsAttribut
 {
     // To figure out if the sequence is valid, we have to look at the character that comes before the current one
     const COORD coordPrevPosition = _GetPreviousFromCursor();
-    ROW& prevRow = GetRowByOffset(coordPrevPosition.Y);
+    const ROW& prevRow = GetRowByOffset(coordPrevPosition.Y);
     DbcsAttribute prevDbcsAttr;
     try
     {
@@ -362,6 +365,10 @@ OutputCellIterator TextBuffer::WriteLine(const OutputCellIterator givenIt,
 
     //  Get the row and write the cells
     ROW& row = GetRowByOffset(target.Y);
+
+    // Every cell we write could bring a new attribute with it.
+    _ReserveAttributes(row.size());
+
     const auto newIt = row.WriteCells(givenIt, target.X, setWrap, limitRight);
 
     // Take the cell distance written and notify that it needs to be repainted.
@@ -404,7 +411,7 @@ bool TextBuffer::InsertCharacter(const std::wstring_view chars,
         try
         {
             charRow.GlyphAt(iCol) = chars;
-            charRow.DbcsAttrAt(iCol) = dbcsAttribute;
+            charRow.SetDbcsAttrAt(iCol, dbcsAttribute);
         }
         catch (...)
         {
@@ -413,6 +420,15 @@ bool TextBuffer::InsertCharacter(const std::wstring_view chars,
         }
 
         // Store color data
+        try
+        {
+            _ReserveAttributes(1);
+        }
+        catch (...)
+        {
+            LOG_HR(wil::ResultFromCaughtException());
+            return false;
+        }
         fSuccess = Row.GetAttrRow().SetAttrToEnd(iCol, attr);
         if (fSuccess)
         {
@@ -539,6 +555,14 @@ bool TextBuffer::IncrementCircularBuffer()
     // to the logical position 0 in the window (cursor coordinates and all other coordinates).
     _renderTarget.TriggerCircling();
 
+    // Keep the old "first row" in the history before it's cleaned out. Losing
+    // it from there isn't worth failing the scroll over.
+    try
+    {
+        _ScrollOutRow(_storage.at(_firstRow));
+    }
+    CATCH_LOG();
+
     // First, clean out the old "first row" as it will become the "last row" of the buffer after the circle is performed.
     bool fSuccess = _storage.at(_firstRow).Reset(_currentAttributes);
     if (fSuccess)
@@ -734,7 +758,7 @@ void TextBuffer::ScrollRows(const SHORT firstRow, const SHORT size, const SHORT
     }
 
     // Renumber the IDs now that we've rearranged where the rows sit within the buffer.
-    // Refreshing should also delegate to the UnicodeStorage to re-key all the stored unicode sequences (where applicable).
+    // Each row carries its own UnicodeStorage along with it, so nothing needs to be re-keyed.
     _RefreshRowIDs(std::nullopt);
 }
 
@@ -820,7 +844,7 @@ NTSTATUS TextBuffer::ResizeTraditional(const COORD newSize) noexcept
 
         // Now that we've tampered with the row placement, refresh all the row IDs.
         // Also take advantage of the row ID refresh loop to resize the rows in the X dimension
-        // and cleanup the UnicodeStorage characters that might fall outside the resized buffer.
+        // (which also drops any UnicodeStorage glyphs that fall outside the resized row).
         _RefreshRowIDs(newSize.X);
 
     }
@@ -829,14 +853,535 @@ NTSTATUS TextBuffer::ResizeTraditional(const COORD newSize) noexcept
     return S_OK;
 }
 
-const UnicodeStorage& TextBuffer::GetUnicodeStorage() const
+// Routine Description:
+// - Resizes the buffer, rewrapping its text to the new width. Rows are joined
+//   into logical lines by their wrap-forced flag, and each logical line is
+//   laid out again at the new width.
+// - Only the rows from ReflowMargin above the first visible row down to the
+//   last row in use are reflowed right away. The rows above those are set
+//   aside at the width they had, and reflowed later by ReflowHistory, so that
+//   dragging a window edge doesn't cost anything for the history. They stay
+//   set aside until then, or until as many rows have scrolled out of the
+//   buffer after them.
+// - The reflowed rows start at the top of the buffer. The cursor is moved to
+//   the same spot in the text.
+// Arguments:
+// - newSize - new size of the buffer
+// - firstVisibleRow - the top row of the viewport
+// Return Value:
+// - S_OK if successful. E_INVALIDARG if the size is unexpected. E_OUTOFMEMORY if allocation failed.
+[[nodiscard]]
+HRESULT TextBuffer::ResizeWithReflow(const COORD newSize, const SHORT firstVisibleRow) noexcept
+{
+    RETURN_HR_IF(E_INVALIDARG, newSize.X <= 0 || newSize.Y <= 0);
+
+    try
+    {
+        const auto oldCursor = _cursor.GetPosition();
+        const auto lastRow = std::max(oldCursor.Y, GetLastNonSpaceCharacter().Y);
+
+        // Always start at the beginning of a logical line, and never below the
+        // cursor's line, so the cursor always has somewhere to go.
+        const auto marginTop = std::clamp(firstVisibleRow - ReflowMargin, 0, static_cast<int>(lastRow));
+        const auto firstRow = _GetLogicalLineStart(std::min(static_cast<SHORT>(marginTop), oldCursor.Y));
+
+        std::vector<const ROW*> rows;
+        rows.reserve(lastRow - firstRow + 1);
+        for (auto row = firstRow; row <= lastRow; ++row)
+        {
+            rows.push_back(&GetRowByOffset(row));
+        }
+
+        COORD cursor{ oldCursor.X, gsl::narrow_cast<SHORT>(oldCursor.Y - firstRow) };
+        auto reflowed = _ReflowRows(rows, newSize.X, &cursor);
+        while (reflowed.size() < static_cast<size_t>(newSize.Y))
+        {
+            reflowed.emplace_back(0i16, newSize.X, _currentAttributes, this);
+        }
+
+        // Set aside the rows above the reflowed ones, oldest first.
+        _RotateToFirstRow();
+        for (SHORT row = 0; row < firstRow; ++row)
+        {
+            auto& unreflowed = _unreflowedRows.emplace_back(std::move(_storage.front()));
+            unreflowed.GetCharRow().UpdateParent(&unreflowed);
+            _storage.pop_front();
+        }
+
+        _storage.swap(reflowed);
+
+        // If the text takes more rows than the buffer has, the oldest of them
+        // scroll out of it, right after the rows that were set aside.
+        while (_storage.size() > static_cast<size_t>(newSize.Y))
+        {
+            try
+            {
+                _ScrollOutRow(_storage.front());
+            }
+            CATCH_LOG();
+            _storage.pop_front();
+            if (cursor.Y > 0)
+            {
+                cursor.Y--;
+            }
+        }
+
+        _RefreshRowIDs(std::nullopt);
+        _cursor.SetPosition(cursor);
+    }
+    CATCH_RETURN();
+
+    return S_OK;
+}
+
+// Routine Description:
+// - Gets how many rows a reflowing resize set aside above the top of the
+//   buffer that haven't been reflowed yet.
+// Return Value:
+// - the number of rows, at whatever width they had
+size_t TextBuffer::GetUnreflowedRowCount() const noexcept
+{
+    return _unreflowedRows.size();
+}
+
+// Routine Description:
+// - Reflows the newest of the rows set aside by ResizeWithReflow, and puts
+//   them back at the top of the buffer. Everything in the buffer moves down to
+//   make room, into the empty rows below the last row in use.
+// - Whatever doesn't fit in the buffer anymore stays set aside. It's reflowed
+//   once there's room for it, if it doesn't scroll on into the store first.
+// Arguments:
+// - rows - how many rows to add at the top. More may be added to finish a
+//      logical line.
+// - lastRowInUse - the last row that has to stay in the buffer, like the
+//      bottom of the viewport. The cursor's row and the last row with text
+//      are always kept.
+// Return Value:
+// - how many rows were added at the top, which is how far everything moved down.
+// Note: will throw exception if unable to allocate the new rows
+SHORT TextBuffer::ReflowHistory(const SHORT rows, const SHORT lastRowInUse)
+{
+    if (_unreflowedRows.empty() || rows <= 0)
+    {
+        return 0;
+    }
+
+    const auto size = GetSize().Dimensions();
+    const auto lastRow = std::max({ lastRowInUse, _cursor.GetPosition().Y, GetLastNonSpaceCharacter().Y });
+    const auto freeRows = static_cast<size_t>(std::max(size.Y - 1 - lastRow, 0));
+
+    std::deque<ROW> reflowed;
+    std::vector<const ROW*> lineRows;
+    while (!_unreflowedRows.empty() && reflowed.size() < static_cast<size_t>(rows))
+    {
+        // Take the newest logical line that's left.
+        auto start = _unreflowedRows.size() - 1;
+        while (start > 0 && _unreflowedRows[start - 1].GetCharRow().WasWrapForced())
+        {
+            --start;
+        }
+
+        lineRows.clear();
+        for (auto row = start; row < _unreflowedRows.size(); ++row)
+        {
+            lineRows.push_back(&_unreflowedRows[row]);
+        }
+
+        auto line = _ReflowRows(lineRows, size.X, nullptr);
+        if (reflowed.size() + line.size() > freeRows)
+        {
+            break;
+        }
+
+        reflowed.insert(reflowed.begin(), std::make_move_iterator(line.begin()), std::make_move_iterator(line.end()));
+        _unreflowedRows.erase(_unreflowedRows.begin() + start, _unreflowedRows.end());
+    }
+
+    const auto added = gsl::narrow<SHORT>(reflowed.size());
+    if (added > 0)
+    {
+        _RotateToFirstRow();
+        _storage.insert(_storage.begin(), std::make_move_iterator(reflowed.begin()), std::make_move_iterator(reflowed.end()));
+        _storage.erase(_storage.end() - added, _storage.end());
+        _RefreshRowIDs(std::nullopt);
+
+        auto cursor = _cursor.GetPosition();
+        cursor.Y += added;
+        _cursor.SetPosition(cursor);
+
+        _renderTarget.TriggerRedrawAll();
+    }
+    return added;
+}
+
+TextAttributeTable& TextBuffer::GetAttributeTable() noexcept
+{
+    return _attributeTable;
+}
+
+ScrollbackStore& TextBuffer::GetScrollback() noexcept
 {
-    return _unicodeStorage;
+    return _scrollback;
 }
 
-UnicodeStorage& TextBuffer::GetUnicodeStorage()
+const ScrollbackStore& TextBuffer::GetScrollback() const noexcept
 {
-    return _unicodeStorage;
+    return _scrollback;
+}
+
+// Routine Description:
+// - Gets how many rows of history there are above the top of the buffer: the
+//      lines in the scrollback store, then the rows a reflowing resize set
+//      aside. Unlike the buffer's own rows, they can be more than a SHORT holds.
+// Return Value:
+// - the number of rows
+size_t TextBuffer::GetHistoryRowCount() const noexcept
+{
+    return _scrollback.size() + _unreflowedRows.size();
+}
+
+// Routine Description:
+// - Copies rows of the history into rows of another buffer, so that they can
+//      be drawn or selected like any other row.
+// - The history rows are numbered from 0, the oldest line in the store, up to
+//      GetHistoryRowCount(). The numbers after that go on into the rows of
+//      this buffer, so a range can cross from the history into the buffer.
+// - Rows that were wider than the target are cut off, and narrower ones are
+//      filled out with the target's current attributes.
+// Arguments:
+// - firstRow - the number of the first row to copy
+// - count - how many rows to copy
+// - target - the buffer to copy into. It mustn't be this one.
+// - targetRow - the row of the target to copy the first row into, in offset
+//      coordinates like GetRowByOffset
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::CopyHistoryRows(const size_t firstRow,
+                                 const size_t count,
+                                 TextBuffer& target,
+                                 const SHORT targetRow) const
+{
+    ScrollbackStore::Reader reader{ _scrollback };
+    CopyHistoryRows(firstRow, count, target, targetRow, reader);
+}
+
+// Routine Description:
+// - Copies rows of the history into rows of another buffer, like the other
+//      CopyHistoryRows, reading the store through the given reader. A caller
+//      that copies rows over and over can keep a reader, so that the page it
+//      decoded last isn't decoded again.
+// Arguments:
+// - firstRow - the number of the first row to copy
+// - count - how many rows to copy
+// - target - the buffer to copy into. It mustn't be this one.
+// - targetRow - the row of the target to copy the first row into, in offset
+//      coordinates like GetRowByOffset
+// - reader - a reader of this buffer's scrollback store
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::CopyHistoryRows(const size_t firstRow,
+                                 const size_t count,
+                                 TextBuffer& target,
+                                 const SHORT targetRow,
+                                 ScrollbackStore::Reader& reader) const
+{
+    const auto storeRows = _scrollback.size();
+    const auto historyRows = GetHistoryRowCount();
+    THROW_HR_IF(E_INVALIDARG, &target == this);
+    THROW_HR_IF(E_INVALIDARG, firstRow + count > historyRows + TotalRowCount());
+    THROW_HR_IF(E_INVALIDARG, targetRow < 0 || targetRow + count > target.TotalRowCount());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto row = firstRow + i;
+        auto& destination = target.GetRowByOffset(targetRow + i);
+        if (row < storeRows)
+        {
+            target._WriteScrollbackLine(reader.GetLine(_scrollback.FirstLine() + row), destination);
+        }
+        else if (row < historyRows)
+        {
+            target._WriteScrollbackLine(s_GetScrollbackLine(_unreflowedRows[row - storeRows]), destination);
+        }
+        else
+        {
+            target._WriteScrollbackLine(s_GetScrollbackLine(GetRowByOffset(row - historyRows)), destination);
+        }
+    }
+}
+
+// Routine Description:
+// - Copies a row that's about to scroll out of the buffer into the scrollback
+//      store. If the store doesn't keep anything, the row isn't copied, but
+//      it still gets counted.
+// Arguments:
+// - row - the row to copy
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::_AppendToScrollback(const ROW& row)
+{
+    _scrollback.Append(_scrollback.GetCapacity() != 0 ? s_GetScrollbackLine(row) : ScrollbackStore::Line{});
+}
+
+// Routine Description:
+// - Copies a row into the form the scrollback store keeps its lines in.
+// Arguments:
+// - row - the row to copy
+// Return Value:
+// - the line. Throws exceptions on failures.
+ScrollbackStore::Line TextBuffer::s_GetScrollbackLine(const ROW& row)
+{
+    ScrollbackStore::Line line{};
+    const auto& charRow = row.GetCharRow();
+    line.text = charRow.GetText();
+    line.text.erase(line.text.find_last_not_of(UNICODE_SPACE) + 1);
+    line.attributes = row.GetAttrRow().GetRuns();
+    line.columns = row.size();
+    line.wrapForced = charRow.WasWrapForced();
+    return line;
+}
+
+// Routine Description:
+// - Overwrites a row of this buffer with a line from the history.
+// Arguments:
+// - line - the line to write. It can be wider or narrower than the row.
+// - row - the row to write it into
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::_WriteScrollbackLine(const ScrollbackStore::Line& line, ROW& row)
+{
+    _ReserveAttributes(line.attributes.size());
+    THROW_HR_IF(E_FAIL, !row.Reset(_currentAttributes));
+
+    if (!line.text.empty())
+    {
+        // Only the text is written here. The colors go in below, all at once.
+        row.WriteCells(OutputCellIterator{ line.text }, 0, false);
+    }
+
+    std::vector<TextAttributeRun> runs;
+    runs.reserve(line.attributes.size());
+    size_t width = 0;
+    for (auto run : line.attributes)
+    {
+        if (width >= row.size())
+        {
+            break;
+        }
+        run.SetLength(std::min(run.GetLength(), row.size() - width));
+        width += run.GetLength();
+        runs.push_back(run);
+    }
+    if (width > 0)
+    {
+        THROW_IF_FAILED(row.GetAttrRow().InsertAttrRuns({ runs.data(), runs.size() }, 0, width - 1, row.size()));
+    }
+
+    row.GetCharRow().SetWrapForced(line.wrapForced);
+}
+
+// Routine Description:
+// - Finds the first row of the logical line that the given row is part of,
+//      by walking up while the row above wrapped into it.
+// Arguments:
+// - row - the row, in offset coordinates
+// Return Value:
+// - the first row of the logical line
+SHORT TextBuffer::_GetLogicalLineStart(const SHORT row) const
+{
+    auto start = row;
+    while (start > 0 && GetRowByOffset(start - 1).GetCharRow().WasWrapForced())
+    {
+        --start;
+    }
+    return start;
+}
+
+// Routine Description:
+// - Lays out the logical lines in the given rows again at a new width.
+// - Rows that wrapped give all their cells, except for the padding left where
+//      a wide glyph didn't fit. The last row of a line drops its trailing
+//      spaces, up to the cursor if it's on that line.
+// Arguments:
+// - rows - the rows to reflow, in order. They don't need to be as wide as the
+//      buffer.
+// - newWidth - the width of the new rows
+// - pCursor - optional. Going in, a position relative to the first of the
+//      rows. Coming out, the same spot in the text, relative to the first of
+//      the new rows.
+// Return Value:
+// - the new rows, at least one per logical line. Their IDs aren't set.
+// Note: will throw exception if unable to allocate the new rows
+std::deque<ROW> TextBuffer::_ReflowRows(const std::vector<const ROW*>& rows, const SHORT newWidth, COORD* const pCursor)
+{
+    std::deque<ROW> newRows;
+    std::vector<OutputCell> cells;
+    std::optional<COORD> newCursor;
+
+    size_t next = 0;
+    while (next < rows.size())
+    {
+        cells.clear();
+        std::optional<size_t> cursorCell;
+        bool wrapped = false;
+        do
+        {
+            const auto& row = *rows[next];
+            const auto& charRow = row.GetCharRow();
+            const auto& attrRow = row.GetAttrRow();
+            wrapped = charRow.WasWrapForced();
+            const auto right = wrapped ? row.size() - (charRow.WasDoubleBytePadded() ? 1 : 0) : charRow.MeasureRight();
+
+            if (pCursor != nullptr && static_cast<size_t>(pCursor->Y) == next)
+            {
+                cursorCell = cells.size() + pCursor->X;
+            }
+
+            for (size_t column = 0; column < right; ++column)
+            {
+                cells.emplace_back(charRow.GlyphAt(column), charRow.DbcsAttrAt(column), attrRow.GetAttrByColumn(column));
+            }
+            ++next;
+        } while (wrapped && next < rows.size());
+
+        // Keep the spaces up to the cursor, so it stays the same distance from the text.
+        while (cursorCell.has_value() && cells.size() < cursorCell.value())
+        {
+            cells.emplace_back(std::wstring_view{ L" " }, DbcsAttribute{}, _currentAttributes);
+        }
+
+        const OutputCellIterator start{ std::basic_string_view<OutputCell>{ cells.data(), cells.size() } };
+        auto it = start;
+        do
+        {
+            const auto consumedBefore = gsl::narrow_cast<size_t>(it.GetInputDistance(start));
+            auto& newRow = newRows.emplace_back(0i16, newWidth, _currentAttributes, this);
+            if (it)
+            {
+                it = newRow.WriteCells(it, 0, true);
+            }
+            const auto consumedAfter = gsl::narrow_cast<size_t>(it.GetInputDistance(start));
+
+            if (cursorCell.has_value() && !newCursor.has_value())
+            {
+                const auto column = cursorCell.value() - consumedBefore;
+                if (cursorCell.value() < consumedAfter || (!it && column < static_cast<size_t>(newWidth)))
+                {
+                    newCursor = COORD{ gsl::narrow<SHORT>(column), gsl::narrow<SHORT>(newRows.size() - 1) };
+                }
+            }
+        } while (it);
+
+        // If the text ends right at the edge of a row, the cursor after it goes
+        // on a row of its own, and the text's row ends the line instead of wrapping.
+        if (cursorCell.has_value() && !newCursor.has_value())
+        {
+            newRows.back().GetCharRow().SetWrapForced(false);
+            newRows.emplace_back(0i16, newWidth, _currentAttributes, this);
+            newCursor = COORD{ 0, gsl::narrow<SHORT>(newRows.size() - 1) };
+        }
+
+        // WriteCells wraps every row it fills. The last one only wraps if the
+        // line carries on past the rows we were given.
+        newRows.back().GetCharRow().SetWrapForced(wrapped);
+    }
+
+    if (pCursor != nullptr)
+    {
+        *pCursor = newCursor.value_or(COORD{ 0, 0 });
+    }
+    return newRows;
+}
+
+// Routine Description:
+// - Rotates the storage so that the first row is at index 0. Row IDs and
+//      parent pointers have to be refreshed after.
+void TextBuffer::_RotateToFirstRow()
+{
+    std::rotate(_storage.begin(), _storage.begin() + _firstRow, _storage.end());
+    _SetFirstRowIndex(0);
+}
+
+// Routine Description:
+// - Moves a row that's scrolling out of the top of the buffer into the history
+//      above it.
+// - The rows that a reflowing resize set aside are newer than anything in the
+//      store, so while there are any, the row goes after them, and the oldest
+//      of them moves on into the store instead. That way each of them stays
+//      set aside, and can still be reflowed, until as many rows have scrolled
+//      out after it. The store doesn't care how wide the rows it gets are.
+// Arguments:
+// - row - the row that's scrolling out. Afterwards it holds the storage of the
+//      row that moved on into the store, at the same width, and has to be
+//      reset before it's used again.
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::_ScrollOutRow(ROW& row)
+{
+    if (_unreflowedRows.empty())
+    {
+        _AppendToScrollback(row);
+        return;
+    }
+
+    _AppendToScrollback(_unreflowedRows.front());
+    try
+    {
+        auto& oldest = _unreflowedRows.front();
+        if (oldest.size() != row.size())
+        {
+            THROW_IF_FAILED(oldest.Resize(row.size()));
+        }
+        _unreflowedRows.emplace_back(std::move(row));
+    }
+    catch (...)
+    {
+        // The oldest row is in the store already.
+        _unreflowedRows.pop_front();
+        throw;
+    }
+
+    auto& newest = _unreflowedRows.back();
+    newest.GetCharRow().UpdateParent(&newest);
+
+    row = std::move(_unreflowedRows.front());
+    _unreflowedRows.pop_front();
+    row.SetId(newest.GetId());
+    row.GetCharRow().UpdateParent(&row);
+}
+
+// Routine Description:
+// - Called before storing the given number of new attributes, to keep the
+//      attribute table from growing without end.
+// - Attributes stay in the table when the last cell using them is
+//      overwritten. Once the table has grown to the sweep size, the IDs of
+//      the attributes no row uses anymore are released, to be reused. The
+//      attributes the rows still use keep their IDs, and stay where they are.
+// - The next sweep waits until the table has doubled, so that a buffer that
+//      really does use that many attributes isn't swept on every write.
+// Arguments:
+// - count - how many new attributes we're about to store
+// Return Value:
+// - <none>, throws exceptions on failures.
+void TextBuffer::_ReserveAttributes(const size_t count)
+{
+    if (_attributeTable.Size() + count <= _attributeSweepSize)
+    {
+        return;
+    }
+
+    std::vector<bool> used(_attributeTable.IdLimit(), false);
+    for (const auto& row : _storage)
+    {
+        row.GetAttrRow().MarkUsedAttributes(used);
+    }
+    for (const auto& row : _unreflowedRows)
+    {
+        row.GetAttrRow().MarkUsedAttributes(used);
+    }
+    _attributeTable.ReleaseUnused(used);
+
+    _attributeSweepSize = std::max(MinAttributeSweepSize, (_attributeTable.Size() + count) * 2);
 }
 
 // Routine Description:
@@ -844,19 +1389,15 @@ UnicodeStorage& TextBuffer::GetUnicodeStorage()
 //   by shuffling pointers around.
 // - This will also update parent pointers that are stored in depth within the buffer
 //   (e.g. it will update CharRow parents pointing at Rows that might have been moved around)
-// - Optionally takes a new row width if we're resizing to perform a resize operation and cleanup
-//   any high unicode (UnicodeStorage) runs while we're already looping through the rows.
+// - Optionally takes a new row width if we're resizing to perform a resize operation while
+//   we're already looping through the rows.
 // Arguments:
 // - newRowWidth - Optional new value for the row width.
 void TextBuffer::_RefreshRowIDs(std::optional<SHORT> newRowWidth)
 {
-    std::map<SHORT, SHORT> rowMap;
     SHORT i = 0;
     for (auto& it : _storage)
     {
-        // Build a map so we can update Unicode Storage
-        rowMap.emplace(it.GetId(), i);
-
         // Update the IDs
         it.SetId(i++);
 
@@ -870,9 +1411,6 @@ void TextBuffer::_RefreshRowIDs(std::optional<SHORT> newRowWidth)
             THROW_IF_FAILED(it.Resize(newRowWidth.value()));
         }
     }
-
-    // Give the new mapping to Unicode Storage
-    _unicodeStorage.Remap(rowMap, newRowWidth);
 }
 
 void TextBuffer::_NotifyPaint(const Viewport& viewport) const
@@ -52,6 +52,8 @@ filling in the last row, and updating the screen.
 #include "cursor.h"
 #include "Row.hpp"
 #include "TextAttribute.hpp"
+#include "TextAttributeTable.hpp"
+#include "ScrollbackStore.hpp"
 #include "UnicodeStorage.hpp"
 #include "../types/inc/Viewport.hpp"
 
@@ -127,8 +129,35 @@ public:
     [[nodiscard]]
     HRESULT ResizeTraditional(const COORD newSize) noexcept;
 
-    const UnicodeStorage& GetUnicodeStorage() const;
-    UnicodeStorage& GetUnicodeStorage();
+    // How many rows above the first visible row a reflowing resize reflows
+    // right away. Older rows are reflowed when something scrolls near them.
+    static constexpr SHORT ReflowMargin = 100;
+
+    // The attribute table isn't swept for unused attributes before it holds
+    // at least this many.
+    static constexpr size_t MinAttributeSweepSize = 16384;
+
+    [[nodiscard]]
+    HRESULT ResizeWithReflow(const COORD newSize, const SHORT firstVisibleRow) noexcept;
+
+    size_t GetUnreflowedRowCount() const noexcept;
+    SHORT ReflowHistory(const SHORT rows, const SHORT lastRowInUse);
+
+    TextAttributeTable& GetAttributeTable() noexcept;
+
+    ScrollbackStore& GetScrollback() noexcept;
+    const ScrollbackStore& GetScrollback() const noexcept;
+
+    size_t GetHistoryRowCount() const noexcept;
+    void CopyHistoryRows(const size_t firstRow,
+                         const size_t count,
+                         TextBuffer& target,
+                         const SHORT targetRow) const;
+    void CopyHistoryRows(const size_t firstRow,
+                         const size_t count,
+                         TextBuffer& target,
+                         const SHORT targetRow,
+                         ScrollbackStore::Reader& reader) const;
 
     Microsoft::Console::Render::IRenderTarget& GetRenderTarget();
 
@@ -155,10 +184,32 @@ private:
 
     TextAttribute _currentAttributes;
 
-    // storage location for glyphs that can't fit into the buffer normally
-    UnicodeStorage _unicodeStorage;
+    // every distinct attribute used by the rows, which only store its ID
+    TextAttributeTable _attributeTable;
+
+    // once the table holds this many attributes, the ones that aren't used
+    // anymore are released
+    size_t _attributeSweepSize;
+
+    // the lines that have scrolled off the top of _storage
+    ScrollbackStore _scrollback;
+
+    // rows that a reflowing resize left above the top of _storage, oldest
+    // first, at whatever width they had then. They're between _storage and
+    // _scrollback, and the rows that scroll out of _storage go after them.
+    std::deque<ROW> _unreflowedRows;
 
     void _RefreshRowIDs(std::optional<SHORT> newRowWidth);
+    void _ReserveAttributes(const size_t count);
+    void _AppendToScrollback(const ROW& row);
+    void _WriteScrollbackLine(const ScrollbackStore::Line& line, ROW& row);
+
+    static ScrollbackStore::Line s_GetScrollbackLine(const ROW& row);
+
+    SHORT _GetLogicalLineStart(const SHORT row) const;
+    std::deque<ROW> _ReflowRows(const std::vector<const ROW*>& rows, const SHORT newWidth, COORD* const pCursor);
+    void _RotateToFirstRow();
+    void _ScrollOutRow(ROW& row);
 
     Microsoft::Console::Render::IRenderTarget& _renderTarget;
 
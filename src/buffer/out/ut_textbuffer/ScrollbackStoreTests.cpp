@@ -0,0 +1,285 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "../ScrollbackStore.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class ScrollbackStoreTests
+{
+    TEST_CLASS(ScrollbackStoreTests);
+
+    static ScrollbackStore::Line s_MakeLine(const size_t number)
+    {
+        ScrollbackStore::Line line{};
+        line.text = std::to_wstring(number);
+        line.attributes.emplace_back(80, TextAttribute{ FOREGROUND_RED });
+        line.columns = 80;
+        line.wrapForced = number % 2 == 0;
+        return line;
+    }
+
+    // Waits for the pages that are being compressed on the threadpool, and
+    // puts them in place like the next Append would.
+    static void s_WaitForCompaction(ScrollbackStore& store)
+    {
+        if (store._compactionWork)
+        {
+            WaitForThreadpoolWorkCallbacks(store._compactionWork.get(), FALSE);
+        }
+        store._FinishCompaction();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(0), store._compressingPages);
+    }
+
+    TEST_METHOD(NothingIsKeptWithoutCapacity)
+    {
+        ScrollbackStore store;
+        store.Append(s_MakeLine(0));
+        store.Append(s_MakeLine(1));
+
+        VERIFY_IS_TRUE(store.empty());
+        VERIFY_IS_TRUE(store._pages.empty());
+        VERIFY_ARE_EQUAL(2ull, store.EndLine(), L"Lines that aren't kept still get counted.");
+        VERIFY_ARE_EQUAL(store.EndLine(), store.FirstLine());
+        ScrollbackStore::Reader reader{ store };
+        VERIFY_THROWS_SPECIFIC(reader.GetLine(1),
+                               wil::ResultException,
+                               [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+    }
+
+    TEST_METHOD(OldestLinesAreEvicted)
+    {
+        // Span a few pages, and leave the last one partly full.
+        const size_t capacity = ScrollbackStore::PageSize * 2 + 10;
+        const size_t appended = ScrollbackStore::PageSize * 5 + 3;
+
+        ScrollbackStore store;
+        store.SetCapacity(capacity);
+        for (size_t i = 0; i < appended; ++i)
+        {
+            store.Append(s_MakeLine(i));
+        }
+
+        VERIFY_ARE_EQUAL(capacity, store.size());
+        VERIFY_ARE_EQUAL(static_cast<ScrollbackStore::line_number>(appended), store.EndLine());
+        VERIFY_ARE_EQUAL(static_cast<ScrollbackStore::line_number>(appended - capacity), store.FirstLine());
+
+        // Only the pages that still have lines in them are kept.
+        VERIFY_ARE_EQUAL(static_cast<size_t>(4), store._pages.size());
+
+        ScrollbackStore::Reader reader{ store };
+        for (auto i = store.FirstLine(); i < store.EndLine(); ++i)
+        {
+            const auto& line = reader.GetLine(i);
+            VERIFY_ARE_EQUAL(String(std::to_wstring(i).c_str()), String(line.text.c_str()));
+            VERIFY_ARE_EQUAL(i % 2 == 0, line.wrapForced);
+            VERIFY_ARE_EQUAL(static_cast<size_t>(80), line.columns);
+            VERIFY_ARE_EQUAL(TextAttribute{ FOREGROUND_RED }, line.attributes.at(0).GetAttributes());
+        }
+
+        VERIFY_THROWS_SPECIFIC(reader.GetLine(store.FirstLine() - 1),
+                               wil::ResultException,
+                               [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+        VERIFY_THROWS_SPECIFIC(reader.GetLine(store.EndLine()),
+                               wil::ResultException,
+                               [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+    }
+
+    TEST_METHOD(ShrinkingCapacityEvicts)
+    {
+        ScrollbackStore store;
+        store.SetCapacity(1000);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            store.Append(s_MakeLine(i));
+        }
+
+        store.SetCapacity(3);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(3), store.size());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), store._pages.size());
+        ScrollbackStore::Reader reader{ store };
+        VERIFY_ARE_EQUAL(String(L"997"), String(reader.GetLine(997).text.c_str()));
+        VERIFY_ARE_EQUAL(String(L"999"), String(reader.GetLine(999).text.c_str()));
+
+        store.Clear();
+        VERIFY_IS_TRUE(store.empty());
+        VERIFY_ARE_EQUAL(1000ull, store.FirstLine(), L"Clearing the store doesn't restart the numbering.");
+
+        store.Append(s_MakeLine(1000));
+        VERIFY_ARE_EQUAL(String(L"1000"), String(ScrollbackStore::Reader{ store }.GetLine(1000).text.c_str()));
+    }
+
+    TEST_METHOD(ColdPagesAreCompressed)
+    {
+        const size_t pages = ScrollbackStore::HotPages + 3;
+
+        ScrollbackStore store;
+        store.SetCapacity(SIZE_MAX);
+
+        std::vector<ScrollbackStore::Line> expected;
+        for (size_t i = 0; i < pages * ScrollbackStore::PageSize; ++i)
+        {
+            // Log-like lines, mostly the same from one to the next, with a few
+            // colors and the odd non-ASCII char.
+            ScrollbackStore::Line line{};
+            line.text = L"2019-05-06 12:00:" + std::to_wstring(i % 60) + L" [info] build step " + std::to_wstring(i) + L" finished \x2713";
+            line.attributes.emplace_back(24, TextAttribute{ FOREGROUND_GREEN });
+            line.attributes.emplace_back(6, TextAttribute{ RGB(i % 4, 0, 0), RGB(0, 0, 0) });
+            line.attributes.emplace_back(90, TextAttribute{ FOREGROUND_RED });
+            line.columns = 120;
+            line.wrapForced = i % 3 == 0;
+
+            expected.push_back(line);
+            store.Append(std::move(line));
+        }
+
+        const auto verifyLines = [&]() {
+            ScrollbackStore::Reader reader{ store };
+            for (auto i = store.FirstLine(); i < store.EndLine(); ++i)
+            {
+                const auto& line = reader.GetLine(i);
+                const auto& expectedLine = expected.at(gsl::narrow<size_t>(i));
+                VERIFY_ARE_EQUAL(String(expectedLine.text.c_str()), String(line.text.c_str()));
+                VERIFY_ARE_EQUAL(expectedLine.columns, line.columns);
+                VERIFY_ARE_EQUAL(expectedLine.wrapForced, line.wrapForced);
+                VERIFY_ARE_EQUAL(expectedLine.attributes.size(), line.attributes.size());
+                for (size_t run = 0; run < line.attributes.size(); ++run)
+                {
+                    VERIFY_ARE_EQUAL(expectedLine.attributes.at(run).GetLength(), line.attributes.at(run).GetLength());
+                    VERIFY_ARE_EQUAL(expectedLine.attributes.at(run).GetAttributes(), line.attributes.at(run).GetAttributes());
+                }
+            }
+        };
+
+        Log::Comment(L"Appending doesn't wait for the compression, and the lines can be read while it goes on.");
+        verifyLines();
+        s_WaitForCompaction(store);
+
+        // The last page is full, but no line has come along to start another one.
+        VERIFY_ARE_EQUAL(pages, store._pages.size());
+        size_t rawSize = 0;
+        size_t compressedSize = 0;
+        for (size_t i = 0; i < pages; ++i)
+        {
+            const auto& page = store._pages.at(i);
+            if (i < pages - ScrollbackStore::HotPages)
+            {
+                VERIFY_IS_TRUE(page.IsCompressed());
+                compressedSize += page.GetCompressedSize();
+                for (size_t j = 0; j < page.size(); ++j)
+                {
+                    rawSize += expected.at(i * ScrollbackStore::PageSize + j).text.size() * sizeof(wchar_t);
+                }
+            }
+            else
+            {
+                VERIFY_IS_FALSE(page.IsCompressed());
+            }
+        }
+        Log::Comment(NoThrowString().Format(L"%zu bytes of text compressed to %zu bytes", rawSize, compressedSize));
+        VERIFY_IS_LESS_THAN(compressedSize * 4, rawSize);
+
+        verifyLines();
+    }
+
+    TEST_METHOD(SpilledPagesReadBack)
+    {
+        const size_t memoryPages = 2;
+        const size_t capacityPages = 20;
+
+        ScrollbackStore store;
+        store.SetCapacity(capacityPages * ScrollbackStore::PageSize);
+        store.EnableSpilling(memoryPages);
+
+        // Go through the capacity several times over, so that spilled pages
+        // get evicted and their chunks reused.
+        const size_t lines = capacityPages * ScrollbackStore::PageSize * 5;
+        for (size_t i = 0; i < lines; ++i)
+        {
+            store.Append(s_MakeLine(i));
+        }
+        s_WaitForCompaction(store);
+
+        const auto pages = store._pages.size();
+        for (size_t i = 0; i < pages; ++i)
+        {
+            const auto& page = store._pages.at(i);
+            const auto spilled = i + ScrollbackStore::HotPages + memoryPages < pages;
+            VERIFY_ARE_EQUAL(spilled, page.IsSpilled());
+            VERIFY_ARE_EQUAL(i + ScrollbackStore::HotPages < pages, page.IsCompressed());
+        }
+
+        // The file only needs to hold what's kept, so it shouldn't have grown
+        // past a chunk or two.
+        VERIFY_IS_LESS_THAN_OR_EQUAL(store._spillFile->GetChunkCount(), static_cast<size_t>(2));
+
+        ScrollbackStore::Reader reader{ store };
+        for (auto i = store.FirstLine(); i < store.EndLine(); ++i)
+        {
+            const auto& line = reader.GetLine(i);
+            const auto expected = s_MakeLine(gsl::narrow<size_t>(i));
+            VERIFY_ARE_EQUAL(String(expected.text.c_str()), String(line.text.c_str()));
+            VERIFY_ARE_EQUAL(expected.columns, line.columns);
+            VERIFY_ARE_EQUAL(expected.wrapForced, line.wrapForced);
+            VERIFY_ARE_EQUAL(static_cast<size_t>(1), line.attributes.size());
+            VERIFY_ARE_EQUAL(expected.attributes.at(0).GetAttributes(), line.attributes.at(0).GetAttributes());
+        }
+
+        store.Clear();
+        VERIFY_ARE_EQUAL(store._spillFile->_chunks.size(), store._spillFile->_freeChunks.size() + 1, L"Every chunk but the current one is free.");
+    }
+
+    TEST_METHOD(OversizedPagesStayInMemory)
+    {
+        ScrollbackStore store;
+        store.SetCapacity(ScrollbackStore::PageSize * (ScrollbackStore::HotPages + 3));
+        store.EnableSpilling(0);
+
+        // Text that doesn't repeat, with every char taking 3 bytes, so that
+        // the first page compresses to more than a chunk of the file.
+        const size_t bigLineLength = 8192;
+        uint32_t seed = 1;
+        std::wstring bigText(bigLineLength, L' ');
+        for (size_t i = 0; i < ScrollbackStore::PageSize; ++i)
+        {
+            for (auto& ch : bigText)
+            {
+                seed = seed * 1664525 + 1013904223;
+                ch = static_cast<wchar_t>(0x4e00 + (seed >> 16) % 0x5000);
+            }
+            auto line = s_MakeLine(i);
+            line.text = bigText;
+            line.columns = bigLineLength;
+            store.Append(std::move(line));
+        }
+
+        const auto lines = store.GetCapacity();
+        for (auto i = ScrollbackStore::PageSize; i < lines; ++i)
+        {
+            store.Append(s_MakeLine(i));
+        }
+        s_WaitForCompaction(store);
+
+        const auto& bigPage = store._pages.front();
+        VERIFY_IS_TRUE(bigPage.IsCompressed());
+        VERIFY_IS_FALSE(bigPage.IsSpilled());
+        VERIFY_IS_GREATER_THAN(bigPage.GetCompressedSize(), ScrollbackSpillFile::ChunkSize);
+
+        // The pages after it are spilled all the same.
+        const auto pages = store._pages.size();
+        for (size_t i = 1; i < pages; ++i)
+        {
+            VERIFY_ARE_EQUAL(i + ScrollbackStore::HotPages < pages, store._pages.at(i).IsSpilled());
+        }
+
+        ScrollbackStore::Reader reader{ store };
+        VERIFY_ARE_EQUAL(String(bigText.c_str()), String(reader.GetLine(ScrollbackStore::PageSize - 1).text.c_str()));
+        VERIFY_ARE_EQUAL(String(L"300"), String(reader.GetLine(300).text.c_str()));
+    }
+};
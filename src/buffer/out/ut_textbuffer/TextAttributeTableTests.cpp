@@ -0,0 +1,100 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+#include "../../inc/consoletaeftemplates.hpp"
+
+#include "../TextAttributeTable.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class TextAttributeTableTests
+{
+    TEST_CLASS(TextAttributeTableTests);
+
+    TEST_METHOD(EqualAttributesShareAnId)
+    {
+        TextAttributeTable table;
+        const TextAttribute red{ FOREGROUND_RED };
+        const TextAttribute rgb{ RGB(1, 2, 3), RGB(4, 5, 6) };
+        TextAttribute boldRed{ FOREGROUND_RED };
+        boldRed.Embolden();
+
+        const auto redId = table.Intern(red);
+        const auto rgbId = table.Intern(rgb);
+        const auto boldRedId = table.Intern(boldRed);
+
+        VERIFY_ARE_NOT_EQUAL(redId, rgbId);
+        VERIFY_ARE_NOT_EQUAL(redId, boldRedId);
+        VERIFY_ARE_NOT_EQUAL(rgbId, boldRedId);
+
+        VERIFY_ARE_EQUAL(redId, table.Intern(TextAttribute{ FOREGROUND_RED }));
+        VERIFY_ARE_EQUAL(rgbId, table.Intern(TextAttribute{ RGB(1, 2, 3), RGB(4, 5, 6) }));
+        VERIFY_ARE_EQUAL(static_cast<size_t>(3), table.Size());
+        VERIFY_ARE_EQUAL(TextAttributeTable::Capacity - 3, table.Remaining());
+
+        VERIFY_ARE_EQUAL(red, table.Get(redId));
+        VERIFY_ARE_EQUAL(rgb, table.Get(rgbId));
+        VERIFY_ARE_EQUAL(boldRed, table.Get(boldRedId));
+    }
+
+    TEST_METHOD(InternedAttributesDontMove)
+    {
+        TextAttributeTable table;
+        const auto& first = table.Get(table.Intern(TextAttribute{ FOREGROUND_GREEN }));
+
+        // Add more attributes than a 16-bit ID can tell apart, so that the
+        // table has to grow many times.
+        const DWORD count = 0x20000;
+        for (DWORD i = 1; i < count; i++)
+        {
+            table.Intern(TextAttribute{ i, 0 });
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(count), table.Size());
+
+        VERIFY_ARE_EQUAL(TextAttribute{ FOREGROUND_GREEN }, first);
+        VERIFY_ARE_EQUAL(&first, &table.Get(table.Intern(TextAttribute{ FOREGROUND_GREEN })));
+        for (DWORD i = 1; i < count; i++)
+        {
+            VERIFY_ARE_EQUAL(static_cast<TextAttributeTable::id_type>(i), table.Intern(TextAttribute{ i, 0 }));
+        }
+    }
+
+    TEST_METHOD(ReleasedIdsAreReused)
+    {
+        TextAttributeTable table;
+        const auto redId = table.Intern(TextAttribute{ FOREGROUND_RED });
+        const auto greenId = table.Intern(TextAttribute{ FOREGROUND_GREEN });
+        const auto blueId = table.Intern(TextAttribute{ FOREGROUND_BLUE });
+        const auto whiteId = table.Intern(TextAttribute{ FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE });
+        const auto& red = table.Get(redId);
+        const auto& blue = table.Get(blueId);
+
+        Log::Comment(L"Only green and white aren't used anymore.");
+        std::vector<bool> used(table.IdLimit(), false);
+        used[redId] = true;
+        used[blueId] = true;
+        table.ReleaseUnused(used);
+
+        VERIFY_ARE_EQUAL(static_cast<size_t>(2), table.Size());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(3), table.IdLimit(), L"White was last, so its slot is gone altogether.");
+
+        Log::Comment(L"The attributes still used keep their IDs, and stay where they are.");
+        VERIFY_ARE_EQUAL(redId, table.Intern(TextAttribute{ FOREGROUND_RED }));
+        VERIFY_ARE_EQUAL(blueId, table.Intern(TextAttribute{ FOREGROUND_BLUE }));
+        VERIFY_ARE_EQUAL(&red, &table.Get(redId));
+        VERIFY_ARE_EQUAL(&blue, &table.Get(blueId));
+        VERIFY_ARE_EQUAL(TextAttribute{ FOREGROUND_BLUE }, blue);
+
+        Log::Comment(L"A new attribute gets the released ID, and white comes back as a new one.");
+        const TextAttribute rgb{ RGB(1, 2, 3), RGB(4, 5, 6) };
+        VERIFY_ARE_EQUAL(greenId, table.Intern(rgb));
+        VERIFY_ARE_EQUAL(rgb, table.Get(greenId));
+        VERIFY_ARE_EQUAL(whiteId, table.Intern(TextAttribute{ FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE }));
+        VERIFY_ARE_NOT_EQUAL(greenId, table.Intern(TextAttribute{ FOREGROUND_GREEN }));
+        VERIFY_ARE_EQUAL(static_cast<size_t>(5), table.Size());
+    }
+};
@@ -19,17 +19,17 @@ class UnicodeStorageTests
     TEST_METHOD(CanOverwriteEmoji)
     {
         UnicodeStorage storage;
-        const COORD coord{ 1, 3 };
-        const std::vector<wchar_t> newMoon{ 0xD83C, 0xDF11 };
-        const std::vector<wchar_t> fullMoon{ 0xD83C, 0xDF15 };
+        const size_t column = 3;
+        const std::wstring newMoon{ 0xD83C, 0xDF11 };
+        const std::wstring fullMoon{ 0xD83C, 0xDF15 };
 
         // store initial glyph
-        storage.StoreGlyph(coord, newMoon);
+        storage.StoreGlyph(column, newMoon);
 
         // verify it was stored
-        auto findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& newMoonGlyph = findIt->second;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), storage._glyphs.size());
+        VERIFY_ARE_EQUAL(column, storage._glyphs.front().first);
+        const std::wstring& newMoonGlyph = storage.GetText(column);
         VERIFY_ARE_EQUAL(newMoonGlyph.size(), newMoon.size());
         for (size_t i = 0; i < newMoon.size(); ++i)
         {
@@ -37,16 +37,49 @@ class UnicodeStorageTests
         }
 
         // overwrite it
-        storage.StoreGlyph(coord, fullMoon);
+        storage.StoreGlyph(column, fullMoon);
 
         // verify the glyph was overwritten
-        findIt = storage._map.find(coord);
-        VERIFY_ARE_NOT_EQUAL(findIt, storage._map.end());
-        const std::vector<wchar_t>& fullMoonGlyph = findIt->second;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), storage._glyphs.size());
+        const std::wstring& fullMoonGlyph = storage.GetText(column);
         VERIFY_ARE_EQUAL(fullMoonGlyph.size(), fullMoon.size());
         for (size_t i = 0; i < fullMoon.size(); ++i)
         {
             VERIFY_ARE_EQUAL(fullMoonGlyph.at(i), fullMoon.at(i));
         }
     }
+
+    TEST_METHOD(GlyphsStaySortedByColumn)
+    {
+        UnicodeStorage storage;
+        const std::wstring newMoon{ 0xD83C, 0xDF11 };
+        const std::wstring fullMoon{ 0xD83C, 0xDF15 };
+        const std::wstring waxingMoon{ 0xD83C, 0xDF12 };
+
+        storage.StoreGlyph(8, fullMoon);
+        storage.StoreGlyph(2, newMoon);
+        storage.StoreGlyph(5, waxingMoon);
+
+        VERIFY_ARE_EQUAL(static_cast<size_t>(3), storage._glyphs.size());
+        VERIFY_ARE_EQUAL(static_cast<size_t>(2), storage._glyphs.at(0).first);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(5), storage._glyphs.at(1).first);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(8), storage._glyphs.at(2).first);
+        VERIFY_IS_TRUE(waxingMoon == storage.GetText(5));
+
+        // erasing a column that has nothing stored is fine
+        storage.Erase(3);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(3), storage._glyphs.size());
+
+        storage.Erase(5);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(2), storage._glyphs.size());
+        VERIFY_THROWS(storage.GetText(5), wil::ResultException);
+
+        // shrinking the row drops everything at or past the new width
+        storage.Resize(8);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), storage._glyphs.size());
+        VERIFY_IS_TRUE(newMoon == storage.GetText(2));
+
+        storage.Clear();
+        VERIFY_IS_TRUE(storage._glyphs.empty());
+    }
 };
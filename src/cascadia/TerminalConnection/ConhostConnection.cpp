@@ -19,12 +19,12 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                                          hstring const& startingDirectory,
                                         uint32_t initialRows,
                                         uint32_t initialCols) :
+        _output{ std::make_shared<ConnectionOutput>() },
         _connected{ false },
         _inPipe{ INVALID_HANDLE_VALUE },
         _outPipe{ INVALID_HANDLE_VALUE },
         _signalPipe{ INVALID_HANDLE_VALUE },
-        _outputThreadId{ 0 },
-        _hOutputThread{ INVALID_HANDLE_VALUE },
+        _outputPump{ nullptr },
         _piConhost{ 0 },
         _closing{ false }
     {
@@ -37,12 +37,22 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
     winrt::event_token ConhostConnection::TerminalOutput(Microsoft::Terminal::TerminalConnection::TerminalOutputEventArgs const& handler)
     {
-        return _outputHandlers.add(handler);
+        return _output->handlers.add(handler);
     }
 
     void ConhostConnection::TerminalOutput(winrt::event_token const& token) noexcept
     {
-        _outputHandlers.remove(token);
+        _output->handlers.remove(token);
+    }
+
+    winrt::event_token ConhostConnection::TerminalOutputUtf8(Microsoft::Terminal::TerminalConnection::TerminalOutputUtf8EventArgs const& handler)
+    {
+        return _output->utf8Handlers.add(handler);
+    }
+
+    void ConhostConnection::TerminalOutputUtf8(winrt::event_token const& token) noexcept
+    {
+        _output->utf8Handlers.remove(token);
     }
 
     winrt::event_token ConhostConnection::TerminalDisconnected(Microsoft::Terminal::TerminalConnection::TerminalDisconnectedEventArgs const& handler)
@@ -75,15 +85,21 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         _connected = true;
 
-        // Create our own output handling thread
+        // Start pumping the output from our backing host.
         // Each console needs to make sure to drain the output from it's backing host.
-        _outputThreadId = (DWORD)-1;
-        _hOutputThread = CreateThread(nullptr,
-                                      0,
-                                      (LPTHREAD_START_ROUTINE)StaticOutputThreadProc,
-                                      this,
-                                      0,
-                                      &_outputThreadId);
+        _outputPump = std::make_unique<OutputPump>(_outPipe,
+                                                   [output = _output](std::string_view batch) {
+                                                       // Pass the output to our registered event handlers
+                                                       output->Deliver(batch);
+                                                   },
+                                                   [this](DWORD /*error*/) {
+                                                       // If we're closing, this is okay.
+                                                       if (!_closing)
+                                                       {
+                                                           _disconnectHandlers();
+                                                       }
+                                                   });
+        _outputPump->Start();
     }
 
     void ConhostConnection::WriteInput(hstring const& data)
@@ -118,58 +134,14 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         if (_closing) return;
         _closing = true;
         // TODO:
-        //      terminate the output thread
         //      Close our handles
         //      Close the Pseudoconsole
         //      terminate our processes
         CloseHandle(_signalPipe);
         CloseHandle(_inPipe);
+        // Closing the output pipe fails the pump's pending read, which stops it.
         CloseHandle(_outPipe);
-        // What? CreateThread is in app partition but TerminateThread isn't?
-        //TerminateThread(_hOutputThread, 0);
         TerminateProcess(_piConhost.hProcess, 0);
         CloseHandle(_piConhost.hProcess);
     }
-
-    DWORD ConhostConnection::StaticOutputThreadProc(LPVOID lpParameter)
-    {
-        ConhostConnection* const pInstance = (ConhostConnection*)lpParameter;
-        return pInstance->_OutputThread();
-    }
-
-    DWORD ConhostConnection::_OutputThread()
-    {
-        const size_t bufferSize = 4096;
-        BYTE buffer[bufferSize];
-        DWORD dwRead;
-        while (true)
-        {
-            dwRead = 0;
-            bool fSuccess = false;
-
-            fSuccess = !!ReadFile(_outPipe, buffer, bufferSize, &dwRead, nullptr);
-            if (!fSuccess)
-            {
-                if (_closing)
-                {
-                    // This is okay, break out to kill the thread
-                    return 0;
-                }
-                else
-                {
-                    _disconnectHandlers();
-                    return (DWORD)-1;
-                }
-
-            }
-            if (dwRead == 0) continue;
-            // Convert buffer to hstring
-            char* pchStr = (char*)(buffer);
-            std::string str{pchStr, dwRead};
-            auto hstr = winrt::to_hstring(str);
-
-            // Pass the output to our registered event handlers
-            _outputHandlers(hstr);
-        }
-    }
 }
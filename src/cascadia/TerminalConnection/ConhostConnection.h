@@ -4,6 +4,8 @@
 #pragma once
 
 #include "ConhostConnection.g.h"
+#include "ConnectionOutput.h"
+#include "OutputPump.h"
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
@@ -13,6 +15,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::event_token TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler);
         void TerminalOutput(winrt::event_token const& token) noexcept;
+        winrt::event_token TerminalOutputUtf8(TerminalConnection::TerminalOutputUtf8EventArgs const& handler);
+        void TerminalOutputUtf8(winrt::event_token const& token) noexcept;
         winrt::event_token TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler);
         void TerminalDisconnected(winrt::event_token const& token) noexcept;
         void Start();
@@ -21,7 +25,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         void Close();
 
     private:
-        winrt::event<TerminalConnection::TerminalOutputEventArgs> _outputHandlers;
+        std::shared_ptr<ConnectionOutput> _output;
         winrt::event<TerminalConnection::TerminalDisconnectedEventArgs> _disconnectHandlers;
 
         uint32_t _initialRows;
@@ -34,13 +38,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         HANDLE _outPipe; // The pipe for reading output from
         HANDLE _signalPipe;
         //HPCON _hPC;
-        DWORD _outputThreadId;
-        HANDLE _hOutputThread;
+        std::unique_ptr<OutputPump> _outputPump;
         PROCESS_INFORMATION _piConhost;
         bool _closing;
 
-        static DWORD StaticOutputThreadProc(LPVOID lpParameter);
-        DWORD _OutputThread();
     };
 }
 
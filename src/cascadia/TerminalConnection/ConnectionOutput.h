@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// ConnectionOutput.h
+// The output event handlers of a connection, and what it needs to deliver
+// output to them.
+//
+// A connection shares this with its OutputPump's delivery thread through a
+// shared_ptr. A handler can close or destroy the connection, so delivering a
+// batch only ever touches this, never the connection, and it's kept alive
+// until the batch has been delivered to every handler.
+
+#pragma once
+
+#include "winrt/Microsoft.Terminal.TerminalConnection.h"
+#include "Utf8OutputDecoder.h"
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    struct ConnectionOutput final
+    {
+        winrt::event<TerminalConnection::TerminalOutputEventArgs> handlers;
+        winrt::event<TerminalConnection::TerminalOutputUtf8EventArgs> utf8Handlers;
+        Utf8OutputDecoder decoder; // Only used by the output pump's thread
+
+        // Method Description:
+        // - Passes a batch of output from the pump to the handlers. It's only
+        //      decoded to UTF-16 if there's a handler that wants it that way.
+        // Arguments:
+        // - output - the batch of output, in UTF-8
+        void Deliver(const std::string_view output)
+        {
+            if (utf8Handlers)
+            {
+                const auto bytes = reinterpret_cast<const uint8_t*>(output.data());
+                utf8Handlers(winrt::array_view<const uint8_t>{ bytes, bytes + output.size() });
+            }
+
+            if (handlers)
+            {
+                const auto& text = decoder.Decode(output);
+                if (!text.empty())
+                {
+                    handlers(text);
+                }
+            }
+        }
+    };
+}
@@ -11,12 +11,12 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
     ConptyConnection::ConptyConnection(hstring const& commandline,
                                        uint32_t initialRows,
                                        uint32_t initialCols) :
+        _output{ std::make_shared<ConnectionOutput>() },
         _connected{ false },
         _inPipe{ INVALID_HANDLE_VALUE },
         _outPipe{ INVALID_HANDLE_VALUE },
         _hPC{ INVALID_HANDLE_VALUE },
-        _outputThreadId{ 0 },
-        _hOutputThread{ INVALID_HANDLE_VALUE },
+        _outputPump{ nullptr },
         _piClient{ 0 }
     {
         _commandline = commandline;
@@ -27,12 +27,22 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
     winrt::event_token ConptyConnection::TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler)
     {
-        return _outputHandlers.add(handler);
+        return _output->handlers.add(handler);
     }
 
     void ConptyConnection::TerminalOutput(winrt::event_token const& token) noexcept
     {
-        _outputHandlers.remove(token);
+        _output->handlers.remove(token);
+    }
+
+    winrt::event_token ConptyConnection::TerminalOutputUtf8(TerminalConnection::TerminalOutputUtf8EventArgs const& handler)
+    {
+        return _output->utf8Handlers.add(handler);
+    }
+
+    void ConptyConnection::TerminalOutputUtf8(winrt::event_token const& token) noexcept
+    {
+        _output->utf8Handlers.remove(token);
     }
 
     winrt::event_token ConptyConnection::TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler)
@@ -55,15 +65,18 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         _connected = true;
 
-        // Create our own output handling thread
+        // Start pumping the output from the pseudoconsole.
         // Each console needs to make sure to drain the output from it's backing host.
-        _outputThreadId = (DWORD)-1;
-        _hOutputThread = CreateThread(nullptr,
-                                      0,
-                                      (LPTHREAD_START_ROUTINE)StaticOutputThreadProc,
-                                      this,
-                                      0,
-                                      &_outputThreadId);
+        _outputPump = std::make_unique<OutputPump>(_outPipe,
+                                                   [output = _output](std::string_view batch) {
+                                                       // Pass the output to our registered event handlers
+                                                       output->Deliver(batch);
+                                                   },
+                                                   [](DWORD error) {
+                                                       // We don't support disconnect handlers yet.
+                                                       THROW_WIN32(error);
+                                                   });
+        _outputPump->Start();
 
         //// When we recieve some data:
         //hstring outputFromConpty = L"hello world";
@@ -220,39 +233,4 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         THROW_LAST_ERROR_IF(!fSuccess);
         DeleteProcThreadAttributeList(siEx.lpAttributeList);
     }
-
-
-    DWORD ConptyConnection::StaticOutputThreadProc(LPVOID lpParameter)
-    {
-        ConptyConnection* const pInstance = (ConptyConnection*)lpParameter;
-        return pInstance->_OutputThread();
-    }
-
-    DWORD ConptyConnection::_OutputThread()
-    {
-        BYTE buffer[256];
-        DWORD dwRead;
-        while (true)
-        {
-            dwRead = 0;
-            bool fSuccess = false;
-
-            fSuccess = !!ReadFile(_outPipe, buffer, ARRAYSIZE(buffer), &dwRead, nullptr);
-
-            THROW_LAST_ERROR_IF(!fSuccess);
-
-            // Convert buffer to hstring
-            char* pchStr = (char*)(buffer);
-            std::string str{pchStr, dwRead};
-            auto hstr = winrt::to_hstring(str);
-
-            // Pass the output to our registered event handlers
-            _outputHandlers(hstr);
-
-            // if (this->_active)
-            // {
-            //     _pfnReadCallback(buffer, dwRead);
-            // }
-        }
-    }
 }
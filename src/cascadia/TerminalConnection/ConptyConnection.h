@@ -4,6 +4,8 @@
 #pragma once
 
 #include "ConptyConnection.g.h"
+#include "ConnectionOutput.h"
+#include "OutputPump.h"
 // Note that the ConptyConnection is no longer a part of this project
 // Until there's platform-level support for full-trust universal applications,
 // all ProcThreadAttribute things will be unusable. Unfortunately, this means
@@ -17,6 +19,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::event_token TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler);
         void TerminalOutput(winrt::event_token const& token) noexcept;
+        winrt::event_token TerminalOutputUtf8(TerminalConnection::TerminalOutputUtf8EventArgs const& handler);
+        void TerminalOutputUtf8(winrt::event_token const& token) noexcept;
         winrt::event_token TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler);
         void TerminalDisconnected(winrt::event_token const& token) noexcept;
         void Start();
@@ -25,7 +29,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         void Close();
 
     private:
-        winrt::event<TerminalConnection::TerminalOutputEventArgs> _outputHandlers;
+        std::shared_ptr<ConnectionOutput> _output;
 
         uint32_t _initialRows;
         uint32_t _initialCols;
@@ -35,13 +39,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         HANDLE _inPipe;  // The pipe for writing input to
         HANDLE _outPipe; // The pipe for reading output from
         HPCON _hPC;
-        DWORD _outputThreadId;
-        HANDLE _hOutputThread;
+        std::unique_ptr<OutputPump> _outputPump;
         PROCESS_INFORMATION _piClient;
 
-        static DWORD StaticOutputThreadProc(LPVOID lpParameter);
         void _CreatePseudoConsole();
-        DWORD _OutputThread();
     };
 }
 
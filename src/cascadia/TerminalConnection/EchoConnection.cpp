@@ -3,7 +3,9 @@
 
 #include "pch.h"
 #include "EchoConnection.h"
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
@@ -21,6 +23,16 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         _outputHandlers.remove(token);
     }
 
+    winrt::event_token EchoConnection::TerminalOutputUtf8(TerminalConnection::TerminalOutputUtf8EventArgs const& handler)
+    {
+        return _outputUtf8Handlers.add(handler);
+    }
+
+    void EchoConnection::TerminalOutputUtf8(winrt::event_token const& token) noexcept
+    {
+        _outputUtf8Handlers.remove(token);
+    }
+
     winrt::event_token EchoConnection::TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler)
     {
         handler;
@@ -54,7 +66,16 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 prettyPrint << wch;
             }
         }
-        _outputHandlers(prettyPrint.str());
+        const auto output = prettyPrint.str();
+        _outputHandlers(output);
+
+        if (_outputUtf8Handlers)
+        {
+            const auto length = WideCharToMultiByte(CP_UTF8, 0, output.data(), static_cast<int>(output.size()), nullptr, 0, nullptr, nullptr);
+            std::vector<uint8_t> utf8(std::max(length, 0));
+            WideCharToMultiByte(CP_UTF8, 0, output.data(), static_cast<int>(output.size()), reinterpret_cast<char*>(utf8.data()), length, nullptr, nullptr);
+            _outputUtf8Handlers(utf8);
+        }
     }
 
     void EchoConnection::Resize(uint32_t rows, uint32_t columns)
@@ -13,6 +13,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
         winrt::event_token TerminalOutput(TerminalConnection::TerminalOutputEventArgs const& handler);
         void TerminalOutput(winrt::event_token const& token) noexcept;
+        winrt::event_token TerminalOutputUtf8(TerminalConnection::TerminalOutputUtf8EventArgs const& handler);
+        void TerminalOutputUtf8(winrt::event_token const& token) noexcept;
         winrt::event_token TerminalDisconnected(TerminalConnection::TerminalDisconnectedEventArgs const& handler);
         void TerminalDisconnected(winrt::event_token const& token) noexcept;
         void Start();
@@ -22,6 +24,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 
     private:
         winrt::event<TerminalConnection::TerminalOutputEventArgs> _outputHandlers;
+        winrt::event<TerminalConnection::TerminalOutputUtf8EventArgs> _outputUtf8Handlers;
     };
 }
 
@@ -0,0 +1,143 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "OutputPump.h"
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    // Constructor Description:
+    // - Creates a pump for the given pipe. Nothing is read until Start is called.
+    // Arguments:
+    // - pipe - the pipe to read the pty's output from. The pump doesn't own it.
+    // - onOutput - called on the pump's thread with each batch of output.
+    // - onDisconnected - called on the pump's thread when the pipe can't be read
+    //      anymore, after everything read before that has been delivered.
+    OutputPump::OutputPump(HANDLE pipe, OutputCallback onOutput, DisconnectedCallback onDisconnected) :
+        _pipe{ pipe },
+        _state{ std::make_shared<State>() },
+        _readThread{},
+        _deliverThread{}
+    {
+        _state->onOutput = std::move(onOutput);
+        _state->onDisconnected = std::move(onDisconnected);
+    }
+
+    // Destructor Description:
+    // - Stops delivering output. The read thread might still be blocked
+    //      reading the pipe until it's closed, so it's left to exit on its own.
+    //      Neither thread touches anything but the state it shares with us.
+    OutputPump::~OutputPump()
+    {
+        {
+            std::lock_guard<std::mutex> guard{ _state->lock };
+            _state->stopping = true;
+        }
+        _state->readable.notify_all();
+        _state->writable.notify_all();
+
+        if (_deliverThread.joinable())
+        {
+            // An output handler might be what's destroying us. The delivery
+            //      thread finds out it was stopped once the handler returns.
+            if (_deliverThread.get_id() == std::this_thread::get_id())
+            {
+                _deliverThread.detach();
+            }
+            else
+            {
+                _deliverThread.join();
+            }
+        }
+
+        if (_readThread.joinable())
+        {
+            _readThread.detach();
+        }
+    }
+
+    // Method Description:
+    // - Starts reading the pipe, and delivering what's read.
+    void OutputPump::Start()
+    {
+        _readThread = std::thread(s_ReadThread, _pipe, _state);
+        _deliverThread = std::thread(s_DeliverThread, _state);
+    }
+
+    // Method Description:
+    // - Reads the pipe until a read fails, adding everything read to the
+    //      pending output. If too much is pending already, waits for the
+    //      delivery thread to take it first.
+    // Arguments:
+    // - pipe - the pipe to read
+    // - state - what we share with the delivery thread
+    void OutputPump::s_ReadThread(HANDLE pipe, std::shared_ptr<State> state)
+    {
+        std::string buffer(s_MinReadSize, '\0');
+        while (true)
+        {
+            DWORD dwRead = 0;
+            const bool fSuccess = !!ReadFile(pipe, buffer.data(), static_cast<DWORD>(buffer.size()), &dwRead, nullptr);
+            const DWORD error = fSuccess ? ERROR_SUCCESS : GetLastError();
+
+            {
+                std::unique_lock<std::mutex> lock{ state->lock };
+                if (!fSuccess || state->stopping)
+                {
+                    state->readDone = true;
+                    state->readError = error;
+                    lock.unlock();
+                    state->readable.notify_one();
+                    return;
+                }
+
+                state->writable.wait(lock, [&]() { return state->pending.size() < s_MaxPendingSize || state->stopping; });
+                state->pending.append(buffer.data(), dwRead);
+            }
+            state->readable.notify_one();
+
+            // A full read means there's probably more where it came from.
+            if (dwRead == buffer.size() && buffer.size() < s_MaxReadSize)
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+        }
+    }
+
+    // Method Description:
+    // - Delivers whatever has been read since the last batch, until we're
+    //      stopped, or until the pipe is done and everything has been delivered.
+    // Arguments:
+    // - state - what we share with the read thread
+    void OutputPump::s_DeliverThread(std::shared_ptr<State> state)
+    {
+        std::unique_lock<std::mutex> lock{ state->lock };
+        while (true)
+        {
+            state->readable.wait(lock, [&]() { return !state->pending.empty() || state->readDone || state->stopping; });
+            if (state->stopping)
+            {
+                return;
+            }
+
+            if (state->pending.empty())
+            {
+                const DWORD error = state->readError;
+                lock.unlock();
+                state->onDisconnected(error);
+                return;
+            }
+
+            // Take everything that's pending, and give the reader back the
+            //      buffer from the last batch, so neither of them reallocates.
+            state->delivering.swap(state->pending);
+            lock.unlock();
+            state->writable.notify_one();
+
+            state->onOutput(state->delivering);
+            state->delivering.clear();
+
+            lock.lock();
+        }
+    }
+}
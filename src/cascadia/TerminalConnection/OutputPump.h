@@ -0,0 +1,87 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// OutputPump.h
+// Reads the UTF-8 output of a pty from its pipe, and hands it to the
+// connection's output handlers as it is. The terminal parses UTF-8 itself,
+// and the connection only decodes it for handlers that want UTF-16 text.
+//
+// Reading and delivering happen on two threads. While the handlers are busy
+// with one batch of output, everything read in the meantime piles up, and is
+// delivered as a single batch once they're done. That way the terminal takes
+// its lock once per batch, rather than once per read.
+//
+// The pending bytes are kept in buffers that are reused from batch to batch,
+// and handed out by reference, so delivering output doesn't allocate once the
+// buffers are big enough.
+//
+// Both threads only touch state they share through a shared_ptr, never the
+// pump itself. So a handler can destroy the pump, the connection that owns it,
+// and the handlers themselves: the delivery thread finds out it was stopped
+// once the handler returns, and exits.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    class OutputPump final
+    {
+    public:
+        // Called with each batch of output, in UTF-8. A batch can end in the
+        //      middle of a character. The text is only valid during the call.
+        using OutputCallback = std::function<void(std::string_view output)>;
+        // Called once the pipe can't be read anymore, with the error that ReadFile failed with.
+        using DisconnectedCallback = std::function<void(DWORD error)>;
+
+        OutputPump(HANDLE pipe, OutputCallback onOutput, DisconnectedCallback onDisconnected);
+        ~OutputPump();
+
+        void Start();
+
+    private:
+        // What the two threads share. Each thread holds on to it, so that it
+        // can be left to finish what it's doing after the pump is gone.
+        struct State
+        {
+            std::mutex lock;
+            std::condition_variable readable;
+            std::condition_variable writable;
+
+            // Read from the pipe, and not delivered yet.
+            std::string pending;
+            bool readDone = false;
+            DWORD readError = ERROR_SUCCESS;
+            bool stopping = false;
+
+            // Owned by the delivery thread.
+            OutputCallback onOutput;
+            DisconnectedCallback onDisconnected;
+            std::string delivering;
+        };
+
+        // The size of the reads starts small, and doubles every time a read
+        // fills it, up to the maximum.
+        static constexpr size_t s_MinReadSize = 4096;
+        static constexpr size_t s_MaxReadSize = 64 * 1024;
+
+        // When this much is waiting to be delivered, reading stops until the
+        // handlers catch up, so a flood of output can't use up all our memory.
+        static constexpr size_t s_MaxPendingSize = 1024 * 1024;
+
+        static void s_ReadThread(HANDLE pipe, std::shared_ptr<State> state);
+        static void s_DeliverThread(std::shared_ptr<State> state);
+
+        HANDLE _pipe;
+        std::shared_ptr<State> _state;
+        std::thread _readThread;
+        std::thread _deliverThread;
+    };
+}
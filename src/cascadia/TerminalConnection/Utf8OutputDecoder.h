@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+//
+// Utf8OutputDecoder.h
+// Converts the UTF-8 output of a pty to UTF-16, one batch at a time.
+//
+// A batch can end in the middle of a character. The start of that character
+// is kept, and completed by the next batch. The text of each batch is kept in
+// a buffer that's reused from batch to batch, so decoding doesn't allocate
+// once the buffer is big enough.
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
+{
+    class Utf8OutputDecoder final
+    {
+    public:
+        Utf8OutputDecoder() noexcept :
+            _text{},
+            _partial{},
+            _partialLength{ 0 }
+        {
+        }
+
+        // Method Description:
+        // - Converts a batch of UTF-8 output to UTF-16. A sequence that's
+        //      split at the end of the batch is kept, and completed by the next one.
+        // Arguments:
+        // - utf8 - the batch to convert
+        // Return Value:
+        // - the text. It's only valid until the next call.
+        const std::wstring& Decode(const std::string_view utf8)
+        {
+            _text.clear();
+            size_t begin = 0;
+
+            if (_partialLength != 0)
+            {
+                const auto length = s_SequenceLength(_partial[0]);
+                while (_partialLength < length && begin < utf8.size() && (utf8[begin] & 0xC0) == 0x80)
+                {
+                    _partial[_partialLength++] = utf8[begin++];
+                }
+
+                if (_partialLength < length && begin == utf8.size())
+                {
+                    // Still not all there.
+                    return _text;
+                }
+
+                // If the sequence was cut short by something that doesn't
+                //      continue it, it's converted to a replacement character.
+                _AppendUtf8(_partial, _partialLength);
+                _partialLength = 0;
+            }
+
+            const auto end = s_CompleteLength(utf8, begin);
+            _partialLength = utf8.size() - end;
+            std::copy(utf8.begin() + end, utf8.end(), _partial);
+
+            _AppendUtf8(utf8.data() + begin, end - begin);
+            return _text;
+        }
+
+        // Method Description:
+        // - Finds out how long a UTF-8 sequence is from its first byte.
+        // Arguments:
+        // - lead - the first byte of the sequence
+        // Return Value:
+        // - the length of the sequence, or 1 if the byte can't start one.
+        static size_t s_SequenceLength(const char lead) noexcept
+        {
+            const auto byte = static_cast<unsigned char>(lead);
+            if (byte >= 0xF0 && byte <= 0xF7)
+            {
+                return 4;
+            }
+            if (byte >= 0xE0)
+            {
+                return byte <= 0xEF ? 3 : 1;
+            }
+            if (byte >= 0xC0)
+            {
+                return 2;
+            }
+            return 1;
+        }
+
+        // Method Description:
+        // - Finds where the last complete UTF-8 sequence in the text ends.
+        // Arguments:
+        // - utf8 - the text to look at
+        // - begin - where in the text to start looking
+        // Return Value:
+        // - the length of the text, unless it ends in the middle of a sequence,
+        //      in which case it's where that sequence starts.
+        static size_t s_CompleteLength(const std::string_view utf8, const size_t begin) noexcept
+        {
+            const auto size = utf8.size();
+
+            // An incomplete sequence can only have started in the last 3 bytes.
+            for (size_t back = 1; back <= 3 && back <= size - begin; back++)
+            {
+                const auto ch = utf8[size - back];
+                if ((ch & 0xC0) != 0x80)
+                {
+                    return s_SequenceLength(ch) > back ? size - back : size;
+                }
+            }
+            return size;
+        }
+
+    private:
+        // Method Description:
+        // - Converts complete UTF-8 sequences to UTF-16, at the end of _text.
+        // Arguments:
+        // - utf8 - the text to convert
+        // - length - how many bytes to convert
+        void _AppendUtf8(const char* const utf8, const size_t length)
+        {
+            if (length == 0)
+            {
+                return;
+            }
+
+            // Every UTF-8 sequence, even an invalid one, takes at least as many
+            //      bytes as it takes UTF-16 code units.
+            const auto oldSize = _text.size();
+            _text.resize(oldSize + length);
+            const int converted = MultiByteToWideChar(CP_UTF8,
+                                                      0,
+                                                      utf8,
+                                                      static_cast<int>(length),
+                                                      _text.data() + oldSize,
+                                                      static_cast<int>(length));
+            _text.resize(oldSize + std::max(converted, 0));
+        }
+
+        std::wstring _text;
+
+        // The start of a UTF-8 sequence that was split between two batches.
+        char _partial[4];
+        size_t _partialLength;
+    };
+}
@@ -291,6 +291,10 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         _renderer = std::make_unique<::Microsoft::Console::Render::Renderer>(_terminal, nullptr, 0, std::move(renderThread));
         ::Microsoft::Console::Render::IRenderTarget& renderTarget = *_renderer;
 
+        // The DX engine is only used by the renderer, and by us while we hold
+        //      LockPainting, so it can paint while the terminal takes more output.
+        _renderer->AllowPaintingOutsideLock();
+
         // Set up the DX Engine
         auto dxEngine = std::make_unique<::Microsoft::Console::Render::DxEngine>();
         _renderer->AddRenderEngine(dxEngine.get());
@@ -329,10 +333,14 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         THROW_IF_FAILED(dxEngine->Enable());
         _renderEngine = std::move(dxEngine);
 
-        auto onRecieveOutputFn = [this](const hstring str) {
-            _terminal->Write(str.c_str());
+        // The connection hands us a batch of output at a time, as the UTF-8
+        //      it came in, in a buffer of its own, so don't copy it. The
+        //      terminal decodes it itself, even when a character is split
+        //      between two batches.
+        auto onRecieveOutputFn = [this](const array_view<const uint8_t> output) {
+            _terminal->WriteUtf8({ reinterpret_cast<const char*>(output.data()), output.size() });
         };
-        _connectionOutputEventToken = _connection.TerminalOutput(onRecieveOutputFn);
+        _connectionOutputEventToken = _connection.TerminalOutputUtf8(onRecieveOutputFn);
 
         auto inputFn = std::bind(&TermControl::_SendInputToConnection, this, std::placeholders::_1);
         _terminal->SetWriteInputCallback(inputFn);
@@ -801,6 +809,8 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
 
     void TermControl::_SendInputToConnection(const std::wstring& wstr)
     {
+        // The echo of this input should be painted as soon as it comes back.
+        _renderer->NotifyInput();
         _connection.WriteInput(wstr);
     }
 
@@ -849,6 +859,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         const auto dpi = (int)(scale * USER_DEFAULT_SCREEN_DPI);
 
         // TODO: MSFT: 21169071 - Shouldn't this all happen through _renderer and trigger the invalidate automatically on DPI change?
+        auto paintLock = _renderer->LockPainting();
         THROW_IF_FAILED(_renderEngine->UpdateDpi(dpi));
         _renderer->TriggerRedrawAll();
     }
@@ -865,6 +876,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         size.cy = static_cast<long>(newHeight);
 
         // Tell the dx engine that our window is now the new size.
+        auto paintLock = _renderer->LockPainting();
         THROW_IF_FAILED(_renderEngine->SetWindowSize(size));
 
         // Invalidate everything
@@ -874,6 +886,7 @@ namespace winrt::Microsoft::Terminal::TerminalControl::implementation
         const auto viewInPixels = Viewport::FromDimensions({ 0, 0 },
                                                            { static_cast<short>(size.cx), static_cast<short>(size.cy) });
         const auto vp = _renderEngine->GetViewportInCharacters(viewInPixels);
+        paintLock.unlock();
 
         // If this function succeeds with S_FALSE, then the terminal didn't
         //      actually change size. No need to notify the connection of this
@@ -45,7 +45,12 @@ Terminal::Terminal() :
     _boxSelection{ false },
     _selectionActive{ false },
     _selectionAnchor{ 0, 0 },
-    _endSelectionPosition { 0, 0 }
+    _endSelectionPosition { 0, 0 },
+    _selectionAnchor_YOffset{ 0 },
+    _endSelectionPosition_YOffset{ 0 },
+    _historyViewFirstRow{ 0 },
+    _historyViewHistoryRows{ 0 },
+    _historyViewEndLine{ 0 }
 {
     _stateMachine = std::make_unique<StateMachine>(new OutputStateMachineEngine(new TerminalDispatch(*this)));
 
@@ -81,7 +86,27 @@ void Terminal::CreateFromSettings(winrt::Microsoft::Terminal::Settings::ICoreSet
 {
     const COORD viewportSize{ static_cast<short>(settings.InitialCols()), static_cast<short>(settings.InitialRows()) };
     // TODO:MSFT:20642297 - Support infinite scrollback here, if HistorySize is -1
-    Create(viewportSize, static_cast<short>(settings.HistorySize()), renderTarget);
+    const auto historySize = std::max(settings.HistorySize(), 0);
+
+    // The buffer's rows are addressed with SHORTs, so only so much of the
+    // history fits in it. The rest is kept in the buffer's scrollback store.
+    const auto bufferHistory = std::min(historySize, SHRT_MAX - viewportSize.Y);
+    Create(viewportSize, static_cast<short>(bufferHistory), renderTarget);
+    auto& scrollback = _buffer->GetScrollback();
+    scrollback.SetCapacity(static_cast<size_t>(historySize - bufferHistory));
+
+    // Past a few MB of compressed history, move the oldest of it out to disk,
+    // so that a huge HistorySize doesn't turn into a huge working set. If the
+    // temp file can't be made, the history just stays in memory.
+    static constexpr size_t scrollbackMemoryPages = 64;
+    if (scrollback.GetCapacity() > (ScrollbackStore::HotPages + scrollbackMemoryPages) * ScrollbackStore::PageSize)
+    {
+        try
+        {
+            scrollback.EnableSpilling(scrollbackMemoryPages);
+        }
+        CATCH_LOG();
+    }
 
     UpdateSettings(settings);
 }
@@ -152,13 +177,17 @@ HRESULT Terminal::UserResize(const COORD viewportSize) noexcept
         return S_FALSE;
     }
 
-    const auto oldTop = _mutableViewport.Top();
+    // Keep the cursor the same distance from the top of the viewport, as far
+    // as the new viewport allows.
+    const auto oldCursorHeight = _buffer->GetCursor().GetPosition().Y - _mutableViewport.Top();
 
     const short newBufferHeight = viewportSize.Y + _scrollbackLines;
     COORD bufferSize{ viewportSize.X, newBufferHeight };
-    RETURN_IF_FAILED(_buffer->ResizeTraditional(bufferSize));
+    RETURN_IF_FAILED(_buffer->ResizeWithReflow(bufferSize, gsl::narrow_cast<short>(_VisibleStartIndex())));
 
-    auto proposedTop = oldTop;
+    const auto newCursorY = _buffer->GetCursor().GetPosition().Y;
+    const auto cursorHeight = std::min(oldCursorHeight, viewportSize.Y - 1);
+    auto proposedTop = gsl::narrow_cast<short>(std::max(0, newCursorY - cursorHeight));
     const auto newView = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
     const auto proposedBottom = newView.BottomExclusive();
     // If the new bottom would be below the bottom of the buffer, then slide the
@@ -170,6 +199,7 @@ HRESULT Terminal::UserResize(const COORD viewportSize) noexcept
 
     _mutableViewport = Viewport::FromDimensions({ 0, proposedTop }, viewportSize);
     _scrollOffset = 0;
+    _RefreshHistoryView();
     _NotifyScrollEvent();
 
     return S_OK;
@@ -180,6 +210,23 @@ void Terminal::Write(std::wstring_view stringView)
     auto lock = LockForWriting();
 
     _stateMachine->ProcessString(stringView.data(), stringView.size());
+    _RefreshHistoryView();
+}
+
+// Method Description:
+// - Writes UTF-8 text, such as the output of a pty, through the parser. The
+//   parser decodes it as it goes, so there's no need to convert it to UTF-16
+//   first. A character split across two calls is completed by the second.
+// Arguments:
+// - stringView: the UTF-8 text to write.
+// Return Value:
+// - <none>
+void Terminal::WriteUtf8(std::string_view stringView)
+{
+    auto lock = LockForWriting();
+
+    _stateMachine->ProcessUtf8(stringView);
+    _RefreshHistoryView();
 }
 
 // Method Description:
@@ -206,6 +253,7 @@ bool Terminal::SendKeyEvent(const WORD vkey,
     {
         auto lock = LockForWriting();
         _scrollOffset = 0;
+        _RefreshHistoryView();
         _NotifyScrollEvent();
     }
 
@@ -289,6 +337,28 @@ int Terminal::_VisibleStartIndex() const noexcept
     return std::max(0, _ViewStartIndex() - _scrollOffset);
 }
 
+// _HistoryRowCount is the number of rows of history above the first row of the
+//      buffer, in its scrollback store and set aside by resizes. The scroll
+//      positions we report count them, so the scrollbar reaches back into them.
+int Terminal::_HistoryRowCount() const noexcept
+{
+    return gsl::narrow_cast<int>(_buffer->GetHistoryRowCount());
+}
+
+// _VisibleTopRow is the first visible row, in buffer coordinates. Unlike
+//      _VisibleStartIndex, it goes negative when the view is scrolled up past
+//      the top of the buffer, into the history.
+int Terminal::_VisibleTopRow() const noexcept
+{
+    return std::max(_ViewStartIndex() - _scrollOffset, -_HistoryRowCount());
+}
+
+// _HistoryDepth is how far above the top of the buffer the view starts
+int Terminal::_HistoryDepth() const noexcept
+{
+    return std::max(0, -_VisibleTopRow());
+}
+
 Viewport Terminal::_GetVisibleViewport() const noexcept
 {
     const COORD origin{ 0, gsl::narrow<short>(_VisibleStartIndex()) };
@@ -309,12 +379,12 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
     auto& cursor = _buffer->GetCursor();
     const Viewport bufferSize = _buffer->GetSize();
 
-    for (size_t i = 0; i < stringView.size(); i++)
+    size_t i = 0;
+    while (i < stringView.size())
     {
-        wchar_t wch = stringView[i];
+        const wchar_t wch = stringView[i];
         const COORD cursorPosBefore = cursor.GetPosition();
         COORD proposedCursorPosition = cursorPosBefore;
-        bool notifyScroll = false;
 
         if (wch == UNICODE_LINEFEED)
         {
@@ -338,90 +408,296 @@ void Terminal::_WriteBuffer(const std::wstring_view& stringView)
         }
         else
         {
-            // TODO: MSFT 21006766
-            // This is not great but I need it demoable. Fix by making a buffer stream writer.
-            if (wch >= 0xD800 && wch <= 0xDFFF)
+            // Everything up to the next cursor control character is a run of
+            // printable text. Hand the whole run to the buffer at once instead of
+            // building an iterator and writing for every single character.
+            size_t runLength = 1;
+            while (i + runLength < stringView.size() && !_IsCursorControlChar(stringView[i + runLength]))
             {
-                OutputCellIterator it{ stringView.substr(i, 2) , _buffer->GetCurrentAttributes() };
-                const auto end = _buffer->Write(it);
-                const auto cellDistance = end.GetCellDistance(it);
-                i += cellDistance - 1;
-                proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
-            }
-            else
-            {
-                OutputCellIterator it{ stringView.substr(i, 1) , _buffer->GetCurrentAttributes() };
-                const auto end = _buffer->Write(it);
-                const auto cellDistance = end.GetCellDistance(it);
-                proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
+                runLength++;
             }
+
+            _WritePrintableRun(stringView.substr(i, runLength));
+            i += runLength;
+            continue;
+        }
+
+        _AdjustCursorPosition(proposedCursorPosition);
+        i++;
+    }
+}
+
+// Method Description:
+// - Writes a run of printable text into the buffer starting at the cursor,
+//   one row at a time. Each row is filled in a single pass through
+//   TextBuffer::WriteLine, and the cursor is wrapped onto the next row (cycling
+//   the circular buffer if necessary) whenever a row fills up.
+// - Surrogate pairs and wide glyphs are measured by the OutputCellIterator, so
+//   they're never split across a call.
+// Arguments:
+// - run: a run of text containing no cursor control characters.
+// Return Value:
+// - <none>
+void Terminal::_WritePrintableRun(const std::wstring_view run)
+{
+    auto& cursor = _buffer->GetCursor();
+    const auto bufferWidth = _buffer->GetSize().Width();
+
+    OutputCellIterator it{ run, _buffer->GetCurrentAttributes() };
+    while (it)
+    {
+        COORD proposedCursorPosition = cursor.GetPosition();
+
+        // If the cursor is sitting just past the end of the row, then the last
+        // write filled the row. Wrap onto the next row before writing more.
+        if (proposedCursorPosition.X >= bufferWidth)
+        {
+            _buffer->GetRowByOffset(proposedCursorPosition.Y).GetCharRow().SetWrapForced(true);
+            proposedCursorPosition.X = 0;
+            proposedCursorPosition.Y++;
+            _AdjustCursorPosition(proposedCursorPosition);
+            continue;
         }
 
-        // If we're about to scroll past the bottom of the buffer, instead cycle the buffer.
-        const auto newRows = proposedCursorPosition.Y - bufferSize.Height() + 1;
-        if (newRows > 0)
+        const auto end = _buffer->WriteLine(it, proposedCursorPosition, true);
+        const auto cellDistance = end.GetCellDistance(it);
+
+        // A glyph wider than the whole buffer doesn't fit on any row. Nothing
+        // was written, so wrapping would only leave it stuck at the start of
+        // the next row, forever. Drop it instead, like writing it one
+        // character at a time would have.
+        if (end && cellDistance == 0 && proposedCursorPosition.X == 0)
         {
-            for(auto dy = 0; dy < newRows; dy++)
-            {
-                _buffer->IncrementCircularBuffer();
-                proposedCursorPosition.Y--;
-            }
-            notifyScroll = true;
+            it = end;
+            ++it;
+            continue;
         }
 
-        // This section is essentially equivalent to `AdjustCursorPosition`
-        // Update Cursor Position
-        cursor.SetPosition(proposedCursorPosition);
+        it = end;
+
+        // If we still have text left over, then we ran out of room on this row.
+        // (This includes a wide glyph that didn't fit in the final column - the
+        // row was padded out and the glyph goes onto the next row.)
+        // Park the cursor past the end so we wrap on the next time around.
+        if (it)
+        {
+            proposedCursorPosition.X = bufferWidth;
+        }
+        else
+        {
+            proposedCursorPosition.X += gsl::narrow<SHORT>(cellDistance);
+        }
+
+        _AdjustCursorPosition(proposedCursorPosition);
+    }
+}
 
-        const COORD cursorPosAfter = cursor.GetPosition();
+// Method Description:
+// - Moves the cursor to the proposed position. If the position is below the
+//   bottom of the buffer, cycles the buffer up instead. If the cursor leaves the
+//   mutable viewport, the viewport is moved down to follow it.
+// - This is essentially equivalent to conhost's `AdjustCursorPosition`.
+// Arguments:
+// - proposedPosition: the new location for the cursor, in buffer coordinates.
+// Return Value:
+// - <none>
+void Terminal::_AdjustCursorPosition(const COORD proposedPosition)
+{
+    auto& cursor = _buffer->GetCursor();
+    const Viewport bufferSize = _buffer->GetSize();
+    COORD proposedCursorPosition = proposedPosition;
+    bool notifyScroll = false;
 
-        // Move the viewport down if the cursor moved below the viewport.
-        if (cursorPosAfter.Y > _mutableViewport.BottomInclusive())
+    // If we're about to scroll past the bottom of the buffer, instead cycle the buffer.
+    const auto newRows = proposedCursorPosition.Y - bufferSize.Height() + 1;
+    if (newRows > 0)
+    {
+        for(auto dy = 0; dy < newRows; dy++)
         {
-            const auto newViewTop = std::max(0, cursorPosAfter.Y - (_mutableViewport.Height() - 1));
-            if (newViewTop != _mutableViewport.Top())
-            {
-                _mutableViewport = Viewport::FromDimensions({0, gsl::narrow<short>(newViewTop)}, _mutableViewport.Dimensions());
-                notifyScroll = true;
-            }
+            _buffer->IncrementCircularBuffer();
+            proposedCursorPosition.Y--;
         }
+        notifyScroll = true;
+    }
+
+    // Update Cursor Position
+    cursor.SetPosition(proposedCursorPosition);
+
+    const COORD cursorPosAfter = cursor.GetPosition();
 
-        if (notifyScroll)
+    // Move the viewport down if the cursor moved below the viewport.
+    if (cursorPosAfter.Y > _mutableViewport.BottomInclusive())
+    {
+        const auto newViewTop = std::max(0, cursorPosAfter.Y - (_mutableViewport.Height() - 1));
+        if (newViewTop != _mutableViewport.Top())
         {
-            _buffer->GetRenderTarget().TriggerRedrawAll();
-            _NotifyScrollEvent();
+            _mutableViewport = Viewport::FromDimensions({0, gsl::narrow<short>(newViewTop)}, _mutableViewport.Dimensions());
+            notifyScroll = true;
         }
     }
+
+    if (notifyScroll)
+    {
+        _buffer->GetRenderTarget().TriggerRedrawAll();
+        _NotifyScrollEvent();
+    }
 }
 
+// Method Description:
+// - Returns true for the characters that _WriteBuffer handles by moving the
+//   cursor rather than printing a glyph.
+bool Terminal::_IsCursorControlChar(const wchar_t wch) noexcept
+{
+    return wch == UNICODE_LINEFEED ||
+           wch == UNICODE_CARRIAGERETURN ||
+           wch == UNICODE_BACKSPACE;
+}
+
+// Method Description:
+// - Scrolls the view as the result of some user interaction.
+// Arguments:
+// - viewTop: the new top of the view. Like the positions we report through the
+//      scroll position callback, it counts the rows of history above the top
+//      of the buffer.
+// Return Value:
+// - <none>
 void Terminal::UserScrollViewport(const int viewTop)
 {
-    const auto clampedNewTop = std::max(0, viewTop);
-    const auto realTop = _ViewStartIndex();
-    const auto newDelta = realTop - clampedNewTop;
+    auto lock = LockForWriting();
+
+    const auto newTopRow = std::max(0, viewTop) - _HistoryRowCount();
+    bool notifyScroll = false;
+
     // if viewTop > realTop, we want the offset to be 0.
+    _scrollOffset = std::max(0, _ViewStartIndex() - newTopRow);
+
+    // Scrolling close to the top reflows more of the history that a resize
+    // left above the buffer. Everything moves down to make room for it, and
+    // the view stays as far above the viewport as it was.
+    if (newTopRow < TextBuffer::ReflowMargin && _buffer->GetUnreflowedRowCount() > 0)
+    {
+        try
+        {
+            const auto rows = std::min(TextBuffer::ReflowMargin - newTopRow, static_cast<int>(SHRT_MAX));
+            const auto added = _buffer->ReflowHistory(gsl::narrow<SHORT>(rows),
+                                                      _mutableViewport.BottomInclusive());
+            if (added > 0)
+            {
+                _mutableViewport = Viewport::FromDimensions({ 0, gsl::narrow<short>(_mutableViewport.Top() + added) },
+                                                            _mutableViewport.Dimensions());
+                notifyScroll = true;
+            }
+        }
+        CATCH_LOG();
+    }
 
-    _scrollOffset = std::max(0, newDelta);
+    _RefreshHistoryView();
     _buffer->GetRenderTarget().TriggerRedrawAll();
+
+    if (notifyScroll)
+    {
+        _NotifyScrollEvent();
+    }
 }
 
 int Terminal::GetScrollOffset()
 {
-    return _VisibleStartIndex();
+    return _HistoryRowCount() + _VisibleTopRow();
 }
 
 void Terminal::_NotifyScrollEvent()
 {
     if (_pfnScrollPositionChanged)
     {
-        const auto visible = _GetVisibleViewport();
-        const auto top = visible.Top();
-        const auto height = visible.Height();
-        const auto bottom = this->GetBufferHeight();
+        const auto historyRows = _HistoryRowCount();
+        const auto top = historyRows + _VisibleTopRow();
+        const auto height = _mutableViewport.Height();
+        const auto bottom = historyRows + this->GetBufferHeight();
         _pfnScrollPositionChanged(top, height, bottom);
     }
 }
 
+// Method Description:
+// - Copies the visible rows into _historyView while the view is scrolled up
+//   past the top of the buffer, or drops _historyView once it isn't. This has
+//   to be called with the write lock held, every time the view moves or the
+//   rows under it change, so that readers only ever read _historyView.
+// - If the rows can't be copied, the view shows the top of the buffer instead.
+// - The history rows are only copied again, and the whole view redrawn, when
+//   the history under the view has changed. Otherwise, only the rows of the
+//   buffer below the history are, since they're the only ones output can change.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Terminal::_RefreshHistoryView() noexcept
+{
+    const auto depth = _HistoryDepth();
+    if (depth == 0)
+    {
+        if (_historyView)
+        {
+            _historyView.reset();
+            _historyReader.reset();
+            _buffer->GetRenderTarget().TriggerRedrawAll();
+        }
+        return;
+    }
+
+    try
+    {
+        const auto size = _mutableViewport.Dimensions();
+        const auto historyRows = _buffer->GetHistoryRowCount();
+        const auto firstRow = historyRows - depth;
+        const auto endLine = _buffer->GetScrollback().EndLine();
+
+        bool historyChanged = true;
+        if (!_historyView || !(_historyView->GetSize().Dimensions() == size))
+        {
+            _historyView.reset();
+            _historyView = std::make_unique<TextBuffer>(size,
+                                                        TextAttribute{},
+                                                        _buffer->GetCursor().GetSize(),
+                                                        _buffer->GetRenderTarget());
+        }
+        else
+        {
+            historyChanged = firstRow != _historyViewFirstRow ||
+                             historyRows != _historyViewHistoryRows ||
+                             endLine != _historyViewEndLine;
+        }
+
+        if (!_historyReader)
+        {
+            _historyReader = std::make_unique<ScrollbackStore::Reader>(_buffer->GetScrollback());
+        }
+
+        if (historyChanged)
+        {
+            // The rows below the history, if any fit in the view, are the top
+            // rows of the buffer.
+            _buffer->CopyHistoryRows(firstRow, size.Y, *_historyView, 0, *_historyReader);
+            _historyViewFirstRow = firstRow;
+            _historyViewHistoryRows = historyRows;
+            _historyViewEndLine = endLine;
+            _buffer->GetRenderTarget().TriggerRedrawAll();
+        }
+        else if (depth < size.Y)
+        {
+            const auto bufferRows = gsl::narrow_cast<SHORT>(size.Y - depth);
+            _buffer->CopyHistoryRows(historyRows, bufferRows, *_historyView, gsl::narrow_cast<SHORT>(depth), *_historyReader);
+            _buffer->GetRenderTarget().TriggerRedraw(Viewport::FromDimensions({ 0, gsl::narrow_cast<SHORT>(depth) },
+                                                                              { size.X, bufferRows }));
+        }
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        _historyView.reset();
+        _historyReader.reset();
+    }
+}
+
 void Terminal::SetWriteInputCallback(std::function<void(std::wstring&)> pfn) noexcept
 {
     _pfnWriteInput = pfn;
@@ -454,12 +730,10 @@ void Terminal::SetSelectionAnchor(const COORD position)
 {
     _selectionAnchor = position;
 
-    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
-    THROW_IF_FAILED(ShortSub(_selectionAnchor.Y, gsl::narrow<SHORT>(_scrollOffset), &_selectionAnchor.Y));
-
-    // copy value of ViewStartIndex to support scrolling
-    // and update on new buffer output (used in _GetSelectionRects())
-    _selectionAnchor_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
+    // copy the first visible row, which includes _scrollOffset, to map this to
+    // the right row as the view scrolls and new output comes in (used in
+    // _GetSelectionRects())
+    _selectionAnchor_YOffset = _VisibleTopRow();
 
     _selectionActive = true;
     SetEndSelectionPosition(position);
@@ -473,12 +747,10 @@ void Terminal::SetEndSelectionPosition(const COORD position)
 {
     _endSelectionPosition = position;
 
-    // include _scrollOffset here to ensure this maps to the right spot of the original viewport
-    THROW_IF_FAILED(ShortSub(_endSelectionPosition.Y, gsl::narrow<SHORT>(_scrollOffset), &_endSelectionPosition.Y));
-
-    // copy value of ViewStartIndex to support scrolling
-    // and update on new buffer output (used in _GetSelectionRects())
-    _endSelectionPosition_YOffset = gsl::narrow<SHORT>(_ViewStartIndex());
+    // copy the first visible row, which includes _scrollOffset, to map this to
+    // the right row as the view scrolls and new output comes in (used in
+    // _GetSelectionRects())
+    _endSelectionPosition_YOffset = _VisibleTopRow();
 }
 
 void Terminal::_InitializeColorTable()
@@ -493,10 +765,17 @@ void Terminal::_InitializeColorTable()
 }
 
 // Method Description:
-// - Helper to determine the selected region of the buffer. Used for rendering.
+// - Helper to determine the selected region of the buffer, or of the history
+//   above it. Used for rendering and copying.
+// Arguments:
+// - firstRow: the first row to look at, in buffer coordinates. It's negative
+//      for rows of the history above the buffer.
+// - rowCount: how many rows to look at
 // Return Value:
-// - A vector of rectangles representing the regions to select, line by line. They are absolute coordinates relative to the buffer origin.
-std::vector<SMALL_RECT> Terminal::_GetSelectionRects() const
+// - A vector of rectangles representing the regions to select, line by line,
+//      for the selected rows that are among the ones looked at. Their rows
+//      are relative to firstRow.
+std::vector<SMALL_RECT> Terminal::_GetSelectionRects(const int firstRow, const int rowCount) const
 {
     std::vector<SMALL_RECT> selectionArea;
 
@@ -506,35 +785,40 @@ std::vector<SMALL_RECT> Terminal::_GetSelectionRects() const
     }
 
     // Add anchor offset here to update properly on new buffer output
-    SHORT temp1, temp2;
-    THROW_IF_FAILED(ShortAdd(_selectionAnchor.Y, _selectionAnchor_YOffset, &temp1));
-    THROW_IF_FAILED(ShortAdd(_endSelectionPosition.Y, _endSelectionPosition_YOffset, &temp2));
-
-    // create these new anchors for comparison and rendering
-    const COORD selectionAnchorWithOffset = { _selectionAnchor.X, temp1 };
-    const COORD endSelectionPositionWithOffset = { _endSelectionPosition.X, temp2 };
+    const auto anchorRow = _selectionAnchor.Y + _selectionAnchor_YOffset;
+    const auto endRow = _endSelectionPosition.Y + _endSelectionPosition_YOffset;
 
     // NOTE: (0,0) is top-left so vertical comparison is inverted
-    const COORD &higherCoord = (selectionAnchorWithOffset.Y <= endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
-    const COORD &lowerCoord = (selectionAnchorWithOffset.Y > endSelectionPositionWithOffset.Y) ? selectionAnchorWithOffset : endSelectionPositionWithOffset;
+    const auto anchorIsHigher = anchorRow <= endRow;
+    const auto higherRow = anchorIsHigher ? anchorRow : endRow;
+    const auto lowerRow = anchorIsHigher ? endRow : anchorRow;
+    const auto higherX = anchorIsHigher ? _selectionAnchor.X : _endSelectionPosition.X;
+    const auto lowerX = anchorIsHigher ? _endSelectionPosition.X : _selectionAnchor.X;
+
+    const auto top = std::max(higherRow, firstRow);
+    const auto bottom = std::min(lowerRow, firstRow + rowCount - 1);
+    if (top > bottom)
+    {
+        return selectionArea;
+    }
 
-    selectionArea.reserve(lowerCoord.Y - higherCoord.Y + 1);
-    for (auto row = higherCoord.Y; row <= lowerCoord.Y; row++)
+    selectionArea.reserve(bottom - top + 1);
+    for (auto row = top; row <= bottom; row++)
     {
         SMALL_RECT selectionRow;
 
-        selectionRow.Top = row;
-        selectionRow.Bottom = row;
+        selectionRow.Top = gsl::narrow<SHORT>(row - firstRow);
+        selectionRow.Bottom = selectionRow.Top;
 
-        if (_boxSelection || higherCoord.Y == lowerCoord.Y)
+        if (_boxSelection || higherRow == lowerRow)
         {
-            selectionRow.Left = std::min(higherCoord.X, lowerCoord.X);
-            selectionRow.Right = std::max(higherCoord.X, lowerCoord.X);
+            selectionRow.Left = std::min(higherX, lowerX);
+            selectionRow.Right = std::max(higherX, lowerX);
         }
         else
         {
-            selectionRow.Left = (row == higherCoord.Y) ? higherCoord.X : 0;
-            selectionRow.Right = (row == lowerCoord.Y) ? lowerCoord.X : _buffer->GetSize().RightInclusive();
+            selectionRow.Left = (row == higherRow) ? higherX : 0;
+            selectionRow.Right = (row == lowerRow) ? lowerX : _buffer->GetSize().RightInclusive();
         }
 
         selectionArea.emplace_back(selectionRow);
@@ -576,16 +860,59 @@ const std::wstring Terminal::RetrieveSelectedTextFromBuffer(bool trimTrailingWhi
     std::function<COLORREF(TextAttribute&)> GetForegroundColor = std::bind(&Terminal::GetForegroundColor, this, std::placeholders::_1);
     std::function<COLORREF(TextAttribute&)> GetBackgroundColor = std::bind(&Terminal::GetBackgroundColor, this, std::placeholders::_1);
 
-    auto data = _buffer->GetTextForClipboard(!_boxSelection,
-                                             trimTrailingWhitespace,
-                                             _GetSelectionRects(),
-                                             GetForegroundColor,
-                                             GetBackgroundColor);
+    const auto historyRows = _HistoryRowCount();
+    const auto bufferRows = gsl::narrow_cast<int>(_buffer->TotalRowCount());
+    const auto anchorRow = _selectionAnchor.Y + _selectionAnchor_YOffset;
+    const auto endRow = _endSelectionPosition.Y + _endSelectionPosition_YOffset;
+    const auto topRow = std::max(std::min(anchorRow, endRow), -historyRows);
+    const auto bottomRow = std::min(std::max(anchorRow, endRow), bufferRows - 1);
 
     std::wstring result;
-    for (const auto& text : data.text)
+    if (!_selectionActive || topRow >= 0)
     {
-        result += text;
+        auto data = _buffer->GetTextForClipboard(!_boxSelection,
+                                                 trimTrailingWhitespace,
+                                                 _GetSelectionRects(0, bufferRows),
+                                                 GetForegroundColor,
+                                                 GetBackgroundColor);
+        for (const auto& text : data.text)
+        {
+            result += text;
+        }
+        return result;
+    }
+
+    // The selection starts in the history above the buffer. Its rows are
+    // copied into a scratch buffer a chunk at a time, to get their text the
+    // same way. Each chunk but the last copies one row more than it keeps, so
+    // that GetTextForClipboard can tell whether its last line goes on.
+    static constexpr int chunkRows = 1024;
+    const auto scratchRows = std::min(bottomRow - topRow + 1, chunkRows + 1);
+    TextBuffer scratch{ { _buffer->GetSize().Width(), gsl::narrow<SHORT>(scratchRows) },
+                        TextAttribute{},
+                        _buffer->GetCursor().GetSize(),
+                        _buffer->GetRenderTarget() };
+
+    ScrollbackStore::Reader reader{ _buffer->GetScrollback() };
+    for (auto chunkTop = topRow; chunkTop <= bottomRow; chunkTop += chunkRows)
+    {
+        const auto lastChunk = bottomRow - chunkTop < chunkRows;
+        const auto rows = lastChunk ? bottomRow - chunkTop + 1 : chunkRows + 1;
+        _buffer->CopyHistoryRows(gsl::narrow_cast<size_t>(historyRows + chunkTop), rows, scratch, 0, reader);
+
+        auto data = scratch.GetTextForClipboard(!_boxSelection,
+                                                trimTrailingWhitespace,
+                                                _GetSelectionRects(chunkTop, rows),
+                                                GetForegroundColor,
+                                                GetBackgroundColor);
+        if (!lastChunk)
+        {
+            data.text.pop_back();
+        }
+        for (const auto& text : data.text)
+        {
+            result += text;
+        }
     }
 
     return result;
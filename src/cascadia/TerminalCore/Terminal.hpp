@@ -27,6 +27,13 @@ namespace Microsoft::Terminal::Core
     class Terminal;
 }
 
+#ifdef UNIT_TESTING
+namespace TerminalCoreUnitTests
+{
+    class TerminalBufferTests;
+};
+#endif
+
 class Microsoft::Terminal::Core::Terminal final :
     public Microsoft::Terminal::Core::ITerminalApi,
     public Microsoft::Terminal::Core::ITerminalInput,
@@ -47,6 +54,7 @@ public:
 
     // Write goes through the parser
     void Write(std::wstring_view stringView);
+    void WriteUtf8(std::string_view stringView);
 
     [[nodiscard]]
     std::shared_lock<std::shared_mutex> LockForReading();
@@ -144,8 +152,11 @@ public:
     COORD _endSelectionPosition;
     bool _boxSelection;
     bool _selectionActive;
-    SHORT _selectionAnchor_YOffset;
-    SHORT _endSelectionPosition_YOffset;
+    // The first visible row when each end of the selection was set, in
+    // buffer coordinates. It's negative if that was in the history above the
+    // buffer, which can be further up than a SHORT reaches.
+    int _selectionAnchor_YOffset;
+    int _endSelectionPosition_YOffset;
 
     std::shared_mutex _readWriteLock;
 
@@ -157,6 +168,7 @@ public:
 
     // _scrollOffset is the number of lines above the viewport that are currently visible
     // If _scrollOffset is 0, then the visible region of the buffer is the viewport.
+    // It can reach past the top of the buffer, into the history above it.
     int _scrollOffset;
     // TODO this might not be the value we want to store.
     // We might want to store the height in the scrollback that's currenty visible.
@@ -171,8 +183,28 @@ public:
     //      underneath them, while others would prefer to anchor it in place.
     //      Either way, we sohould make this behavior controlled by a setting.
 
+    // While the view is scrolled up past the top of the buffer, the visible
+    // rows are copied in here, and this is what gets drawn. Null otherwise.
+    std::unique_ptr<TextBuffer> _historyView;
+
+    // Reads the history into _historyView. It's kept along with the view, so
+    // that the page it decoded last isn't decoded again on every write.
+    std::unique_ptr<ScrollbackStore::Reader> _historyReader;
+
+    // The history the rows of _historyView were copied from: the first row,
+    // how many history rows there were, and the store's EndLine. While these
+    // stay the same, the history rows in the view do too.
+    size_t _historyViewFirstRow;
+    size_t _historyViewHistoryRows;
+    ScrollbackStore::line_number _historyViewEndLine;
+
     int _ViewStartIndex() const noexcept;
     int _VisibleStartIndex() const noexcept;
+    int _HistoryRowCount() const noexcept;
+    int _VisibleTopRow() const noexcept;
+    int _HistoryDepth() const noexcept;
+
+    void _RefreshHistoryView() noexcept;
 
     Microsoft::Console::Types::Viewport _GetMutableViewport() const noexcept;
     Microsoft::Console::Types::Viewport _GetVisibleViewport() const noexcept;
@@ -180,9 +212,16 @@ public:
     void _InitializeColorTable();
 
     void _WriteBuffer(const std::wstring_view& stringView);
+    void _WritePrintableRun(const std::wstring_view run);
+    void _AdjustCursorPosition(const COORD proposedPosition);
+    static bool _IsCursorControlChar(const wchar_t wch) noexcept;
 
     void _NotifyScrollEvent();
 
-    std::vector<SMALL_RECT> _GetSelectionRects() const;
+    std::vector<SMALL_RECT> _GetSelectionRects(const int firstRow, const int rowCount) const;
+
+#ifdef UNIT_TESTING
+    friend class TerminalCoreUnitTests::TerminalBufferTests;
+#endif
 };
 
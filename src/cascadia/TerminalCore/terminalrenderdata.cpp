@@ -10,12 +10,18 @@ using namespace Microsoft::Console::Render;
 
 Viewport Terminal::GetViewport() noexcept
 {
+    // While the view is scrolled up past the top of the buffer, the visible
+    // rows are all there is of _historyView.
+    if (_historyView)
+    {
+        return _historyView->GetSize();
+    }
     return _GetVisibleViewport();
 }
 
 const TextBuffer& Terminal::GetTextBuffer() noexcept
 {
-    return *_buffer;
+    return _historyView ? *_historyView : *_buffer;
 }
 
 const FontInfo& Terminal::GetFontInfo() noexcept
@@ -55,12 +61,25 @@ const COLORREF Terminal::GetBackgroundColor(const TextAttribute& attr) const noe
 COORD Terminal::GetCursorPosition() const noexcept
 {
     const auto& cursor = _buffer->GetCursor();
-    return cursor.GetPosition();
+    auto position = cursor.GetPosition();
+
+    // In _historyView, the rows of the buffer start below the history.
+    if (_historyView)
+    {
+        position.Y = gsl::narrow_cast<SHORT>(position.Y + _HistoryDepth());
+    }
+    return position;
 }
 
 bool Terminal::IsCursorVisible() const noexcept
 {
     const auto& cursor = _buffer->GetCursor();
+
+    // The rows of the buffer in _historyView are only the ones at its bottom.
+    if (_historyView && cursor.GetPosition().Y + _HistoryDepth() >= _mutableViewport.Height())
+    {
+        return false;
+    }
     return cursor.IsVisible() && !cursor.IsPopupShown();
 }
 
@@ -109,7 +128,11 @@ std::vector<Microsoft::Console::Types::Viewport> Terminal::GetSelectionRects() n
 {
     std::vector<Viewport> result;
 
-    for (const auto& lineRect : _GetSelectionRects())
+    // While _historyView is drawn, only the rows in it are of any use, and
+    // they're relative to its top.
+    const auto firstRow = _historyView ? _VisibleTopRow() : 0;
+    const auto rowCount = _historyView ? _mutableViewport.Height() : gsl::narrow_cast<int>(_buffer->TotalRowCount());
+    for (const auto& lineRect : _GetSelectionRects(firstRow, rowCount))
     {
         result.emplace_back(Viewport::FromInclusive(lineRect));
     }
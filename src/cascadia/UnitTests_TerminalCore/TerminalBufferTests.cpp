@@ -0,0 +1,204 @@
+/*
+* Copyright (c) Microsoft Corporation.
+* Licensed under the MIT license.
+*/
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalCore/Terminal.hpp"
+#include "../renderer/inc/DummyRenderTarget.hpp"
+#include "consoletaeftemplates.hpp"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+namespace TerminalCoreUnitTests
+{
+    class TerminalBufferTests
+    {
+        TEST_CLASS(TerminalBufferTests);
+
+        TEST_METHOD(PrintRunWritesWholeRow)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            term.Write(L"abcdef");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"abcdef    " }, buffer.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 6, 0 }), buffer.GetCursor().GetPosition());
+            VERIFY_IS_FALSE(buffer.GetRowByOffset(0).GetCharRow().WasWrapForced());
+        }
+
+        TEST_METHOD(PrintRunWrapsAcrossRows)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            term.Write(L"0123456789abcde");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"0123456789" }, buffer.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"abcde     " }, buffer.GetRowByOffset(1).GetText());
+            VERIFY_IS_TRUE(buffer.GetRowByOffset(0).GetCharRow().WasWrapForced());
+            VERIFY_ARE_EQUAL((COORD{ 5, 1 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(PrintRunFillingRowDefersWrap)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            // Filling the row exactly leaves the cursor past the end of the row
+            // until something else is printed.
+            term.Write(L"0123456789");
+            VERIFY_ARE_EQUAL((COORD{ 10, 0 }), term.GetTextBuffer().GetCursor().GetPosition());
+
+            term.Write(L"X");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"X         " }, buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 1, 1 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(PrintRunWithSurrogatePair)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            // U+1D400 MATHEMATICAL BOLD CAPITAL A, surrounded by plain text.
+            term.Write(L"a\xD835\xDC00z");
+
+            const auto& buffer = term.GetTextBuffer();
+            const auto& charRow = buffer.GetRowByOffset(0).GetCharRow();
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"a" }, static_cast<std::wstring_view>(charRow.GlyphAt(0)));
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"\xD835\xDC00" }, static_cast<std::wstring_view>(charRow.GlyphAt(1)));
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"z" }, static_cast<std::wstring_view>(charRow.GlyphAt(2)));
+            VERIFY_ARE_EQUAL((COORD{ 3, 0 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(PrintRunCyclesCircularBuffer)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 4, 3 }, 0, emptyRT);
+
+            // 4 rows worth of text into a 3 row buffer, in one run.
+            term.Write(L"aaaabbbbccccdd");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"bbbb" }, buffer.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"cccc" }, buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"dd  " }, buffer.GetRowByOffset(2).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 2, 2 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(PrintRunDropsGlyphWiderThanBuffer)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 1, 3 }, 0, emptyRT);
+
+            // U+3042 HIRAGANA LETTER A takes two columns, and can never fit in
+            // a one column buffer. It should be dropped, not wrapped forever.
+            term.Write(L"a042" L"b");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"a" }, buffer.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"b" }, buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 1, 1 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(PrintRunBetweenControlCharacters)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            term.Write(L"abc\r\ndef\bX");
+
+            const auto& buffer = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"abc       " }, buffer.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"deX       " }, buffer.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL((COORD{ 3, 1 }), buffer.GetCursor().GetPosition());
+        }
+
+        TEST_METHOD(ScrollingIntoHistoryShowsStoredLines)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 4, 3 }, 0, emptyRT);
+            term._buffer->GetScrollback().SetCapacity(10);
+
+            // Two lines scroll out of the buffer, into its scrollback store.
+            term.Write(L"a\r\nb\r\nc\r\nd\r\ne");
+            VERIFY_ARE_EQUAL(2, term.GetScrollOffset());
+            VERIFY_ARE_EQUAL(std::wstring{ L"c   " }, term.GetTextBuffer().GetRowByOffset(0).GetText());
+
+            // Scroll up one line, into the history.
+            term.UserScrollViewport(1);
+            VERIFY_ARE_EQUAL(1, term.GetScrollOffset());
+            VERIFY_ARE_EQUAL((SMALL_RECT{ 0, 0, 3, 2 }), term.GetViewport().ToInclusive());
+            const auto& view = term.GetTextBuffer();
+            VERIFY_ARE_EQUAL(std::wstring{ L"b   " }, view.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"c   " }, view.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"d   " }, view.GetRowByOffset(2).GetText());
+            VERIFY_IS_FALSE(term.IsCursorVisible());
+
+            // Output that only changes the buffer rows in the view leaves the
+            // history rows alone, and updates the others.
+            const auto historyEndLine = term._historyViewEndLine;
+            term.Write(L"\x1b[2;2Hz");
+            VERIFY_IS_TRUE(&term.GetTextBuffer() == &view);
+            VERIFY_ARE_EQUAL(historyEndLine, term._historyViewEndLine);
+            VERIFY_ARE_EQUAL(std::wstring{ L"b   " }, view.GetRowByOffset(0).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"c   " }, view.GetRowByOffset(1).GetText());
+            VERIFY_ARE_EQUAL(std::wstring{ L"dz  " }, view.GetRowByOffset(2).GetText());
+
+            // Select from the history into the buffer, and copy it.
+            term.SetSelectionAnchor({ 0, 0 });
+            term.SetEndSelectionPosition({ 3, 1 });
+            VERIFY_ARE_EQUAL(std::wstring{ L"b\r\nc" }, term.RetrieveSelectedTextFromBuffer(true));
+
+            // The selection stays on the same lines as the view scrolls.
+            term.UserScrollViewport(0);
+            VERIFY_ARE_EQUAL(std::wstring{ L"a   " }, term.GetTextBuffer().GetRowByOffset(0).GetText());
+            const auto selectionRects = term.GetSelectionRects();
+            VERIFY_ARE_EQUAL(static_cast<size_t>(2), selectionRects.size());
+            VERIFY_ARE_EQUAL(static_cast<SHORT>(1), selectionRects.at(0).Top());
+            VERIFY_ARE_EQUAL(static_cast<SHORT>(2), selectionRects.at(1).Top());
+
+            // Scrolling back down goes back to drawing the buffer itself.
+            term.UserScrollViewport(2);
+            VERIFY_IS_TRUE(&term.GetTextBuffer() == term._buffer.get());
+            VERIFY_IS_TRUE(term.IsCursorVisible());
+        }
+
+        TEST_METHOD(WriteUtf8SplitAcrossCalls)
+        {
+            Terminal term = Terminal();
+            DummyRenderTarget emptyRT;
+            term.Create({ 10, 5 }, 0, emptyRT);
+
+            // U+3042 HIRAGANA LETTER A is three bytes in UTF-8. Split it between two writes.
+            term.WriteUtf8("a\x1b[1mb\xe3\x81");
+            term.WriteUtf8("\x82" "c");
+
+            const auto& buffer = term.GetTextBuffer();
+            const auto& charRow = buffer.GetRowByOffset(0).GetCharRow();
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"a" }, static_cast<std::wstring_view>(charRow.GlyphAt(0)));
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"b" }, static_cast<std::wstring_view>(charRow.GlyphAt(1)));
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"\x3042" }, static_cast<std::wstring_view>(charRow.GlyphAt(2)));
+            VERIFY_ARE_EQUAL(std::wstring_view{ L"c" }, static_cast<std::wstring_view>(charRow.GlyphAt(4)));
+            VERIFY_ARE_EQUAL((COORD{ 5, 0 }), buffer.GetCursor().GetPosition());
+        }
+    };
+}
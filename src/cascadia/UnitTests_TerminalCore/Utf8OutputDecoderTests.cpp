@@ -0,0 +1,84 @@
+/*
+* Copyright (c) Microsoft Corporation.
+* Licensed under the MIT license.
+*
+* Class Name: Utf8OutputDecoderTests
+*/
+#include "precomp.h"
+#include <WexTestClass.h>
+
+#include "../cascadia/TerminalConnection/Utf8OutputDecoder.h"
+
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+using namespace winrt::Microsoft::Terminal::TerminalConnection::implementation;
+
+namespace TerminalCoreUnitTests
+{
+    class Utf8OutputDecoderTests
+    {
+        TEST_CLASS(Utf8OutputDecoderTests);
+
+        TEST_METHOD(DecodesCompleteText)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{ L"a\x3042" L"b" }, decoder.Decode("a\xe3\x81\x82" "b"));
+        }
+
+        TEST_METHOD(CarriesSequenceSplitAfterOneByte)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{ L"a" }, decoder.Decode("a\xf0"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xd83d\xde00" L"b" }, decoder.Decode("\x9f\x98\x80" "b"));
+        }
+
+        TEST_METHOD(CarriesSequenceSplitAfterTwoBytes)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{ L"a" }, decoder.Decode("a\xf0\x9f"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xd83d\xde00" L"b" }, decoder.Decode("\x98\x80" "b"));
+        }
+
+        TEST_METHOD(CarriesSequenceSplitAfterThreeBytes)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{ L"a" }, decoder.Decode("a\xf0\x9f\x98"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xd83d\xde00" L"b" }, decoder.Decode("\x80" "b"));
+        }
+
+        TEST_METHOD(CarriesSequenceAcrossSeveralBatches)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{}, decoder.Decode("\xf0"));
+            VERIFY_ARE_EQUAL(std::wstring{}, decoder.Decode("\x9f"));
+            VERIFY_ARE_EQUAL(std::wstring{}, decoder.Decode("\x98"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xd83d\xde00" }, decoder.Decode("\x80"));
+        }
+
+        TEST_METHOD(CarriesThreeByteSequence)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{}, decoder.Decode("\xe3\x81"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\x3042" }, decoder.Decode("\x82"));
+        }
+
+        TEST_METHOD(DoesNotHoldBackInvalidLeadBytes)
+        {
+            Utf8OutputDecoder decoder;
+
+            // None of these can start a sequence, so there's nothing to wait for.
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xfffd" }, decoder.Decode("\xff"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xfffd" }, decoder.Decode("\x80"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"a\xfffd" }, decoder.Decode("a\xf8"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"b" }, decoder.Decode("b"));
+        }
+
+        TEST_METHOD(ReplacesSequenceCutShort)
+        {
+            Utf8OutputDecoder decoder;
+            VERIFY_ARE_EQUAL(std::wstring{}, decoder.Decode("\xe3"));
+            VERIFY_ARE_EQUAL(std::wstring{ L"\xfffd" L"a" }, decoder.Decode("a"));
+        }
+    };
+}
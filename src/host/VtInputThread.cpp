@@ -68,16 +68,17 @@ HRESULT VtInputThread::_HandleRunInput(_In_reads_(cch) const byte* const charBuf
 
     try
     {
-        std::unique_ptr<wchar_t[]> pwsSequence;
+        // The converted text lives in the parser's own buffer, which is
+        //      reused from read to read.
+        std::wstring_view wstr;
         unsigned int cchConsumed;
-        unsigned int cchSequence;
-        auto hr = _utf8Parser.Parse(charBuffer, cch, cchConsumed, pwsSequence, cchSequence);
+        auto hr = _utf8Parser.Parse(charBuffer, cch, cchConsumed, wstr);
         // If we hit a parsing error, eat it. It's bad utf-8, we can't do anything with it.
         if (FAILED(hr))
         {
             return S_FALSE;
         }
-        _pInputStateMachine->ProcessString(pwsSequence.get(), cchSequence);
+        _pInputStateMachine->ProcessString(wstr.data(), wstr.size());
     }
     CATCH_RETURN();
 
@@ -156,28 +156,40 @@ HRESULT VtIo::CreateIoHandlers() noexcept
             switch (_IoMode)
             {
             case VtIoMode::XTERM_256:
-                _pVtRenderEngine = std::make_unique<Xterm256Engine>(std::move(_hOutput),
-                                                                    gci,
-                                                                    initialViewport,
-                                                                    gci.GetColorTable(),
-                                                                    static_cast<WORD>(gci.GetColorTableSize()));
+            {
+                auto xterm256Engine = std::make_unique<Xterm256Engine>(std::move(_hOutput),
+                                                                       gci,
+                                                                       initialViewport,
+                                                                       gci.GetColorTable(),
+                                                                       static_cast<WORD>(gci.GetColorTableSize()));
+                xterm256Engine->SetFrameDiffing(true);
+                _pVtRenderEngine = std::move(xterm256Engine);
                 break;
+            }
             case VtIoMode::XTERM:
-                _pVtRenderEngine = std::make_unique<XtermEngine>(std::move(_hOutput),
+            {
+                auto xtermEngine = std::make_unique<XtermEngine>(std::move(_hOutput),
                                                                  gci,
                                                                  initialViewport,
                                                                  gci.GetColorTable(),
                                                                  static_cast<WORD>(gci.GetColorTableSize()),
                                                                  false);
+                xtermEngine->SetFrameDiffing(true);
+                _pVtRenderEngine = std::move(xtermEngine);
                 break;
+            }
             case VtIoMode::XTERM_ASCII:
-                _pVtRenderEngine = std::make_unique<XtermEngine>(std::move(_hOutput),
+            {
+                auto xtermEngine = std::make_unique<XtermEngine>(std::move(_hOutput),
                                                                  gci,
                                                                  initialViewport,
                                                                  gci.GetColorTable(),
                                                                  static_cast<WORD>(gci.GetColorTableSize()),
                                                                  true);
+                xtermEngine->SetFrameDiffing(true);
+                _pVtRenderEngine = std::move(xtermEngine);
                 break;
+            }
             case VtIoMode::WIN_TELNET:
                 _pVtRenderEngine = std::make_unique<WinTelnetEngine>(std::move(_hOutput),
                                                                      gci,
@@ -191,6 +203,16 @@ HRESULT VtIo::CreateIoHandlers() noexcept
             if (_pVtRenderEngine)
             {
                 _pVtRenderEngine->SetTerminalOwner(this);
+
+                // Frames the engine holds back while the terminal is slow to
+                //      read get painted once it has caught up.
+                _pVtRenderEngine->SetRepaintCallback([]() {
+                    auto* const pRender = ServiceLocator::LocateGlobals().pRender;
+                    if (pRender != nullptr)
+                    {
+                        pRender->TriggerPaint();
+                    }
+                });
             }
         }
     }
@@ -863,7 +863,8 @@ NTSTATUS WriteCharsLegacy(SCREEN_INFORMATION& screenInfo,
                 try
                 {
                     // If we're on top of a trailing cell, clear it and the previous cell.
-                    if (charRow.DbcsAttrAt(TargetPoint.X).IsTrailing())
+                    // (Read it through a const ref, which doesn't upgrade an ASCII row.)
+                    if (static_cast<const CharRow&>(charRow).DbcsAttrAt(TargetPoint.X).IsTrailing())
                     {
                         // Space to clear for 2 cells.
                         OutputCellIterator it(UNICODE_SPACE, 2);
@@ -1133,7 +1134,6 @@ HRESULT ApiRoutines::WriteConsoleAImpl(IConsoleOutputObject& context,
         const auto codepage = gci.OutputCP;
 
         // Convert our input parameters to Unicode
-        std::unique_ptr<wchar_t[]> wideCharBuffer{ nullptr };
         static Utf8ToWideCharParser parser{ gci.OutputCP };
 
         // update current codepage in case it was changed from last time
@@ -1142,23 +1142,23 @@ HRESULT ApiRoutines::WriteConsoleAImpl(IConsoleOutputObject& context,
         parser.SetCodePage(gci.OutputCP);
 
         SCREEN_INFORMATION& ScreenInfo = context.GetActiveBuffer();
-        wchar_t* pwchBuffer;
+        const wchar_t* pwchBuffer;
         size_t cchBuffer;
         if (codepage == CP_UTF8)
         {
-            wideCharBuffer.release();
+            // The parser converts into a buffer of its own that it reuses from call to call.
+            //      It stays valid until the next call, and we hold the console lock until we're done with it.
             unsigned int charCount;
             unsigned int charsConsumed;
-            unsigned int charsGenerated;
+            std::wstring_view converted;
             RETURN_IF_FAILED(SizeTToUInt(buffer.size(), &charCount));
             RETURN_IF_FAILED(parser.Parse(reinterpret_cast<const byte*>(buffer.data()),
                                           charCount,
                                           charsConsumed,
-                                          wideCharBuffer,
-                                          charsGenerated));
+                                          converted));
 
-            pwchBuffer = reinterpret_cast<wchar_t*>(wideCharBuffer.get());
-            cchBuffer = charsGenerated;
+            pwchBuffer = converted.data();
+            cchBuffer = converted.size();
             read = charsConsumed;
         }
         else
@@ -133,7 +133,7 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 //   from the input buffer and in the peek case they are not.
 // Arguments:
 // - pInputBuffer - The input buffer to take records from to return to the client
-// - outEvents - The storage location to fill with input events
+// - outRecords - The storage location to fill with input records
 // - eventReadCount - The number of events to read
 // - pInputReadHandleData - A structure that will help us maintain
 // some input context across various calls on the same input
@@ -154,7 +154,7 @@ void EventsToUnicode(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
 // - Or an out of memory/math/string error message in NTSTATUS format.
 [[nodiscard]]
 static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
-                                   std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+                                   std::vector<INPUT_RECORD>& outRecords,
                                    const size_t eventReadCount,
                                    INPUT_READ_HANDLE_DATA& readHandleState,
                                    const bool IsUnicode,
@@ -173,22 +173,22 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
         LockConsole();
         auto Unlock = wil::scope_exit([&] { UnlockConsole(); });
 
-        std::deque<std::unique_ptr<IInputEvent>> partialEvents;
+        std::vector<INPUT_RECORD> partialRecords;
         if (!IsUnicode)
         {
             if (inputBuffer.IsReadPartialByteSequenceAvailable())
             {
-                partialEvents.push_back(inputBuffer.FetchReadPartialByteSequence(IsPeek));
+                partialRecords.push_back(inputBuffer.FetchReadPartialByteSequence(IsPeek)->ToInputRecord());
             }
         }
 
         size_t amountToRead;
-        if (FAILED(SizeTSub(eventReadCount, partialEvents.size(), &amountToRead)))
+        if (FAILED(SizeTSub(eventReadCount, partialRecords.size(), &amountToRead)))
         {
             return STATUS_INTEGER_OVERFLOW;
         }
-        std::deque<std::unique_ptr<IInputEvent>> readEvents;
-        NTSTATUS Status = inputBuffer.Read(readEvents,
+        std::vector<INPUT_RECORD> readRecords;
+        NTSTATUS Status = inputBuffer.Read(readRecords,
                                            amountToRead,
                                            IsPeek,
                                            true,
@@ -197,13 +197,13 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
 
         if (CONSOLE_STATUS_WAIT == Status)
         {
-            FAIL_FAST_IF(!(readEvents.empty()));
+            FAIL_FAST_IF(!(readRecords.empty()));
             // If we're told to wait until later, move all of our context
             // to the read data object and send it back up to the server.
             waiter = std::make_unique<DirectReadData>(&inputBuffer,
                                                       &readHandleState,
                                                       eventReadCount,
-                                                      std::move(partialEvents));
+                                                      std::move(partialRecords));
         }
         else if (NT_SUCCESS(Status))
         {
@@ -212,36 +212,24 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
             {
                 try
                 {
-                    SplitToOem(readEvents);
+                    SplitToOem(readRecords);
                 }
                 CATCH_LOG();
             }
 
-            // combine partial and readEvents
-            while (!partialEvents.empty())
-            {
-                readEvents.push_front(std::move(partialEvents.back()));
-                partialEvents.pop_back();
-            }
-
-            // move events over
-            for (size_t i = 0; i < eventReadCount; ++i)
-            {
-                if (readEvents.empty())
-                {
-                    break;
-                }
-                outEvents.push_back(std::move(readEvents.front()));
-                readEvents.pop_front();
-            }
+            // combine partial and readRecords
+            readRecords.insert(readRecords.cbegin(), partialRecords.cbegin(), partialRecords.cend());
 
             // store partial event if necessary
-            if (!readEvents.empty())
+            if (readRecords.size() > eventReadCount)
             {
-                inputBuffer.StoreReadPartialByteSequence(std::move(readEvents.front()));
-                readEvents.pop_front();
-                FAIL_FAST_IF(!(readEvents.empty()));
+                inputBuffer.StoreReadPartialByteSequence(IInputEvent::Create(readRecords[eventReadCount]));
+                FAIL_FAST_IF(readRecords.size() != eventReadCount + 1);
+                readRecords.pop_back();
             }
+
+            // move records over
+            outRecords.insert(outRecords.end(), readRecords.cbegin(), readRecords.cend());
         }
         return Status;
     }
@@ -257,7 +245,7 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
 // - The A version will convert to W using the console's current Input codepage (see SetConsoleCP)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
+// - outRecords - storage location for read records
 // - eventsToRead - The number of input events to read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
@@ -269,7 +257,7 @@ static NTSTATUS _DoGetConsoleInput(InputBuffer& inputBuffer,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+                                           std::vector<INPUT_RECORD>& outRecords,
                                            const size_t eventsToRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
@@ -277,7 +265,7 @@ HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
     try
     {
         RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
+                                           outRecords,
                                            eventsToRead,
                                            readHandleState,
                                            false,
@@ -293,7 +281,7 @@ HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
+// - outRecords - storage location for read records
 // - eventsToRead - The number of input events to read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
@@ -305,7 +293,7 @@ HRESULT ApiRoutines::PeekConsoleInputAImpl(IConsoleInputObject& context,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+                                           std::vector<INPUT_RECORD>& outRecords,
                                            const size_t eventsToRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
@@ -313,7 +301,7 @@ HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
     try
     {
         RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
+                                           outRecords,
                                            eventsToRead,
                                            readHandleState,
                                            true,
@@ -329,7 +317,7 @@ HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
 // - The A version will convert to W using the console's current Input codepage (see SetConsoleCP)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
+// - outRecords - storage location for read records
 // - eventsToRead - The number of input events to read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
@@ -341,7 +329,7 @@ HRESULT ApiRoutines::PeekConsoleInputWImpl(IConsoleInputObject& context,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+                                           std::vector<INPUT_RECORD>& outRecords,
                                            const size_t eventsToRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
@@ -349,7 +337,7 @@ HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
     try
     {
         RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
+                                           outRecords,
                                            eventsToRead,
                                            readHandleState,
                                            false,
@@ -365,7 +353,7 @@ HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
 // - The W version accepts UCS-2 formatted characters (wide characters)
 // Arguments:
 // - context - The input buffer to take records from to return to the client
-// - outEvents - storage location for read events
+// - outRecords - storage location for read records
 // - eventsToRead - The number of input events to read
 // - readHandleState - A structure that will help us maintain
 // some input context across various calls on the same input
@@ -377,7 +365,7 @@ HRESULT ApiRoutines::ReadConsoleInputAImpl(IConsoleInputObject& context,
 // restore this call later.
 [[nodiscard]]
 HRESULT ApiRoutines::ReadConsoleInputWImpl(IConsoleInputObject& context,
-                                           std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+                                           std::vector<INPUT_RECORD>& outRecords,
                                            const size_t eventsToRead,
                                            INPUT_READ_HANDLE_DATA& readHandleState,
                                            std::unique_ptr<IWaitRoutine>& waiter) noexcept
@@ -385,7 +373,7 @@ HRESULT ApiRoutines::ReadConsoleInputWImpl(IConsoleInputObject& context,
     try
     {
         RETURN_NTSTATUS(_DoGetConsoleInput(context,
-                                           outEvents,
+                                           outRecords,
                                            eventsToRead,
                                            readHandleState,
                                            true,
@@ -517,9 +505,24 @@ HRESULT ApiRoutines::WriteConsoleInputWImpl(InputBuffer& context,
 
     try
     {
-        auto events = IInputEvent::Create(buffer);
+        // The records are written as they are, without creating an
+        // IInputEvent for each of them. Reject the whole batch up front
+        // if any of them isn't an event we know about.
+        for (const auto& record : buffer)
+        {
+            RETURN_HR_IF(E_INVALIDARG, !InputBuffer::IsValidRecord(record));
+        }
 
-        return _WriteConsoleInputWImplHelper(context, events, written, append);
+        if (append)
+        {
+            written = context.Write(buffer);
+        }
+        else
+        {
+            written = context.Prepend(buffer);
+        }
+
+        return S_OK;
     }
     CATCH_RETURN();
 }
@@ -209,23 +209,22 @@ void InputBuffer::Flush()
 // - The console lock must be held when calling this routine.
 void InputBuffer::FlushAllButKeys()
 {
-    auto newEnd = std::remove_if(_storage.begin(), _storage.end(), [](const std::unique_ptr<IInputEvent>& event)
+    _storage.remove_if([](const INPUT_RECORD& record)
     {
-        return event->EventType() != InputEventType::KeyEvent;
+        return record.EventType != KEY_EVENT;
     });
-    _storage.erase(newEnd, _storage.end());
 }
 
 // Routine Description:
-// - This routine reads from the input buffer.
+// - This routine reads from the input buffer into a batch of records.
 // - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
 //   if there isn't enough data in the buffer, and it can be set to not remove records as it reads them out.
 // Note:
 // - The console lock must be held when calling this routine.
 // Arguments:
-// - OutEvents - deque to store the read events
+// - OutRecords - the records read are added to the end of this
 // - AmountToRead - the amount of events to try to read
-// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
+// - Peek - If true, copy events to OutRecords but don't remove them from the input buffer.
 // - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
 // - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
 // - Stream - true if read should unpack KeyEvents that have a >1 repeat count. AmountToRead must be 1 if Stream is true.
@@ -234,7 +233,7 @@ void InputBuffer::FlushAllButKeys()
 // - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
 // - otherwise a suitable memory/math/string error in NTSTATUS form.
 [[nodiscard]]
-NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEvents,
+NTSTATUS InputBuffer::Read(_Out_ std::vector<INPUT_RECORD>& OutRecords,
                            const size_t AmountToRead,
                            const bool Peek,
                            const bool WaitForData,
@@ -253,10 +252,9 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
         }
 
         // read from buffer
-        std::deque<std::unique_ptr<IInputEvent>> events;
         size_t eventsRead;
         bool resetWaitEvent;
-        _ReadBuffer(events,
+        _ReadBuffer(OutRecords,
                     AmountToRead,
                     eventsRead,
                     Peek,
@@ -264,13 +262,6 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
                     Unicode,
                     Stream);
 
-        // copy events to outEvents
-        while (!events.empty())
-        {
-            OutEvents.push_back(std::move(events.front()));
-            events.pop_front();
-        }
-
         if (resetWaitEvent)
         {
             ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
@@ -284,55 +275,69 @@ NTSTATUS InputBuffer::Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEv
 }
 
 // Routine Description:
-// - This routine reads a single event from the input buffer.
-// - It can convert returned data to through the currently set Input CP, it can optionally return a wait condition
-//   if there isn't enough data in the buffer, and it can be set to not remove records as it reads them out.
+// - This routine reads a single record from the input buffer, without allocating anything. It's
+//   what reads a character at a time use.
+// - It can optionally return a wait condition if the buffer is empty, and it can be set to not
+//   remove the record as it reads it out. A single record reads the same whether or not the
+//   read is unicode.
 // Note:
 // - The console lock must be held when calling this routine.
 // Arguments:
-// - outEvent - where the read event is stored
-// - Peek - If true, copy events to pInputRecord but don't remove them from the input buffer.
-// - WaitForData - if true, wait until an event is input (if there aren't enough to fill client buffer). if false, return immediately
-// - Unicode - true if the data in key events should be treated as unicode. false if they should be converted by the current input CP.
+// - outRecord - where the read record is stored. Empty if there wasn't one to read.
+// - Peek - If true, copy the record to outRecord but don't remove it from the input buffer.
+// - WaitForData - if true, wait until an event is input. if false, return immediately
 // - Stream - true if read should unpack KeyEvents that have a >1 repeat count.
 // Return Value:
-// - STATUS_SUCCESS if records were read into the client buffer and everything is OK.
-// - CONSOLE_STATUS_WAIT if there weren't enough records to satisfy the request (and waits are allowed)
-// - otherwise a suitable memory/math/string error in NTSTATUS form.
+// - STATUS_SUCCESS if a record was read, or there wasn't one and waits aren't allowed.
+// - CONSOLE_STATUS_WAIT if there wasn't a record to read (and waits are allowed)
 [[nodiscard]]
-NTSTATUS InputBuffer::Read(_Out_ std::unique_ptr<IInputEvent>& outEvent,
+NTSTATUS InputBuffer::Read(_Out_ std::optional<INPUT_RECORD>& outRecord,
                            const bool Peek,
                            const bool WaitForData,
-                           const bool Unicode,
-                           const bool Stream)
+                           const bool Stream) noexcept
 {
-    NTSTATUS Status;
-    try
+    outRecord.reset();
+    if (_storage.empty())
     {
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
-        Status = Read(outEvents,
-                      1,
-                      Peek,
-                      WaitForData,
-                      Unicode,
-                      Stream);
-        if (!outEvents.empty())
+        if (!WaitForData)
         {
-            outEvent.swap(outEvents.front());
+            return STATUS_SUCCESS;
         }
+        return CONSOLE_STATUS_WAIT;
     }
-    catch (...)
+
+    INPUT_RECORD& storedRecord = _storage.front();
+    outRecord = storedRecord;
+
+    // for stream reads we need to split any key events that have been coalesced.
+    // the rest of the repeats stay in the buffer, unless we're only peeking.
+    if (Stream &&
+        storedRecord.EventType == KEY_EVENT &&
+        storedRecord.Event.KeyEvent.wRepeatCount > 1)
+    {
+        outRecord->Event.KeyEvent.wRepeatCount = 1;
+        if (!Peek)
+        {
+            --storedRecord.Event.KeyEvent.wRepeatCount;
+        }
+    }
+    else if (!Peek)
     {
-        Status = NTSTATUS_FROM_HRESULT(wil::ResultFromCaughtException());
+        _storage.pop_front();
     }
 
-    return Status;
+    // signal if we emptied the buffer
+    if (_storage.empty())
+    {
+        ServiceLocator::LocateGlobals().hInputEvent.ResetEvent();
+    }
+    return STATUS_SUCCESS;
 }
 
 // Routine Description:
 // - This routine reads from a buffer. It does the buffer manipulation.
 // Arguments:
-// - outEvents - where read events are placed
+// - outRecords - where read events are placed
 // - readCount - amount of events to read
 // - eventsRead - where to store number of events read
 // - peek - if true , don't remove data from buffer, just copy it.
@@ -343,7 +348,7 @@ NTSTATUS InputBuffer::Read(_Out_ std::unique_ptr<IInputEvent>& outEvent,
 // - <none>
 // Note:
 // - The console lock must be held when calling this routine.
-void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+void InputBuffer::_ReadBuffer(_Out_ std::vector<INPUT_RECORD>& outRecords,
                               const size_t readCount,
                               _Out_ size_t& eventsRead,
                               const bool peek,
@@ -356,94 +361,52 @@ void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& ou
     FAIL_FAST_IF(streamRead && readCount != 1);
 
     resetWaitEvent = false;
+    eventsRead = 0;
 
-    std::deque<std::unique_ptr<IInputEvent>> readEvents;
     // we need another var to keep track of how many we've read
     // because dbcs records count for two when we aren't doing a
     // unicode read but the eventsRead count should return the number
     // of events actually put into outRecords.
     size_t virtualReadCount = 0;
+    // the number of records to remove from the front of the buffer
+    // once we're done. peeking doesn't remove any.
+    size_t consumedCount = 0;
 
-    while (!_storage.empty() && virtualReadCount < readCount)
+    while (consumedCount < _storage.size() && virtualReadCount < readCount)
     {
-        bool performNormalRead = true;
-        // for stream reads we need to split any key events that have been coalesced
-        if (streamRead)
-        {
-            if (_storage.front()->EventType() == InputEventType::KeyEvent)
-            {
-                KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.front().get());
-                if (pKeyEvent->GetRepeatCount() > 1)
-                {
-                    // split the key event
-                    std::unique_ptr<KeyEvent> streamKeyEvent = std::make_unique<KeyEvent>(*pKeyEvent);
-                    streamKeyEvent->SetRepeatCount(1);
-                    readEvents.push_back(std::move(streamKeyEvent));
-                    pKeyEvent->SetRepeatCount(pKeyEvent->GetRepeatCount() - 1);
-                    performNormalRead = false;
-                }
-            }
-        }
-
-        if (performNormalRead)
-        {
-            readEvents.push_back(std::move(_storage.front()));
-            _storage.pop_front();
-        }
+        INPUT_RECORD& storedRecord = _storage[consumedCount];
+        outRecords.push_back(storedRecord);
+        INPUT_RECORD& readRecord = outRecords.back();
+        ++eventsRead;
 
         ++virtualReadCount;
-        if (!unicode)
+        if (!unicode &&
+            readRecord.EventType == KEY_EVENT &&
+            IsGlyphFullWidth(readRecord.Event.KeyEvent.uChar.UnicodeChar))
         {
-            if (readEvents.back()->EventType() == InputEventType::KeyEvent)
-            {
-                const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(readEvents.back().get());
-                if (IsGlyphFullWidth(pKeyEvent->GetCharData()))
-                {
-                    ++virtualReadCount;
-                }
-            }
+            ++virtualReadCount;
         }
-    }
 
-    // the amount of events that were actually read
-    eventsRead = readEvents.size();
-
-    // copy the events back if we were supposed to peek
-    if (peek)
-    {
-        if (streamRead)
-        {
-            // we need to check and see if the event was split from a coalesced key event
-            // or if it was unrelated to the current front event in storage
-            if (!readEvents.empty() &&
-                !_storage.empty() &&
-                readEvents.back()->EventType() == InputEventType::KeyEvent &&
-                _storage.front()->EventType() == InputEventType::KeyEvent &&
-                _CanCoalesce(static_cast<const KeyEvent&>(*readEvents.back()),
-                                static_cast<const KeyEvent&>(*_storage.front())))
-            {
-                KeyEvent& keyEvent = static_cast<KeyEvent&>(*_storage.front());
-                keyEvent.SetRepeatCount(keyEvent.GetRepeatCount() + 1);
-            }
-            else
-            {
-                _storage.push_front(IInputEvent::Create(readEvents.back()->ToInputRecord()));
-            }
-        }
-        else
+        // for stream reads we need to split any key events that have been coalesced.
+        // the rest of the repeats stay in the buffer, unless we're only peeking.
+        if (streamRead &&
+            readRecord.EventType == KEY_EVENT &&
+            readRecord.Event.KeyEvent.wRepeatCount > 1)
         {
-            for (auto it = readEvents.crbegin(); it != readEvents.crend(); ++it)
+            readRecord.Event.KeyEvent.wRepeatCount = 1;
+            if (!peek)
             {
-                _storage.push_front(IInputEvent::Create((*it)->ToInputRecord()));
+                --storedRecord.Event.KeyEvent.wRepeatCount;
             }
+            break;
         }
+
+        ++consumedCount;
     }
 
-    // move events read to proper deque
-    while (!readEvents.empty())
+    if (!peek)
     {
-        outEvents.push_back(std::move(readEvents.front()));
-        readEvents.pop_front();
+        _storage.pop_front(consumedCount);
     }
 
     // signal if we emptied the buffer
@@ -457,57 +420,80 @@ void InputBuffer::_ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& ou
 // -  Writes events to the beginning of the input buffer.
 // Arguments:
 // - inEvents - events to write to buffer.
-// - eventsWritten - The number of events written to the buffer on exit.
 // Return Value:
-// S_OK if successful.
+// - The number of events that were written to input buffer.
 // Note:
 // - The console lock must be held when calling this routine.
 size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
 {
     try
     {
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
-        {
-            return STATUS_SUCCESS;
-        }
-        // read all of the records out of the buffer, then write the
-        // prepend ones, then write the original set. We need to do it
-        // this way to handle any coalescing that might occur.
-
-        // get all of the existing records, "emptying" the buffer
-        std::deque<std::unique_ptr<IInputEvent>> existingStorage;
-        existingStorage.swap(_storage);
-
-        // We will need this variable to pass to _WriteBuffer so it can attempt to determine wait status.
-        // However, because we swapped the storage out from under it with an empty deque, it will always
-        // return true after the first one (as it is filling the newly emptied backing deque.)
-        // Then after the second one, because we've inserted some input, it will always say false.
+        const auto records = IInputEvent::ToInputRecords(inEvents);
+        inEvents.clear();
+        return Prepend(records);
+    }
+    catch (...)
+    {
+        LOG_HR(wil::ResultFromCaughtException());
+        return 0;
+    }
+}
+
+// Routine Description:
+// -  Writes a batch of records to the beginning of the input buffer.
+// Arguments:
+// - inRecords - records to write to buffer.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Prepend(const gsl::span<const INPUT_RECORD> inRecords)
+{
+    try
+    {
+        // Set the existing records aside, write the prepended ones
+        // to the now empty buffer, then put the existing ones back
+        // after them. Writing to an empty buffer means that the
+        // prepended records aren't coalesced with the existing ones.
+        _prependStorage.clear();
+        _prependStorage.swap(_storage);
+
+        size_t prependEventsWritten = 0;
         bool unusedWaitStatus = false;
+        const HRESULT hr = wil::ResultFromException([&]() {
+            _WriteBuffer(inRecords, prependEventsWritten, unusedWaitStatus);
+        });
 
-        // write the prepend records
-        size_t prependEventsWritten;
-        _WriteBuffer(inEvents, prependEventsWritten, unusedWaitStatus);
-        FAIL_FAST_IF(!(unusedWaitStatus));
+        // The existing records were already processed when they
+        // were first written, so they're only moved back.
+        for (size_t i = 0; i < _prependStorage.size(); ++i)
+        {
+            _storage.push_back(_prependStorage[i]);
+        }
+        _prependStorage.clear();
 
-        // write all previously existing records
-        size_t existingEventsWritten;
-        _WriteBuffer(existingStorage, existingEventsWritten, unusedWaitStatus);
-        FAIL_FAST_IF(!(!unusedWaitStatus));
+        THROW_IF_FAILED(hr);
+        if (prependEventsWritten == 0)
+        {
+            return 0;
+        }
 
         // We need to set the wait event if there were 0 events in the
-        // input queue when we started.
-        // Because we did interesting manipulation of the wait queue
-        // in order to prepend, we can't trust what _WriteBuffer said
-        // and instead need to set the event if the original backing
-        // buffer (the one we swapped out at the top) was empty
-        // when this whole thing started.
-        if (existingStorage.empty())
+        // input queue when we started. Setting it again when there
+        // already were some doesn't hurt.
+        if (!_storage.empty())
         {
             ServiceLocator::LocateGlobals().hInputEvent.SetEvent();
         }
         WakeUpReadersWaitingForData();
 
+        // Whatever the client does with this input should be painted without delay.
+        auto* const pRender = ServiceLocator::LocateGlobals().pRender;
+        if (pRender != nullptr)
+        {
+            pRender->NotifyInput();
+        }
+
         return prependEventsWritten;
     }
     catch (...)
@@ -529,12 +515,28 @@ size_t InputBuffer::Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& in
 // - any outside references to inEvent will ben invalidated after
 // calling this method.
 size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
+{
+    const INPUT_RECORD record = inEvent->ToInputRecord();
+    inEvent.reset();
+    return Write(gsl::make_span(&record, 1));
+}
+
+// Routine Description:
+// - Writes events to the input buffer. Wakes up any readers that are
+// waiting for additional input events.
+// Arguments:
+// - inEvents - input events to store in the buffer. Empty on exit.
+// Return Value:
+// - The number of events that were written to input buffer.
+// Note:
+// - The console lock must be held when calling this routine.
+size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
 {
     try
     {
-        std::deque<std::unique_ptr<IInputEvent>> inEvents;
-        inEvents.push_back(std::move(inEvent));
-        return Write(inEvents);
+        const auto records = IInputEvent::ToInputRecords(inEvents);
+        inEvents.clear();
+        return Write(records);
     }
     catch (...)
     {
@@ -544,28 +546,26 @@ size_t InputBuffer::Write(_Inout_ std::unique_ptr<IInputEvent> inEvent)
 }
 
 // Routine Description:
-// - Writes events to the input buffer. Wakes up any readers that are
-// waiting for additional input events.
+// - Writes a batch of records to the input buffer. Wakes up any readers
+// that are waiting for additional input events.
 // Arguments:
-// - inEvents - input events to store in the buffer.
+// - inRecords - input records to store in the buffer.
 // Return Value:
 // - The number of events that were written to input buffer.
 // Note:
 // - The console lock must be held when calling this routine.
-size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+size_t InputBuffer::Write(const gsl::span<const INPUT_RECORD> inRecords)
 {
     try
     {
-        _HandleConsoleSuspensionEvents(inEvents);
-        if (inEvents.empty())
-        {
-            return 0;
-        }
-
         // Write to buffer.
         size_t EventsWritten;
         bool SetWaitEvent;
-        _WriteBuffer(inEvents, EventsWritten, SetWaitEvent);
+        _WriteBuffer(inRecords, EventsWritten, SetWaitEvent);
+        if (EventsWritten == 0)
+        {
+            return 0;
+        }
 
         if (SetWaitEvent)
         {
@@ -574,6 +574,14 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 
         // Alert any writers waiting for space.
         WakeUpReadersWaitingForData();
+
+        // Whatever the client does with this input should be painted without delay.
+        auto* const pRender = ServiceLocator::LocateGlobals().pRender;
+        if (pRender != nullptr)
+        {
+            pRender->NotifyInput();
+        }
+
         return EventsWritten;
     }
     catch (...)
@@ -584,9 +592,9 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 }
 
 // Routine Description:
-// - Coalesces input events and transfers them to storage queue.
+// - Coalesces input records and transfers them to storage queue.
 // Arguments:
-// - inRecords - The events to store.
+// - inRecords - The records to store.
 // - eventsWritten - The number of events written since this function
 // was called.
 // - setWaitEvent - on exit, true if buffer became non-empty.
@@ -594,29 +602,47 @@ size_t InputBuffer::Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEv
 // - None
 // Note:
 // - The console lock must be held when calling this routine.
-// - will throw on failure
-void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents,
+// - will throw on failure. Nothing is written if any of the records
+// isn't a kind of input event that we know about.
+void InputBuffer::_WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                                _Out_ size_t& eventsWritten,
                                _Out_ bool& setWaitEvent)
 {
     eventsWritten = 0;
     setWaitEvent = false;
+
+    for (const auto& inRecord : inRecords)
+    {
+        THROW_HR_IF(E_INVALIDARG, !IsValidRecord(inRecord));
+    }
+
     const bool initiallyEmptyQueue = _storage.empty();
-    const size_t initialInEventsSize = inEvents.size();
     const bool vtInputMode = IsInVirtualTerminalInputMode();
 
-    while(!inEvents.empty())
+    // we only check for possible coalescing when storing one
+    // record at a time because this is the original behavior of
+    // the input buffer. Changing this behavior may break stuff
+    // that was depending on it.
+    const bool canCoalesce = inRecords.size() == 1;
+
+    for (const auto& inRecord : inRecords)
     {
-        // Pop the next event.
+        // Take the next record.
+        // If it pauses or resumes the console, that's all it does.
         // If we're in vt mode, try and handle it with the vt input module.
         // If it was handled, do nothing else for it.
-        // If there was one event passed in, try coalescing it with the previous event currently in the buffer.
+        // If there was one record passed in, try coalescing it with the previous event currently in the buffer.
         // If it's not coalesced, append it to the buffer.
-        std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (vtInputMode)
+        const INPUT_RECORD record = s_NormalizeRecord(inRecord);
+        if (_HandleConsoleSuspensionEvent(record))
+        {
+            continue;
+        }
+
+        if (vtInputMode && record.EventType == KEY_EVENT)
         {
-            const bool handled = _termInput.HandleKey(inEvent.get());
+            const KeyEvent keyEvent{ record.Event.KeyEvent };
+            const bool handled = _termInput.HandleKey(&keyEvent);
             if (handled)
             {
                 eventsWritten++;
@@ -624,46 +650,19 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
             }
         }
 
-        // we only check for possible coalescing when storing one
-        // record at a time because this is the original behavior of
-        // the input buffer. Changing this behavior may break stuff
-        // that was depending on it.
-        if (initialInEventsSize == 1 && !_storage.empty())
+        if (canCoalesce && !_storage.empty())
         {
-            // coalescing requires a deque of events, so push it back onto the front.
-            inEvents.push_front(std::move(inEvent));
-
-            bool coalesced = false;
             // this looks kinda weird but we don't want to coalesce a
             // mouse event and then try to coalesce a key event right after.
-            //
-            // we also pass the whole deque to the coalescing methods
-            // even though they only want one event because it should
-            // be their responsibility to maintain the correct state
-            // of the deque if they process any records in it.
-            if (_CoalesceMouseMovedEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            else if (_CoalesceRepeatedKeyPressEvents(inEvents))
-            {
-                coalesced = true;
-            }
-            if (coalesced)
+            if (_CoalesceMouseMovedEvents(record) ||
+                _CoalesceRepeatedKeyPressEvents(record))
             {
                 eventsWritten = 1;
                 return;
             }
-            else
-            {
-                // We didn't coalesce the event. pull it from the queue again,
-                //  to keep the state consistent with the start of this block.
-                inEvent = std::move(inEvents.front());
-                inEvents.pop_front();
-            }
         }
         // At this point, the event was neither coalesced, nor processed by VT.
-        _storage.push_back(std::move(inEvent));
+        _storage.push_back(record);
         ++eventsWritten;
     }
     if (initiallyEmptyQueue && !_storage.empty())
@@ -673,67 +672,53 @@ void InputBuffer::_WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>&
 }
 
 // Routine Description:
-// - Checks if the last saved event and the first event of inRecords are
-// both MOUSE_MOVED events. If they are, the last saved event is
-// updated with the new mouse position and the first event of inRecords is
-// dropped.
+// - Checks if the last saved event and the incoming record are both
+// MOUSE_MOVED events. If they are, the last saved event is updated
+// with the new mouse position and the incoming record is dropped.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::MouseEvent &&
-        pLastStoredEvent->EventType() == InputEventType::MouseEvent)
+    INPUT_RECORD& lastStoredRecord = _storage.back();
+    if (inRecord.EventType == MOUSE_EVENT &&
+        lastStoredRecord.EventType == MOUSE_EVENT &&
+        inRecord.Event.MouseEvent.dwEventFlags == MOUSE_MOVED &&
+        lastStoredRecord.Event.MouseEvent.dwEventFlags == MOUSE_MOVED)
     {
-        const MouseEvent* const pInMouseEvent = static_cast<const MouseEvent* const>(pFirstInEvent);
-        const MouseEvent* const pLastMouseEvent = static_cast<const MouseEvent* const>(pLastStoredEvent);
-
-        if (pInMouseEvent->IsMouseMoveEvent() &&
-            pLastMouseEvent->IsMouseMoveEvent())
-        {
-            // update mouse moved position
-            MouseEvent* const pMouseEvent = static_cast<MouseEvent* const>(_storage.back().release());
-            pMouseEvent->SetPosition(pInMouseEvent->GetPosition());
-            std::unique_ptr<IInputEvent> tempPtr(pMouseEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
-            return true;
-        }
+        // update mouse moved position
+        lastStoredRecord.Event.MouseEvent.dwMousePosition = inRecord.Event.MouseEvent.dwMousePosition;
+        return true;
     }
     return false;
 }
 
 // Routine Description:
-// - checks two KeyEvents to see if they're similiar enough to be coalesced
+// - checks two key event records to see if they're similiar enough to be coalesced
 // Arguments:
-// - a - the first KeyEvent
-// - b - the other KeyEvent
+// - a - the first key event record
+// - b - the other key event record
 // Return Value:
 // - true if the events could be coalesced, false otherwise
-bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept
+bool InputBuffer::_CanCoalesce(const KEY_EVENT_RECORD& a, const KEY_EVENT_RECORD& b) const noexcept
 {
-    if (WI_IsFlagSet(a.GetActiveModifierKeys(), NLS_IME_CONVERSION) &&
-        a.GetCharData() == b.GetCharData() &&
-        a.GetActiveModifierKeys() == b.GetActiveModifierKeys())
+    if (WI_IsFlagSet(a.dwControlKeyState, NLS_IME_CONVERSION) &&
+        a.uChar.UnicodeChar == b.uChar.UnicodeChar &&
+        a.dwControlKeyState == b.dwControlKeyState)
     {
         return true;
     }
     // other key events check
-    else if (a.GetVirtualScanCode() == b.GetVirtualScanCode() &&
-                a.GetCharData() == b.GetCharData() &&
-                a.GetActiveModifierKeys() == b.GetActiveModifierKeys())
+    else if (a.wVirtualScanCode == b.wVirtualScanCode &&
+                a.uChar.UnicodeChar == b.uChar.UnicodeChar &&
+                a.dwControlKeyState == b.dwControlKeyState)
     {
         return true;
     }
@@ -741,44 +726,35 @@ bool InputBuffer::_CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexc
 }
 
 // Routine Description::
-// - If the last input event saved and the first input event in inRecords
-// are both a keypress down event for the same key, update the repeat
-// count of the saved event and drop the first from inRecords.
+// - If the last input event saved and the incoming record are both a
+// keypress down event for the same key, update the repeat count of the
+// saved event and drop the incoming record.
 // Arguments:
-// - inRecords - The incoming records to process.
+// - inRecord - The incoming record to process.
 // Return Value:
 // true if events were coalesced, false if they were not.
 // Note:
-// - The size of inRecords must be 1.
 // - Coalescing here means updating a record that already exists in
 // the buffer with updated values from an incoming event, instead of
 // storing the incoming event (which would make the original one
 // redundant/out of date with the most current state).
-bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord)
 {
-    FAIL_FAST_IF(!(inEvents.size() == 1));
     FAIL_FAST_IF(_storage.empty());
-    const IInputEvent* const pFirstInEvent = inEvents.front().get();
-    const IInputEvent* const pLastStoredEvent = _storage.back().get();
-    if (pFirstInEvent->EventType() == InputEventType::KeyEvent &&
-        pLastStoredEvent->EventType() == InputEventType::KeyEvent)
-    {
-        const KeyEvent* const pInKeyEvent = static_cast<const KeyEvent* const>(pFirstInEvent);
-        const KeyEvent* const pLastKeyEvent = static_cast<const KeyEvent* const>(pLastStoredEvent);
-
-        if (pInKeyEvent->IsKeyDown() &&
-            pLastKeyEvent->IsKeyDown() &&
-            !IsGlyphFullWidth(pInKeyEvent->GetCharData()) &&
-            _CanCoalesce(*pInKeyEvent, *pLastKeyEvent))
+    INPUT_RECORD& lastStoredRecord = _storage.back();
+    if (inRecord.EventType == KEY_EVENT &&
+        lastStoredRecord.EventType == KEY_EVENT)
+    {
+        const KEY_EVENT_RECORD& inKeyEvent = inRecord.Event.KeyEvent;
+        KEY_EVENT_RECORD& lastKeyEvent = lastStoredRecord.Event.KeyEvent;
+
+        if (inKeyEvent.bKeyDown &&
+            lastKeyEvent.bKeyDown &&
+            !IsGlyphFullWidth(inKeyEvent.uChar.UnicodeChar) &&
+            _CanCoalesce(inKeyEvent, lastKeyEvent))
         {
             // increment repeat count
-            KeyEvent* const pKeyEvent = static_cast<KeyEvent* const>(_storage.back().release());
-            WORD repeatCount = pKeyEvent->GetRepeatCount() + pInKeyEvent->GetRepeatCount();
-            pKeyEvent->SetRepeatCount(repeatCount);
-            std::unique_ptr<IInputEvent> tempPtr(pKeyEvent);
-            tempPtr.swap(_storage.back());
-
-            inEvents.pop_front();
+            lastKeyEvent.wRepeatCount += inKeyEvent.wRepeatCount;
             return true;
         }
     }
@@ -788,42 +764,86 @@ bool InputBuffer::_CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique
 // Routine Description:
 // - Handles records that suspend/resume the console.
 // Arguments:
-// - records - records to check for pause/unpause events
+// - inRecord - record to check for pause/unpause events
 // Return Value:
-// - None
+// - true if the record paused or resumed the console, and shouldn't be stored.
 // Note:
 // - The console lock must be held when calling this routine.
 // - will throw exception on error
-void InputBuffer::_HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents)
+bool InputBuffer::_HandleConsoleSuspensionEvent(const INPUT_RECORD& inRecord)
 {
     CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
 
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
-    while (!inEvents.empty())
+    if (inRecord.EventType == KEY_EVENT && inRecord.Event.KeyEvent.bKeyDown)
     {
-        std::unique_ptr<IInputEvent> currEvent = std::move(inEvents.front());
-        inEvents.pop_front();
-        if (currEvent->EventType() == InputEventType::KeyEvent)
+        const KEY_EVENT_RECORD& keyEvent = inRecord.Event.KeyEvent;
+        if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
+            !IsSystemKey(keyEvent.wVirtualKeyCode))
         {
-            const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(currEvent.get());
-            if (pKeyEvent->IsKeyDown())
-            {
-                if (WI_IsFlagSet(gci.Flags, CONSOLE_SUSPENDED) &&
-                    !IsSystemKey(pKeyEvent->GetVirtualKeyCode()))
-                {
-                    UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
-                    continue;
-                }
-                else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && pKeyEvent->IsPauseKey())
-                {
-                    WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
-                    continue;
-                }
-            }
+            UnblockWriteConsole(CONSOLE_OUTPUT_SUSPENDED);
+            return true;
+        }
+        else if (WI_IsFlagSet(InputMode, ENABLE_LINE_INPUT) && keyEvent.wVirtualKeyCode == VK_PAUSE)
+        {
+            WI_SetFlag(gci.Flags, CONSOLE_SUSPENDED);
+            return true;
         }
-        outEvents.push_back(std::move(currEvent));
     }
-    inEvents.swap(outEvents);
+    return false;
+}
+
+// Routine Description:
+// - Checks whether a record holds a kind of input event that we know about.
+// Arguments:
+// - record - the record to check
+// Return Value:
+// - true if it does.
+bool InputBuffer::IsValidRecord(const INPUT_RECORD& record) noexcept
+{
+    switch (record.EventType)
+    {
+    case KEY_EVENT:
+    case MOUSE_EVENT:
+    case WINDOW_BUFFER_SIZE_EVENT:
+    case MENU_EVENT:
+    case FOCUS_EVENT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Routine Description:
+// - Copies a record the way it would have come back from its IInputEvent: only the
+//   part of the union that's in use is kept, and the flags are either TRUE or FALSE.
+// Arguments:
+// - record - the record to copy. Must hold a valid event type.
+// Return Value:
+// - the copy to store
+INPUT_RECORD InputBuffer::s_NormalizeRecord(const INPUT_RECORD& record) noexcept
+{
+    INPUT_RECORD normalized{ 0 };
+    normalized.EventType = record.EventType;
+    switch (record.EventType)
+    {
+    case KEY_EVENT:
+        normalized.Event.KeyEvent = record.Event.KeyEvent;
+        normalized.Event.KeyEvent.bKeyDown = !!record.Event.KeyEvent.bKeyDown;
+        break;
+    case MOUSE_EVENT:
+        normalized.Event.MouseEvent = record.Event.MouseEvent;
+        break;
+    case WINDOW_BUFFER_SIZE_EVENT:
+        normalized.Event.WindowBufferSizeEvent = record.Event.WindowBufferSizeEvent;
+        break;
+    case MENU_EVENT:
+        normalized.Event.MenuEvent = record.Event.MenuEvent;
+        break;
+    case FOCUS_EVENT:
+        normalized.Event.FocusEvent.bSetFocus = !!record.Event.FocusEvent.bSetFocus;
+        break;
+    }
+    return normalized;
 }
 
 // Routine Description:
@@ -850,12 +870,11 @@ void InputBuffer::_HandleTerminalInputCallback(std::deque<std::unique_ptr<IInput
     try
     {
         // add all input events to the storage queue
-        while (!inEvents.empty())
+        for (const auto& inEvent : inEvents)
         {
-            std::unique_ptr<IInputEvent> inEvent = std::move(inEvents.front());
-            inEvents.pop_front();
-            _storage.push_back(std::move(inEvent));
+            _storage.push_back(inEvent->ToInputRecord());
         }
+        inEvents.clear();
     }
     catch (...)
     {
@@ -19,6 +19,7 @@ Revision History:
 #pragma once
 
 #include "inputReadHandleData.h"
+#include "inputRecordRing.hpp"
 #include "readData.hpp"
 #include "../types/inc/IInputEvent.hpp"
 
@@ -56,36 +57,42 @@ public:
     void FlushAllButKeys();
 
     [[nodiscard]]
-    NTSTATUS Read(_Out_ std::deque<std::unique_ptr<IInputEvent>>& OutEvents,
-                  const size_t AmountToRead,
+    NTSTATUS Read(_Out_ std::optional<INPUT_RECORD>& outRecord,
                   const bool Peek,
                   const bool WaitForData,
-                  const bool Unicode,
-                  const bool Stream);
+                  const bool Stream) noexcept;
 
     [[nodiscard]]
-    NTSTATUS Read(_Out_ std::unique_ptr<IInputEvent>& inEvent,
+    NTSTATUS Read(_Out_ std::vector<INPUT_RECORD>& OutRecords,
+                  const size_t AmountToRead,
                   const bool Peek,
                   const bool WaitForData,
                   const bool Unicode,
                   const bool Stream);
 
-
     size_t Prepend(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Prepend(const gsl::span<const INPUT_RECORD> inRecords);
 
     size_t Write(_Inout_ std::unique_ptr<IInputEvent> inEvent);
     size_t Write(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    size_t Write(const gsl::span<const INPUT_RECORD> inRecords);
+
+    static bool IsValidRecord(const INPUT_RECORD& record) noexcept;
 
     bool IsInVirtualTerminalInputMode() const;
     Microsoft::Console::VirtualTerminal::TerminalInput& GetTerminalInput();
 
 private:
-    std::deque<std::unique_ptr<IInputEvent>> _storage;
+    // The events are kept as INPUT_RECORDs, and read out as them too.
+    InputRecordRing _storage;
+    // The events that were already in the buffer while others are prepended.
+    // Kept around so that its allocation is reused.
+    InputRecordRing _prependStorage;
     std::unique_ptr<IInputEvent> _readPartialByteSequence;
     std::unique_ptr<IInputEvent> _writePartialByteSequence;
     Microsoft::Console::VirtualTerminal::TerminalInput _termInput;
 
-    void _ReadBuffer(_Out_ std::deque<std::unique_ptr<IInputEvent>>& outEvents,
+    void _ReadBuffer(_Out_ std::vector<INPUT_RECORD>& outRecords,
                      const size_t readCount,
                      _Out_ size_t& eventsRead,
                      const bool peek,
@@ -93,14 +100,16 @@ private:
                      const bool unicode,
                      const bool streamRead);
 
-    void _WriteBuffer(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inRecords,
+    void _WriteBuffer(const gsl::span<const INPUT_RECORD> inRecords,
                       _Out_ size_t& eventsWritten,
                       _Out_ bool& setWaitEvent);
 
-    bool _CanCoalesce(const KeyEvent& a, const KeyEvent& b) const noexcept;
-    bool _CoalesceMouseMovedEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    bool _CoalesceRepeatedKeyPressEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
-    void _HandleConsoleSuspensionEvents(_Inout_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
+    bool _CanCoalesce(const KEY_EVENT_RECORD& a, const KEY_EVENT_RECORD& b) const noexcept;
+    bool _CoalesceMouseMovedEvents(const INPUT_RECORD& inRecord) noexcept;
+    bool _CoalesceRepeatedKeyPressEvents(const INPUT_RECORD& inRecord);
+    bool _HandleConsoleSuspensionEvent(const INPUT_RECORD& inRecord);
+
+    static INPUT_RECORD s_NormalizeRecord(const INPUT_RECORD& record) noexcept;
 
     void _HandleTerminalInputCallback(_In_ std::deque<std::unique_ptr<IInputEvent>>& inEvents);
 
@@ -0,0 +1,163 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "inputRecordRing.hpp"
+
+// Routine Description:
+// - Creates an empty ring. Nothing is allocated until the first record is added.
+InputRecordRing::InputRecordRing() noexcept :
+    _records{},
+    _head{ 0 },
+    _size{ 0 }
+{
+}
+
+// Routine Description:
+// - Gets the number of records in the ring.
+size_t InputRecordRing::size() const noexcept
+{
+    return _size;
+}
+
+// Routine Description:
+// - Checks whether there are any records in the ring.
+bool InputRecordRing::empty() const noexcept
+{
+    return _size == 0;
+}
+
+// Routine Description:
+// - Removes every record. The ring keeps its allocation for later use.
+void InputRecordRing::clear() noexcept
+{
+    _head = 0;
+    _size = 0;
+}
+
+// Routine Description:
+// - Gets the record at the given position, counting from the front.
+// Arguments:
+// - index - the position of the record. Must be less than size().
+// Return Value:
+// - the record
+INPUT_RECORD& InputRecordRing::operator[](const size_t index) noexcept
+{
+    return _records[_Wrap(_head + index)];
+}
+
+const INPUT_RECORD& InputRecordRing::operator[](const size_t index) const noexcept
+{
+    return _records[_Wrap(_head + index)];
+}
+
+INPUT_RECORD& InputRecordRing::front() noexcept
+{
+    return (*this)[0];
+}
+
+const INPUT_RECORD& InputRecordRing::front() const noexcept
+{
+    return (*this)[0];
+}
+
+INPUT_RECORD& InputRecordRing::back() noexcept
+{
+    return (*this)[_size - 1];
+}
+
+const INPUT_RECORD& InputRecordRing::back() const noexcept
+{
+    return (*this)[_size - 1];
+}
+
+// Routine Description:
+// - Adds a record to the back of the ring.
+// Arguments:
+// - record - the record to add
+// Return Value:
+// - <none>
+// Note:
+// - will throw if the ring has to grow and can't
+void InputRecordRing::push_back(const INPUT_RECORD& record)
+{
+    if (_size == _records.size())
+    {
+        _Grow();
+    }
+    _records[_Wrap(_head + _size)] = record;
+    ++_size;
+}
+
+// Routine Description:
+// - Adds a record to the front of the ring.
+// Arguments:
+// - record - the record to add
+// Return Value:
+// - <none>
+// Note:
+// - will throw if the ring has to grow and can't
+void InputRecordRing::push_front(const INPUT_RECORD& record)
+{
+    if (_size == _records.size())
+    {
+        _Grow();
+    }
+    _head = _Wrap(_head + _records.size() - 1);
+    _records[_head] = record;
+    ++_size;
+}
+
+// Routine Description:
+// - Removes the record at the front of the ring.
+void InputRecordRing::pop_front() noexcept
+{
+    pop_front(1);
+}
+
+// Routine Description:
+// - Removes records from the front of the ring.
+// Arguments:
+// - count - how many records to remove. Must be at most size().
+// Return Value:
+// - <none>
+void InputRecordRing::pop_front(const size_t count) noexcept
+{
+    _size -= count;
+    _head = _size == 0 ? 0 : _Wrap(_head + count);
+}
+
+// Routine Description:
+// - Exchanges the records, and the allocations holding them, with another ring.
+void InputRecordRing::swap(InputRecordRing& other) noexcept
+{
+    _records.swap(other._records);
+    std::swap(_head, other._head);
+    std::swap(_size, other._size);
+}
+
+// Routine Description:
+// - Maps a position past the end of the allocation back around to the start.
+size_t InputRecordRing::_Wrap(const size_t index) const noexcept
+{
+    return index & (_records.size() - 1);
+}
+
+// Routine Description:
+// - Doubles the capacity of the ring, moving the records so that the front
+//   is at the start of the new allocation.
+// Note:
+// - will throw if the allocation fails. The ring is unchanged if it does.
+void InputRecordRing::_Grow()
+{
+    const size_t capacity = _records.empty() ? s_InitialCapacity : _records.size() * 2;
+    std::vector<INPUT_RECORD> records(capacity);
+    for (size_t i = 0; i < _size; ++i)
+    {
+        records[i] = (*this)[i];
+    }
+
+    _records.swap(records);
+    _head = 0;
+}
@@ -0,0 +1,79 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- inputRecordRing.hpp
+
+Abstract:
+- A queue of INPUT_RECORDs, stored by value in a ring that grows as needed.
+- INPUT_RECORD is already a tagged union of every kind of input event, so the
+    input buffer keeps its events in one of these instead of allocating an
+    IInputEvent for each of them. Once the ring is big enough for the input
+    that's coming in, queueing and dequeueing events doesn't allocate at all.
+- The interface follows the std::deque one that it replaces.
+--*/
+
+#pragma once
+
+#include <vector>
+
+class InputRecordRing final
+{
+public:
+    InputRecordRing() noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    void clear() noexcept;
+
+    INPUT_RECORD& operator[](const size_t index) noexcept;
+    const INPUT_RECORD& operator[](const size_t index) const noexcept;
+    INPUT_RECORD& front() noexcept;
+    const INPUT_RECORD& front() const noexcept;
+    INPUT_RECORD& back() noexcept;
+    const INPUT_RECORD& back() const noexcept;
+
+    void push_back(const INPUT_RECORD& record);
+    void push_front(const INPUT_RECORD& record);
+    void pop_front() noexcept;
+    void pop_front(const size_t count) noexcept;
+
+    void swap(InputRecordRing& other) noexcept;
+
+    // Method Description:
+    // - Removes every record that the predicate returns true for, keeping
+    //      the order of the others.
+    // Arguments:
+    // - pred - called with each record in the ring
+    // Return Value:
+    // - <none>
+    template<typename Predicate>
+    void remove_if(Predicate pred)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < _size; ++i)
+        {
+            const INPUT_RECORD& record = (*this)[i];
+            if (!pred(record))
+            {
+                (*this)[kept++] = record;
+            }
+        }
+        _size = kept;
+    }
+
+private:
+    // The first allocation is big enough for typing, and is doubled as
+    //      needed when a lot of input comes in at once.
+    static constexpr size_t s_InitialCapacity = 32;
+
+    size_t _Wrap(const size_t index) const noexcept;
+    void _Grow();
+
+    // The capacity is always zero or a power of two, so that wrapping an
+    //      index around the end is just a mask.
+    std::vector<INPUT_RECORD> _records;
+    size_t _head;
+    size_t _size;
+};
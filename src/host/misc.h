@@ -21,7 +21,7 @@ Revision History:
 
 #include "screenInfo.hpp"
 #include "../types/inc/IInputEvent.hpp"
-#include <deque>
+#include <vector>
 #include <memory>
 
 WCHAR CharToWchar(_In_reads_(cch) const char * const pch, const UINT cch);
@@ -44,7 +44,7 @@ int ConvertToOem(const UINT uiCodePage,
                  _Out_writes_(cchTarget) CHAR * const pchTarget,
                  const UINT cchTarget) noexcept;
 
-void SplitToOem(std::deque<std::unique_ptr<IInputEvent>>& events);
+void SplitToOem(std::vector<INPUT_RECORD>& records);
 
 int ConvertInputToUnicode(const UINT uiCodePage,
                           _In_reads_(cchSource) const CHAR * const pchSource,
@@ -117,6 +117,8 @@ public:
     // Forwarders to Window if we're the active buffer.
     [[nodiscard]]
     NTSTATUS SetViewportOrigin(const bool fAbsolute, const COORD coordWindowOrigin, const bool updateBottom);
+    [[nodiscard]]
+    NTSTATUS UserScrollViewport(const COORD coordWindowOrigin);
 
     bool SendNotifyBeep() const;
     bool PostUpdateWindowSize() const;
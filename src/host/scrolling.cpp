@@ -152,7 +152,7 @@ void Scrolling::s_HandleMouseWheel(_In_ bool isMouseWheel,
             {
                 NewOrigin.Y = coordBufferSize.Y - ScreenInfo.GetViewport().Height();
             }
-            LOG_IF_FAILED(ScreenInfo.SetViewportOrigin(true, NewOrigin, false));
+            LOG_IF_FAILED(ScreenInfo.UserScrollViewport(NewOrigin));
         }
     }
     else if (isMouseHWheel && s_ucWheelScrollChars > 0)
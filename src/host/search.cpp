@@ -5,11 +5,6 @@
 
 #include "search.h"
 
-#include "dbcs.h"
-#include "../buffer/out/CharRow.hpp"
-#include "../types/inc/Utf16Parser.hpp"
-#include "../types/inc/GlyphWidth.hpp"
-
 // Routine Description:
 // - Constructs a Search object.
 // - Make a Search object then call .FindNext() to locate items.
@@ -26,7 +21,7 @@ Search::Search(const SCREEN_INFORMATION& screenInfo,
     _direction(direction),
     _sensitivity(sensitivity),
     _screenInfo(screenInfo),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(str, sensitivity == Sensitivity::CaseInsensitive),
     _coordAnchor(s_GetInitialAnchor(screenInfo, direction))
 {
     _coordNext = _coordAnchor;
@@ -50,7 +45,7 @@ Search::Search(const SCREEN_INFORMATION& screenInfo,
     _direction(direction),
     _sensitivity(sensitivity),
     _screenInfo(screenInfo),
-    _needle(s_CreateNeedleFromString(str)),
+    _needle(str, sensitivity == Sensitivity::CaseInsensitive),
     _coordAnchor(anchor)
 {
     _coordNext = _coordAnchor;
@@ -71,22 +66,50 @@ bool Search::FindNext()
         return false;
     }
 
-    do
+    // The next match is the one that starts closest to where we left off,
+    // going around the buffer from the anchor.
+    const auto nextDistance = _DistanceFromAnchor(_coordNext);
+    const std::pair<COORD, COORD>* found = nullptr;
+    size_t foundDistance = 0;
+    for (const auto& match : FindAll())
     {
-        if (_FindNeedleInHaystackAt(_coordNext, _coordSelStart, _coordSelEnd))
-        {
-            _UpdateNextPosition();
-            _reachedEnd = _coordNext == _coordAnchor;
-            return true;
-        }
-        else
+        const auto distance = _DistanceFromAnchor(match.first);
+        if (distance >= nextDistance && (found == nullptr || distance < foundDistance))
         {
-            _UpdateNextPosition();
+            found = &match;
+            foundDistance = distance;
         }
+    }
 
-    } while (_coordNext != _coordAnchor);
+    if (found == nullptr)
+    {
+        _coordNext = _coordAnchor;
+        return false;
+    }
 
-    return false;
+    _coordSelStart = found->first;
+    _coordSelEnd = found->second;
+    _coordNext = found->first;
+    _UpdateNextPosition();
+    _reachedEnd = _coordNext == _coordAnchor;
+    return true;
+}
+
+// Routine Description
+// - Finds every instance of the search term within the screen buffer at once.
+//   The buffer is only searched the first time, and the later calls (and
+//   FindNext) reuse what was found.
+// Arguments:
+// - <none> - Uses internal state from constructor
+// Return Value:
+// - The start and end position of every match, in buffer order.
+const std::vector<std::pair<COORD, COORD>>& Search::FindAll()
+{
+    if (!_matches.has_value())
+    {
+        _matches = _needle.FindAll(_screenInfo.GetTextBuffer());
+    }
+    return _matches.value();
 }
 
 // Routine Description:
@@ -164,90 +187,27 @@ COORD Search::s_GetInitialAnchor(const SCREEN_INFORMATION& screenInfo, const Dir
 }
 
 // Routine Description:
-// - Attempts to compare the search term (the needle) to the screen buffer (the haystack)
-//   at the given coordinate position of the screen buffer.
-// - Performs one comparison. Call again with new positions to check other spots.
+// - Measures how far along the search a position is. Searches start at the
+//   anchor and go around the buffer in their direction until they're back to it.
 // Arguments:
-// - pos - The position in the haystack (screen buffer) to compare
-// - start - If we found it, this is filled with the coordinate of the first character of the needle.
-// - end - If we found it, this is filled with the coordinate of the last character of the needle.
+// - coord - The position in the buffer
 // Return Value:
-// - True if we found it. False if not.
-bool Search::_FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const
+// - The number of cells a search has to move past to get from the anchor to the position.
+size_t Search::_DistanceFromAnchor(const COORD coord) const
 {
-    start = { 0 };
-    end = { 0 };
-
-    COORD bufferPos = pos;
-
-    for (const auto& needleCell : _needle)
-    {
-        // Haystack is the buffer. Needle is the string we were given.
-        const auto hayIter = _screenInfo.GetTextDataAt(bufferPos);
-        const auto hayChars = *hayIter;
-        const auto needleChars = std::wstring_view(needleCell.data(), needleCell.size());
-
-        // If we didn't match at any point of the needle, return false.
-        if (!_CompareChars(hayChars, needleChars))
-        {
-            return false;
-        }
-
-        _IncrementCoord(bufferPos);
-    }
-
-    _DecrementCoord(bufferPos);
-
-    // If we made it the whole way through the needle, then it was in the haystack.
-    // Fill out the span that we found the result at and return true.
-    start = pos;
-    end = bufferPos;
-
-    return true;
-}
+    const auto bufferSize = _screenInfo.GetBufferSize();
+    const size_t width = bufferSize.Width();
+    const size_t cells = width * bufferSize.Height();
+    const size_t position = coord.Y * width + coord.X;
+    const size_t anchor = _coordAnchor.Y * width + _coordAnchor.X;
 
-// Routine Description:
-// - Provides an abstraction for comparing two spans of text.
-// - Internally handles case sensitivity based on object construction.
-// Arguments:
-// - one - String view representing the first string of text
-// - two - String view representing the second string of text
-// Return Value:
-// - True if they are the same. False otherwise.
-bool Search::_CompareChars(const std::wstring_view one, const std::wstring_view two) const
-{
-    if (one.size() != two.size())
-    {
-        return false;
-    }
-
-    for (size_t i = 0; i < one.size(); i++)
-    {
-        if (_ApplySensitivity(one[i]) != _ApplySensitivity(two[i]))
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
-
-// Routine Description:
-// - Provides an abstraction for conditionally applying case sensitivity
-//   based on object construction
-// Arguments:
-// - wch - Character to adjust if necessary
-// Return Value:
-// - Adjusted value (or not).
-wchar_t Search::_ApplySensitivity(const wchar_t wch) const
-{
-    if (_sensitivity == Sensitivity::CaseInsensitive)
+    if (_direction == Direction::Forward)
     {
-        return ::towlower(wch);
+        return (position + cells - anchor) % cells;
     }
     else
     {
-        return wch;
+        return (anchor + cells - position) % cells;
     }
 }
 
@@ -289,24 +249,3 @@ void Search::_UpdateNextPosition()
     }
 }
 
-// Routine Description:
-// - Creates a "needle" of the correct format for comparison to the screen buffer text data
-//   that we can use for our search
-// Arguments:
-// - wstr - String that will be our search term
-// Return Value:
-// - Structured text data for comparison to screen buffer text data.
-std::vector<std::vector<wchar_t>> Search::s_CreateNeedleFromString(const std::wstring& wstr)
-{
-    const auto charData = Utf16Parser::Parse(wstr);
-    std::vector<std::vector<wchar_t>> cells;
-    for (const auto chars : charData)
-    {
-        if (IsGlyphFullWidth(std::wstring_view{ chars.data(), chars.size() }))
-        {
-            cells.emplace_back(chars);
-        }
-        cells.emplace_back(chars);
-    }
-    return cells;
-}
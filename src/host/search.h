@@ -17,6 +17,8 @@ Revision History:
 
 #pragma once
 
+#include "../buffer/out/TextBufferSearch.hpp"
+
 // This used to be in find.h.
 #define SEARCH_STRING_LENGTH    (80)
 
@@ -47,6 +49,7 @@ public:
            const COORD anchor);
 
     bool FindNext();
+    const std::vector<std::pair<COORD, COORD>>& FindAll();
     void Select() const;
     void Color(const TextAttribute attr) const;
 
@@ -54,24 +57,24 @@ public:
 
 private:
 
-    wchar_t _ApplySensitivity(const wchar_t wch) const;
-    bool Search::_FindNeedleInHaystackAt(const COORD pos, COORD& start, COORD& end) const;
-    bool _CompareChars(const std::wstring_view one, const std::wstring_view two) const;
+    size_t _DistanceFromAnchor(const COORD coord) const;
     void _UpdateNextPosition();
 
     void _IncrementCoord(COORD& coord) const;
     void _DecrementCoord(COORD& coord) const;
 
     static COORD s_GetInitialAnchor(const SCREEN_INFORMATION& screenInfo, const Direction dir);
-    static std::vector<std::vector<wchar_t>> s_CreateNeedleFromString(const std::wstring& wstr);
 
     bool _reachedEnd = false;
     COORD _coordNext = { 0 };
     COORD _coordSelStart = { 0 };
     COORD _coordSelEnd = { 0 };
 
+    // Every match in the buffer, found the first time they're needed.
+    std::optional<std::vector<std::pair<COORD, COORD>>> _matches;
+
     const COORD _coordAnchor;
-    const std::vector<std::vector<wchar_t>> _needle;
+    const TextBufferSearch _needle;
     const Direction _direction;
     const Sensitivity _sensitivity;
     const SCREEN_INFORMATION& _screenInfo;
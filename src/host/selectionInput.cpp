@@ -703,9 +703,9 @@ bool Selection::_HandleColorSelection(const INPUT_KEY_INFO* const pInputKeyInfo)
                     Telemetry::Instance().LogColorSelectionUsed();
 
                     Search search(screenInfo, str, Search::Direction::Forward, Search::Sensitivity::CaseInsensitive);
-                    while (search.FindNext())
+                    for (const auto& match : search.FindAll())
                     {
-                        search.Color(TextAttribute{ static_cast<WORD>(ulAttr) });
+                        ColorSelection(match.first, match.second, TextAttribute{ static_cast<WORD>(ulAttr) });
                     }
                 }
             }
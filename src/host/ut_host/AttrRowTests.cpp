@@ -62,6 +62,7 @@ namespace WEX {
 
 class AttrRowTests
 {
+    TextAttributeTable _attributeTable;
     ATTR_ROW* pSingle;
     ATTR_ROW* pChain;
 
@@ -81,7 +82,8 @@ class AttrRowTests
 
     TEST_METHOD_SETUP(MethodSetup)
     {
-        pSingle = new ATTR_ROW(_sDefaultLength, _DefaultAttr);
+        _attributeTable = TextAttributeTable{};
+        pSingle = new ATTR_ROW(_sDefaultLength, _DefaultAttr, _attributeTable);
 
         // Segment length is the expected length divided by the row length
         // E.g. row of 80, 4 segments, 20 segment length each
@@ -101,15 +103,15 @@ class AttrRowTests
         }
 
         // Create the chain
-        pChain = new ATTR_ROW(_sDefaultLength, _DefaultAttr);
+        pChain = new ATTR_ROW(_sDefaultLength, _DefaultAttr, _attributeTable);
         pChain->_list.resize(sChainSegmentsNeeded);
 
         // Attach all chain segments that are even multiples of the row length
         for (short iChain = 0; iChain < _sDefaultChainLength; iChain++)
         {
-            TextAttributeRun* pRun = &pChain->_list[iChain];
+            InternedAttributeRun* pRun = &pChain->_list[iChain];
 
-            pRun->SetAttributesFromLegacy(iChain); // Just use the chain position as the value
+            pRun->SetAttributeId(_attributeTable.Intern(TextAttribute(iChain))); // Just use the chain position as the value
             pRun->SetLength(sChainSegLength);
         }
 
@@ -117,11 +119,12 @@ class AttrRowTests
         {
             // If we had a leftover, then this chain is one longer than we expected (the default length)
             // So use it as the index (because indicies start at 0)
-            TextAttributeRun* pRun = &pChain->_list[_sDefaultChainLength];
+            InternedAttributeRun* pRun = &pChain->_list[_sDefaultChainLength];
 
-            pRun->SetAttributes(_DefaultChainAttr);
+            pRun->SetAttributeId(_attributeTable.Intern(_DefaultChainAttr));
             pRun->SetLength(sChainLeftover);
         }
+        pChain->_UpdateRunEnds();
 
         return true;
     }
@@ -151,7 +154,7 @@ class AttrRowTests
             pUnderTest->Reset(attr);
 
             VERIFY_ARE_EQUAL(pUnderTest->_list.size(), 1u);
-            VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetAttributes(), attr);
+            VERIFY_ARE_EQUAL(GetRun(*pUnderTest, 0).GetAttributes(), attr);
             VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetLength(), (unsigned int)_sDefaultLength);
         }
     }
@@ -229,6 +232,29 @@ class AttrRowTests
         return HRESULT_FROM_NT(status);
     }
 
+    // Routine Description:
+    // - Looks up the attributes of one of the runs stored in a row.
+    // Arguments:
+    // - row - the row to look in
+    // - index - which of the row's runs to get
+    // Return Value:
+    // - the run, with its attributes instead of their ID
+    TextAttributeRun GetRun(const ATTR_ROW& row, const size_t index)
+    {
+        const auto& run = row._list.at(index);
+        return TextAttributeRun(run.GetLength(), _attributeTable.Get(run.GetAttributeId()));
+    }
+
+    std::vector<TextAttributeRun> GetRuns(const ATTR_ROW& row)
+    {
+        std::vector<TextAttributeRun> runs;
+        for (size_t i = 0; i < row._list.size(); i++)
+        {
+            runs.push_back(GetRun(row, i));
+        }
+        return runs;
+    }
+
     NoThrowString LogRunElement(_In_ TextAttributeRun& run)
     {
         return NoThrowString().Format(L"%wc%d", run.GetAttributes().GetLegacyAttributes(), run.GetLength());
@@ -265,16 +291,18 @@ class AttrRowTests
 
         // Set up our "original row" that we are going to try to insert into.
         // This will represent a 10 column run of R3->B5->G2 that we will use for all tests.
-        ATTR_ROW originalRow{ static_cast<UINT>(_sDefaultLength), _DefaultAttr };
+        ATTR_ROW originalRow{ static_cast<UINT>(_sDefaultLength), _DefaultAttr, _attributeTable };
         originalRow._list.resize(3);
         originalRow._cchRowWidth = 10;
-        originalRow._list[0].SetAttributesFromLegacy('R');
+        originalRow._list[0].SetAttributeId(_attributeTable.Intern(TextAttribute('R')));
         originalRow._list[0].SetLength(3);
-        originalRow._list[1].SetAttributesFromLegacy('B');
+        originalRow._list[1].SetAttributeId(_attributeTable.Intern(TextAttribute('B')));
         originalRow._list[1].SetLength(5);
-        originalRow._list[2].SetAttributesFromLegacy('G');
+        originalRow._list[2].SetAttributeId(_attributeTable.Intern(TextAttribute('G')));
         originalRow._list[2].SetLength(2);
-        LogChain(L"Original: ", originalRow._list);
+        originalRow._UpdateRunEnds();
+        auto originalRuns = GetRuns(originalRow);
+        LogChain(L"Original: ", originalRuns);
 
         // Set up our "insertion run"
         size_t cInsertRow = 1;
@@ -352,12 +380,13 @@ class AttrRowTests
         std::vector<TextAttributeRun> packedRunExpected;
         std::copy_n(packedRun.get(), cPackedRun, std::back_inserter(packedRunExpected));
 
+        auto actualRuns = GetRuns(originalRow);
         LogChain(L"Expected: ", packedRunExpected);
-        LogChain(L"Actual: ", originalRow._list);
+        LogChain(L"Actual: ", actualRuns);
 
         for (size_t testIndex = 0; testIndex < cPackedRun; testIndex++)
         {
-            VERIFY_ARE_EQUAL(packedRun[testIndex], originalRow._list[testIndex]);
+            VERIFY_ARE_EQUAL(packedRun[testIndex], actualRuns[testIndex]);
         }
     }
 
@@ -514,10 +543,10 @@ class AttrRowTests
         // Was 1 (single), should now have 2 segments
         VERIFY_ARE_EQUAL(pSingle->_list.size(), 2u);
 
-        VERIFY_ARE_EQUAL(pSingle->_list[0].GetAttributes(), _DefaultAttr);
+        VERIFY_ARE_EQUAL(GetRun(*pSingle, 0).GetAttributes(), _DefaultAttr);
         VERIFY_ARE_EQUAL(pSingle->_list[0].GetLength(), (unsigned int)(_sDefaultLength - (_sDefaultLength - iTestIndex)));
 
-        VERIFY_ARE_EQUAL(pSingle->_list[1].GetAttributes(), TestAttr);
+        VERIFY_ARE_EQUAL(GetRun(*pSingle, 1).GetAttributes(), TestAttr);
         VERIFY_ARE_EQUAL(pSingle->_list[1].GetLength(), (unsigned int)(_sDefaultLength - iTestIndex));
 
         Log::Comment(L"SetAttrToEnd for existing chain of multiple colors.");
@@ -527,19 +556,19 @@ class AttrRowTests
         VERIFY_ARE_EQUAL(pChain->_list.size(), 5u);
 
         // Verify chain colors and lengths
-        VERIFY_ARE_EQUAL(TextAttribute(0), pChain->_list[0].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(0), GetRun(*pChain, 0).GetAttributes());
         VERIFY_ARE_EQUAL(pChain->_list[0].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(1), pChain->_list[1].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(1), GetRun(*pChain, 1).GetAttributes());
         VERIFY_ARE_EQUAL(pChain->_list[1].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(2), pChain->_list[2].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(2), GetRun(*pChain, 2).GetAttributes());
         VERIFY_ARE_EQUAL(pChain->_list[2].GetLength(), (unsigned int)13);
 
-        VERIFY_ARE_EQUAL(TextAttribute(3), pChain->_list[3].GetAttributes());
+        VERIFY_ARE_EQUAL(TextAttribute(3), GetRun(*pChain, 3).GetAttributes());
         VERIFY_ARE_EQUAL(pChain->_list[3].GetLength(), (unsigned int)11);
 
-        VERIFY_ARE_EQUAL(TestAttr, pChain->_list[4].GetAttributes());
+        VERIFY_ARE_EQUAL(TestAttr, GetRun(*pChain, 4).GetAttributes());
         VERIFY_ARE_EQUAL(pChain->_list[4].GetLength(), (unsigned int)30);
 
         Log::Comment(L"SECOND: Set index to 0 to test replacing anything with a single");
@@ -556,13 +585,49 @@ class AttrRowTests
             VERIFY_ARE_EQUAL(pUnderTest->_list.size(), 1u);
 
             // singular pair should contain the color
-            VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetAttributes(), TestAttr);
+            VERIFY_ARE_EQUAL(GetRun(*pUnderTest, 0).GetAttributes(), TestAttr);
 
             // and its length should be the length of the whole string
             VERIFY_ARE_EQUAL(pUnderTest->_list[0].GetLength(), (unsigned int)_sDefaultLength);
         }
     }
 
+    TEST_METHOD(TestAttributesAreInterned)
+    {
+        const TextAttribute testAttr{ FOREGROUND_BLUE | BACKGROUND_GREEN };
+        const auto tableSize = _attributeTable.Size();
+
+        pSingle->SetAttrToEnd(10, testAttr);
+        pChain->SetAttrToEnd(20, testAttr);
+
+        Log::Comment(L"The attribute is stored once, and both rows refer to it with the same ID.");
+        VERIFY_ARE_EQUAL(tableSize + 1, _attributeTable.Size());
+
+        auto single = pSingle->cbegin();
+        single += 10;
+        auto chain = pChain->cbegin();
+        chain += 20;
+        VERIFY_ARE_EQUAL(single.GetAttributeId(), chain.GetAttributeId());
+        VERIFY_ARE_EQUAL(testAttr, *single);
+        VERIFY_ARE_EQUAL(testAttr, *chain);
+
+        Log::Comment(L"Only the IDs of the attributes the row uses are marked as used.");
+        std::vector<bool> used(_attributeTable.IdLimit(), false);
+        pChain->MarkUsedAttributes(used);
+
+        size_t usedCount = 0;
+        for (size_t id = 0; id < used.size(); id++)
+        {
+            const bool inRow = std::any_of(pChain->_list.cbegin(), pChain->_list.cend(), [&](const InternedAttributeRun& run) {
+                return run.GetAttributeId() == id;
+            });
+            VERIFY_ARE_EQUAL(inRow, static_cast<bool>(used[id]));
+            usedCount += used[id] ? 1 : 0;
+        }
+        VERIFY_IS_LESS_THAN_OR_EQUAL(usedCount, pChain->_list.size());
+        VERIFY_IS_TRUE(used[single.GetAttributeId()]);
+    }
+
     TEST_METHOD(TestTotalLength)
     {
         ATTR_ROW* pTestItems[]{ pSingle, pChain };
@@ -577,6 +642,66 @@ class AttrRowTests
         }
     }
 
+    TEST_METHOD(TestRunRemaining)
+    {
+        auto it = pChain->cbegin();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(sChainSegLength), it.GetRunRemaining());
+
+        it += 5;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(sChainSegLength - 5), it.GetRunRemaining());
+
+        // Stepping past the end of a run moves to the start of the next one.
+        it += sChainSegLength - 5;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(sChainSegLength), it.GetRunRemaining());
+
+        auto single = pSingle->cbegin();
+        single += _sDefaultLength - 1;
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), single.GetRunRemaining());
+    }
+
+    TEST_METHOD(TestFindAttrIndex)
+    {
+        Log::Comment(L"Every column of the chain should be found in the run that covers it.");
+        size_t runStart = 0;
+        for (size_t run = 0; run < pChain->_list.size(); run++)
+        {
+            const auto runLength = pChain->_list[run].GetLength();
+            for (size_t column = runStart; column < runStart + runLength; column++)
+            {
+                size_t applies = 0;
+                VERIFY_ARE_EQUAL(run, pChain->FindAttrIndex(column, &applies));
+                VERIFY_ARE_EQUAL(runStart + runLength - column, applies);
+            }
+            runStart += runLength;
+        }
+        VERIFY_ARE_EQUAL(pChain->_cchRowWidth, runStart);
+    }
+
+    TEST_METHOD(TestIteratorRandomAccess)
+    {
+        const std::vector<TextAttribute> attrs{ pChain->begin(), pChain->end() };
+
+        Log::Comment(L"Jumping straight to a column should land on the same attribute as walking to it.");
+        for (size_t column = 0; column < attrs.size(); column += 7)
+        {
+            auto it = pChain->cbegin();
+            it += static_cast<ptrdiff_t>(column);
+            VERIFY_ARE_EQUAL(attrs[column], *it);
+
+            it -= static_cast<ptrdiff_t>(column / 2);
+            VERIFY_ARE_EQUAL(attrs[column - column / 2], *it);
+        }
+
+        Log::Comment(L"Walking backward from the end should visit every attribute in reverse.");
+        auto it = pChain->cend();
+        for (size_t column = attrs.size(); column > 0; column--)
+        {
+            --it;
+            VERIFY_ARE_EQUAL(attrs[column - 1], *it);
+        }
+        VERIFY_IS_TRUE(pChain->cbegin() == it);
+    }
+
     TEST_METHOD(TestResize)
     {
         CommonState state;
@@ -34,32 +34,12 @@ class CodepointWidthDetectorTests
     TEST_CLASS(CodepointWidthDetectorTests);
 
 
-    TEST_METHOD(CodepointWidthDetectDefersMapPopulation)
-    {
-        CodepointWidthDetector widthDetector;
-        VERIFY_IS_TRUE(widthDetector._map.empty());
-        widthDetector.IsWide(UNICODE_SPACE);
-        VERIFY_IS_TRUE(widthDetector._map.empty());
-        // now force checking
-        widthDetector.GetWidth(emoji);
-        VERIFY_IS_FALSE(widthDetector._map.empty());
-    }
-
     TEST_METHOD(CanLookUpEmoji)
     {
         CodepointWidthDetector widthDetector;
         VERIFY_IS_TRUE(widthDetector.IsWide(emoji));
     }
 
-    TEST_METHOD(TestUnicodeRangeCompare)
-    {
-        CodepointWidthDetector::UnicodeRangeCompare compare;
-        // test comparing 2 search terms
-        CodepointWidthDetector::UnicodeRange a{ 0x10 };
-        CodepointWidthDetector::UnicodeRange b{ 0x15 };
-        VERIFY_IS_TRUE(static_cast<bool>(compare(a, b)));
-    }
-
     TEST_METHOD(CanExtractCodepoint)
     {
         CodepointWidthDetector widthDetector;
@@ -84,6 +64,45 @@ class CodepointWidthDetectorTests
         }
     }
 
+    TEST_METHOD(CanGetWidthsOfUnassignedCodepoints)
+    {
+        CodepointWidthDetector widthDetector;
+        VERIFY_ARE_EQUAL(CodepointWidth::Invalid, widthDetector.GetWidth(L"\x0378")); // unassigned, in greek and coptic
+        VERIFY_ARE_EQUAL(CodepointWidth::Invalid, widthDetector.GetWidth(L"\xDBBF\xDFFE")); // U+FFFFE, a noncharacter
+        VERIFY_ARE_EQUAL(CodepointWidth::Ambiguous, widthDetector.GetWidth(L"\xDBFF\xDFFD")); // U+10FFFD, the last private use character
+        VERIFY_ARE_EQUAL(CodepointWidth::Invalid, widthDetector.GetWidth(L"\xDBFF\xDFFF")); // U+10FFFF, the last codepoint
+    }
+
+    TEST_METHOD(CanGetWidthsOfRun)
+    {
+        CodepointWidthDetector widthDetector;
+        std::wstring run;
+        std::vector<CodepointWidth> expected;
+        for (const auto& data : testData)
+        {
+            const auto& wstr = std::get<1>(data);
+            run.append(wstr);
+            // every wchar_t of a surrogate pair gets the width of the whole codepoint
+            expected.insert(expected.end(), wstr.size(), std::get<2>(data));
+        }
+        // a lone surrogate is measured on its own
+        run.push_back(L'\xD83D');
+        expected.push_back(widthDetector.GetWidth(L"\xD83D"));
+
+        std::vector<CodepointWidth> widths(run.size(), CodepointWidth::Invalid);
+        widthDetector.GetWidths(run, widths);
+        VERIFY_ARE_EQUAL(expected.size(), widths.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            VERIFY_ARE_EQUAL(expected[i], widths[i], NoThrowString().Format(L"Index %zu", i));
+        }
+
+        // the run has to fit
+        VERIFY_THROWS_SPECIFIC(widthDetector.GetWidths(run, gsl::span<CodepointWidth>{ widths.data(), 1 }),
+                               wil::ResultException,
+                               [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+    }
+
     static bool FallbackMethod(const std::wstring_view glyph)
     {
         if (glyph.size() < 1)
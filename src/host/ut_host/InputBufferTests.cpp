@@ -77,7 +77,7 @@ class InputBufferTests
             INPUT_RECORD record;
             record.EventType = MENU_EVENT;
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back()->ToInputRecord());
+            VERIFY_ARE_EQUAL(record, inputBuffer._storage.back());
         }
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
     }
@@ -97,7 +97,7 @@ class InputBufferTests
         // verify that the events are the same in storage
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i]->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i], record);
         }
     }
 
@@ -120,10 +120,9 @@ class InputBufferTests
         // check that they coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
         // check that the mouse position is being updated correctly
-        const IInputEvent* const pOutEvent = inputBuffer._storage.front().get();
-        const MouseEvent* const pMouseEvent = static_cast<const MouseEvent* const>(pOutEvent);
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().X, static_cast<SHORT>(RECORD_INSERT_COUNT));
-        VERIFY_ARE_EQUAL(pMouseEvent->GetPosition().Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
+        const INPUT_RECORD& outRecord = inputBuffer._storage.front();
+        VERIFY_ARE_EQUAL(outRecord.Event.MouseEvent.dwMousePosition.X, static_cast<SHORT>(RECORD_INSERT_COUNT));
+        VERIFY_ARE_EQUAL(outRecord.Event.MouseEvent.dwMousePosition.Y, static_cast<SHORT>(RECORD_INSERT_COUNT * 2));
 
         // add a key event and another mouse event to make sure that
         // an event between two mouse events stopped the coalescing.
@@ -161,10 +160,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), mouseRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), mouseRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), mouseRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], mouseRecords[i]);
         }
     }
 
@@ -187,16 +186,14 @@ class InputBufferTests
 
         // the single event should have a repeat count for each
         // coalesced event
-        std::unique_ptr<IInputEvent> outEvent;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvent,
+        std::optional<INPUT_RECORD> outRecord;
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecord,
                                                  true,
                                                  false,
-                                                 false,
                                                  false));
 
-        VERIFY_ARE_NOT_EQUAL(nullptr, outEvent.get());
-        const KeyEvent* const pKeyEvent = static_cast<const KeyEvent* const>(outEvent.get());
-        VERIFY_ARE_EQUAL(pKeyEvent->GetRepeatCount(), RECORD_INSERT_COUNT);
+        VERIFY_IS_TRUE(outRecord.has_value());
+        VERIFY_ARE_EQUAL(outRecord->Event.KeyEvent.wRepeatCount, RECORD_INSERT_COUNT);
     }
 
     TEST_METHOD(InputBufferDoesNotCoalesceBulkKeyEvents)
@@ -220,10 +217,10 @@ class InputBufferTests
         // no events should have been coalesced
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT + 1);
         // check that the events stored match those inserted
-        VERIFY_ARE_EQUAL(inputBuffer._storage.front()->ToInputRecord(), keyRecords[0]);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front(), keyRecords[0]);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1]->ToInputRecord(), keyRecords[i]);
+            VERIFY_ARE_EQUAL(inputBuffer._storage[i + 1], keyRecords[i]);
         }
     }
 
@@ -238,7 +235,7 @@ class InputBufferTests
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
             VERIFY_IS_GREATER_THAN(inputBuffer.Write(IInputEvent::Create(record)), 0u);
-            VERIFY_ARE_EQUAL(inputBuffer._storage.back()->ToInputRecord(), record);
+            VERIFY_ARE_EQUAL(inputBuffer._storage.back(), record);
         }
 
         // The events shouldn't be coalesced
@@ -285,19 +282,19 @@ class InputBufferTests
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT / 2);
 
         // make sure that the non key events were the ones removed
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t amountToRead = RECORD_INSERT_COUNT / 2;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  false,
                                                  false,
                                                  false,
                                                  false));
-        VERIFY_ARE_EQUAL(amountToRead, outEvents.size());
+        VERIFY_ARE_EQUAL(amountToRead, outRecords.size());
 
-        for (size_t i = 0; i < outEvents.size(); ++i)
+        for (size_t i = 0; i < outRecords.size(); ++i)
         {
-            VERIFY_ARE_EQUAL(outEvents[i]->EventType(), InputEventType::KeyEvent);
+            VERIFY_ARE_EQUAL(outRecords[i].EventType, KEY_EVENT);
         }
     }
 
@@ -316,19 +313,19 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // read them back out
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t amountToRead = RECORD_INSERT_COUNT;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  false,
                                                  false,
                                                  false,
                                                  false));
-        VERIFY_ARE_EQUAL(amountToRead, outEvents.size());
+        VERIFY_ARE_EQUAL(amountToRead, outRecords.size());
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 0u);
         for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(records[i], outEvents[i]->ToInputRecord());
+            VERIFY_ARE_EQUAL(records[i], outRecords[i]);
         }
     }
 
@@ -347,20 +344,20 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // peek at events
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t amountToRead = RECORD_INSERT_COUNT;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  true,
                                                  false,
                                                  false,
                                                  false));
 
-        VERIFY_ARE_EQUAL(amountToRead, outEvents.size());
+        VERIFY_ARE_EQUAL(amountToRead, outRecords.size());
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
         for (unsigned int i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(records[i], outEvents[i]->ToInputRecord());
+            VERIFY_ARE_EQUAL(records[i], outRecords[i]);
         }
     }
 
@@ -381,10 +378,10 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // read one record, make sure ResetWaitEvent isn't set
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t eventsRead = 0;
         bool resetWaitEvent = false;
-        inputBuffer._ReadBuffer(outEvents,
+        inputBuffer._ReadBuffer(outRecords,
                                 1,
                                 eventsRead,
                                 false,
@@ -395,8 +392,8 @@ class InputBufferTests
         VERIFY_IS_FALSE(!!resetWaitEvent);
 
         // read the rest, resetWaitEvent should be set to true
-        outEvents.clear();
-        inputBuffer._ReadBuffer(outEvents,
+        outRecords.clear();
+        inputBuffer._ReadBuffer(outRecords,
                                 RECORD_INSERT_COUNT - 1,
                                 eventsRead,
                                 false,
@@ -430,10 +427,10 @@ class InputBufferTests
         VERIFY_IS_GREATER_THAN(inputBuffer.Write(inEvents), 0u);
 
         // read them out non-unicode style and compare
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t eventsRead = 0;
         bool resetWaitEvent = false;
-        inputBuffer._ReadBuffer(outEvents,
+        inputBuffer._ReadBuffer(outRecords,
                                 recordInsertCount,
                                 eventsRead,
                                 false,
@@ -443,10 +440,10 @@ class InputBufferTests
         // the dbcs record should have counted for two elements in
         // the array, making it so that we get less events read
         VERIFY_ARE_EQUAL(eventsRead, recordInsertCount - 1);
-        VERIFY_ARE_EQUAL(eventsRead, outEvents.size());
+        VERIFY_ARE_EQUAL(eventsRead, outRecords.size());
         for (size_t i = 0; i < eventsRead; ++i)
         {
-            VERIFY_ARE_EQUAL(outEvents[i]->ToInputRecord(), inRecords[i]);
+            VERIFY_ARE_EQUAL(outRecords[i], inRecords[i]);
         }
     }
 
@@ -476,34 +473,34 @@ class InputBufferTests
         VERIFY_ARE_EQUAL(eventsWritten, RECORD_INSERT_COUNT);
 
         // grab the first set of events and ensure they match prependRecords
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t amountToRead = RECORD_INSERT_COUNT;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  false,
                                                  false,
                                                  false,
                                                  false));
-        VERIFY_ARE_EQUAL(amountToRead, outEvents.size());
+        VERIFY_ARE_EQUAL(amountToRead, outRecords.size());
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT);
         for (unsigned int i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(prependRecords[i], outEvents[i]->ToInputRecord());
+            VERIFY_ARE_EQUAL(prependRecords[i], outRecords[i]);
         }
 
-        outEvents.clear();
+        outRecords.clear();
         // verify the rest of the records
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  false,
                                                  false,
                                                  false,
                                                  false));
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 0u);
-        VERIFY_ARE_EQUAL(amountToRead, outEvents.size());
+        VERIFY_ARE_EQUAL(amountToRead, outRecords.size());
         for (unsigned int i = 0; i < RECORD_INSERT_COUNT; ++i)
         {
-            VERIFY_ARE_EQUAL(records[i], outEvents[i]->ToInputRecord());
+            VERIFY_ARE_EQUAL(records[i], outRecords[i]);
         }
     }
 
@@ -574,9 +571,9 @@ class InputBufferTests
         VERIFY_IS_TRUE(WI_IsFlagSet(gci.Flags, CONSOLE_OUTPUT_SUSPENDED));
         VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 1u);
 
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
         size_t amountToRead = 2;
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  amountToRead,
                                                  true,
                                                  false,
@@ -588,22 +585,17 @@ class InputBufferTests
     {
         InputBuffer inputBuffer;
         INPUT_RECORD record = MakeKeyEvent(true, 1, L'a', 0, L'a', 0);
-        std::unique_ptr<IInputEvent> inputEvent = IInputEvent::Create(record);
         size_t eventsWritten;
         bool waitEvent = false;
         inputBuffer.Flush();
         // write one event to an empty buffer
-        std::deque<std::unique_ptr<IInputEvent>> storage;
-        storage.push_back(std::move(inputEvent));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer(gsl::make_span(&record, 1), eventsWritten, waitEvent);
         VERIFY_IS_TRUE(waitEvent);
         // write another, it shouldn't signal this time
         INPUT_RECORD record2 = MakeKeyEvent(true, 1, L'b', 0, L'b', 0);
-        std::unique_ptr<IInputEvent> inputEvent2 = IInputEvent::Create(record2);
         // write another event to a non-empty buffer
         waitEvent = false;
-        storage.push_back(std::move(inputEvent2));
-        inputBuffer._WriteBuffer(storage, eventsWritten, waitEvent);
+        inputBuffer._WriteBuffer(gsl::make_span(&record2, 1), eventsWritten, waitEvent);
 
         VERIFY_IS_FALSE(waitEvent);
     }
@@ -613,19 +605,19 @@ class InputBufferTests
         InputBuffer inputBuffer;
         const WORD repeatCount = 5;
         INPUT_RECORD record = MakeKeyEvent(true, repeatCount, L'a', 0, L'a', 0);
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
 
         VERIFY_ARE_EQUAL(inputBuffer.Write(IInputEvent::Create(record)), 1u);
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  1,
                                                  false,
                                                  false,
                                                  true,
                                                  true));
-        VERIFY_ARE_EQUAL(outEvents.size(), 1u);
+        VERIFY_ARE_EQUAL(outRecords.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount - 1);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount - 1);
+        VERIFY_ARE_EQUAL(outRecords.front().Event.KeyEvent.wRepeatCount, 1u);
     }
 
     TEST_METHOD(StreamPeekingDeCoalesces)
@@ -633,19 +625,70 @@ class InputBufferTests
         InputBuffer inputBuffer;
         const WORD repeatCount = 5;
         INPUT_RECORD record = MakeKeyEvent(true, repeatCount, L'a', 0, L'a', 0);
-        std::deque<std::unique_ptr<IInputEvent>> outEvents;
+        std::vector<INPUT_RECORD> outRecords;
 
         VERIFY_ARE_EQUAL(inputBuffer.Write(IInputEvent::Create(record)), 1u);
-        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outEvents,
+        VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
                                                  1,
                                                  true,
                                                  false,
                                                  true,
                                                  true));
-        VERIFY_ARE_EQUAL(outEvents.size(), 1u);
+        VERIFY_ARE_EQUAL(outRecords.size(), 1u);
         VERIFY_ARE_EQUAL(inputBuffer._storage.size(), 1u);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*inputBuffer._storage.front()).GetRepeatCount(), repeatCount);
-        VERIFY_ARE_EQUAL(static_cast<const KeyEvent&>(*outEvents.front()).GetRepeatCount(), 1u);
+        VERIFY_ARE_EQUAL(inputBuffer._storage.front().Event.KeyEvent.wRepeatCount, repeatCount);
+        VERIFY_ARE_EQUAL(outRecords.front().Event.KeyEvent.wRepeatCount, 1u);
+    }
+
+    TEST_METHOD(CanWriteAndReadBatchesOfRecords)
+    {
+        Log::Comment(L"Records written in batches should come back out in order, while the storage wraps around and grows");
+
+        InputBuffer inputBuffer;
+        std::vector<INPUT_RECORD> inRecords;
+        for (unsigned int i = 0; i < RECORD_INSERT_COUNT; ++i)
+        {
+            inRecords.push_back(MakeKeyEvent(TRUE, 1, static_cast<WCHAR>(L'A' + i), 0, static_cast<WCHAR>(L'A' + i), 0));
+        }
+
+        // keep the buffer partly full while writing and reading enough
+        // records that the storage has to wrap around and grow.
+        std::vector<INPUT_RECORD> outRecords;
+        for (size_t batch = 0; batch < 20; ++batch)
+        {
+            VERIFY_ARE_EQUAL(inputBuffer.Write(inRecords), RECORD_INSERT_COUNT);
+            if (batch % 2 == 0)
+            {
+                VERIFY_ARE_EQUAL(inputBuffer.Write(inRecords), RECORD_INSERT_COUNT);
+            }
+
+            outRecords.clear();
+            VERIFY_SUCCESS_NTSTATUS(inputBuffer.Read(outRecords,
+                                                     RECORD_INSERT_COUNT,
+                                                     false,
+                                                     false,
+                                                     true,
+                                                     false));
+            VERIFY_ARE_EQUAL(outRecords.size(), RECORD_INSERT_COUNT);
+            for (size_t i = 0; i < RECORD_INSERT_COUNT; ++i)
+            {
+                VERIFY_ARE_EQUAL(outRecords[i], inRecords[i]);
+            }
+        }
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), RECORD_INSERT_COUNT * 10);
+    }
+
+    TEST_METHOD(WritingInvalidRecordsWritesNothing)
+    {
+        InputBuffer inputBuffer;
+        INPUT_RECORD records[2];
+        records[0] = MakeKeyEvent(TRUE, 1, L'a', 0, L'a', 0);
+        records[1] = MakeKeyEvent(TRUE, 1, L'b', 0, L'b', 0);
+        records[1].EventType = 0x1234;
+
+        VERIFY_IS_FALSE(InputBuffer::IsValidRecord(records[1]));
+        VERIFY_ARE_EQUAL(inputBuffer.Write(gsl::make_span(records)), 0u);
+        VERIFY_ARE_EQUAL(inputBuffer.GetNumberOfReadyEvents(), 0u);
     }
 
 };
@@ -8,9 +8,170 @@
 
 #include "..\..\host\renderData.hpp"
 #include "..\..\renderer\base\renderer.hpp"
+#include "..\..\renderer\inc\RenderEngineBase.hpp"
+
+#include "..\interactivity\inc\ServiceLocator.hpp"
 
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
+using namespace Microsoft::Console::Render;
+
+// An engine that wants to be painted before the buffer circles, like the VT
+//      engine, and whose Present can be made to wait, to see what the renderer
+//      does with calls that come in while a frame is being presented.
+class CirclingTestEngine final : public RenderEngineBase
+{
+public:
+    CirclingTestEngine() :
+        RenderEngineBase(),
+        _isDirty{ false },
+        _circling{ false }
+    {
+        presenting.create(wil::EventOptions::ManualReset);
+        finishPresenting.create(wil::EventOptions::ManualReset);
+    }
+
+    // Makes the next Present wait for finishPresenting, after setting presenting.
+    std::atomic<bool> holdNextPresent{ false };
+    wil::unique_event presenting;
+    wil::unique_event finishPresenting;
+
+    std::atomic<int> circlings{ 0 };
+    std::atomic<int> circlingFramesPainted{ 0 };
+
+    [[nodiscard]]
+    HRESULT StartPaint() noexcept override { return _isDirty ? S_OK : S_FALSE; }
+
+    [[nodiscard]]
+    HRESULT EndPaint() noexcept override
+    {
+        if (_circling)
+        {
+            circlingFramesPainted++;
+            _circling = false;
+        }
+        _isDirty = false;
+        return S_OK;
+    }
+
+    [[nodiscard]]
+    HRESULT Present() noexcept override
+    {
+        if (holdNextPresent.exchange(false))
+        {
+            presenting.SetEvent();
+            finishPresenting.wait();
+        }
+        return S_OK;
+    }
+
+    [[nodiscard]]
+    HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept override
+    {
+        *pForcePaint = false;
+        return S_OK;
+    }
+
+    [[nodiscard]]
+    HRESULT ScrollFrame() noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT Invalidate(const SMALL_RECT* const /*psrRegion*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT InvalidateCursor(const COORD* const /*pcoordCursor*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT InvalidateSystem(const RECT* const /*prcDirtyClient*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT InvalidateSelection(const std::vector<SMALL_RECT>& /*rectangles*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT InvalidateScroll(const COORD* const /*pcoordDelta*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT InvalidateAll() noexcept override
+    {
+        _isDirty = true;
+        return S_OK;
+    }
+
+    [[nodiscard]]
+    HRESULT InvalidateCircling(_Out_ bool* const pForcePaint) noexcept override
+    {
+        circlings++;
+        _circling = true;
+        *pForcePaint = true;
+        return InvalidateAll();
+    }
+
+    [[nodiscard]]
+    HRESULT PaintBackground() noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT PaintBufferLine(std::basic_string_view<Cluster> const /*clusters*/,
+                            const COORD /*coord*/,
+                            const bool /*fTrimLeft*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT PaintBufferGridLines(const GridLines /*lines*/,
+                                 const COLORREF /*color*/,
+                                 const size_t /*cchLine*/,
+                                 const COORD /*coordTarget*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT PaintSelection(const SMALL_RECT /*rect*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT PaintCursor(const CursorOptions& /*options*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT UpdateDrawingBrushes(const COLORREF /*colorForeground*/,
+                                 const COLORREF /*colorBackground*/,
+                                 const WORD /*legacyColorAttribute*/,
+                                 const bool /*isBold*/,
+                                 const bool /*isSettingDefaultBrushes*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/,
+                       _Out_ FontInfo& /*FontInfo*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT UpdateDpi(const int /*iDpi*/) noexcept override { return S_OK; }
+
+    [[nodiscard]]
+    HRESULT UpdateViewport(const SMALL_RECT /*srNewViewport*/) noexcept override { return InvalidateAll(); }
+
+    [[nodiscard]]
+    HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/,
+                            _Out_ FontInfo& /*FontInfo*/,
+                            const int /*iDpi*/) noexcept override { return S_OK; }
+
+    SMALL_RECT GetDirtyRectInChars() override { return {}; }
+
+    [[nodiscard]]
+    HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override
+    {
+        *pFontSize = { 1, 1 };
+        return S_OK;
+    }
+
+    [[nodiscard]]
+    HRESULT IsGlyphWideByFont(const std::wstring_view /*glyph*/, _Out_ bool* const pResult) noexcept override
+    {
+        *pResult = false;
+        return S_OK;
+    }
+
+protected:
+    [[nodiscard]]
+    HRESULT _DoUpdateTitle(const std::wstring& /*newTitle*/) noexcept override { return S_OK; }
+
+private:
+    bool _isDirty;
+    bool _circling;
+};
 
 class RendererTests
 {
@@ -19,6 +180,7 @@ class RendererTests
     std::unique_ptr<CommonState> m_state;
     std::unique_ptr<RenderData> m_renderData;
     std::unique_ptr<Renderer> m_renderer;
+    std::unique_ptr<CirclingTestEngine> m_engine;
 
     TEST_CLASS_SETUP(ClassSetup)
     {
@@ -50,22 +212,146 @@ class RendererTests
 
     TEST_METHOD_SETUP(MethodSetup)
     {
-        Renderer* pRenderer = nullptr;
-        Globals& g = ServiceLocator::LocateGlobals();
-        CONSOLE_INFORMATION& gci = g.getConsoleInformation();
-        VERIFY_SUCCEEDED(Renderer::s_CreateInstance(gci.renderData, &pRenderer));
-        m_renderer.reset(pRenderer);
+        CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+
+        auto thread = std::make_unique<RenderThread>();
+        auto* const pThread = thread.get();
+        m_renderer = std::make_unique<Renderer>(&gci.renderData, nullptr, 0, std::move(thread));
+        VERIFY_SUCCEEDED(pThread->Initialize(m_renderer.get()));
         return true;
     }
 
     TEST_METHOD_CLEANUP(MethodCleanup)
     {
+        // The thread has to be running, and not waiting out a long frame
+        //      interval, for the renderer to be torn down.
+        m_renderer->SetFrameInterval(std::chrono::milliseconds{ 0 });
+        m_renderer->EnablePainting();
+        m_renderer->NotifyInput();
         m_renderer.reset(nullptr);
+        m_engine.reset(nullptr);
         return true;
     }
 
+    // Waits up to a few seconds for the render thread to have painted the given number of frames.
+    static bool s_WaitForFrames(const Renderer& renderer, const uint64_t frames)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            if (renderer.GetRenderThreadCounters().frames >= frames)
+            {
+                return true;
+            }
+            Sleep(10);
+        }
+        return false;
+    }
+
     TEST_METHOD(Sample)
     {
         m_renderer->TriggerTitleChange();
     }
+
+    TEST_METHOD(OutputIsPacedAndInputIsPaintedRightAway)
+    {
+        Log::Comment(L"Output should be painted at most once per frame interval, all in one frame, "
+                     L"while a frame that shows input should be painted right away.");
+
+        m_renderer->SetFrameInterval(std::chrono::seconds{ 10 });
+        m_renderer->EnablePainting();
+
+        Log::Comment(L"The first frame has no frame before it to wait for.");
+        m_renderer->TriggerPaint();
+        VERIFY_IS_TRUE(s_WaitForFrames(*m_renderer, 1));
+
+        Log::Comment(L"Output waits for the frame interval.");
+        m_renderer->TriggerPaint();
+        m_renderer->TriggerPaint();
+        m_renderer->TriggerPaint();
+        Sleep(200);
+        VERIFY_ARE_EQUAL(1u, m_renderer->GetRenderThreadCounters().frames);
+
+        Log::Comment(L"Input cuts the wait short, and the output is all painted in the one frame.");
+        m_renderer->NotifyInput();
+        VERIFY_IS_TRUE(s_WaitForFrames(*m_renderer, 2));
+
+        // Let the thread finish counting the frame, and make sure there's no other one.
+        Sleep(200);
+
+        const auto counters = m_renderer->GetRenderThreadCounters();
+        VERIFY_ARE_EQUAL(2u, counters.frames);
+        VERIFY_ARE_EQUAL(2u, counters.coalescedRequests);
+        VERIFY_ARE_EQUAL(1u, counters.inputFrames);
+        VERIFY_ARE_EQUAL(counters.lastInputLatency.count(), counters.totalInputLatency.count());
+        VERIFY_IS_LESS_THAN(counters.lastInputLatency.count(), std::chrono::microseconds{ std::chrono::milliseconds{ 100 } }.count());
+    }
+
+    TEST_METHOD(InputPastTheInputWindowDoesNotHurryOutput)
+    {
+        Log::Comment(L"Input that nothing was painted for within the input window "
+                     L"shouldn't cut the wait for the frame interval short anymore.");
+
+        m_renderer->SetFrameInterval(std::chrono::seconds{ 10 });
+        m_renderer->EnablePainting();
+
+        m_renderer->TriggerPaint();
+        VERIFY_IS_TRUE(s_WaitForFrames(*m_renderer, 1));
+
+        Log::Comment(L"Input that doesn't cause output, then output once the input window has passed.");
+        m_renderer->NotifyInput();
+        Sleep(300);
+        m_renderer->TriggerPaint();
+        Sleep(200);
+        VERIFY_ARE_EQUAL(1u, m_renderer->GetRenderThreadCounters().frames);
+
+        Log::Comment(L"New input still gets the output painted right away.");
+        m_renderer->NotifyInput();
+        VERIFY_IS_TRUE(s_WaitForFrames(*m_renderer, 2));
+        Sleep(200);
+
+        const auto counters = m_renderer->GetRenderThreadCounters();
+        VERIFY_ARE_EQUAL(2u, counters.frames);
+        VERIFY_ARE_EQUAL(1u, counters.inputFrames);
+    }
+
+    TEST_METHOD(CirclingWhilePresentingIsNotDeferred)
+    {
+        Log::Comment(L"When the buffer circles while a frame is being presented, the engines should "
+                     L"still be told, and get to paint, before the rows that scroll off are gone.");
+
+        m_engine = std::make_unique<CirclingTestEngine>();
+        m_renderer->AddRenderEngine(m_engine.get());
+        m_renderer->SetFrameInterval(std::chrono::milliseconds{ 0 });
+        m_renderer->EnablePainting();
+
+        Log::Comment(L"Get the render thread stuck presenting a frame.");
+        m_engine->holdNextPresent = true;
+        auto finishPresenting = wil::scope_exit([&]() { m_engine->finishPresenting.SetEvent(); });
+        m_renderer->TriggerRedrawAll();
+        VERIFY_IS_TRUE(m_engine->presenting.wait(5000));
+
+        Log::Comment(L"Circle the buffer under the console lock, like writing to the console does.");
+        int circlings = 0;
+        int circlingFramesPainted = 0;
+        wil::unique_event circled;
+        circled.create(wil::EventOptions::ManualReset);
+        std::thread circler([&]() {
+            CONSOLE_INFORMATION& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+            gci.LockConsole();
+            m_renderer->TriggerCircling();
+            circlings = m_engine->circlings;
+            circlingFramesPainted = m_engine->circlingFramesPainted;
+            gci.UnlockConsole();
+            circled.SetEvent();
+        });
+
+        Log::Comment(L"It waits for the frame to be presented, and the engine paints before it returns.");
+        VERIFY_IS_FALSE(circled.wait(200));
+        finishPresenting.reset();
+        VERIFY_IS_TRUE(circled.wait(5000));
+        circler.join();
+
+        VERIFY_ARE_EQUAL(1, circlings);
+        VERIFY_ARE_EQUAL(1, circlingFramesPainted);
+    }
 };
@@ -163,4 +163,44 @@ class SearchTests
         Search s(outputBuffer, L"\x304b", Search::Direction::Backward, Search::Sensitivity::CaseInsensitive);
         DoFoundChecks(s, coordStartExpected, -1);
     }
+
+    TEST_METHOD(FindAllMatches)
+    {
+        auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+        auto& outputBuffer = gci.GetActiveOutputBuffer();
+        auto& textBuffer = outputBuffer.GetTextBuffer();
+
+        // Put "QR" across a wrapped pair of ASCII rows, after the filled ones.
+        const SHORT lastColumn = textBuffer.GetSize().RightInclusive();
+        auto& wrappedRow = textBuffer.GetRowByOffset(4).GetCharRow();
+        wrappedRow.GlyphAt(lastColumn) = L"Q";
+        wrappedRow.SetWrapForced(true);
+        textBuffer.GetRowByOffset(5).GetCharRow().GlyphAt(0) = L"r";
+        VERIFY_IS_TRUE(wrappedRow.IsAscii());
+
+        Log::Comment(L"Every match is found, with the last cell of a double width glyph as its end.");
+        Search wide(outputBuffer, L"\x304d" L"d", Search::Direction::Forward, Search::Sensitivity::CaseInsensitive);
+        const auto& wideMatches = wide.FindAll();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(4), wideMatches.size());
+        for (SHORT row = 0; row < 4; row++)
+        {
+            VERIFY_ARE_EQUAL(COORD({ 5, row }), wideMatches.at(row).first);
+            VERIFY_ARE_EQUAL(COORD({ 7, row }), wideMatches.at(row).second);
+        }
+
+        Log::Comment(L"A match can span rows that were wrapped, but only case insensitively here.");
+        Search caseSensitive(outputBuffer, L"QR", Search::Direction::Forward, Search::Sensitivity::CaseSensitive);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(0), caseSensitive.FindAll().size());
+
+        Search caseInsensitive(outputBuffer, L"qR", Search::Direction::Forward, Search::Sensitivity::CaseInsensitive);
+        const auto& wrappedMatches = caseInsensitive.FindAll();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), wrappedMatches.size());
+        VERIFY_ARE_EQUAL(COORD({ lastColumn, 4 }), wrappedMatches.at(0).first);
+        VERIFY_ARE_EQUAL(COORD({ 0, 5 }), wrappedMatches.at(0).second);
+
+        Log::Comment(L"FindNext walks the same matches.");
+        VERIFY_IS_TRUE(caseInsensitive.FindNext());
+        VERIFY_ARE_EQUAL(COORD({ lastColumn, 4 }), caseInsensitive._coordSelStart);
+        VERIFY_IS_FALSE(caseInsensitive.FindNext());
+    }
 };
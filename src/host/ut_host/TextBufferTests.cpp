@@ -142,6 +142,16 @@ class TextBufferTests
 
     TEST_METHOD(TestBurrito);
 
+    TEST_METHOD(AsciiRowsStayCompact);
+
+    TEST_METHOD(ScrolledOutRowsGoToScrollback);
+    TEST_METHOD(SpilledScrollbackCopiesBack);
+
+    TEST_METHOD(ResizeWithReflowRewrapsLogicalLines);
+    TEST_METHOD(ResizeWithReflowDefersHistory);
+
+    TEST_METHOD(KeepsColorsOfMoreAttributesThanFitIn16Bits);
+
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -1899,14 +1909,17 @@ void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage()._glyphs.size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the row of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X, bufferSize.Y - 1 };
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    for (const auto& row : _buffer->_storage)
+    {
+        VERIFY_IS_TRUE(row.GetUnicodeStorage()._glyphs.empty(), L"No row should have anything stored now.");
+    }
 }
 
 // This tests that columns removed from the buffer while resizing traditionally will also drop the high unicode
@@ -1934,14 +1947,14 @@ void TextBufferTests::ResizeTraditionalHighUnicodeColumnRemoval()
     const auto readBackText = *readBack;
     VERIFY_ARE_EQUAL(String(emoji), String(readBackText.data(), gsl::narrow<int>(readBackText.size())));
 
-    VERIFY_ARE_EQUAL(1u, _buffer->GetUnicodeStorage()._map.size(), L"There should be one item in the map.");
+    VERIFY_ARE_EQUAL(1u, _buffer->_storage[pos.Y].GetUnicodeStorage()._glyphs.size(), L"There should be one item in the row's storage.");
 
     // Perform resize to trim off the column of the buffer that included the emoji
     COORD trimmedBufferSize{ bufferSize.X - 1, bufferSize.Y};
 
     VERIFY_NT_SUCCESS(_buffer->ResizeTraditional(trimmedBufferSize));
 
-    VERIFY_IS_TRUE(_buffer->GetUnicodeStorage()._map.empty(), L"The map should now be empty.");
+    VERIFY_IS_TRUE(_buffer->_storage[pos.Y].GetUnicodeStorage()._glyphs.empty(), L"The row's storage should now be empty.");
 }
 
 void TextBufferTests::TestBurrito()
@@ -1964,3 +1977,294 @@ void TextBufferTests::TestBurrito()
     _buffer->IncrementCursor();
     VERIFY_IS_FALSE(afterBurritoIter);
 }
+
+// This tests that rows only get upgraded from one byte per cell when something
+// other than single width ASCII is written to them, and go back when reset.
+void TextBufferTests::AsciiRowsStayCompact()
+{
+    const COORD bufferSize{ 80, 10 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    auto& asciiRow = _buffer->_storage[0];
+    auto& accentRow = _buffer->_storage[1];
+    auto& wideRow = _buffer->_storage[2];
+
+    asciiRow.WriteCells(OutputCellIterator{ std::wstring_view{ L"hello world" } }, 0, false);
+    VERIFY_IS_TRUE(asciiRow.GetCharRow().IsAscii());
+    VERIFY_ARE_EQUAL(String(L"h"), String(std::wstring{ asciiRow.GetCharRow().GlyphAt(0) }.c_str()));
+    VERIFY_IS_TRUE(asciiRow.GetCharRow().DbcsAttrAt(0).IsSingle());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(11), asciiRow.GetCharRow().MeasureRight());
+
+    // This is e with an acute accent: é
+    accentRow.WriteCells(OutputCellIterator{ std::wstring_view{ L"caf\x00e9" } }, 0, false);
+    VERIFY_IS_FALSE(accentRow.GetCharRow().IsAscii());
+    VERIFY_ARE_EQUAL(String(L"caf\x00e9"), String(accentRow.GetText().substr(0, 4).c_str()));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(0), accentRow.GetCharRow()._asciiData.capacity());
+
+    // This is the hiragana letter a: あ. It takes two columns.
+    wideRow.WriteCells(OutputCellIterator{ std::wstring_view{ L"\x3042" } }, 0, false);
+    VERIFY_IS_FALSE(wideRow.GetCharRow().IsAscii());
+    VERIFY_IS_TRUE(wideRow.GetCharRow().DbcsAttrAt(0).IsLeading());
+    VERIFY_IS_TRUE(wideRow.GetCharRow().DbcsAttrAt(1).IsTrailing());
+
+    // Overwriting with ASCII doesn't go back by itself, but resetting does.
+    accentRow.WriteCells(OutputCellIterator{ std::wstring_view{ L"cafe" } }, 0, false);
+    VERIFY_IS_FALSE(accentRow.GetCharRow().IsAscii());
+    VERIFY_IS_TRUE(accentRow.Reset(attr));
+    VERIFY_IS_TRUE(accentRow.GetCharRow().IsAscii());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(0), accentRow.GetCharRow()._data.capacity());
+    VERIFY_IS_FALSE(accentRow.GetCharRow().ContainsText());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), accentRow.size());
+}
+
+// This tests that the rows that scroll off the top of the circular buffer are
+// kept in the scrollback store, keep their line numbers, and can be copied
+// back out of it together with the rows still in the buffer.
+void TextBufferTests::ScrolledOutRowsGoToScrollback()
+{
+    const COORD bufferSize{ 20, 3 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    _buffer->GetScrollback().SetCapacity(4);
+
+    const auto& scrollback = _buffer->GetScrollback();
+
+    // Scroll ten lines through the buffer, writing each one's number into it.
+    // The store's end line is the number of the buffer's first row.
+    for (int i = 0; i < 10; ++i)
+    {
+        auto& row = _buffer->GetRowByOffset(bufferSize.Y - 1);
+        row.WriteCells(OutputCellIterator{ std::to_wstring(scrollback.EndLine() + bufferSize.Y - 1) }, 0, true);
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    }
+
+    VERIFY_ARE_EQUAL(10ull, scrollback.EndLine());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(4), scrollback.size());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(4), _buffer->GetHistoryRowCount());
+
+    ScrollbackStore::Reader reader{ scrollback };
+    for (auto i = scrollback.FirstLine(); i < scrollback.EndLine(); ++i)
+    {
+        const auto& line = reader.GetLine(i);
+        VERIFY_ARE_EQUAL(String(std::to_wstring(i).c_str()), String(line.text.c_str()));
+        VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), line.columns);
+        VERIFY_IS_FALSE(line.attributes.empty());
+    }
+
+    Log::Comment(L"Copy the history and the buffer after it into another buffer.");
+    const TextAttribute otherAttr{ 0x1f };
+    TextBuffer copy{ { bufferSize.X, 7 }, otherAttr, cursorSize, _renderTarget };
+    _buffer->CopyHistoryRows(0, 7, copy, 0);
+    for (SHORT y = 0; y < 6; ++y)
+    {
+        auto expected = std::to_wstring(y + 6);
+        expected.resize(bufferSize.X, L' ');
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(copy.GetRowByOffset(y).GetText().c_str()));
+        VERIFY_IS_TRUE(attr == copy.GetRowByOffset(y).GetAttrRow().GetAttrByColumn(0));
+    }
+    VERIFY_IS_FALSE(copy.GetRowByOffset(6).GetCharRow().ContainsText());
+
+    VERIFY_THROWS_SPECIFIC(_buffer->CopyHistoryRows(1, 7, copy, 0),
+                           wil::ResultException,
+                           [](wil::ResultException& e) { return e.GetErrorCode() == E_INVALIDARG; });
+}
+
+// This tests that the lines the scrollback store has spilled out to its temp
+// file are read back when the history is copied out of the buffer.
+void TextBufferTests::SpilledScrollbackCopiesBack()
+{
+    const COORD bufferSize{ 10, 3 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // Enough lines that every page but the hot ones goes cold, and keep none
+    // of the cold ones in memory.
+    auto& scrollback = _buffer->GetScrollback();
+    const auto lines = ScrollbackStore::PageSize * (ScrollbackStore::HotPages + 3);
+    scrollback.SetCapacity(lines);
+    scrollback.EnableSpilling(0);
+
+    for (size_t i = 0; i < lines; ++i)
+    {
+        auto& row = _buffer->GetRowByOffset(bufferSize.Y - 1);
+        row.WriteCells(OutputCellIterator{ std::to_wstring(scrollback.EndLine() + bufferSize.Y - 1) }, 0, true);
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    }
+
+    // The cold pages are compressed on the threadpool, and spilled once the
+    // store puts them in place.
+    WaitForThreadpoolWorkCallbacks(scrollback._compactionWork.get(), FALSE);
+    scrollback._FinishCompaction();
+    VERIFY_ARE_EQUAL(static_cast<size_t>(3), scrollback._pages.size() - ScrollbackStore::HotPages);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        VERIFY_IS_TRUE(scrollback._pages.at(i).IsSpilled());
+    }
+
+    Log::Comment(L"Copy rows from across the end of one spilled page and the start of the next.");
+    const SHORT copiedRows = 5;
+    TextBuffer copy{ { bufferSize.X, copiedRows }, attr, cursorSize, _renderTarget };
+    const auto firstRow = ScrollbackStore::PageSize - 2;
+    _buffer->CopyHistoryRows(firstRow, copiedRows, copy, 0);
+    for (SHORT y = 0; y < copiedRows; ++y)
+    {
+        auto expected = std::to_wstring(firstRow + y);
+        expected.resize(bufferSize.X, L' ');
+        VERIFY_ARE_EQUAL(String(expected.c_str()), String(copy.GetRowByOffset(y).GetText().c_str()));
+    }
+}
+
+void TextBufferTests::ResizeWithReflowRewrapsLogicalLines()
+{
+    const COORD bufferSize{ 10, 20 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    // One logical line that wraps over three rows, then a short one.
+    for (const auto wch : std::wstring_view{ L"abcdefghijklmnopqrstuvwxy" })
+    {
+        VERIFY_IS_TRUE(_buffer->InsertCharacter(wch, DbcsAttribute{}, attr));
+    }
+    VERIFY_IS_TRUE(_buffer->NewlineCursor());
+    for (const auto wch : std::wstring_view{ L"hello" })
+    {
+        VERIFY_IS_TRUE(_buffer->InsertCharacter(wch, DbcsAttribute{}, attr));
+    }
+    VERIFY_IS_TRUE(_buffer->GetRowByOffset(1).GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(COORD({ 5, 3 }), _buffer->GetCursor().GetPosition());
+
+    Log::Comment(L"Widening joins the wrapped rows back up.");
+    VERIFY_SUCCEEDED(_buffer->ResizeWithReflow({ 20, 20 }, 0));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(0), _buffer->GetUnreflowedRowCount());
+    VERIFY_ARE_EQUAL(String(L"abcdefghijklmnopqrst"), String(_buffer->GetRowByOffset(0).GetText().c_str()));
+    VERIFY_IS_TRUE(_buffer->GetRowByOffset(0).GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(String(L"uvwxy               "), String(_buffer->GetRowByOffset(1).GetText().c_str()));
+    VERIFY_IS_FALSE(_buffer->GetRowByOffset(1).GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(String(L"hello               "), String(_buffer->GetRowByOffset(2).GetText().c_str()));
+    VERIFY_ARE_EQUAL(COORD({ 5, 2 }), _buffer->GetCursor().GetPosition());
+
+    Log::Comment(L"Narrowing splits it up again, at the new width.");
+    VERIFY_SUCCEEDED(_buffer->ResizeWithReflow({ 7, 20 }, 0));
+    VERIFY_ARE_EQUAL(String(L"abcdefg"), String(_buffer->GetRowByOffset(0).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"hijklmn"), String(_buffer->GetRowByOffset(1).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"opqrstu"), String(_buffer->GetRowByOffset(2).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"vwxy   "), String(_buffer->GetRowByOffset(3).GetText().c_str()));
+    VERIFY_IS_FALSE(_buffer->GetRowByOffset(3).GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(String(L"hello  "), String(_buffer->GetRowByOffset(4).GetText().c_str()));
+    VERIFY_ARE_EQUAL(COORD({ 5, 4 }), _buffer->GetCursor().GetPosition());
+    VERIFY_ARE_EQUAL(bufferSize.Y, _buffer->GetSize().Height());
+}
+
+void TextBufferTests::ResizeWithReflowDefersHistory()
+{
+    const COORD bufferSize{ 10, 400 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+    _buffer->GetScrollback().SetCapacity(1000);
+
+    for (int i = 0; i < 300; ++i)
+    {
+        for (const auto wch : L"line " + std::to_wstring(i))
+        {
+            VERIFY_IS_TRUE(_buffer->InsertCharacter(wch, DbcsAttribute{}, attr));
+        }
+        VERIFY_IS_TRUE(_buffer->NewlineCursor());
+    }
+
+    Log::Comment(L"Only the lines from a margin above the viewport down are reflowed.");
+    VERIFY_SUCCEEDED(_buffer->ResizeWithReflow({ 5, 400 }, 290));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(190), _buffer->GetUnreflowedRowCount());
+    VERIFY_ARE_EQUAL(String(L"line "), String(_buffer->GetRowByOffset(0).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"190  "), String(_buffer->GetRowByOffset(1).GetText().c_str()));
+    VERIFY_ARE_EQUAL(COORD({ 0, 220 }), _buffer->GetCursor().GetPosition());
+
+    Log::Comment(L"Reflowing some history puts it back at the top.");
+    VERIFY_ARE_EQUAL(static_cast<SHORT>(10), _buffer->ReflowHistory(10, 220));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(185), _buffer->GetUnreflowedRowCount());
+    VERIFY_ARE_EQUAL(String(L"185  "), String(_buffer->GetRowByOffset(1).GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"190  "), String(_buffer->GetRowByOffset(11).GetText().c_str()));
+    VERIFY_ARE_EQUAL(COORD({ 0, 230 }), _buffer->GetCursor().GetPosition());
+
+    Log::Comment(L"What doesn't fit in the buffer anymore stays set aside.");
+    VERIFY_ARE_EQUAL(static_cast<SHORT>(168), _buffer->ReflowHistory(SHRT_MAX, 230));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(101), _buffer->GetUnreflowedRowCount());
+    VERIFY_ARE_EQUAL(String(L"101  "), String(_buffer->GetRowByOffset(1).GetText().c_str()));
+    VERIFY_ARE_EQUAL(COORD({ 0, 398 }), _buffer->GetCursor().GetPosition());
+
+    const auto& scrollback = _buffer->GetScrollback();
+    VERIFY_IS_TRUE(scrollback.empty());
+
+    Log::Comment(L"Rows scrolling out of the buffer go after the set aside ones, and push the oldest of them into the scrollback.");
+    for (int i = 0; i < 3; ++i)
+    {
+        VERIFY_IS_TRUE(_buffer->IncrementCircularBuffer());
+    }
+    VERIFY_ARE_EQUAL(static_cast<size_t>(101), _buffer->GetUnreflowedRowCount());
+    VERIFY_ARE_EQUAL(String(L"line 3    "), String(_buffer->_unreflowedRows.front().GetText().c_str()));
+    VERIFY_ARE_EQUAL(String(L"line "), String(_buffer->_unreflowedRows.back().GetText().c_str()));
+    VERIFY_IS_TRUE(_buffer->_unreflowedRows.back().GetCharRow().WasWrapForced());
+    VERIFY_ARE_EQUAL(static_cast<size_t>(5), _buffer->GetRowByOffset(bufferSize.Y - 1).size());
+    VERIFY_IS_FALSE(_buffer->GetRowByOffset(bufferSize.Y - 1).GetCharRow().ContainsText());
+
+    VERIFY_ARE_EQUAL(static_cast<size_t>(3), scrollback.size());
+    ScrollbackStore::Reader reader{ scrollback };
+    VERIFY_ARE_EQUAL(String(L"line 2"), String(reader.GetLine(scrollback.EndLine() - 1).text.c_str()));
+    const auto& oldest = reader.GetLine(scrollback.FirstLine());
+    VERIFY_ARE_EQUAL(String(L"line 0"), String(oldest.text.c_str()));
+    VERIFY_ARE_EQUAL(static_cast<size_t>(bufferSize.X), oldest.columns);
+}
+
+// This tests that a buffer where every cell has an RGB color of its own, more
+// of them than fit in a 16-bit ID, keeps the colors of every cell, and that the
+// attributes the cells stop using are released again.
+void TextBufferTests::KeepsColorsOfMoreAttributesThanFitIn16Bits()
+{
+    const COORD bufferSize{ 256, 300 };
+    const UINT cursorSize = 12;
+    const TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, _renderTarget);
+
+    const auto cellAttr = [](const SHORT x, const SHORT y, const BYTE pass) {
+        return TextAttribute{ RGB(x, y & 0xff, y >> 8), RGB(pass, 0, 0) };
+    };
+
+    std::vector<OutputCell> cells;
+    for (BYTE pass = 0; pass < 2; pass++)
+    {
+        for (SHORT y = 0; y < bufferSize.Y; y++)
+        {
+            cells.clear();
+            for (SHORT x = 0; x < bufferSize.X; x++)
+            {
+                cells.emplace_back(std::wstring_view{ L"x" }, DbcsAttribute{}, cellAttr(x, y, pass));
+            }
+            _buffer->WriteLine(OutputCellIterator{ std::basic_string_view<OutputCell>{ cells.data(), cells.size() } }, { 0, y });
+        }
+
+        Log::Comment(NoThrowString().Format(L"Pass %d: every cell has the color it was written with.", pass));
+        for (SHORT y = 0; y < bufferSize.Y; y++)
+        {
+            const auto& attrRow = _buffer->GetRowByOffset(y).GetAttrRow();
+            for (SHORT x = 0; x < bufferSize.X; x++)
+            {
+                if (attrRow.GetAttrByColumn(x) != cellAttr(x, y, pass))
+                {
+                    VERIFY_FAIL(NoThrowString().Format(L"Wrong color at (%d, %d)", x, y));
+                }
+            }
+        }
+
+        const size_t cellCount = bufferSize.X * bufferSize.Y;
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(_buffer->GetAttributeTable().Size(), cellCount);
+        VERIFY_IS_LESS_THAN_OR_EQUAL(_buffer->GetAttributeTable().Size(), _buffer->_attributeSweepSize);
+    }
+
+    Log::Comment(L"The attributes of the first pass were released, rather than piling up.");
+    VERIFY_IS_LESS_THAN(_buffer->GetAttributeTable().Size(), static_cast<size_t>(bufferSize.X * bufferSize.Y * 2));
+}
@@ -31,15 +31,14 @@ class Utf8ToWideCharParserTests
         const unsigned char wideHello[10] = { 0x48, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x6c, 0x00, 0x6f, 0x00 };
         unsigned int count = 5;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
 
-        VERIFY_SUCCEEDED(parser.Parse(hello, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(hello, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)5);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)5);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)5);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for (int i = 0; i < ARRAYSIZE(wideHello); ++i)
         {
             VERIFY_ARE_EQUAL(wideHello[i], pReturnedBytes[i]);
@@ -55,15 +54,14 @@ class Utf8ToWideCharParserTests
         const unsigned char wideSushi[4] = { 0x59, 0x30, 0x57, 0x30 };
         unsigned int count = 6;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
 
-        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)6);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)2);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)2);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for (int i = 0; i < ARRAYSIZE(wideSushi); ++i)
         {
             VERIFY_ARE_EQUAL(wideSushi[i], pReturnedBytes[i]);
@@ -79,24 +77,23 @@ class Utf8ToWideCharParserTests
         auto parser = Utf8ToWideCharParser { utf8CodePage };
         unsigned int count = 1;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
 
         for (int i = 0; i < 2; ++i)
         {
-            VERIFY_SUCCEEDED(parser.Parse(shi + i, count, consumed, output, generated));
+            VERIFY_SUCCEEDED(parser.Parse(shi + i, count, consumed, output));
             VERIFY_ARE_EQUAL(consumed, (unsigned int)1);
-            VERIFY_ARE_EQUAL(generated, (unsigned int)0);
-            VERIFY_ARE_EQUAL(output.get(), nullptr);
+            VERIFY_ARE_EQUAL(output.size(), (size_t)0);
+            VERIFY_IS_TRUE(output.empty());
             count = 1;
         }
 
-        VERIFY_SUCCEEDED(parser.Parse(shi + 2, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(shi + 2, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)1);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)1);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)1);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for (int i = 0; i < ARRAYSIZE(wideShi); ++i)
         {
             VERIFY_ARE_EQUAL(wideShi[i], pReturnedBytes[i]);
@@ -111,17 +108,16 @@ class Utf8ToWideCharParserTests
         const unsigned char wideSushi[4] = { 0x59, 0x30, 0x57, 0x30 };
         unsigned int count = 4;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
         auto parser = Utf8ToWideCharParser { utf8CodePage };
 
-        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output));
         // check that we got the first wide char back
         VERIFY_ARE_EQUAL(consumed, (unsigned int)4);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)1);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)1);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for (int i = 0; i < 2; ++i)
         {
             VERIFY_ARE_EQUAL(wideSushi[i], pReturnedBytes[i]);
@@ -130,24 +126,20 @@ class Utf8ToWideCharParserTests
         // add byte 2 of 3 to parser
         count = 1;
         consumed = 0;
-        generated = 0;
-        output.reset(nullptr);
-        VERIFY_SUCCEEDED(parser.Parse(sushi + 4, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(sushi + 4, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)1);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)0);
-        VERIFY_ARE_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)0);
+        VERIFY_IS_TRUE(output.empty());
 
         // add last byte
         count = 1;
         consumed = 0;
-        generated = 0;
-        output.reset(nullptr);
-        VERIFY_SUCCEEDED(parser.Parse(sushi + 5, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(sushi + 5, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)1);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)1);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)1);
+        VERIFY_IS_FALSE(output.empty());
 
-        pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for (int i = 0; i < 2; ++i)
         {
             VERIFY_ARE_EQUAL(wideSushi[i + 2], pReturnedBytes[i]);
@@ -181,16 +173,15 @@ class Utf8ToWideCharParserTests
         // send first 4 bytes
         unsigned int count = 4;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
         auto parser = Utf8ToWideCharParser { utf8CodePage };
 
-        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)4);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)1);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)1);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for(int i = 0; i < 2; ++i)
         {
             VERIFY_ARE_EQUAL(wideDoomoArigatoo[i], pReturnedBytes[i]);
@@ -199,14 +190,12 @@ class Utf8ToWideCharParserTests
         // send next 16 bytes
         count = 16;
         consumed = 0;
-        generated = 0;
-        output.reset(nullptr);
-        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo + 4, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo + 4, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)16);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)5);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)5);
+        VERIFY_IS_FALSE(output.empty());
 
-        pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for(int i = 0; i < 10; ++i)
         {
             VERIFY_ARE_EQUAL(wideDoomoArigatoo[i + 2], pReturnedBytes[i]);
@@ -215,14 +204,12 @@ class Utf8ToWideCharParserTests
         // send last 4 bytes
         count = 4;
         consumed = 0;
-        generated = 0;
-        output.reset(nullptr);
-        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo + 20, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(doomoArigatoo + 20, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)4);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)2);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)2);
+        VERIFY_IS_FALSE(output.empty());
 
-        pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for(int i = 0; i < 4; ++i)
         {
             VERIFY_ARE_EQUAL(wideDoomoArigatoo[i + 12], pReturnedBytes[i]);
@@ -241,16 +228,15 @@ class Utf8ToWideCharParserTests
         const unsigned char wideSushi[4] = { 0x59, 0x30, 0x57, 0x30 };
         unsigned int count = 9;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
+        std::wstring_view output;
         auto parser = Utf8ToWideCharParser { utf8CodePage };
 
-        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output, generated));
+        VERIFY_SUCCEEDED(parser.Parse(sushi, count, consumed, output));
         VERIFY_ARE_EQUAL(consumed, (unsigned int)9);
-        VERIFY_ARE_EQUAL(generated, (unsigned int)2);
-        VERIFY_ARE_NOT_EQUAL(output.get(), nullptr);
+        VERIFY_ARE_EQUAL(output.size(), (size_t)2);
+        VERIFY_IS_FALSE(output.empty());
 
-        unsigned char* pReturnedBytes = reinterpret_cast<unsigned char*>(output.get());
+        const unsigned char* pReturnedBytes = reinterpret_cast<const unsigned char*>(output.data());
         for(int i = 0; i < ARRAYSIZE(wideSushi); ++i)
         {
             VERIFY_ARE_EQUAL(wideSushi[i], pReturnedBytes[i]);
@@ -261,27 +247,115 @@ class Utf8ToWideCharParserTests
     {
         Log::Comment(L"Testing that a saved partial sequence is cleared when the codepage changes");
         auto parser = Utf8ToWideCharParser { utf8CodePage };
-        // 2 bytes of a 4 byte sequence
+        // 2 bytes of a 4 byte sequence (U+1F600)
         const unsigned int inputSize = 2;
-        const unsigned char partialSequence[inputSize] = { 0xF0, 0x80 };
+        const unsigned char partialSequence[inputSize] = { 0xF0, 0x9F };
         unsigned int count = inputSize;
         unsigned int consumed = 0;
-        unsigned int generated = 0;
-        unique_ptr<wchar_t[]> output { nullptr };
-        VERIFY_SUCCEEDED(parser.Parse(partialSequence, count, consumed, output, generated));
-        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::BeginPartialParse);
+        std::wstring_view output;
+        VERIFY_SUCCEEDED(parser.Parse(partialSequence, count, consumed, output));
+        VERIFY_IS_TRUE(output.empty());
         VERIFY_ARE_EQUAL(parser._bytesStored, inputSize);
         // set the codepage to the same one it currently is, ensure
         // that nothing changes
         parser.SetCodePage(utf8CodePage);
-        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::BeginPartialParse);
         VERIFY_ARE_EQUAL(parser._bytesStored, inputSize);
         // change to a different codepage, ensure parser is reset
         parser.SetCodePage(USACodePage);
-        VERIFY_ARE_EQUAL(parser._currentState, Utf8ToWideCharParser::_State::Ready);
         VERIFY_ARE_EQUAL(parser._bytesStored, (unsigned int)0);
     }
 
+    TEST_METHOD(RemovesOverlongAndOutOfRangeSequencesTest)
+    {
+        Log::Comment(L"Testing that sequences which are well formed but don't encode a valid code point are removed");
+        const unsigned char input[] = {
+            'a',
+            0xC0, 0xAF,             // overlong '/'
+            0xE0, 0x80, 0xAF,       // overlong '/'
+            0xED, 0xA0, 0x80,       // U+D800, a surrogate
+            0xF4, 0x90, 0x80, 0x80, // U+110000, past the end of Unicode
+            0xF5, 0x80, 0x80, 0x80, // a lead byte that can't start anything
+            'b'
+        };
+        unsigned int consumed = 0;
+        std::wstring_view output;
+        auto parser = Utf8ToWideCharParser { utf8CodePage };
+
+        VERIFY_SUCCEEDED(parser.Parse(input, (unsigned int)ARRAYSIZE(input), consumed, output));
+        VERIFY_ARE_EQUAL(consumed, (unsigned int)ARRAYSIZE(input));
+        VERIFY_ARE_EQUAL(std::wstring(L"ab"), std::wstring(output));
+    }
+
+    TEST_METHOD(ConvertsSurrogatePairSplitAtEveryByteTest)
+    {
+        Log::Comment(L"Testing that a four byte sequence becomes a surrogate pair, no matter how it's split");
+        // U+1F600, between two ASCII chars
+        const unsigned char input[6] = { 'a', 0xF0, 0x9F, 0x98, 0x80, 'b' };
+
+        for (unsigned int split = 1; split < ARRAYSIZE(input); ++split)
+        {
+            auto parser = Utf8ToWideCharParser { utf8CodePage };
+            unsigned int consumed = 0;
+            std::wstring_view output;
+            std::wstring result;
+
+            VERIFY_SUCCEEDED(parser.Parse(input, split, consumed, output));
+            VERIFY_ARE_EQUAL(consumed, split);
+            result.append(output);
+
+            VERIFY_SUCCEEDED(parser.Parse(input + split, (unsigned int)ARRAYSIZE(input) - split, consumed, output));
+            VERIFY_ARE_EQUAL(consumed, (unsigned int)ARRAYSIZE(input) - split);
+            result.append(output);
+
+            VERIFY_ARE_EQUAL(std::wstring(L"a\xD83D\xDE00" L"b"), result, NoThrowString().Format(L"Split at %u", split));
+        }
+    }
+
+    TEST_METHOD(ConvertsLongAsciiRunsTest)
+    {
+        Log::Comment(L"Testing that runs of ASCII of every length around the vector width convert correctly, with and without a non-ASCII char after them");
+        auto parser = Utf8ToWideCharParser { utf8CodePage };
+        for (unsigned int length = 1; length < 70; ++length)
+        {
+            std::string input;
+            std::wstring expected;
+            for (unsigned int i = 0; i < length; ++i)
+            {
+                input.push_back(static_cast<char>(' ' + (i % 95)));
+                expected.push_back(static_cast<wchar_t>(' ' + (i % 95)));
+            }
+            unsigned int consumed = 0;
+            std::wstring_view output;
+
+            VERIFY_SUCCEEDED(parser.Parse(reinterpret_cast<const byte*>(input.data()), length, consumed, output));
+            VERIFY_ARE_EQUAL(expected, std::wstring(output));
+
+            // U+00E9
+            input.append("\xC3\xA9");
+            expected.push_back(L'\xE9');
+            VERIFY_SUCCEEDED(parser.Parse(reinterpret_cast<const byte*>(input.data()), length + 2, consumed, output));
+            VERIFY_ARE_EQUAL(expected, std::wstring(output));
+        }
+    }
+
+    TEST_METHOD(ReusesOutputBufferTest)
+    {
+        Log::Comment(L"Testing that the parser keeps converting into the same buffer once it's big enough");
+        const unsigned char hello[5] = { 0x48, 0x65, 0x6c, 0x6c, 0x6f };
+        unsigned int consumed = 0;
+        std::wstring_view output;
+        auto parser = Utf8ToWideCharParser { utf8CodePage };
+
+        VERIFY_SUCCEEDED(parser.Parse(hello, 5, consumed, output));
+        const wchar_t* const firstBuffer = output.data();
+        for (unsigned int count = 1; count <= 5; ++count)
+        {
+            VERIFY_SUCCEEDED(parser.Parse(hello, count, consumed, output));
+            VERIFY_ARE_EQUAL(reinterpret_cast<uintptr_t>(firstBuffer), reinterpret_cast<uintptr_t>(output.data()));
+            VERIFY_ARE_EQUAL((size_t)count, output.size());
+        }
+    }
+
     TEST_METHOD(_IsLeadByteTest)
     {
         Log::Comment(L"Testing that _IsLeadByte properly differentiates correct from incorrect sequences");
@@ -11,6 +11,9 @@
 #include "../../renderer/vt/WinTelnetEngine.hpp"
 #include "../Settings.hpp"
 
+#include <atomic>
+#include <thread>
+
 using namespace WEX::Common;
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
@@ -109,7 +112,20 @@ class Microsoft::Console::Render::VtRendererTest
 
     TEST_METHOD(TestResize);
 
+    TEST_METHOD(TestInvalidateRows);
+
+    TEST_METHOD(TestFrameDiffing);
+
+    TEST_METHOD(TestPipeWriter);
+
+    TEST_METHOD(TestHoldingFramesWhileWriterIsBehind);
+
+    TEST_METHOD(TestPipeWriterLimitsPending);
+
+    TEST_METHOD(TestCirclingWhileWriterIsBehind);
+
     void Test16Colors(VtEngine* engine);
+    size_t StallPipeWriter(VtPipeWriter& writer);
 
     std::deque<std::string> qExpectedInput;
     bool WriteCallback(const char* const pch, size_t const cch);
@@ -247,6 +263,24 @@ void VtRendererTest::VtSequenceHelperTests()
 
     qExpectedInput.push_back("\x1b[10C");
     VERIFY_SUCCEEDED(engine->_CursorForward(10));
+
+    qExpectedInput.push_back("\x1b[100;300H");
+    VERIFY_SUCCEEDED(engine->_CursorPosition({ 299, 99 }));
+
+    qExpectedInput.push_back("\x1b[32767C");
+    VERIFY_SUCCEEDED(engine->_CursorForward(32767));
+
+    qExpectedInput.push_back("\x1b[38;2;255;0;9m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRenditionRGBColor(RGB(255, 0, 9), true));
+
+    qExpectedInput.push_back("\x1b[48;2;10;100;0m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRenditionRGBColor(RGB(10, 100, 0), false));
+
+    qExpectedInput.push_back("\x1b[97m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRendition16Color(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY, true));
+
+    qExpectedInput.push_back("\x1b[41m");
+    VERIFY_SUCCEEDED(engine->_SetGraphicsRendition16Color(FOREGROUND_RED, false));
 }
 
 void VtRendererTest::Xterm256TestInvalidate()
@@ -1338,3 +1372,416 @@ void VtRendererTest::TestResize()
 
 
 }
+
+void VtRendererTest::TestInvalidateRows()
+{
+    Viewport view = SetUpViewport();
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, view, g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that invalidating the top and bottom rows doesn't make the rows in between dirty"
+    ));
+    SMALL_RECT top = {1, 0, 3, 1};
+    SMALL_RECT bottom = {5, 31, 8, 32};
+    VERIFY_SUCCEEDED(engine->Invalidate(&top));
+    VERIFY_SUCCEEDED(engine->Invalidate(&bottom));
+    TestPaint(*engine, [&]()
+    {
+        // The bounding rect still covers both.
+        VERIFY_ARE_EQUAL((SMALL_RECT{1, 0, 8, 32}), engine->_invalidRect.ToExclusive());
+
+        const auto dirty = engine->GetDirtyArea();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(2), dirty.size());
+        VERIFY_ARE_EQUAL(Viewport::FromExclusive(top).ToInclusive(), dirty.at(0));
+        VERIFY_ARE_EQUAL(Viewport::FromExclusive(bottom).ToInclusive(), dirty.at(1));
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that rows dirty in the same columns are combined"
+    ));
+    SMALL_RECT block = {0, 2, 4, 4};
+    VERIFY_SUCCEEDED(engine->Invalidate(&block));
+    TestPaint(*engine, [&]()
+    {
+        const auto dirty = engine->GetDirtyArea();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), dirty.size());
+        VERIFY_ARE_EQUAL(Viewport::FromExclusive(block).ToInclusive(), dirty.at(0));
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that offsetting the invalid area moves each row, and keeps what was left behind"
+    ));
+    SMALL_RECT moved = {2, 5, 4, 6};
+    VERIFY_SUCCEEDED(engine->Invalidate(&moved));
+    COORD offset = {1, 1};
+    VERIFY_SUCCEEDED(engine->_InvalidOffset(&offset));
+    TestPaint(*engine, [&]()
+    {
+        const auto dirty = engine->GetDirtyArea();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(2), dirty.size());
+        VERIFY_ARE_EQUAL((SMALL_RECT{2, 5, 3, 5}), dirty.at(0));
+        VERIFY_ARE_EQUAL((SMALL_RECT{3, 6, 4, 6}), dirty.at(1));
+    });
+
+    Log::Comment(NoThrowString().Format(
+        L"Make sure that when the whole viewport gets cleared, every row gets repainted"
+    ));
+    COORD scrollDelta = {0, 1};
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&scrollDelta));
+    scrollDelta = {0, -1};
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&scrollDelta));
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]()
+    {
+        const auto dirty = engine->GetDirtyArea();
+        VERIFY_ARE_EQUAL(static_cast<size_t>(1), dirty.size());
+        VERIFY_ARE_EQUAL(view.ToInclusive(), dirty.at(0));
+    });
+}
+
+void VtRendererTest::TestFrameDiffing()
+{
+    wil::unique_hfile hFile = wil::unique_hfile(INVALID_HANDLE_VALUE);
+    auto engine = std::make_unique<Xterm256Engine>(std::move(hFile), p, SetUpViewport(), g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE));
+    auto pfn = std::bind(&VtRendererTest::WriteCallback, this, std::placeholders::_1, std::placeholders::_2);
+    engine->SetTestCallback(pfn);
+    engine->SetFrameDiffing(true);
+
+    // Verify the first paint emits a clear and go home
+    qExpectedInput.push_back("\x1b[2J");
+    TestPaint(*engine, [&]() {
+        VERIFY_IS_FALSE(engine->_firstPaint);
+    });
+
+    // Keep the strings alive for as long as the clusters pointing into them.
+    std::vector<std::wstring> lines;
+    lines.reserve(4);
+    auto makeClusters = [&](const std::wstring_view text) {
+        lines.emplace_back(text);
+        const auto& line = lines.back();
+        std::vector<Cluster> clusters;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            clusters.emplace_back(std::wstring_view{ &line.at(i), 1 }, static_cast<size_t>(1));
+        }
+        return clusters;
+    };
+
+    // Invalidate the line before each frame, so that the frame isn't skipped.
+    auto invalidateLine = [&](const short y) {
+        SMALL_RECT line = { 0, y, 10, static_cast<SHORT>(y + 1) };
+        VERIFY_SUCCEEDED(engine->Invalidate(&line));
+    };
+
+    auto paintLine = [&](const std::vector<Cluster>& clusters, const short y) {
+        Log::Comment(L"Make sure the cursor is at 0,0");
+        if (engine->_lastText.X != 0 || engine->_lastText.Y != 0)
+        {
+            qExpectedInput.push_back("\x1b[H");
+        }
+        VERIFY_SUCCEEDED(engine->_MoveCursor({ 0, 0 }));
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ clusters.data(), clusters.size() }, { 0, y }, false));
+    };
+
+    const auto original = makeClusters(L"abcdefghij");
+    const auto oneChange = makeClusters(L"abcdeXghij");
+    const auto farChanges = makeClusters(L"aXcdeXghiY");
+    const auto nearChanges = makeClusters(L"aZcZeXghiY");
+
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(L"The first time a line is painted, all of it is written.");
+        qExpectedInput.push_back("abcdefghij");
+        paintLine(original, 0);
+    });
+
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(L"Painting the same line again writes nothing.");
+        paintLine(original, 0);
+    });
+
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(L"Only the changed cell is written, after moving the cursor over the rest.");
+        qExpectedInput.push_back("\x1b[5C");
+        qExpectedInput.push_back("X");
+        paintLine(oneChange, 0);
+    });
+
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(L"Changes far apart are written separately.");
+        qExpectedInput.push_back("\x1b[1C");
+        qExpectedInput.push_back("X");
+        qExpectedInput.push_back("\x1b[7C");
+        qExpectedInput.push_back("Y");
+        paintLine(farChanges, 0);
+    });
+
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        Log::Comment(L"Changes close together are written with the unchanged text between them.");
+        qExpectedInput.push_back("\x1b[1C");
+        qExpectedInput.push_back("ZcZ");
+        paintLine(nearChanges, 0);
+    });
+
+    Log::Comment(L"Scroll the contents down a row.");
+    COORD scrollDelta = { 0, 1 };
+    VERIFY_SUCCEEDED(engine->InvalidateScroll(&scrollDelta));
+    TestPaintXterm(*engine, [&]()
+    {
+        qExpectedInput.push_back("\x1b[H");
+        qExpectedInput.push_back("\x1b[L");
+        VERIFY_SUCCEEDED(engine->ScrollFrame());
+
+        Log::Comment(L"The line moved along with the scroll, and doesn't need to be written again.");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ nearChanges.data(), nearChanges.size() }, { 0, 1 }, false));
+
+        Log::Comment(L"The new line at the top isn't known, so all of it is written.");
+        qExpectedInput.push_back("abcdefghij");
+        VERIFY_SUCCEEDED(engine->PaintBufferLine({ original.data(), original.size() }, { 0, 0 }, false));
+    });
+
+    Log::Comment(L"Once we've lost track of the terminal's contents, everything is written again.");
+    engine->_InvalidateShadow();
+    invalidateLine(0);
+    TestPaintXterm(*engine, [&]()
+    {
+        qExpectedInput.push_back("aZcZeXghiY");
+        paintLine(nearChanges, 0);
+    });
+}
+
+void VtRendererTest::TestPipeWriter()
+{
+    wil::unique_hfile readPipe;
+    wil::unique_hfile writePipe;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+    VtPipeWriter writer{ std::move(writePipe) };
+    bool repainted = false;
+    writer.SetRepaintCallback([&]() { repainted = true; });
+    VERIFY_SUCCEEDED(writer.Start());
+
+    Log::Comment(L"Everything submitted is written to the pipe, in order.");
+    std::string buffer = "abc";
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+    VERIFY_IS_TRUE(buffer.empty());
+    buffer = "def";
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+    VERIFY_SUCCEEDED(writer.WaitForDrain());
+
+    char read[6]{};
+    DWORD dwRead = 0;
+    VERIFY_WIN32_BOOL_SUCCEEDED(ReadFile(readPipe.get(), read, ARRAYSIZE(read), &dwRead, nullptr));
+    VERIFY_ARE_EQUAL(static_cast<DWORD>(6), dwRead);
+    VERIFY_ARE_EQUAL(std::string("abcdef"), std::string(read, dwRead));
+
+    Log::Comment(L"Once the writer has caught up, frames aren't held back.");
+    VERIFY_IS_FALSE(writer.HoldFrameIfBehind());
+    VERIFY_IS_FALSE(repainted);
+
+    auto counters = writer.GetCounters();
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(6), counters.bytesWritten);
+    VERIFY_ARE_EQUAL(static_cast<size_t>(0), counters.bytesQueued);
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(0), counters.framesHeldBack);
+
+    Log::Comment(L"When the terminal goes away, the failed write is reported.");
+    readPipe.reset();
+    buffer = "ghi";
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+    VERIFY_FAILED(writer.WaitForDrain());
+    VERIFY_FAILED(writer.GetResult());
+    buffer = "jkl";
+    VERIFY_FAILED(writer.Submit(buffer));
+}
+
+// Function Description:
+// - Gets the writer stuck on a write that's bigger than the pipe, which it
+//      can't finish until someone reads the other end.
+// Arguments:
+// - writer: the writer to stall
+// Return Value:
+// - how many bytes the stuck write is
+size_t VtRendererTest::StallPipeWriter(VtPipeWriter& writer)
+{
+    std::string buffer(64 * 1024, 'a');
+    const size_t stuck = buffer.size();
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> guard{ writer._lock };
+            if (writer._isWriting)
+            {
+                break;
+            }
+        }
+        Sleep(1);
+    }
+    return stuck;
+}
+
+void VtRendererTest::TestHoldingFramesWhileWriterIsBehind()
+{
+    wil::unique_hfile readPipe;
+    wil::unique_hfile writePipe;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+    std::unique_ptr<XtermEngine> engine = std::make_unique<XtermEngine>(std::move(writePipe), p, SetUpViewport(), g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE), false);
+    VtPipeWriter& writer = *engine->_pipeWriter;
+    wil::unique_event repainted;
+    repainted.create(wil::EventOptions::ManualReset);
+    engine->SetRepaintCallback([&]() { repainted.SetEvent(); });
+
+    Log::Comment(L"Get the writer stuck, with another frame queued up behind it.");
+    const size_t stuck = StallPipeWriter(writer);
+    std::string buffer = "b";
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+
+    Log::Comment(L"While the writer is behind, frames are held back, and what they'd have painted stays invalid.");
+    VERIFY_IS_TRUE(writer.HoldFrameIfBehind());
+    VERIFY_SUCCEEDED(engine->InvalidateAll());
+    VERIFY_ARE_EQUAL(S_FALSE, engine->StartPaint());
+    VERIFY_IS_TRUE(engine->_frameHeldBack);
+    VERIFY_IS_TRUE(engine->_fInvalidRectUsed);
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(2), writer.GetCounters().framesHeldBack);
+    VERIFY_IS_FALSE(repainted.is_signaled());
+
+    Log::Comment(L"Once the terminal reads, the writer catches up, and asks for the held frame to be repainted.");
+    std::thread reader([&]() {
+        char read[4096];
+        DWORD dwRead = 0;
+        while (ReadFile(readPipe.get(), read, ARRAYSIZE(read), &dwRead, nullptr))
+        {
+        }
+    });
+    VERIFY_IS_TRUE(repainted.wait(5000));
+
+    auto counters = writer.GetCounters();
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(stuck + 1), counters.bytesWritten);
+    VERIFY_ARE_EQUAL(static_cast<size_t>(0), counters.bytesQueued);
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(2), counters.framesHeldBack);
+
+    Log::Comment(L"The repaint paints what the held frame skipped.");
+    VERIFY_IS_FALSE(writer.HoldFrameIfBehind());
+    VERIFY_ARE_EQUAL(S_OK, engine->StartPaint());
+    VERIFY_IS_FALSE(engine->_frameHeldBack);
+    VERIFY_SUCCEEDED(engine->EndPaint());
+    VERIFY_IS_FALSE(engine->_fInvalidRectUsed);
+    VERIFY_SUCCEEDED(writer.WaitForDrain());
+
+    counters = writer.GetCounters();
+    VERIFY_IS_GREATER_THAN(counters.bytesWritten, static_cast<uint64_t>(stuck + 1));
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(2), counters.framesHeldBack);
+
+    Log::Comment(L"Once the engine is gone, the pipe is closed, and the reader stops.");
+    engine.reset();
+    reader.join();
+}
+
+void VtRendererTest::TestPipeWriterLimitsPending()
+{
+    wil::unique_hfile readPipe;
+    wil::unique_hfile writePipe;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+    auto writer = std::make_unique<VtPipeWriter>(std::move(writePipe));
+    VERIFY_SUCCEEDED(writer->Start());
+
+    Log::Comment(L"Get the writer stuck, with as much queued up behind it as it allows.");
+    const size_t stuck = StallPipeWriter(*writer);
+    std::string buffer(VtPipeWriter::s_MaxPendingBytes, 'b');
+    VERIFY_SUCCEEDED(writer->Submit(buffer));
+
+    Log::Comment(L"Anything more has to wait until the writer takes what's queued.");
+    std::atomic<bool> submitted{ false };
+    HRESULT hrSubmit = E_FAIL;
+    std::thread submitter([&]() {
+        std::string more = "c";
+        hrSubmit = writer->Submit(more);
+        submitted = true;
+    });
+    Sleep(100);
+    VERIFY_IS_FALSE(submitted.load());
+    VERIFY_ARE_EQUAL(stuck + VtPipeWriter::s_MaxPendingBytes, writer->GetCounters().bytesQueued);
+
+    Log::Comment(L"Once the terminal reads, it goes through, and nothing piled up any further.");
+    std::thread reader([&]() {
+        char read[4096];
+        DWORD dwRead = 0;
+        while (ReadFile(readPipe.get(), read, ARRAYSIZE(read), &dwRead, nullptr))
+        {
+        }
+    });
+    submitter.join();
+    VERIFY_IS_TRUE(submitted.load());
+    VERIFY_SUCCEEDED(hrSubmit);
+    VERIFY_SUCCEEDED(writer->WaitForDrain());
+
+    auto counters = writer->GetCounters();
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(stuck + VtPipeWriter::s_MaxPendingBytes + 1), counters.bytesWritten);
+    VERIFY_ARE_EQUAL(stuck + VtPipeWriter::s_MaxPendingBytes, counters.maxBytesQueued);
+
+    Log::Comment(L"Once the writer is gone, the pipe is closed, and the reader stops.");
+    writer.reset();
+    reader.join();
+}
+
+void VtRendererTest::TestCirclingWhileWriterIsBehind()
+{
+    wil::unique_hfile readPipe;
+    wil::unique_hfile writePipe;
+    VERIFY_WIN32_BOOL_SUCCEEDED(CreatePipe(&readPipe, &writePipe, nullptr, 0));
+
+    std::unique_ptr<XtermEngine> engine = std::make_unique<XtermEngine>(std::move(writePipe), p, SetUpViewport(), g_ColorTable, static_cast<WORD>(COLOR_TABLE_SIZE), false);
+    VtPipeWriter& writer = *engine->_pipeWriter;
+
+    Log::Comment(L"Get the writer stuck on a write that's bigger than the pipe, with more queued up behind it.");
+    const size_t stuck = StallPipeWriter(writer);
+    std::string buffer = "b";
+    VERIFY_SUCCEEDED(writer.Submit(buffer));
+
+    Log::Comment(L"The terminal only gets around to reading once we're already painting.");
+    std::thread reader([&]() {
+        Sleep(100);
+        char read[4096];
+        DWORD dwRead = 0;
+        while (ReadFile(readPipe.get(), read, ARRAYSIZE(read), &dwRead, nullptr))
+        {
+        }
+    });
+
+    Log::Comment(L"The frame for circling the buffer is painted anyway, once the writer has caught up.");
+    bool forcePaint = false;
+    VERIFY_SUCCEEDED(engine->InvalidateCircling(&forcePaint));
+    VERIFY_IS_TRUE(forcePaint);
+    VERIFY_SUCCEEDED(engine->InvalidateAll());
+    VERIFY_ARE_EQUAL(S_OK, engine->StartPaint());
+    VERIFY_IS_FALSE(engine->_frameHeldBack);
+
+    auto counters = writer.GetCounters();
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(stuck + 1), counters.bytesWritten);
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(0), counters.framesHeldBack);
+    VERIFY_SUCCEEDED(engine->EndPaint());
+
+    Log::Comment(L"Once the engine is gone, the pipe is closed, and the reader stops.");
+    engine.reset();
+    reader.join();
+}
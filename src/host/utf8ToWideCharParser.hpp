@@ -9,6 +9,8 @@ Abstract:
 - This transforms a multi-byte character sequence into wide chars
 - It will attempt to work around invalid byte sequences
 - Partial byte sequences are supported
+- Converted text is written into a buffer owned by the parser and reused
+  from call to call, so steady state parsing doesn't allocate
 
 Author(s):
 - Austin Diviness (AustDi) 16-August-2016
@@ -25,30 +27,18 @@ public:
     HRESULT Parse(_In_reads_(cchBuffer) const byte* const pBytes,
                   _In_ unsigned int const cchBuffer,
                   _Out_ unsigned int& cchConsumed,
-                  _Inout_ std::unique_ptr<wchar_t[]>& converted,
-                  _Out_ unsigned int& cchConverted);
+                  _Out_ std::wstring_view& converted);
 
 private:
-    enum class _State
-    {
-        Ready,             // ready for input, no partially parsed code points
-        Error,             // error in parsing given bytes
-        BeginPartialParse, // not a clean byte sequence, needs involved parsing
-        AwaitingMoreBytes, // have a partial sequence saved, waiting for the rest of it
-        Finished           // ready to return a wide char sequence
-    };
-
     bool _IsLeadByte(_In_ byte ch);
     bool _IsContinuationByte(_In_ byte ch);
     bool _IsAsciiByte(_In_ byte ch);
-    bool _IsValidMultiByteSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
-    bool _IsPartialMultiByteSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
     unsigned int _Utf8SequenceSize(_In_ byte ch);
-    unsigned int _ParseFullRange(_In_reads_(cb) const byte* const _InputChars, const unsigned int cb);
-    unsigned int _InvolvedParse(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb);
-    std::pair<std::unique_ptr<byte[]>, unsigned int> _RemoveInvalidSequences(_In_reads_(cb) const byte* const pInputChars,
-                                                                             const unsigned int cb);
+    void _ConvertAscii(_Inout_ const byte*& pInputChars, _In_ const byte* const pInputEnd, _Inout_ wchar_t*& pOutputChars);
+    unsigned int _ConvertSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb, _Inout_ wchar_t*& pOutputChars);
+    unsigned int _ConvertStoredSequence(_In_reads_(cb) const byte* const pInputChars, const unsigned int cb, _Inout_ wchar_t*& pOutputChars);
     void _StorePartialSequence(_In_reads_(cb) const byte* const pLeadByte, const unsigned int cb);
+    void _ReserveConvertedWideChars(const size_t cch);
     void _Reset();
 
     static const unsigned int _UTF8_BYTE_SEQUENCE_MAX = 4;
@@ -56,8 +46,9 @@ private:
     byte _utf8CodePointPieces[_UTF8_BYTE_SEQUENCE_MAX];
     unsigned int _bytesStored; // bytes stored in utf8CodePointPieces
     unsigned int _currentCodePage;
+    // Reused between calls to Parse; only reallocated when a call needs more room than any before it.
     std::unique_ptr<wchar_t[]> _convertedWideChars;
-    _State _currentState;
+    size_t _cchConvertedWideChars;
 
 #ifdef UNIT_TESTING
     friend class Utf8ToWideCharParserTests;
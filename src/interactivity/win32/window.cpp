@@ -788,7 +788,7 @@ void Window::VerticalScroll(const WORD wScrollCommand, const WORD wAbsoluteChang
     }
 
     NewOrigin.Y = std::clamp(NewOrigin.Y, 0i16, gsl::narrow<SHORT>(sScreenBufferSizeY - viewport.Height()));
-    LOG_IF_FAILED(ScreenInfo.SetViewportOrigin(true, NewOrigin, false));
+    LOG_IF_FAILED(ScreenInfo.UserScrollViewport(NewOrigin));
 }
 
 // Routine Description:
@@ -37,3 +37,17 @@ HRESULT RenderEngineBase::UpdateTitle(const std::wstring& newTitle) noexcept
     }
     return hr;
 }
+
+// Method Description:
+// - Gets the areas of the frame that need to be repainted, in characters.
+//      By default, this is just the single dirty rectangle of the frame.
+//      Engines that track invalidation more finely can return several
+//      smaller rectangles instead, so that unchanged text isn't repainted.
+// Arguments:
+// - <none>
+// Return Value:
+// - The areas of the frame to repaint. These are Inclusive rects.
+std::vector<SMALL_RECT> RenderEngineBase::GetDirtyArea()
+{
+    return { GetDirtyRectInChars() };
+}
@@ -0,0 +1,343 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "RenderSnapshot.hpp"
+#include "RowRenderView.hpp"
+
+#include "../../buffer/out/textBuffer.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+using namespace Microsoft::Console::Types;
+
+RenderSnapshot::RenderSnapshot() :
+    _defaultBrushes{},
+    _runs{},
+    _text{},
+    _clusters{},
+    _isGridLineDrawingAllowed{ false },
+    _selection{},
+    _cursor{},
+    _title{},
+    _rowClusters{}
+{
+}
+
+// Routine Description:
+// - Forgets the last frame, but keeps the memory for the next one.
+void RenderSnapshot::Clear() noexcept
+{
+    _defaultBrushes = {};
+    _runs.clear();
+    _text.clear();
+    _clusters.clear();
+    _isGridLineDrawingAllowed = false;
+    _selection.clear();
+    _cursor.reset();
+    _title.clear();
+}
+
+// Routine Description:
+// - Copies everything the engine needs to paint its next frame out of the
+//      console. The console must be locked, and the engine must have started
+//      painting, so that it knows what is dirty.
+// Arguments:
+// - data - the console to copy out of
+// - engine - the engine that will paint from this snapshot
+// - selection - the selected rectangles, relative to the viewport
+// Return Value:
+// - <none>
+// Note: will throw exception if unable to allocate memory for the snapshot
+void RenderSnapshot::Capture(IRenderData& data,
+                             IRenderEngine& engine,
+                             const std::vector<SMALL_RECT>& selection)
+{
+    Clear();
+
+    _defaultBrushes = s_ResolveBrushes(data, data.GetDefaultBrushColors());
+    _isGridLineDrawingAllowed = data.IsGridLineDrawingAllowed();
+
+    _CaptureBufferOutput(data, engine);
+    _CaptureOverlays(data, engine);
+    _selection.assign(selection.cbegin(), selection.cend());
+    _CaptureCursor(data);
+    _title = data.GetConsoleTitle();
+}
+
+// Routine Description:
+// - Gets the colors the frame is cleared to.
+// Return Value:
+// - the default brushes
+const RenderSnapshot::Brushes& RenderSnapshot::GetDefaultBrushes() const noexcept
+{
+    return _defaultBrushes;
+}
+
+// Routine Description:
+// - Gets the runs of text to paint, buffer output first and overlays after.
+// Return Value:
+// - the runs, in the order they should be painted
+const std::vector<RenderSnapshot::Run>& RenderSnapshot::GetRuns() const noexcept
+{
+    return _runs;
+}
+
+// Routine Description:
+// - Builds the clusters of one run, ready to hand to PaintBufferLine. They
+//      point into this snapshot, so they're only valid for as long as it is
+//      left alone.
+// Arguments:
+// - run - one of the runs of this snapshot
+// - clusters - receives the clusters of the run. Its contents are replaced.
+// Return Value:
+// - <none>
+void RenderSnapshot::GetClusters(const Run& run, std::vector<Cluster>& clusters) const
+{
+    clusters.clear();
+    for (size_t i = run.firstCluster; i < run.firstCluster + run.clusterCount; ++i)
+    {
+        const auto& cluster = _clusters.at(i);
+        clusters.emplace_back(std::wstring_view{ _text.data() + cluster.offset, cluster.length }, cluster.columns);
+    }
+}
+
+// Routine Description:
+// - Whether grid lines should be drawn around the runs.
+// Return Value:
+// - true if the console allowed grid line drawing when the snapshot was taken
+bool RenderSnapshot::IsGridLineDrawingAllowed() const noexcept
+{
+    return _isGridLineDrawingAllowed;
+}
+
+// Routine Description:
+// - Gets the selected area of the screen.
+// Return Value:
+// - the selected rectangles, relative to the viewport
+const std::vector<SMALL_RECT>& RenderSnapshot::GetSelection() const noexcept
+{
+    return _selection;
+}
+
+// Routine Description:
+// - Gets how to draw the cursor.
+// Return Value:
+// - the cursor, relative to the viewport. Empty if the cursor isn't visible.
+const std::optional<IRenderEngine::CursorOptions>& RenderSnapshot::GetCursor() const noexcept
+{
+    return _cursor;
+}
+
+// Routine Description:
+// - Gets the title of the console window.
+// Return Value:
+// - the title
+const std::wstring& RenderSnapshot::GetTitle() const noexcept
+{
+    return _title;
+}
+
+// Routine Description:
+// - Converts the text attributes to the colors the engines draw with.
+// Arguments:
+// - data - the console, which knows the color table
+// - attr - the attributes to convert
+// Return Value:
+// - the brushes to draw the attributes with
+RenderSnapshot::Brushes RenderSnapshot::s_ResolveBrushes(const IRenderData& data, const TextAttribute& attr) noexcept
+{
+    return { data.GetForegroundColor(attr),
+             data.GetBackgroundColor(attr),
+             attr.GetLegacyAttributes(),
+             attr.IsBold() };
+}
+
+// Routine Description:
+// - Captures the runs of the viewport that are within the engine's dirty area.
+// Arguments:
+// - data - the console to copy out of
+// - engine - the engine whose dirty area we're capturing
+// Return Value:
+// - <none>
+void RenderSnapshot::_CaptureBufferOutput(IRenderData& data, IRenderEngine& engine)
+{
+    // This is the subsection of the entire screen buffer that is currently being presented.
+    const auto view = data.GetViewport();
+    const auto& buffer = data.GetTextBuffer();
+
+    // These are the cells on the visible screen that need to be redrawn, relative to the screen.
+    for (const auto& dirtyRect : engine.GetDirtyArea())
+    {
+        // Shift the dirty region onto the buffer, and keep only what's visible.
+        const auto dirty = Viewport::Offset(Viewport::FromInclusive(dirtyRect), view.Origin());
+        const auto redraw = Viewport::Intersect(dirty, view);
+
+        // Shortcut: don't bother redrawing if the width is 0.
+        if (redraw.Width() <= 0)
+        {
+            continue;
+        }
+
+        for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
+        {
+            const auto bufferLine = Viewport::FromDimensions({ redraw.Left(), row }, { redraw.Width(), 1 });
+            const auto screenLine = Viewport::Offset(bufferLine, -view.Origin());
+
+            _CaptureRow(data,
+                        buffer.GetRowByOffset(row),
+                        bufferLine.Left(),
+                        bufferLine.RightExclusive(),
+                        screenLine.Origin());
+        }
+    }
+}
+
+// Routine Description:
+// - Captures the text that overlays the main buffer to provide user
+//      interactivity regions, like the IME composition.
+// Arguments:
+// - data - the console to copy out of
+// - engine - the engine whose dirty area we're capturing
+// Return Value:
+// - <none>
+void RenderSnapshot::_CaptureOverlays(IRenderData& data, IRenderEngine& engine)
+{
+    for (const auto& overlay : data.GetOverlays())
+    {
+        // Move the overlay's region to where it is supposed to be relative to the window.
+        SMALL_RECT srCaView = overlay.region.ToInclusive();
+        srCaView.Top += overlay.origin.Y;
+        srCaView.Bottom += overlay.origin.Y;
+        srCaView.Left += overlay.origin.X;
+        srCaView.Right += overlay.origin.X;
+        const auto viewConv = Viewport::FromInclusive(srCaView);
+
+        // Dirty is an inclusive rectangle, but oddly enough the IME was an exclusive one, so correct it.
+        SMALL_RECT srDirty = engine.GetDirtyRectInChars();
+        srDirty.Bottom++;
+        srDirty.Right++;
+
+        if (viewConv.TrimToViewport(&srDirty))
+        {
+            const auto viewDirty = Viewport::FromInclusive(srDirty);
+            for (SHORT iRow = viewDirty.Top(); iRow < viewDirty.BottomInclusive(); iRow++)
+            {
+                const COORD target{ viewDirty.Left(), iRow };
+                const auto source = target - overlay.origin;
+
+                const auto& overlayRow = overlay.buffer.GetRowByOffset(source.Y);
+                _CaptureRow(data, overlayRow, source.X, overlayRow.size(), target);
+            }
+        }
+    }
+}
+
+// Routine Description:
+// - Captures the columns [left, right) of one row, one color run at a time.
+// Arguments:
+// - data - the console, which knows the color table
+// - row - the row to capture
+// - left - the first column to capture
+// - right - one past the last column to capture
+// - target - where on the screen the left column is drawn
+// Return Value:
+// - <none>
+void RenderSnapshot::_CaptureRow(const IRenderData& data,
+                                 const ROW& row,
+                                 const size_t left,
+                                 const size_t right,
+                                 const COORD target)
+{
+    RowRenderView view{ row, left, right, _rowClusters };
+    while (view.MoveNext())
+    {
+        const auto& attributes = view.GetAttributes();
+
+        // The run starts however far into the line it is from where we should start drawing.
+        auto screenPoint = target;
+        screenPoint.X += gsl::narrow<SHORT>(view.GetColumn() - left);
+
+        const auto clusters = view.GetClusters();
+        _runs.push_back({ screenPoint,
+                          s_ResolveBrushes(data, attributes),
+                          s_GetGridlines(attributes),
+                          view.GetColumns(),
+                          _clusters.size(),
+                          clusters.size() });
+
+        for (const auto& cluster : clusters)
+        {
+            const auto& text = cluster.GetText();
+            _clusters.push_back({ _text.size(), text.size(), cluster.GetColumns() });
+            _text.append(text);
+        }
+    }
+}
+
+// Routine Description:
+// - Captures where and how to draw the cursor, if it's visible.
+// Arguments:
+// - data - the console to copy out of
+// Return Value:
+// - <none>
+void RenderSnapshot::_CaptureCursor(IRenderData& data)
+{
+    if (!data.IsCursorVisible())
+    {
+        return;
+    }
+
+    // Adjust cursor to viewport
+    COORD coordCursor = data.GetCursorPosition();
+    data.GetViewport().ConvertToOrigin(&coordCursor);
+
+    const COLORREF cursorColor = data.GetCursorColor();
+
+    IRenderEngine::CursorOptions options;
+    options.coordCursor = coordCursor;
+    options.ulCursorHeightPercent = data.GetCursorHeight();
+    options.cursorPixelWidth = data.GetCursorPixelWidth();
+    options.fIsDoubleWidth = data.IsCursorDoubleWidth();
+    options.cursorType = data.GetCursorStyle();
+    options.fUseColor = cursorColor != INVALID_COLOR;
+    options.cursorColor = cursorColor;
+    options.isOn = data.IsCursorOn();
+    _cursor = options;
+}
+
+// Method Description:
+// - Generates a IRenderEngine::GridLines structure from the values in the
+//      provided textAttribute
+// Arguments:
+// - textAttribute: the TextAttribute to generate GridLines from.
+// Return Value:
+// - a GridLines containing all the gridline info from the TextAtribute
+IRenderEngine::GridLines RenderSnapshot::s_GetGridlines(const TextAttribute& textAttribute) noexcept
+{
+    // Convert console grid line representations into rendering engine enum representations.
+    IRenderEngine::GridLines lines = IRenderEngine::GridLines::None;
+
+    if (textAttribute.IsTopHorizontalDisplayed())
+    {
+        lines |= IRenderEngine::GridLines::Top;
+    }
+
+    if (textAttribute.IsBottomHorizontalDisplayed())
+    {
+        lines |= IRenderEngine::GridLines::Bottom;
+    }
+
+    if (textAttribute.IsLeftVerticalDisplayed())
+    {
+        lines |= IRenderEngine::GridLines::Left;
+    }
+
+    if (textAttribute.IsRightVerticalDisplayed())
+    {
+        lines |= IRenderEngine::GridLines::Right;
+    }
+    return lines;
+}
@@ -0,0 +1,108 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RenderSnapshot.hpp
+
+Abstract:
+- Holds everything one render engine needs to paint one frame: the runs of
+    text in its dirty area, already resolved to clusters and colors, along with
+    the overlays, the selection, the cursor and the title.
+- It's captured while the console is locked, and doesn't point back into the
+    console in any way afterwards, so the frame can be painted from it while
+    the console is unlocked and other threads keep changing the buffer.
+- The Renderer keeps one snapshot per engine and captures into it every frame.
+    Clear() keeps the memory of the snapshot, so that capturing doesn't
+    allocate once the snapshot has grown to fit the biggest frame.
+--*/
+
+#pragma once
+
+#include "../inc/Cluster.hpp"
+#include "../inc/IRenderData.hpp"
+#include "../inc/IRenderEngine.hpp"
+
+class ROW;
+
+namespace Microsoft::Console::Render
+{
+    class RenderSnapshot final
+    {
+    public:
+        // The colors to draw with, resolved from a TextAttribute when the snapshot was taken.
+        struct Brushes
+        {
+            COLORREF foreground;
+            COLORREF background;
+            WORD legacyAttributes;
+            bool isBold;
+        };
+
+        // A run of cells that are all drawn with the same brushes.
+        struct Run
+        {
+            // Where on the screen the run starts.
+            COORD target;
+            Brushes brushes;
+            IRenderEngine::GridLines gridLines;
+
+            // How many columns the run covers once drawn.
+            size_t columns;
+
+            // Which of the snapshot's clusters the run is made of.
+            size_t firstCluster;
+            size_t clusterCount;
+        };
+
+        RenderSnapshot();
+
+        void Clear() noexcept;
+        void Capture(IRenderData& data,
+                     IRenderEngine& engine,
+                     const std::vector<SMALL_RECT>& selection);
+
+        const Brushes& GetDefaultBrushes() const noexcept;
+        const std::vector<Run>& GetRuns() const noexcept;
+        void GetClusters(const Run& run, std::vector<Cluster>& clusters) const;
+        bool IsGridLineDrawingAllowed() const noexcept;
+        const std::vector<SMALL_RECT>& GetSelection() const noexcept;
+        const std::optional<IRenderEngine::CursorOptions>& GetCursor() const noexcept;
+        const std::wstring& GetTitle() const noexcept;
+
+        static Brushes s_ResolveBrushes(const IRenderData& data, const TextAttribute& attr) noexcept;
+
+    private:
+        // The text of one cluster, kept as an offset into _text, since the
+        // views into _text would move whenever it grows.
+        struct ClusterText
+        {
+            size_t offset;
+            size_t length;
+            size_t columns;
+        };
+
+        Brushes _defaultBrushes;
+        std::vector<Run> _runs;
+        std::wstring _text;
+        std::vector<ClusterText> _clusters;
+        bool _isGridLineDrawingAllowed;
+        std::vector<SMALL_RECT> _selection;
+        std::optional<IRenderEngine::CursorOptions> _cursor;
+        std::wstring _title;
+
+        // Reused by the row views while capturing.
+        std::vector<Cluster> _rowClusters;
+
+        void _CaptureBufferOutput(IRenderData& data, IRenderEngine& engine);
+        void _CaptureOverlays(IRenderData& data, IRenderEngine& engine);
+        void _CaptureRow(const IRenderData& data,
+                         const ROW& row,
+                         const size_t left,
+                         const size_t right,
+                         const COORD target);
+        void _CaptureCursor(IRenderData& data);
+
+        static IRenderEngine::GridLines s_GetGridlines(const TextAttribute& textAttribute) noexcept;
+    };
+}
@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include "RowRenderView.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Routine Description:
+// - Creates a view over the columns [left, right) of the given row. The view
+//      starts before the first run; call MoveNext to get to it.
+// Arguments:
+// - row - the row of the text buffer to paint
+// - left - the first column to paint
+// - right - one past the last column to paint
+// - clusters - where to build the clusters for each run. Its contents are
+//      replaced on every call to MoveNext.
+RowRenderView::RowRenderView(const ROW& row,
+                             const size_t left,
+                             const size_t right,
+                             std::vector<Cluster>& clusters) :
+    _charRow(row.GetCharRow()),
+    _attrIter(row.GetAttrRow().cbegin()),
+    _column(left),
+    _right(std::min(right, row.size())),
+    _attributes{},
+    _attributeId{ 0 },
+    _runColumn(left),
+    _clusters(clusters)
+{
+    if (_column < _right)
+    {
+        _attrIter += _column;
+    }
+}
+
+// Routine Description:
+// - Moves to the next run of cells that all have the same attributes, and
+//      builds the clusters for it.
+// - A wide glyph whose leading half is the last cell of a run is included in
+//      that run whole, even if its trailing half has other attributes.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if there was another run. false if we've reached the right edge.
+bool RowRenderView::MoveNext()
+{
+    _clusters.clear();
+    if (_column >= _right)
+    {
+        return false;
+    }
+
+    // Cells of one row have the same attributes exactly when they have the same attribute ID.
+    _attributes = *_attrIter;
+    _attributeId = _attrIter.GetAttributeId();
+    _runColumn = _column;
+    while (_column < _right && _attrIter.GetAttributeId() == _attributeId)
+    {
+        // Take every cell left in this attribute run at once.
+        const auto start = _column;
+        const auto end = std::min(_right, _column + _attrIter.GetRunRemaining());
+        while (_column < end)
+        {
+            const size_t columns = _charRow.DbcsAttrAt(_column).IsLeading() ? 2 : 1;
+            _clusters.emplace_back(_charRow.GlyphAt(_column), columns);
+            _column += columns;
+        }
+
+        if (_column < _right)
+        {
+            _attrIter += _column - start;
+        }
+    }
+
+    return true;
+}
+
+// Routine Description:
+// - Gets the attributes of every cell in the current run.
+// Return Value:
+// - the attributes to draw the current run with
+const TextAttribute& RowRenderView::GetAttributes() const noexcept
+{
+    return _attributes;
+}
+
+// Routine Description:
+// - Gets the column of the row that the current run starts at.
+// Return Value:
+// - the first column of the current run
+size_t RowRenderView::GetColumn() const noexcept
+{
+    return _runColumn;
+}
+
+// Routine Description:
+// - Gets how many columns the current run covers once drawn. This can go one
+//      past the right edge of the view, if the run ends with a wide glyph.
+// Return Value:
+// - the width of the current run
+size_t RowRenderView::GetColumns() const noexcept
+{
+    return _column - _runColumn;
+}
+
+// Routine Description:
+// - Gets the clusters of the current run, ready to hand to PaintBufferLine.
+// Return Value:
+// - a view of the clusters, valid until the next call to MoveNext.
+std::basic_string_view<Cluster> RowRenderView::GetClusters() const noexcept
+{
+    return { _clusters.data(), _clusters.size() };
+}
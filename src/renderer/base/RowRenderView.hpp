@@ -0,0 +1,53 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RowRenderView.hpp
+
+Abstract:
+- This is a read-only view over part of one row of the text buffer, for painting.
+- It walks the row one attribute run at a time, reading the glyphs straight out
+    of the CharRow and the run lengths straight out of the ATTR_ROW, instead of
+    visiting every cell through a TextBufferCellIterator.
+- The clusters for each run are built into a buffer owned by the caller, which
+    is meant to be reused for every run of every frame, so that painting doesn't
+    allocate once that buffer has grown big enough.
+--*/
+
+#pragma once
+
+#include "../inc/Cluster.hpp"
+
+#include "../../buffer/out/Row.hpp"
+
+namespace Microsoft::Console::Render
+{
+    class RowRenderView final
+    {
+    public:
+        RowRenderView(const ROW& row,
+                      const size_t left,
+                      const size_t right,
+                      std::vector<Cluster>& clusters);
+
+        bool MoveNext();
+
+        const TextAttribute& GetAttributes() const noexcept;
+        size_t GetColumn() const noexcept;
+        size_t GetColumns() const noexcept;
+        std::basic_string_view<Cluster> GetClusters() const noexcept;
+
+    private:
+        const CharRow& _charRow;
+        AttrRowIterator _attrIter;
+        size_t _column;
+        const size_t _right;
+
+        // The run we're currently looking at.
+        TextAttribute _attributes;
+        TextAttributeTable::id_type _attributeId;
+        size_t _runColumn;
+        std::vector<Cluster>& _clusters;
+    };
+}
@@ -51,6 +51,10 @@ Renderer::~Renderer()
 
 // Routine Description:
 // - Walks through the console data structures to compose a new frame based on the data that has changed since last call and outputs it to the connected rendering engine.
+// - The console is only read while it's locked, to take a snapshot of what
+//      each engine needs to paint. If painting outside the lock is allowed, the
+//      console is unlocked again before the engines start drawing from their
+//      snapshots, so that output isn't held up for the length of a frame.
 // Arguments:
 // - <none>
 // Return Value:
@@ -63,29 +67,76 @@ HRESULT Renderer::PaintFrame()
         return S_FALSE;
     }
 
-    for (IRenderEngine* const pEngine : _rgpEngines)
+    _pData->LockConsole();
+    auto unlock = wil::scope_exit([&]()
+    {
+        _pData->UnlockConsole();
+    });
+
+    std::lock_guard<std::recursive_mutex> paintLock{ _paintLock };
+
+    // Catch the engines up on anything that happened while they painted the last frame.
+    _RunDeferredEngineCalls();
+
+    // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
+    _CheckViewportAndScroll();
+
+    try
+    {
+        _frames.resize(_rgpEngines.size());
+    }
+    CATCH_RETURN();
+
+    for (size_t i = 0; i < _rgpEngines.size(); i++)
+    {
+        auto& frame = _frames.at(i);
+        const HRESULT hr = LOG_IF_FAILED(_StartPaintForEngine(_rgpEngines.at(i), frame.snapshot));
+        frame.isPainting = hr == S_OK;
+    }
+
+    // The snapshots don't point back into the console, so it can go on
+    //      without us now, unless someone else uses the engines under its lock.
+    if (_paintOutsideLock)
     {
-        LOG_IF_FAILED(_PaintFrameForEngine(pEngine));
+        unlock.reset();
+    }
+
+    for (size_t i = 0; i < _rgpEngines.size(); i++)
+    {
+        if (_frames.at(i).isPainting)
+        {
+            LOG_IF_FAILED(_PaintFrameForEngine(_rgpEngines.at(i), _frames.at(i).snapshot));
+        }
+    }
+
+    // Force scope exit unlock to let go of global lock so other threads can run
+    unlock.reset();
+
+    // Trigger out-of-lock presentation for renderers that can support it
+    for (size_t i = 0; i < _rgpEngines.size(); i++)
+    {
+        if (_frames.at(i).isPainting)
+        {
+            LOG_IF_FAILED(_rgpEngines.at(i)->Present());
+        }
     }
 
     return S_OK;
 }
 
-
+// Routine Description:
+// - Starts a frame for one engine, and takes a snapshot of what it has to paint.
+// - The console and the engines must be locked.
+// Arguments:
+// - pEngine - The engine to start a frame for
+// - snapshot - Receives what the engine has to paint
+// Return Value:
+// - S_OK if the engine has something to paint. S_FALSE if it doesn't.
 [[nodiscard]]
-HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
+HRESULT Renderer::_StartPaintForEngine(_In_ IRenderEngine* const pEngine, RenderSnapshot& snapshot)
 {
     FAIL_FAST_IF_NULL(pEngine); // This is a programming error. Fail fast.
 
-    _pData->LockConsole();
-    auto unlock = wil::scope_exit([&]()
-    {
-        _pData->UnlockConsole();
-    });
-
-    // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
-    _CheckViewportAndScroll();
-
     // Try to start painting a frame
     HRESULT const hr = pEngine->StartPaint();
     RETURN_IF_FAILED(hr);
@@ -95,16 +146,43 @@ HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
     //      engine won't know that.
     if (S_FALSE == hr)
     {
-        return S_OK;
+        return S_FALSE;
     }
 
+    // If we can't take the snapshot, there won't be a frame to paint.
+    auto endPaint = wil::scope_exit([&]()
+    {
+        LOG_IF_FAILED(pEngine->EndPaint());
+    });
+
+    try
+    {
+        snapshot.Capture(*_pData, *pEngine, _GetSelectionRects());
+    }
+    CATCH_RETURN();
+
+    endPaint.release();
+    return S_OK;
+}
+
+// Routine Description:
+// - Paints a frame that was started by _StartPaintForEngine, from its snapshot.
+// - Only the engines must be locked. This doesn't look at the console.
+// Arguments:
+// - pEngine - The engine to paint with
+// - snapshot - What to paint
+// Return Value:
+// - S_OK, or the first error from the engine.
+[[nodiscard]]
+HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot)
+{
     auto endPaint = wil::scope_exit([&]()
     {
         LOG_IF_FAILED(pEngine->EndPaint());
     });
 
     // A. Prep Colors
-    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, _pData->GetDefaultBrushColors(), true));
+    RETURN_IF_FAILED(_UpdateDrawingBrushes(pEngine, snapshot.GetDefaultBrushes(), true));
 
     // B. Perform Scroll Operations
     RETURN_IF_FAILED(_PerformScrolling(pEngine));
@@ -112,23 +190,54 @@ HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
     // 1. Paint Background
     RETURN_IF_FAILED(_PaintBackground(pEngine));
 
-    // 2. Paint Rows of Text
-    _PaintBufferOutput(pEngine);
+    // 2. Paint Rows of Text, and the overlays that reside above them
+    _PaintBufferOutput(pEngine, snapshot);
+
+    // 3. Paint Selection
+    _PaintSelection(pEngine, snapshot);
+
+    // 4. Paint Cursor
+    _PaintCursor(pEngine, snapshot);
 
-    // 3. Paint overlays that reside above the text buffer
-    _PaintOverlays(pEngine);
+    // 5. Paint window title
+    RETURN_IF_FAILED(_PaintTitle(pEngine, snapshot));
 
-    // 4. Paint Selection
-    _PaintSelection(pEngine);
+    // As we leave the scope, EndPaint will be called (declared above)
+    return S_OK;
+}
 
-    // 5. Paint Cursor
-    _PaintCursor(pEngine);
+// Routine Description:
+// - Paints a whole frame for one engine right away, on the caller's thread,
+//      with the console locked throughout.
+// Arguments:
+// - pEngine - The engine to paint with
+// Return Value:
+// - S_OK, or the first error from the engine.
+[[nodiscard]]
+HRESULT Renderer::_PaintFrameForEngineNow(_In_ IRenderEngine* const pEngine)
+{
+    _pData->LockConsole();
+    auto unlock = wil::scope_exit([&]()
+    {
+        _pData->UnlockConsole();
+    });
+
+    std::lock_guard<std::recursive_mutex> paintLock{ _paintLock };
+
+    // Last chance check if anything scrolled without an explicit invalidate notification since the last frame.
+    _CheckViewportAndScroll();
 
-    // 6. Paint window title
-    RETURN_IF_FAILED(_PaintTitle(pEngine));
+    // This only happens on teardown and when the buffer circles, so it doesn't
+    //      reuse the snapshots of the paint thread, which might be in use.
+    RenderSnapshot snapshot;
+    HRESULT const hr = _StartPaintForEngine(pEngine, snapshot);
+    RETURN_IF_FAILED(hr);
+    if (S_FALSE == hr)
+    {
+        return S_OK;
+    }
 
-    // Force scope exit end paint to finish up collecting information and possibly painting
-    endPaint.reset();
+    RETURN_IF_FAILED(_PaintFrameForEngine(pEngine, snapshot));
 
     // Force scope exit unlock to let go of global lock so other threads can run
     unlock.reset();
@@ -136,7 +245,6 @@ HRESULT Renderer::_PaintFrameForEngine(_In_ IRenderEngine* const pEngine)
     // Trigger out-of-lock presentation for renderers that can support it
     RETURN_IF_FAILED(pEngine->Present());
 
-    // As we leave the scope, EndPaint will be called (declared above)
     return S_OK;
 }
 
@@ -146,6 +254,64 @@ void Renderer::_NotifyPaintFrame()
     _pThread->NotifyPaint();
 }
 
+// Routine Description:
+// - Makes a call on every engine. If the engines are busy painting a frame
+//      outside of the console lock, the call is saved and made before the next
+//      frame starts instead, so that the caller doesn't have to wait for the
+//      frame to be done.
+// - The call must not depend on the console, since it might not be locked
+//      anymore by the time it's made. Work out everything it needs up front.
+// Arguments:
+// - call - The call to make on each engine
+// Return Value:
+// - <none>
+void Renderer::_ForEachEngine(std::function<void(IRenderEngine* const)> call)
+{
+    std::unique_lock<std::recursive_mutex> paintLock{ _paintLock, std::try_to_lock };
+    if (paintLock.owns_lock())
+    {
+        // Anything that was deferred happened before this, so it goes first.
+        _RunDeferredEngineCalls();
+        for (IRenderEngine* const pEngine : _rgpEngines)
+        {
+            call(pEngine);
+        }
+    }
+    else
+    {
+        try
+        {
+            std::lock_guard<std::mutex> guard{ _deferredLock };
+            _deferredEngineCalls.push_back(std::move(call));
+        }
+        CATCH_LOG();
+    }
+}
+
+// Routine Description:
+// - Makes the calls that were deferred while the engines were painting, in
+//      the order they came in. The engines must be locked.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::_RunDeferredEngineCalls()
+{
+    decltype(_deferredEngineCalls) calls;
+    {
+        std::lock_guard<std::mutex> guard{ _deferredLock };
+        calls.swap(_deferredEngineCalls);
+    }
+
+    for (const auto& call : calls)
+    {
+        for (IRenderEngine* const pEngine : _rgpEngines)
+        {
+            call(pEngine);
+        }
+    }
+}
+
 // Routine Description:
 // - Called when the system has requested we redraw a portion of the console.
 // Arguments:
@@ -154,8 +320,9 @@ void Renderer::_NotifyPaintFrame()
 // - <none>
 void Renderer::TriggerSystemRedraw(const RECT* const prcDirtyClient)
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-        LOG_IF_FAILED(pEngine->InvalidateSystem(prcDirtyClient));
+    const RECT rcDirtyClient = *prcDirtyClient;
+    _ForEachEngine([=](IRenderEngine* const pEngine) {
+        LOG_IF_FAILED(pEngine->InvalidateSystem(&rcDirtyClient));
     });
 
     _NotifyPaintFrame();
@@ -175,7 +342,7 @@ void Renderer::TriggerRedraw(const Viewport& region)
     if (view.TrimToViewport(&srUpdateRegion))
     {
         view.ConvertToOrigin(&srUpdateRegion);
-        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+        _ForEachEngine([=](IRenderEngine* const pEngine) {
             LOG_IF_FAILED(pEngine->Invalidate(&srUpdateRegion));
         });
 
@@ -211,17 +378,18 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
     if (view.IsInBounds(updateCoord))
     {
         view.ConvertToOrigin(&updateCoord);
-        for (IRenderEngine* pEngine : _rgpEngines)
-        {
-            LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
+        const bool isDoubleWidth = _pData->IsCursorDoubleWidth();
+        _ForEachEngine([=](IRenderEngine* const pEngine) {
+            COORD coord = updateCoord;
+            LOG_IF_FAILED(pEngine->InvalidateCursor(&coord));
 
             // Double-wide cursors need to invalidate the right half as well.
-            if (_pData->IsCursorDoubleWidth())
+            if (isDoubleWidth)
             {
-                updateCoord.X++;
-                LOG_IF_FAILED(pEngine->InvalidateCursor(&updateCoord));
+                coord.X++;
+                LOG_IF_FAILED(pEngine->InvalidateCursor(&coord));
             }
-        }
+        });
 
         _NotifyPaintFrame();
     }
@@ -236,7 +404,7 @@ void Renderer::TriggerRedrawCursor(const COORD* const pcoord)
 // - <none>
 void Renderer::TriggerRedrawAll()
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+    _ForEachEngine([](IRenderEngine* const pEngine) {
         LOG_IF_FAILED(pEngine->InvalidateAll());
     });
 
@@ -259,12 +427,16 @@ void Renderer::TriggerTeardown()
     for (IRenderEngine* const pEngine : _rgpEngines)
     {
         bool fEngineRequestsRepaint = false;
-        HRESULT hr = pEngine->PrepareForTeardown(&fEngineRequestsRepaint);
+        HRESULT hr = S_OK;
+        {
+            std::lock_guard<std::recursive_mutex> paintLock{ _paintLock };
+            hr = pEngine->PrepareForTeardown(&fEngineRequestsRepaint);
+        }
         LOG_IF_FAILED(hr);
 
         if (SUCCEEDED(hr) && fEngineRequestsRepaint)
         {
-            LOG_IF_FAILED(_PaintFrameForEngine(pEngine));
+            LOG_IF_FAILED(_PaintFrameForEngineNow(pEngine));
         }
     }
 }
@@ -280,14 +452,14 @@ void Renderer::TriggerSelection()
     try
     {
         // Get selection rectangles
-        const auto rects = _GetSelectionRects();
+        auto rects = _GetSelectionRects();
 
-        std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-            LOG_IF_FAILED(pEngine->InvalidateSelection(_previousSelection));
+        _ForEachEngine([previous = _previousSelection, rects](IRenderEngine* const pEngine) {
+            LOG_IF_FAILED(pEngine->InvalidateSelection(previous));
             LOG_IF_FAILED(pEngine->InvalidateSelection(rects));
         });
 
-        _previousSelection = rects;
+        _previousSelection = std::move(rects);
 
         _NotifyPaintFrame();
     }
@@ -309,7 +481,7 @@ bool Renderer::_CheckViewportAndScroll()
     coordDelta.X = srOldViewport.Left - srNewViewport.Left;
     coordDelta.Y = srOldViewport.Top - srNewViewport.Top;
 
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
+    _ForEachEngine([=](IRenderEngine* const pEngine) {
         LOG_IF_FAILED(pEngine->UpdateViewport(srNewViewport));
         LOG_IF_FAILED(pEngine->InvalidateScroll(&coordDelta));
     });
@@ -344,8 +516,9 @@ void Renderer::TriggerScroll()
 // - <none>
 void Renderer::TriggerScroll(const COORD* const pcoordDelta)
 {
-    std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
-        LOG_IF_FAILED(pEngine->InvalidateScroll(pcoordDelta));
+    const COORD coordDelta = *pcoordDelta;
+    _ForEachEngine([=](IRenderEngine* const pEngine) {
+        LOG_IF_FAILED(pEngine->InvalidateScroll(&coordDelta));
     });
 
     _NotifyPaintFrame();
@@ -354,12 +527,17 @@ void Renderer::TriggerScroll(const COORD* const pcoordDelta)
 // Routine Description:
 // - Called when the text buffer is about to circle it's backing buffer.
 //      A renderer might want to get painted before that happens.
+// - This can't be deferred like the other notifications, since the rows that
+//      scroll off are gone once the buffer has circled. If the engines are
+//      still presenting the last frame, this waits for them. They've let go
+//      of the console lock for that, so the caller can be holding it.
 // Arguments:
 // - <none>
 // Return Value:
 // - <none>
 void Renderer::TriggerCircling()
 {
+    auto paintLock = LockPainting();
     for (IRenderEngine* const pEngine : _rgpEngines)
     {
         bool fEngineRequestsRepaint = false;
@@ -368,11 +546,24 @@ void Renderer::TriggerCircling()
 
         if (SUCCEEDED(hr) && fEngineRequestsRepaint)
         {
-            LOG_IF_FAILED(_PaintFrameForEngine(pEngine));
+            LOG_IF_FAILED(_PaintFrameForEngineNow(pEngine));
         }
     }
 }
 
+// Routine Description:
+// - Called when an engine skipped painting part of a frame, and is ready to
+//      paint it now. Nothing new is invalidated, the engine kept track of what
+//      it skipped.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::TriggerPaint()
+{
+    _NotifyPaintFrame();
+}
+
 // Routine Description:
 // - Called when the title of the console window has changed. Indicates that we
 //      should update the title on the next frame.
@@ -383,10 +574,9 @@ void Renderer::TriggerCircling()
 void Renderer::TriggerTitleChange()
 {
     const std::wstring newTitle = _pData->GetConsoleTitle();
-    for (IRenderEngine* const pEngine : _rgpEngines)
-    {
+    _ForEachEngine([newTitle](IRenderEngine* const pEngine) {
         LOG_IF_FAILED(pEngine->InvalidateTitle(newTitle));
-    }
+    });
     _NotifyPaintFrame();
 }
 
@@ -396,10 +586,9 @@ void Renderer::TriggerTitleChange()
 // - pEngine: the engine to update the title for.
 // Return Value:
 // - the HRESULT of the underlying engine's UpdateTitle call.
-HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
+HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine, const RenderSnapshot& snapshot)
 {
-    const std::wstring newTitle = _pData->GetConsoleTitle();
-    return pEngine->UpdateTitle(newTitle);
+    return pEngine->UpdateTitle(snapshot.GetTitle());
 }
 
 // Routine Description:
@@ -412,6 +601,8 @@ HRESULT Renderer::_PaintTitle(IRenderEngine* const pEngine)
 // - <none>
 void Renderer::TriggerFontChange(const int iDpi, const FontInfoDesired& FontInfoDesired, _Out_ FontInfo& FontInfo)
 {
+    // The caller needs the font back right away, so this waits for the engines.
+    auto paintLock = LockPainting();
     std::for_each(_rgpEngines.begin(), _rgpEngines.end(), [&](IRenderEngine* const pEngine) {
         LOG_IF_FAILED(pEngine->UpdateDpi(iDpi));
         LOG_IF_FAILED(pEngine->UpdateFont(FontInfoDesired, FontInfo));
@@ -436,6 +627,7 @@ HRESULT Renderer::GetProposedFont(const int iDpi, const FontInfoDesired& FontInf
     //      handle this.
     // Currently, the only caller is the WindowProc:WM_GETDPISCALEDSIZE handler.
     //      It will assume that the proposed font is 1x1, regardless of DPI.
+    auto paintLock = LockPainting();
     if (_rgpEngines.size() < 1)
     {
         return E_FAIL;
@@ -472,6 +664,7 @@ HRESULT Renderer::GetProposedFont(const int iDpi, const FontInfoDesired& FontInf
 bool Renderer::IsGlyphWideByFont(const std::wstring_view glyph)
 {
     bool fIsFullWidth = false;
+    auto paintLock = LockPainting();
 
     // There will only every really be two engines - the real head and the VT
     //      renderer. We won't know which is which, so iterate over them.
@@ -491,6 +684,19 @@ bool Renderer::IsGlyphWideByFont(const std::wstring_view glyph)
     return fIsFullWidth;
 }
 
+// Routine Description:
+// - Lets the render thread know that the user just gave us input, so that the
+//      frame that shows its effect is painted right away, instead of waiting
+//      for the frame interval like other output.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::NotifyInput()
+{
+    _pThread->NotifyInput();
+}
+
 // Routine Description:
 // - Sets an event in the render thread that allows it to proceed, thus enabling painting.
 // Arguments:
@@ -516,286 +722,71 @@ void Renderer::WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs)
 }
 
 // Routine Description:
-// - Paint helper to fill in the background color of the invalid area within the frame.
+// - Sets how often the render thread paints frames for output that isn't
+//      caused by input. Frames that show input are painted right away.
 // Arguments:
-// - <none>
+// - interval - the least time between two frames
 // Return Value:
 // - <none>
-[[nodiscard]]
-HRESULT Renderer::_PaintBackground(_In_ IRenderEngine* const pEngine)
+void Renderer::SetFrameInterval(const std::chrono::milliseconds interval) noexcept
 {
-    return pEngine->PaintBackground();
+    _pThread->SetFrameInterval(interval);
 }
 
 // Routine Description:
-// - Paint helper to copy the primary console buffer text onto the screen.
-// - This portion primarily handles figuring the current viewport, comparing it/trimming it versus the invalid portion of the frame, and queuing up, row by row, which pieces of text need to be further processed.
-// - See also: Helper functions that seperate out each complexity of text rendering.
+// - Gets what the render thread has done so far: how many frames it painted,
+//      how many requests it folded into them, and how long input took to show.
 // Arguments:
 // - <none>
 // Return Value:
-// - <none>
-void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine)
+// - the counters
+RenderThreadCounters Renderer::GetRenderThreadCounters() const noexcept
 {
-    // This is the subsection of the entire screen buffer that is currently being presented.
-    // It can move left/right or top/bottom depending on how the viewport is scrolled
-    // relative to the entire buffer.
-    const auto view = _pData->GetViewport();
-
-    // This is effectively the number of cells on the visible screen that need to be redrawn.
-    // The origin is always 0, 0 because it represents the screen itself, not the underlying buffer.
-    auto dirty = Viewport::FromInclusive(pEngine->GetDirtyRectInChars());
-
-    // Shift the origin of the dirty region to match the underlying buffer so we can
-    // compare the two regions directly for intersection.
-    dirty = Viewport::Offset(dirty, view.Origin());
-
-    // The intersection between what is dirty on the screen (in need of repaint)
-    // and what is supposed to be visible on the screen (the viewport) is what
-    // we need to walk through line-by-line and repaint onto the screen.
-    const auto redraw = Viewport::Intersect(dirty, view);
-
-    // Shortcut: don't bother redrawing if the width is 0.
-    if (redraw.Width() > 0)
-    {
-        // Retrieve the text buffer so we can read information out of it.
-        const auto& buffer = _pData->GetTextBuffer();
-
-        // Now walk through each row of text that we need to redraw.
-        for (auto row = redraw.Top(); row < redraw.BottomExclusive(); row++)
-        {
-            // Calculate the boundaries of a single line. This is from the left to right edge of the dirty
-            // area in width and exactly 1 tall.
-            const auto bufferLine = Viewport::FromDimensions({ redraw.Left(), row }, { redraw.Width(), 1 });
-
-            // Find where on the screen we should place this line information. This requires us to re-map
-            // the buffer-based origin of the line back onto the screen-based origin of the line
-            // For example, the screen might say we need to paint 1,1 because it is dirty but the viewport is actually looking
-            // at 13,26 relative to the buffer.
-            // This means that we need 14,27 out of the backing buffer to fill in the 1,1 cell of the screen.
-            const auto screenLine = Viewport::Offset(bufferLine, -view.Origin());
-
-            // Retrieve the cell information iterator limited to just this line we want to redraw.
-            auto it = buffer.GetCellDataAt(bufferLine.Origin(), bufferLine);
-
-            // Ask the helper to paint through this specific line.
-            _PaintBufferOutputHelper(pEngine, it, screenLine.Origin());
-        }
-    }
-}
-
-void Renderer::_PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
-                                        TextBufferCellIterator it,
-                                        const COORD target)
-{
-    // If we have valid data, let's figure out how to draw it.
-    if (it)
-    {
-        // TODO: MSFT: 20961091 -  This is a perf issue. Instead of rebuilding this and allocing memory to hold the reinterpretation,
-        // we should have an iterator/view adapter for the rendering.
-        // That would probably also eliminate the RenderData needing to give us the entire TextBuffer as well...
-        // Retrieve the iterator for one line of information.
-        std::vector<Cluster> clusters;
-        size_t cols = 0;
-
-        // Retrieve the first color.
-        auto color = it->TextAttr();
-
-        // And hold the point where we should start drawing.
-        auto screenPoint = target;
-
-        // This outer loop will continue until we reach the end of the text we are trying to draw.
-        while (it)
-        {
-            // Hold onto the current run color right here for the length of the outer loop.
-            // We'll be changing the persistent one as we run through the inner loops to detect
-            // when a run changes, but we will still need to know this color at the bottom
-            // when we go to draw gridlines for the length of the run.
-            const auto currentRunColor = color;
-
-            // Update the drawing brushes with our color.
-            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, currentRunColor, false));
-
-            // Advance the point by however many columns we've just outputted and reset the accumulator.
-            screenPoint.X += gsl::narrow<SHORT>(cols);
-            cols = 0;
-
-            // Ensure that our cluster vector is clear.
-            clusters.clear();
-
-            // This inner loop will accumulate clusters until the color changes.
-            // When the color changes, it will save the new color off and break.
-            do
-            {
-                if (color != it->TextAttr())
-                {
-                    color = it->TextAttr();
-                    break;
-                }
-
-                // Walk through the text data and turn it into rendering clusters.
-                clusters.emplace_back(it->Chars(), it->Columns());
-
-                // Advance the cluster and column counts.
-                const auto columnCount = clusters.back().GetColumns();
-                it += columnCount > 0 ? columnCount : 1; // prevent infinite loop for no visible columns
-                cols += columnCount;
-
-            } while (it);
-
-            // Do the painting.
-            // TODO: Calculate when trim left should be TRUE
-            THROW_IF_FAILED(pEngine->PaintBufferLine({ clusters.data(), clusters.size() }, screenPoint, false));
-
-            // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
-            if (_pData->IsGridLineDrawingAllowed())
-            {
-                // We're only allowed to draw the grid lines under certain circumstances.
-                _PaintBufferOutputGridLineHelper(pEngine, currentRunColor, cols, screenPoint);
-            }
-        }
-    }
-}
-
-// Method Description:
-// - Generates a IRenderEngine::GridLines structure from the values in the
-//      provided textAttribute
-// Arguments:
-// - textAttribute: the TextAttribute to generate GridLines from.
-// Return Value:
-// - a GridLines containing all the gridline info from the TextAtribute
-IRenderEngine::GridLines Renderer::s_GetGridlines(const TextAttribute& textAttribute) noexcept
-{
-    // Convert console grid line representations into rendering engine enum representations.
-    IRenderEngine::GridLines lines = IRenderEngine::GridLines::None;
-
-    if (textAttribute.IsTopHorizontalDisplayed())
-    {
-        lines |= IRenderEngine::GridLines::Top;
-    }
-
-    if (textAttribute.IsBottomHorizontalDisplayed())
-    {
-        lines |= IRenderEngine::GridLines::Bottom;
-    }
-
-    if (textAttribute.IsLeftVerticalDisplayed())
-    {
-        lines |= IRenderEngine::GridLines::Left;
-    }
-
-    if (textAttribute.IsRightVerticalDisplayed())
-    {
-        lines |= IRenderEngine::GridLines::Right;
-    }
-    return lines;
+    return _pThread->GetCounters();
 }
 
 // Routine Description:
-// - Paint helper for primary buffer output function.
-// - This particular helper sets up the various box drawing lines that can be inscribed around any character in the buffer (left, right, top, underline).
-// - See also: All related helpers and buffer output functions.
-// Arguments:
-// - textAttribute - The line/box drawing attributes to use for this particular run.
-// - cchLine - The length of both pwsLine and pbKAttrsLine.
-// - coordTarget - The X/Y coordinate position in the buffer which we're attempting to start rendering from.
-// Return Value:
-// - <none>
-void Renderer::_PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine,
-                                                const TextAttribute textAttribute,
-                                                const size_t cchLine,
-                                                const COORD coordTarget)
-{
-    const COLORREF rgb = _pData->GetForegroundColor(textAttribute);
-
-    // Convert console grid line representations into rendering engine enum representations.
-    IRenderEngine::GridLines lines = Renderer::s_GetGridlines(textAttribute);
-
-    // Draw the lines
-    LOG_IF_FAILED(pEngine->PaintBufferGridLines(lines, rgb, cchLine, coordTarget));
-}
-
-// Routine Description:
-// - Paint helper to draw the cursor within the buffer.
+// - Paint helper to fill in the background color of the invalid area within the frame.
 // Arguments:
 // - <none>
 // Return Value:
 // - <none>
-void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine)
+[[nodiscard]]
+HRESULT Renderer::_PaintBackground(_In_ IRenderEngine* const pEngine)
 {
-    if (_pData->IsCursorVisible())
-    {
-        // Get cursor position in buffer
-        COORD coordCursor = _pData->GetCursorPosition();
-        // Adjust cursor to viewport
-        Viewport view = _pData->GetViewport();
-        view.ConvertToOrigin(&coordCursor);
-
-        COLORREF cursorColor = _pData->GetCursorColor();
-        bool useColor = cursorColor != INVALID_COLOR;
-
-        // Build up the cursor parameters including position, color, and drawing options
-        IRenderEngine::CursorOptions options;
-        options.coordCursor = coordCursor;
-        options.ulCursorHeightPercent = _pData->GetCursorHeight();
-        options.cursorPixelWidth = _pData->GetCursorPixelWidth();
-        options.fIsDoubleWidth = _pData->IsCursorDoubleWidth();
-        options.cursorType = _pData->GetCursorStyle();
-        options.fUseColor = useColor;
-        options.cursorColor = cursorColor;
-        options.isOn = _pData->IsCursorOn();
-
-        // Draw it within the viewport
-        LOG_IF_FAILED(pEngine->PaintCursor(options));
-
-    }
+    return pEngine->PaintBackground();
 }
 
 // Routine Description:
-// - Paint helper to draw text that overlays the main buffer to provide user interactivity regions
-// - This supports IME composition.
+// - Paint helper to copy the primary console buffer text onto the screen,
+//      along with the text that overlays it to provide user interactivity
+//      regions, like the IME composition.
+// - The snapshot already holds the runs of every row within the dirty area,
+//      one per color, so this only hands them to the engine.
 // Arguments:
-// - engine - The render engine that we're targeting.
-// - overlay - The overlay to draw.
+// - pEngine - The engine to paint with
+// - snapshot - What to paint
 // Return Value:
 // - <none>
-void Renderer::_PaintOverlay(IRenderEngine& engine,
-                             const RenderOverlay& overlay)
+void Renderer::_PaintBufferOutput(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot)
 {
     try
     {
-        // First get the screen buffer's viewport.
-        Viewport view = _pData->GetViewport();
-
-        // Now get the overlay's viewport and adjust it to where it is supposed to be relative to the window.
-
-        SMALL_RECT srCaView = overlay.region.ToInclusive();
-        srCaView.Top += overlay.origin.Y;
-        srCaView.Bottom += overlay.origin.Y;
-        srCaView.Left += overlay.origin.X;
-        srCaView.Right += overlay.origin.X;
-
-        // Set it up in a Viewport helper structure and trim it the IME viewport to be within the full console viewport.
-        Viewport viewConv = Viewport::FromInclusive(srCaView);
-
-        SMALL_RECT srDirty = engine.GetDirtyRectInChars();
-
-        // Dirty is an inclusive rectangle, but oddly enough the IME was an exclusive one, so correct it.
-        srDirty.Bottom++;
-        srDirty.Right++;
-
-        if (viewConv.TrimToViewport(&srDirty))
+        for (const auto& run : snapshot.GetRuns())
         {
-            Viewport viewDirty = Viewport::FromInclusive(srDirty);
-
-            for (SHORT iRow = viewDirty.Top(); iRow < viewDirty.BottomInclusive(); iRow++)
-            {
-                const COORD target{ viewDirty.Left(), iRow };
-                const auto source = target - overlay.origin;
+            // Update the drawing brushes with our color.
+            THROW_IF_FAILED(_UpdateDrawingBrushes(pEngine, run.brushes, false));
 
-                auto it = overlay.buffer.GetCellLineDataAt(source);
+            // Do the painting. The clusters are built into our reusable buffer,
+            //      so this doesn't allocate once it has grown to fit the longest run.
+            // TODO: Calculate when trim left should be TRUE
+            snapshot.GetClusters(run, _clusterBuffer);
+            THROW_IF_FAILED(pEngine->PaintBufferLine({ _clusterBuffer.data(), _clusterBuffer.size() }, run.target, false));
 
-                _PaintBufferOutputHelper(&engine, it, target);
+            // If we're allowed to do grid drawing, draw that now too (since it will be coupled with the color data)
+            if (snapshot.IsGridLineDrawingAllowed())
+            {
+                LOG_IF_FAILED(pEngine->PaintBufferGridLines(run.gridLines, run.brushes.foreground, run.columns, run.target));
             }
         }
     }
@@ -803,43 +794,37 @@ void Renderer::_PaintOverlay(IRenderEngine& engine,
 }
 
 // Routine Description:
-// - Paint helper to draw the composition string portion of the IME.
-// - This specifically is the string that appears at the cursor on the input line showing what the user is currently typing.
-// - See also: Generic Paint IME helper method.
+// - Paint helper to draw the cursor within the buffer.
 // Arguments:
-// - <none>
+// - pEngine - The engine to paint with
+// - snapshot - What to paint
 // Return Value:
 // - <none>
-void Renderer::_PaintOverlays(_In_ IRenderEngine* const pEngine)
+void Renderer::_PaintCursor(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot)
 {
-    try
+    const auto& cursor = snapshot.GetCursor();
+    if (cursor.has_value())
     {
-        const auto overlays = _pData->GetOverlays();
-
-        for (const auto& overlay : overlays)
-        {
-            _PaintOverlay(*pEngine, overlay);
-        }
+        // Draw it within the viewport
+        LOG_IF_FAILED(pEngine->PaintCursor(cursor.value()));
     }
-    CATCH_LOG();
 }
 
 // Routine Description:
 // - Paint helper to draw the selected area of the window.
 // Arguments:
-// - <none>
+// - pEngine - The engine to paint with
+// - snapshot - What to paint
 // Return Value:
 // - <none>
-void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
+void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot)
 {
     try
     {
         SMALL_RECT srDirty = pEngine->GetDirtyRectInChars();
         Viewport dirtyView = Viewport::FromInclusive(srDirty);
 
-        // Get selection rectangles
-        const auto rectangles = _GetSelectionRects();
-        for (auto rect : rectangles)
+        for (auto rect : snapshot.GetSelection())
         {
             if (dirtyView.TrimToViewport(&rect))
             {
@@ -851,10 +836,10 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 }
 
 // Routine Description:
-// - Helper to convert the text attributes to actual RGB colors and update the rendering pen/brush within the rendering engine before the next draw operation.
+// - Helper to hand the colors of the next run to the rendering engine before the next draw operation.
 // Arguments:
 // - pEngine - Which engine is being updated
-// - textAttributes - The 16 color foreground/background combination to set
+// - brushes - The colors to draw with, resolved from the text attributes when the snapshot was taken
 // - isSettingDefaultBrushes - Alerts that the default brushes are being set which will
 //                             impact whether or not to include the hung window/erase window brushes in this operation
 //                             and can affect other draw state that wants to know the default color scheme.
@@ -862,16 +847,17 @@ void Renderer::_PaintSelection(_In_ IRenderEngine* const pEngine)
 // Return Value:
 // - <none>
 [[nodiscard]]
-HRESULT Renderer::_UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute textAttributes, const bool isSettingDefaultBrushes)
+HRESULT Renderer::_UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine,
+                                        const RenderSnapshot::Brushes& brushes,
+                                        const bool isSettingDefaultBrushes)
 {
-    const COLORREF rgbForeground = _pData->GetForegroundColor(textAttributes);
-    const COLORREF rgbBackground = _pData->GetBackgroundColor(textAttributes);
-    const WORD legacyAttributes = textAttributes.GetLegacyAttributes();
-    const bool isBold = textAttributes.IsBold();
-
     // The last color need's to be each engine's responsibility. If it's local to this function,
     //      then on the next engine we might not update the color.
-    RETURN_IF_FAILED(pEngine->UpdateDrawingBrushes(rgbForeground, rgbBackground, legacyAttributes, isBold, isSettingDefaultBrushes));
+    RETURN_IF_FAILED(pEngine->UpdateDrawingBrushes(brushes.foreground,
+                                                   brushes.background,
+                                                   brushes.legacyAttributes,
+                                                   brushes.isBold,
+                                                   isSettingDefaultBrushes));
 
     return S_OK;
 }
@@ -928,5 +914,38 @@ std::vector<SMALL_RECT> Renderer::_GetSelectionRects() const
 void Renderer::AddRenderEngine(_In_ IRenderEngine* const pEngine)
 {
     THROW_IF_NULL_ALLOC(pEngine);
+    auto paintLock = LockPainting();
     _rgpEngines.push_back(pEngine);
 }
+
+// Method Description:
+// - Lets the engines paint each frame from its snapshot after the console has
+//      been unlocked again, so that output can go on while a frame is drawn.
+// - Only use this when the engines are used by nothing but this renderer, or
+//      by callers that hold LockPainting while they use them. Otherwise they
+//      could be used by two threads at once.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void Renderer::AllowPaintingOutsideLock()
+{
+    std::lock_guard<std::recursive_mutex> paintLock{ _paintLock };
+    _paintOutsideLock = true;
+}
+
+// Method Description:
+// - Waits for the engines to be done painting, and keeps them from starting
+//      another frame until the returned lock is released. Anything that uses
+//      an engine directly, instead of through this renderer, must hold this.
+// - If the caller also needs the console lock, it must take that one first.
+// Arguments:
+// - <none>
+// Return Value:
+// - the lock on the engines
+std::unique_lock<std::recursive_mutex> Renderer::LockPainting()
+{
+    std::unique_lock<std::recursive_mutex> paintLock{ _paintLock };
+    _RunDeferredEngineCalls();
+    return paintLock;
+}
@@ -21,6 +21,7 @@ Author(s):
 #include "../inc/IRenderData.hpp"
 
 #include "thread.hpp"
+#include "RenderSnapshot.hpp"
 
 #include "../../buffer/out/textBuffer.hpp"
 #include "../../buffer/out/CharRow.hpp"
@@ -63,6 +64,7 @@ namespace Microsoft::Console::Render
 
         void TriggerCircling() override;
         void TriggerTitleChange() override;
+        void TriggerPaint() override;
 
         void TriggerFontChange(const int iDpi,
                                const FontInfoDesired& FontInfoDesired,
@@ -75,12 +77,27 @@ namespace Microsoft::Console::Render
 
         bool IsGlyphWideByFont(const std::wstring_view glyph) override;
 
+        void NotifyInput() override;
+
         void EnablePainting() override;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) override;
 
+        void SetFrameInterval(const std::chrono::milliseconds interval) noexcept override;
+        RenderThreadCounters GetRenderThreadCounters() const noexcept override;
+
         void AddRenderEngine(_In_ IRenderEngine* const pEngine) override;
 
+        void AllowPaintingOutsideLock();
+        std::unique_lock<std::recursive_mutex> LockPainting();
+
     private:
+        // What one engine is painting this frame.
+        struct EngineFrame
+        {
+            RenderSnapshot snapshot;
+            bool isPainting = false;
+        };
+
         std::deque<IRenderEngine*> _rgpEngines;
 
         IRenderData* _pData; // Non-ownership pointer
@@ -88,37 +105,51 @@ namespace Microsoft::Console::Render
         std::unique_ptr<IRenderThread> _pThread;
         bool _destructing = false;
 
+        // Held by whoever is using the engines. The console lock is always taken
+        //      before this one, never after.
+        std::recursive_mutex _paintLock;
+        bool _paintOutsideLock = false;
+
+        // Calls to the engines that came in while they were busy painting.
+        std::mutex _deferredLock;
+        std::vector<std::function<void(IRenderEngine* const)>> _deferredEngineCalls;
+
+        // One per engine. They're kept around so that their memory can be
+        //      reused for every frame.
+        std::vector<EngineFrame> _frames;
+
         void _NotifyPaintFrame();
 
-        [[nodiscard]]
-        HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine);
+        void _ForEachEngine(std::function<void(IRenderEngine* const)> call);
+        void _RunDeferredEngineCalls();
 
-        bool _CheckViewportAndScroll();
+        [[nodiscard]]
+        HRESULT _StartPaintForEngine(_In_ IRenderEngine* const pEngine, RenderSnapshot& snapshot);
 
         [[nodiscard]]
-        HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
+        HRESULT _PaintFrameForEngine(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot);
 
-        void _PaintBufferOutput(_In_ IRenderEngine* const pEngine);
+        [[nodiscard]]
+        HRESULT _PaintFrameForEngineNow(_In_ IRenderEngine* const pEngine);
 
-        void _PaintBufferOutputHelper(_In_ IRenderEngine* const pEngine,
-                                      TextBufferCellIterator it,
-                                      const COORD target);
+        bool _CheckViewportAndScroll();
 
-        static IRenderEngine::GridLines s_GetGridlines(const TextAttribute& textAttribute) noexcept;
+        [[nodiscard]]
+        HRESULT _PaintBackground(_In_ IRenderEngine* const pEngine);
 
-        void _PaintBufferOutputGridLineHelper(_In_ IRenderEngine* const pEngine,
-                                              const TextAttribute textAttribute,
-                                              const size_t cchLine,
-                                              const COORD coordTarget);
+        void _PaintBufferOutput(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot);
 
-        void _PaintSelection(_In_ IRenderEngine* const pEngine);
-        void _PaintCursor(_In_ IRenderEngine* const pEngine);
+        // Holds the clusters of the run being painted. It's kept around so that
+        //      its memory can be reused for every run of every frame.
+        std::vector<Cluster> _clusterBuffer;
 
-        void _PaintOverlays(_In_ IRenderEngine* const pEngine);
-        void _PaintOverlay(IRenderEngine& engine, const RenderOverlay& overlay);
+        void _PaintSelection(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot);
+        void _PaintCursor(_In_ IRenderEngine* const pEngine, const RenderSnapshot& snapshot);
 
         [[nodiscard]]
-        HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine, const TextAttribute attr, const bool isSettingDefaultBrushes);
+        HRESULT _UpdateDrawingBrushes(_In_ IRenderEngine* const pEngine,
+                                      const RenderSnapshot::Brushes& brushes,
+                                      const bool isSettingDefaultBrushes);
 
         [[nodiscard]]
         HRESULT _PerformScrolling(_In_ IRenderEngine* const pEngine);
@@ -129,7 +160,7 @@ namespace Microsoft::Console::Render
         std::vector<SMALL_RECT> _previousSelection;
 
         [[nodiscard]]
-        HRESULT _PaintTitle(IRenderEngine* const pEngine);
+        HRESULT _PaintTitle(IRenderEngine* const pEngine, const RenderSnapshot& snapshot);
 
         // Helper functions to diagnose issues with painting and layout.
         // These are only actually effective/on in Debug builds when the flag is set using an attached debugger.
@@ -14,9 +14,20 @@ RenderThread::RenderThread() :
     _pRenderer(nullptr),
     _hThread(INVALID_HANDLE_VALUE),
     _hEvent(INVALID_HANDLE_VALUE),
+    _hInputEvent(INVALID_HANDLE_VALUE),
     _hPaintCompletedEvent(INVALID_HANDLE_VALUE),
     _fKeepRunning(true),
-    _hPaintEnabledEvent(INVALID_HANDLE_VALUE)
+    _hPaintEnabledEvent(INVALID_HANDLE_VALUE),
+    _frameInterval{ s_DefaultFrameInterval.count() },
+    _lastFrame{},
+    _paintRequests{ 0 },
+    _inputTime{ 0 },
+    _frames{ 0 },
+    _coalescedRequests{ 0 },
+    _inputFrames{ 0 },
+    _lastInputLatency{ 0 },
+    _maxInputLatency{ 0 },
+    _totalInputLatency{ 0 }
 {
 
 }
@@ -26,6 +37,7 @@ RenderThread::~RenderThread()
     if (_hThread != INVALID_HANDLE_VALUE)
     {
         _fKeepRunning = false; // stop loop after final run
+        SetEvent(_hInputEvent); // cut short any wait for the frame interval
         SignalObjectAndWait(_hEvent, _hThread, INFINITE, FALSE); // signal final paint and wait for thread to finish.
 
         CloseHandle(_hThread);
@@ -38,6 +50,12 @@ RenderThread::~RenderThread()
         _hEvent = INVALID_HANDLE_VALUE;
     }
 
+    if (_hInputEvent != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hInputEvent);
+        _hInputEvent = INVALID_HANDLE_VALUE;
+    }
+
     if (_hPaintEnabledEvent != INVALID_HANDLE_VALUE)
     {
         CloseHandle(_hPaintEnabledEvent);
@@ -85,6 +103,24 @@ HRESULT RenderThread::Initialize(IRenderer* const pRendererParent) noexcept
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        HANDLE hInputEvent = CreateEventW(nullptr, // non-inheritable security attributes
+                                          FALSE,   // auto reset event
+                                          FALSE,   // initially unsignaled
+                                          nullptr  // no name
+                                          );
+
+        if (hInputEvent == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else
+        {
+            _hInputEvent = hInputEvent;
+        }
+    }
+
     if (SUCCEEDED(hr))
     {
         HANDLE hPaintEnabledEvent = CreateEventW(nullptr,
@@ -156,6 +192,13 @@ DWORD WINAPI RenderThread::s_ThreadProc(_In_ LPVOID lpParameter)
     }
 }
 
+// Method Description:
+// - Paints a frame whenever something is dirty.
+// - Frames that show the effect of input are painted right away. Other
+//      frames wait for the frame interval to pass since the last one, so that
+//      everything output in the meantime is painted at once.
+// - When nothing is dirty, the thread waits without a timeout, so it doesn't
+//      wake up until there's something to paint.
 DWORD WINAPI RenderThread::_ThreadProc()
 {
     while (_fKeepRunning)
@@ -163,27 +206,155 @@ DWORD WINAPI RenderThread::_ThreadProc()
         WaitForSingleObject(_hPaintEnabledEvent, INFINITE);
         WaitForSingleObject(_hEvent, INFINITE);
 
+        // The frame starts here, rather than after the wait for the frame
+        //      interval, so that WaitForPaintCompletionAndDisable can't slip
+        //      in while we're waiting, and return while we go on to paint.
         ResetEvent(_hPaintCompletedEvent);
 
+        if (_fKeepRunning && !_IsInputPending(clock::now()))
+        {
+            _WaitForFrameInterval();
+
+            // If painting was disabled while we waited, leave the frame for
+            //      when it's enabled again.
+            if (WaitForSingleObject(_hPaintEnabledEvent, 0) != WAIT_OBJECT_0)
+            {
+                SetEvent(_hEvent);
+                SetEvent(_hPaintCompletedEvent);
+                continue;
+            }
+        }
+
+        // Anything that asks for a paint from here on might not make it into
+        //      this frame, so it has to wake us up again.
+        ResetEvent(_hEvent);
+        ResetEvent(_hInputEvent);
+        const auto requests = _paintRequests.exchange(0);
+        const auto inputTime = _inputTime.exchange(0);
+
         LOG_IF_FAILED(_pRenderer->PaintFrame());
 
         SetEvent(_hPaintCompletedEvent);
 
-        // extra check before we sleep since it's a "long" activity, relatively speaking.
-        if (_fKeepRunning)
-        {
-            Sleep(s_FrameLimitMilliseconds);
-        }
+        _CountFrame(requests, inputTime);
     }
 
     return S_OK;
 }
 
+// Method Description:
+// - Checks whether there's input that the next frame should show right away.
+// Arguments:
+// - now - the current time
+// Return Value:
+// - true if input came in recently, and nothing was painted since.
+bool RenderThread::_IsInputPending(const clock::time_point now) const noexcept
+{
+    const auto inputTime = _inputTime.load();
+    return inputTime != 0 && now - clock::time_point{ clock::duration{ inputTime } } < s_InputWindow;
+}
+
+// Method Description:
+// - Waits until the frame interval has passed since the last frame, or until
+//      input comes in, whichever comes first.
+// - The input event can still be set for input that's past the input window
+//      by now, so waking up for it only ends the wait if there's input pending.
+void RenderThread::_WaitForFrameInterval()
+{
+    const auto nextFrame = _lastFrame + std::chrono::milliseconds{ _frameInterval.load() };
+    for (auto now = clock::now(); _fKeepRunning && now < nextFrame && !_IsInputPending(now); now = clock::now())
+    {
+        // Round up, so that we don't wake up just short of the interval and paint early.
+        const auto wait = std::chrono::ceil<std::chrono::milliseconds>(nextFrame - now);
+        WaitForSingleObject(_hInputEvent, gsl::narrow_cast<DWORD>(wait.count()));
+    }
+}
+
+// Method Description:
+// - Updates the counters after a frame was painted.
+// Arguments:
+// - requests - how many times we were asked to paint for this frame
+// - inputTime - when the oldest input this frame shows came in, or 0 if none
+void RenderThread::_CountFrame(const uint32_t requests, const clock::rep inputTime) noexcept
+{
+    _lastFrame = clock::now();
+    _frames++;
+
+    if (requests > 1)
+    {
+        _coalescedRequests += requests - 1;
+    }
+
+    if (inputTime != 0)
+    {
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(_lastFrame - clock::time_point{ clock::duration{ inputTime } });
+
+        // Input that took this long to get painted probably didn't change the screen at all.
+        if (latency < s_InputWindow)
+        {
+            _inputFrames++;
+            _lastInputLatency = latency.count();
+            _totalInputLatency += latency.count();
+            if (latency.count() > _maxInputLatency.load())
+            {
+                _maxInputLatency = latency.count();
+            }
+        }
+    }
+}
+
 void RenderThread::NotifyPaint()
 {
+    _paintRequests++;
     SetEvent(_hEvent);
 }
 
+// Method Description:
+// - Notes that input came in, so that the next frame is painted without
+//      waiting for the frame interval. Input doesn't ask for a paint by
+//      itself. The output that it causes does.
+void RenderThread::NotifyInput()
+{
+    // Only the oldest input that hasn't been painted yet counts for latency.
+    //      Input that's older than the input window doesn't count at all, so
+    //      its stamp is replaced, rather than keeping the next input from
+    //      being painted right away.
+    const auto now = clock::now();
+    const clock::rep stamp = std::max<clock::rep>(now.time_since_epoch().count(), 1);
+    clock::rep expected = _inputTime.load();
+    while (expected == 0 || now - clock::time_point{ clock::duration{ expected } } >= s_InputWindow)
+    {
+        if (_inputTime.compare_exchange_weak(expected, stamp))
+        {
+            break;
+        }
+    }
+    SetEvent(_hInputEvent);
+}
+
+// Method Description:
+// - Sets how often frames are painted for output that isn't caused by input.
+// Arguments:
+// - interval - the least time between two frames
+void RenderThread::SetFrameInterval(const std::chrono::milliseconds interval) noexcept
+{
+    _frameInterval = interval.count();
+}
+
+// Method Description:
+// - Gets what the thread has done so far.
+// Return Value:
+// - the counters
+RenderThreadCounters RenderThread::GetCounters() const noexcept
+{
+    return { _frames.load(),
+             _coalescedRequests.load(),
+             _inputFrames.load(),
+             std::chrono::microseconds{ _lastInputLatency.load() },
+             std::chrono::microseconds{ _maxInputLatency.load() },
+             std::chrono::microseconds{ _totalInputLatency.load() } };
+}
+
 void RenderThread::EnablePainting()
 {
     SetEvent(_hPaintEnabledEvent);
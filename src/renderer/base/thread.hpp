@@ -17,11 +17,15 @@ Author(s):
 #include "..\inc\IRenderer.hpp"
 #include "..\inc\IRenderThread.hpp"
 
+#include <chrono>
+
 namespace Microsoft::Console::Render
 {
     class RenderThread final : public IRenderThread
     {
     public:
+        using clock = std::chrono::steady_clock;
+
         RenderThread();
         virtual ~RenderThread() override;
 
@@ -29,24 +33,56 @@ namespace Microsoft::Console::Render
         HRESULT Initialize(_In_ IRenderer* const pRendererParent) noexcept;
 
         void NotifyPaint() override;
+        void NotifyInput() override;
 
         void EnablePainting() override;
         void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) override;
-        
+
+        void SetFrameInterval(const std::chrono::milliseconds interval) noexcept override;
+        RenderThreadCounters GetCounters() const noexcept override;
+
     private:
         static DWORD WINAPI s_ThreadProc(_In_ LPVOID lpParameter);
         DWORD WINAPI _ThreadProc();
 
-        static DWORD const s_FrameLimitMilliseconds = 8;
+        bool _IsInputPending(const clock::time_point now) const noexcept;
+        void _WaitForFrameInterval();
+        void _CountFrame(const uint32_t requests, const clock::rep inputTime) noexcept;
+
+        // Output is painted at most once per interval. Input isn't held back by it.
+        static constexpr std::chrono::milliseconds s_DefaultFrameInterval{ 8 };
+
+        // Input that nothing was painted for within this long probably didn't
+        //      change the screen, and doesn't speed up the next frame anymore.
+        static constexpr std::chrono::milliseconds s_InputWindow{ 100 };
 
         HANDLE _hThread;
         HANDLE _hEvent;
 
+        // Signaled on input, to cut a wait for the frame interval short.
+        HANDLE _hInputEvent;
+
         HANDLE _hPaintEnabledEvent;
         HANDLE _hPaintCompletedEvent;
 
         IRenderer* _pRenderer; // Non-ownership pointer
 
         bool _fKeepRunning;
+
+        std::atomic<std::chrono::milliseconds::rep> _frameInterval;
+        clock::time_point _lastFrame;
+
+        // How many times we were asked to paint since the last frame.
+        std::atomic<uint32_t> _paintRequests;
+
+        // When the oldest input that hasn't been painted yet came in, or 0 if there's none.
+        std::atomic<clock::rep> _inputTime;
+
+        std::atomic<uint64_t> _frames;
+        std::atomic<uint64_t> _coalescedRequests;
+        std::atomic<uint64_t> _inputFrames;
+        std::atomic<std::chrono::microseconds::rep> _lastInputLatency;
+        std::atomic<std::chrono::microseconds::rep> _maxInputLatency;
+        std::atomic<std::chrono::microseconds::rep> _totalInputLatency;
     };
 }
@@ -13,15 +13,42 @@ Author(s):
 --*/
 
 #pragma once
+
+#include <chrono>
+
 namespace Microsoft::Console::Render
 {
+    // What a render thread has done so far, for diagnosing how well it keeps up.
+    struct RenderThreadCounters
+    {
+        // How many frames were painted.
+        uint64_t frames;
+
+        // How many paint requests were folded into a frame along with
+        // other ones, instead of getting a frame of their own.
+        uint64_t coalescedRequests;
+
+        // How many frames were painted right away because of input.
+        uint64_t inputFrames;
+
+        // How long it took from input to the end of the frame that
+        // followed it: the last time, the longest time, and all of
+        // them added up, over the inputFrames.
+        std::chrono::microseconds lastInputLatency;
+        std::chrono::microseconds maxInputLatency;
+        std::chrono::microseconds totalInputLatency;
+    };
+
     class IRenderThread
     {
     public:
         virtual ~IRenderThread() = 0;
         virtual void NotifyPaint() = 0;
+        virtual void NotifyInput() = 0;
         virtual void EnablePainting() = 0;
         virtual void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) = 0;
+        virtual void SetFrameInterval(const std::chrono::milliseconds interval) noexcept = 0;
+        virtual RenderThreadCounters GetCounters() const noexcept = 0;
     };
 
     inline Microsoft::Console::Render::IRenderThread::~IRenderThread() { };
@@ -17,6 +17,7 @@ Author(s):
 #include "FontInfoDesired.hpp"
 #include "IRenderEngine.hpp"
 #include "IRenderTarget.hpp"
+#include "IRenderThread.hpp"
 #include "../types/inc/viewport.hpp"
 
 namespace Microsoft::Console::Render
@@ -43,6 +44,7 @@ namespace Microsoft::Console::Render
         virtual void TriggerScroll(const COORD* const pcoordDelta) = 0;
         virtual void TriggerCircling() = 0;
         virtual void TriggerTitleChange() = 0;
+        virtual void TriggerPaint() = 0;
         virtual void TriggerFontChange(const int iDpi,
                                        const FontInfoDesired& FontInfoDesired,
                                        _Out_ FontInfo& FontInfo) = 0;
@@ -54,9 +56,14 @@ namespace Microsoft::Console::Render
 
         virtual bool IsGlyphWideByFont(const std::wstring_view glyph) = 0;
 
+        virtual void NotifyInput() = 0;
+
         virtual void EnablePainting() = 0;
         virtual void WaitForPaintCompletionAndDisable(const DWORD dwTimeoutMs) = 0;
 
+        virtual void SetFrameInterval(const std::chrono::milliseconds interval) noexcept = 0;
+        virtual RenderThreadCounters GetRenderThreadCounters() const noexcept = 0;
+
         virtual void AddRenderEngine(_In_ IRenderEngine* const pEngine) = 0;
     };
 
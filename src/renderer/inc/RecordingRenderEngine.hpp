@@ -0,0 +1,307 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- RecordingRenderEngine.hpp
+
+Abstract:
+- Provides a headless implementation of the IRenderEngine interface, which
+    draws nothing, but records every PaintBufferLine, UpdateDrawingBrushes and
+    PaintCursor call it gets, along with when it got them.
+- This is used to measure the renderer on its own, without the cost of any
+    real drawing, like in the RenderBenchmark tool.
+- The recordings are kept in vectors that keep their memory when cleared, so
+    calling Clear() after looking at each frame keeps the engine from
+    allocating while it's being measured.
+--*/
+
+#pragma once
+#include "RenderEngineBase.hpp"
+#include "../../types/inc/viewport.hpp"
+
+#include <chrono>
+
+namespace Microsoft::Console::Render
+{
+    class RecordingRenderEngine final : public RenderEngineBase
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        enum class CallKind
+        {
+            PaintBufferLine,
+            UpdateDrawingBrushes,
+            PaintCursor
+        };
+
+        struct RecordedCall
+        {
+            CallKind kind;
+
+            // How long after the start of the frame the call was made.
+            clock::duration elapsed;
+
+            // PaintBufferLine: where the line was drawn. PaintCursor: where the cursor was drawn.
+            COORD coord;
+
+            // PaintBufferLine: how many clusters, and how many columns they cover.
+            size_t clusters;
+            size_t columns;
+
+            // UpdateDrawingBrushes: the new colors.
+            COLORREF foreground;
+            COLORREF background;
+        };
+
+        struct RecordedFrame
+        {
+            // How long it took from StartPaint to EndPaint.
+            clock::duration duration;
+
+            // Which of the recorded calls were made during this frame.
+            size_t firstCall;
+            size_t callCount;
+        };
+
+        RecordingRenderEngine() :
+            RenderEngineBase(),
+            _view{ Microsoft::Console::Types::Viewport::Empty() },
+            _dirty{},
+            _isDirty{ false },
+            _frameStart{},
+            _calls{},
+            _frames{}
+        {
+        }
+
+        ~RecordingRenderEngine() override = default;
+
+        const std::vector<RecordedCall>& GetCalls() const noexcept { return _calls; }
+        const std::vector<RecordedFrame>& GetFrames() const noexcept { return _frames; }
+
+        // Forgets everything recorded so far, but keeps the memory for the next frames.
+        void Clear() noexcept
+        {
+            _calls.clear();
+            _frames.clear();
+        }
+
+        [[nodiscard]]
+        HRESULT StartPaint() noexcept override
+        {
+            if (!_isDirty)
+            {
+                return S_FALSE;
+            }
+
+            _frameStart = clock::now();
+            try
+            {
+                _frames.push_back({ {}, _calls.size(), 0 });
+            }
+            CATCH_RETURN();
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT EndPaint() noexcept override
+        {
+            if (!_frames.empty())
+            {
+                auto& frame = _frames.back();
+                frame.duration = clock::now() - _frameStart;
+                frame.callCount = _calls.size() - frame.firstCall;
+            }
+            _isDirty = false;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT Present() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept override
+        {
+            *pForcePaint = false;
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT ScrollFrame() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT Invalidate(const SMALL_RECT* const psrRegion) noexcept override
+        {
+            // The region is exclusive, our dirty rect is inclusive.
+            _InvalidateInclusive({ psrRegion->Left,
+                                   psrRegion->Top,
+                                   static_cast<SHORT>(psrRegion->Right - 1),
+                                   static_cast<SHORT>(psrRegion->Bottom - 1) });
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateCursor(const COORD* const pcoordCursor) noexcept override
+        {
+            _InvalidateInclusive({ pcoordCursor->X, pcoordCursor->Y, pcoordCursor->X, pcoordCursor->Y });
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateSystem(const RECT* const /*prcDirtyClient*/) noexcept override { return InvalidateAll(); }
+
+        [[nodiscard]]
+        HRESULT InvalidateSelection(const std::vector<SMALL_RECT>& rectangles) noexcept override
+        {
+            for (const auto& rect : rectangles)
+            {
+                _InvalidateInclusive(rect);
+            }
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateScroll(const COORD* const /*pcoordDelta*/) noexcept override { return InvalidateAll(); }
+
+        [[nodiscard]]
+        HRESULT InvalidateAll() noexcept override
+        {
+            _InvalidateInclusive(_view.ToOrigin().ToInclusive());
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT InvalidateCircling(_Out_ bool* const pForcePaint) noexcept override
+        {
+            *pForcePaint = false;
+            return InvalidateAll();
+        }
+
+        [[nodiscard]]
+        HRESULT PaintBackground() noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PaintBufferLine(std::basic_string_view<Cluster> const clusters,
+                                const COORD coord,
+                                const bool /*fTrimLeft*/) noexcept override
+        {
+            size_t columns = 0;
+            for (const auto& cluster : clusters)
+            {
+                columns += cluster.GetColumns();
+            }
+            return _Record({ CallKind::PaintBufferLine, {}, coord, clusters.size(), columns, 0, 0 });
+        }
+
+        [[nodiscard]]
+        HRESULT PaintBufferGridLines(const GridLines /*lines*/,
+                                     const COLORREF /*color*/,
+                                     const size_t /*cchLine*/,
+                                     const COORD /*coordTarget*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PaintSelection(const SMALL_RECT /*rect*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT PaintCursor(const CursorOptions& options) noexcept override
+        {
+            return _Record({ CallKind::PaintCursor, {}, options.coordCursor, 0, 0, 0, 0 });
+        }
+
+        [[nodiscard]]
+        HRESULT UpdateDrawingBrushes(const COLORREF colorForeground,
+                                     const COLORREF colorBackground,
+                                     const WORD /*legacyColorAttribute*/,
+                                     const bool /*isBold*/,
+                                     const bool /*isSettingDefaultBrushes*/) noexcept override
+        {
+            return _Record({ CallKind::UpdateDrawingBrushes, {}, {}, 0, 0, colorForeground, colorBackground });
+        }
+
+        [[nodiscard]]
+        HRESULT UpdateFont(const FontInfoDesired& /*FontInfoDesired*/,
+                           _Out_ FontInfo& /*FontInfo*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT UpdateDpi(const int /*iDpi*/) noexcept override { return S_OK; }
+
+        [[nodiscard]]
+        HRESULT UpdateViewport(const SMALL_RECT srNewViewport) noexcept override
+        {
+            _view = Microsoft::Console::Types::Viewport::FromInclusive(srNewViewport);
+            return InvalidateAll();
+        }
+
+        [[nodiscard]]
+        HRESULT GetProposedFont(const FontInfoDesired& /*FontInfoDesired*/,
+                                _Out_ FontInfo& /*FontInfo*/,
+                                const int /*iDpi*/) noexcept override { return S_OK; }
+
+        SMALL_RECT GetDirtyRectInChars() override
+        {
+            return _isDirty ? _dirty : SMALL_RECT{};
+        }
+
+        [[nodiscard]]
+        HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override
+        {
+            *pFontSize = { 1, 1 };
+            return S_OK;
+        }
+
+        [[nodiscard]]
+        HRESULT IsGlyphWideByFont(const std::wstring_view /*glyph*/, _Out_ bool* const pResult) noexcept override
+        {
+            *pResult = false;
+            return S_OK;
+        }
+
+    protected:
+        [[nodiscard]]
+        HRESULT _DoUpdateTitle(const std::wstring& /*newTitle*/) noexcept override { return S_OK; }
+
+    private:
+        Microsoft::Console::Types::Viewport _view;
+        SMALL_RECT _dirty;
+        bool _isDirty;
+
+        clock::time_point _frameStart;
+        std::vector<RecordedCall> _calls;
+        std::vector<RecordedFrame> _frames;
+
+        void _InvalidateInclusive(const SMALL_RECT rect) noexcept
+        {
+            if (rect.Left > rect.Right || rect.Top > rect.Bottom)
+            {
+                return;
+            }
+
+            if (_isDirty)
+            {
+                _dirty.Left = std::min(_dirty.Left, rect.Left);
+                _dirty.Top = std::min(_dirty.Top, rect.Top);
+                _dirty.Right = std::max(_dirty.Right, rect.Right);
+                _dirty.Bottom = std::max(_dirty.Bottom, rect.Bottom);
+            }
+            else
+            {
+                _dirty = rect;
+                _isDirty = true;
+            }
+        }
+
+        [[nodiscard]]
+        HRESULT _Record(RecordedCall call) noexcept
+        {
+            call.elapsed = clock::now() - _frameStart;
+            try
+            {
+                _calls.push_back(call);
+            }
+            CATCH_RETURN();
+            return S_OK;
+        }
+    };
+}
@@ -33,6 +33,8 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT UpdateTitle(const std::wstring& newTitle) noexcept override;
 
+        std::vector<SMALL_RECT> GetDirtyArea() override;
+
     protected:
         [[nodiscard]]
         virtual HRESULT _DoUpdateTitle(const std::wstring& newTitle) noexcept = 0;
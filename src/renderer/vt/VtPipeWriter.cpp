@@ -0,0 +1,277 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "VtPipeWriter.hpp"
+
+#pragma hdrstop
+
+using namespace Microsoft::Console::Render;
+
+// Constructor Description:
+// - Creates a writer for the given pipe. Nothing is written until Start is called.
+// Arguments:
+// - hPipe - a handle to the write end of the VT output pipe.
+VtPipeWriter::VtPipeWriter(_In_ wil::unique_hfile hPipe) :
+    _hFile{ std::move(hPipe) },
+    _hThread{},
+    _pending{},
+    _writing{},
+    _isWriting{ false },
+    _heldBack{ false },
+    _stopping{ false },
+    _result{ S_OK },
+    _pfnRepaint{},
+    _bytesWritten{ 0 },
+    _maxBytesQueued{ 0 },
+    _framesHeldBack{ 0 },
+    _stallTime{}
+{
+    THROW_HR_IF(E_HANDLE, _hFile.get() == INVALID_HANDLE_VALUE);
+}
+
+// Destructor Description:
+// - Lets the writer thread finish writing whatever's queued, and waits for
+//      it to exit. If the terminal isn't reading anymore, the pending write is
+//      cancelled, so that we don't wait for it forever.
+VtPipeWriter::~VtPipeWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard{ _lock };
+        _stopping = true;
+    }
+    _queued.notify_all();
+
+    if (_hThread)
+    {
+        if (WaitForSingleObject(_hThread.get(), s_ShutdownTimeoutMs) == WAIT_TIMEOUT)
+        {
+            CancelSynchronousIo(_hThread.get());
+            WaitForSingleObject(_hThread.get(), INFINITE);
+        }
+    }
+}
+
+// Method Description:
+// - Starts the thread that writes to the pipe.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK if we started the thread, else an appropriate HRESULT.
+[[nodiscard]]
+HRESULT VtPipeWriter::Start() noexcept
+{
+    HANDLE hThread = CreateThread(nullptr,
+                                  0,
+                                  VtPipeWriter::s_WriterThreadProc,
+                                  this,
+                                  0,
+                                  nullptr);
+
+    RETURN_LAST_ERROR_IF_NULL(hThread);
+    _hThread.reset(hThread);
+
+    return S_OK;
+}
+
+// Method Description:
+// - Queues the contents of the buffer to be written to the pipe. If the
+//      previous buffer hasn't been picked up by the writer yet, this is added
+//      to the end of it. If that would make it more than s_MaxPendingBytes,
+//      this waits for the writer to pick it up first, so that a terminal
+//      that's slow to read slows down the output, rather than let it pile up.
+// - The buffer is swapped with an empty one when possible, so that the
+//      caller keeps reusing the same two allocations.
+// Arguments:
+// - buffer - the bytes to write. Empty when this returns.
+// Return Value:
+// - S_OK, or the HRESULT that an earlier write failed with. Once a write has
+//      failed, nothing is written anymore.
+[[nodiscard]]
+HRESULT VtPipeWriter::Submit(std::string& buffer) noexcept
+{
+    try
+    {
+        {
+            std::unique_lock<std::mutex> lock{ _lock };
+            _taken.wait(lock, [&]() { return FAILED(_result) || _pending.empty() || _pending.size() + buffer.size() <= s_MaxPendingBytes; });
+            RETURN_IF_FAILED(_result);
+
+            if (_pending.empty())
+            {
+                _pending.swap(buffer);
+            }
+            else
+            {
+                _pending.append(buffer);
+            }
+            buffer.clear();
+
+            const auto queued = _pending.size() + _writing.size();
+            _maxBytesQueued = std::max(_maxBytesQueued, queued);
+        }
+        _queued.notify_one();
+
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
+// Method Description:
+// - Waits until everything that was submitted has been written to the pipe.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or the HRESULT that a write failed with.
+[[nodiscard]]
+HRESULT VtPipeWriter::WaitForDrain() noexcept
+{
+    try
+    {
+        std::unique_lock<std::mutex> lock{ _lock };
+        _drained.wait(lock, [this]() { return FAILED(_result) || (_pending.empty() && !_isWriting); });
+        return _result;
+    }
+    CATCH_RETURN();
+}
+
+// Method Description:
+// - Checks whether the writer is still behind on the previous frame. If it
+//      is, the caller should skip painting for now, and will be asked to
+//      repaint through the repaint callback once the writer catches up.
+// Arguments:
+// - <none>
+// Return Value:
+// - true if the caller should hold off painting this frame.
+bool VtPipeWriter::HoldFrameIfBehind() noexcept
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    if (_pending.empty() || FAILED(_result))
+    {
+        return false;
+    }
+
+    _heldBack = true;
+    _framesHeldBack++;
+    return true;
+}
+
+// Method Description:
+// - Gets the result of the writes so far.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK, or the HRESULT that a write failed with.
+[[nodiscard]]
+HRESULT VtPipeWriter::GetResult() const noexcept
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    return _result;
+}
+
+// Method Description:
+// - Gets what the writer has done so far.
+// Arguments:
+// - <none>
+// Return Value:
+// - the counters
+VtPipeWriter::Counters VtPipeWriter::GetCounters() const noexcept
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    return { _bytesWritten,
+             _pending.size() + _writing.size(),
+             _maxBytesQueued,
+             _framesHeldBack,
+             std::chrono::duration_cast<std::chrono::microseconds>(_stallTime) };
+}
+
+// Method Description:
+// - Sets the function to call when a frame was held back, and can be painted
+//      now. It's called on the writer thread, and shouldn't do more than ask
+//      for a paint.
+// Arguments:
+// - pfn - the function to call
+// Return Value:
+// - <none>
+void VtPipeWriter::SetRepaintCallback(std::function<void()> pfn)
+{
+    std::lock_guard<std::mutex> guard{ _lock };
+    _pfnRepaint = std::move(pfn);
+}
+
+// Method Description:
+// - Static function used for initializing an instance's ThreadProc.
+// Arguments:
+// - lpParameter - A pointer to the VtPipeWriter instance that should be called.
+// Return Value:
+// - The return value of the underlying instance's _WriterThread
+DWORD WINAPI VtPipeWriter::s_WriterThreadProc(_In_ LPVOID lpParameter)
+{
+    VtPipeWriter* const pWriter = reinterpret_cast<VtPipeWriter*>(lpParameter);
+    return pWriter->_WriterThread();
+}
+
+// Method Description:
+// - Writes whatever's pending to the pipe, until we're told to stop and
+//      everything has been written, or until a write fails.
+// Arguments:
+// - <none>
+// Return Value:
+// - 0 if everything was written, or the HRESULT of the failed write.
+DWORD VtPipeWriter::_WriterThread()
+{
+    std::unique_lock<std::mutex> lock{ _lock };
+    while (true)
+    {
+        _queued.wait(lock, [this]() { return !_pending.empty() || _stopping; });
+        if (_pending.empty())
+        {
+            break;
+        }
+
+        _writing.swap(_pending);
+        _isWriting = true;
+        lock.unlock();
+        _taken.notify_all();
+
+        const auto start = clock::now();
+        DWORD dwWritten = 0;
+        const bool fSuccess = !!WriteFile(_hFile.get(), _writing.data(), gsl::narrow_cast<DWORD>(_writing.size()), &dwWritten, nullptr);
+        const HRESULT hr = fSuccess ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+        const auto stall = clock::now() - start;
+
+        lock.lock();
+        _bytesWritten += dwWritten;
+        _stallTime += stall;
+        _writing.clear();
+        _isWriting = false;
+        _result = hr;
+
+        // A frame held back while we were writing can be painted now. So can
+        //      one that was held back when this write failed, so that the
+        //      engine finds out that the pipe is broken.
+        std::function<void()> pfnRepaint;
+        if (_heldBack && (_pending.empty() || FAILED(hr)))
+        {
+            _heldBack = false;
+            pfnRepaint = _pfnRepaint;
+        }
+
+        if (pfnRepaint)
+        {
+            lock.unlock();
+            pfnRepaint();
+            lock.lock();
+        }
+        _drained.notify_all();
+
+        if (FAILED(hr))
+        {
+            break;
+        }
+    }
+
+    _taken.notify_all();
+    _drained.notify_all();
+    return SUCCEEDED(_result) ? 0 : _result;
+}
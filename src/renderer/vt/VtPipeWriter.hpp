@@ -0,0 +1,112 @@
+/*++
+Copyright (c) Microsoft Corporation
+Licensed under the MIT license.
+
+Module Name:
+- VtPipeWriter.hpp
+
+Abstract:
+- Writes the output of the VtEngine to its pipe on a thread of its own, so
+    that a terminal that's slow to read doesn't hold up the render thread, and
+    through the console lock, the client application.
+- There are two buffers. The writer thread drains one of them into the pipe
+    while the engine fills the other one with the next frame.
+- If the engine finishes another frame while the previous one is still
+    waiting to be written, it should hold off painting instead. Everything it
+    didn't paint stays invalid, so the frames it skipped are all painted at
+    once, as soon as the writer catches up and calls the repaint callback.
+- Output that can't be held back, like what's passed through to the
+    terminal, is appended to what's already waiting. Once that's more than
+    s_MaxPendingBytes, Submit waits for the writer to take it, the same way
+    a write straight to the pipe would have.
+--*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+
+namespace Microsoft::Console::Render
+{
+    class VtPipeWriter final
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // What the writer has done so far, for diagnosing slow terminals.
+        struct Counters
+        {
+            // How many bytes were written to the pipe.
+            uint64_t bytesWritten;
+
+            // How many bytes are waiting to be written right now, and the most
+            // there ever were.
+            size_t bytesQueued;
+            size_t maxBytesQueued;
+
+            // How many frames the engine held off on because the writer was behind.
+            uint64_t framesHeldBack;
+
+            // How long the writer spent waiting for the terminal to read.
+            std::chrono::microseconds stallTime;
+        };
+
+        VtPipeWriter(_In_ wil::unique_hfile hPipe);
+        ~VtPipeWriter();
+
+        [[nodiscard]]
+        HRESULT Start() noexcept;
+
+        [[nodiscard]]
+        HRESULT Submit(std::string& buffer) noexcept;
+        [[nodiscard]]
+        HRESULT WaitForDrain() noexcept;
+
+        bool HoldFrameIfBehind() noexcept;
+        [[nodiscard]]
+        HRESULT GetResult() const noexcept;
+        Counters GetCounters() const noexcept;
+
+        void SetRepaintCallback(std::function<void()> pfn);
+
+    private:
+        static DWORD WINAPI s_WriterThreadProc(_In_ LPVOID lpParameter);
+        DWORD _WriterThread();
+
+        // How long the destructor gives the writer to finish up, before
+        //      cancelling a write the terminal isn't reading.
+        static constexpr DWORD s_ShutdownTimeoutMs = 1000;
+
+        // How much Submit lets pile up behind the write in progress, before
+        //      it waits for the writer.
+        static constexpr size_t s_MaxPendingBytes = 1024 * 1024;
+
+        wil::unique_hfile _hFile;
+        wil::unique_handle _hThread;
+
+        mutable std::mutex _lock;
+        std::condition_variable _queued;
+        std::condition_variable _taken;
+        std::condition_variable _drained;
+
+        // Filled by the engine, waiting for the writer.
+        std::string _pending;
+        // Owned by the writer thread while it's writing it.
+        std::string _writing;
+        bool _isWriting;
+
+        bool _heldBack;
+        bool _stopping;
+        HRESULT _result;
+        std::function<void()> _pfnRepaint;
+
+        uint64_t _bytesWritten;
+        size_t _maxBytesQueued;
+        uint64_t _framesHeldBack;
+        clock::duration _stallTime;
+
+    #ifdef UNIT_TESTING
+        friend class VtRendererTest;
+    #endif
+    };
+}
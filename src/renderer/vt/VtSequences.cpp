@@ -87,9 +87,7 @@ HRESULT VtEngine::_EraseLine() noexcept
 [[nodiscard]]
 HRESULT VtEngine::_EraseCharacter(const short chars) noexcept
 {
-    static const std::string format = "\x1b[%dX";
-
-    return _WriteFormattedString(&format, chars);
+    return _WriteCsi("X", chars);
 }
 
 // Method Description:
@@ -101,10 +99,7 @@ HRESULT VtEngine::_EraseCharacter(const short chars) noexcept
 [[nodiscard]]
 HRESULT VtEngine::_CursorForward(const short chars) noexcept
 {
-
-    static const std::string format = "\x1b[%dC";
-
-    return _WriteFormattedString(&format, chars);
+    return _WriteCsi("C", chars);
 }
 
 // Method Description:
@@ -139,9 +134,7 @@ HRESULT VtEngine::_InsertDeleteLine(const short sLines, const bool fInsertLine)
     {
         return _Write(fInsertLine ? "\x1b[L" : "\x1b[M");
     }
-    const std::string format = fInsertLine ? "\x1b[%dL" : "\x1b[%dM";
-
-    return _WriteFormattedString(&format, sLines);
+    return fInsertLine ? _WriteCsi("L", sLines) : _WriteCsi("M", sLines);
 }
 
 // Method Description:
@@ -181,14 +174,12 @@ HRESULT VtEngine::_InsertLine(const short sLines) noexcept
 [[nodiscard]]
 HRESULT VtEngine::_CursorPosition(const COORD coord) noexcept
 {
-    static const std::string cursorFormat = "\x1b[%d;%dH";
-
     // VT coords start at 1,1
     COORD coordVt = coord;
     coordVt.X++;
     coordVt.Y++;
 
-    return _WriteFormattedString(&cursorFormat, coordVt.Y, coordVt.X);
+    return _WriteCsi("H", coordVt.Y, coordVt.X);
 }
 
 // Method Description:
@@ -212,8 +203,7 @@ HRESULT VtEngine::_CursorHome() noexcept
 [[nodiscard]]
 HRESULT VtEngine::_SetGraphicsBoldness(const bool isBold) noexcept
 {
-    const std::string fmt = isBold ? "\x1b[1m" : "\x1b[22m";
-    return _Write(fmt);
+    return _Write(isBold ? "\x1b[1m" : "\x1b[22m");
 }
 
 // Method Description:
@@ -239,8 +229,6 @@ HRESULT VtEngine::_SetGraphicsDefault() noexcept
 HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
                                                const bool fIsForeground) noexcept
 {
-    static const std::string fmt = "\x1b[%dm";
-
     // Always check using the foreground flags, because the bg flags constants
     //  are a higher byte
     // Foreground sequences are in [30,37] U [90,97]
@@ -260,7 +248,7 @@ HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
                         + (WI_IsFlagSet(wAttr, FOREGROUND_GREEN) ? 2 : 0)
                         + (WI_IsFlagSet(wAttr, FOREGROUND_BLUE) ? 4 : 0);
 
-    return _WriteFormattedString(&fmt, vtIndex);
+    return _WriteCsi("m", vtIndex);
 }
 
 // Method Description:
@@ -275,15 +263,13 @@ HRESULT VtEngine::_SetGraphicsRendition16Color(const WORD wAttr,
 HRESULT VtEngine::_SetGraphicsRenditionRGBColor(const COLORREF color,
                                                 const bool fIsForeground) noexcept
 {
-    const std::string fmt = fIsForeground ?
-        "\x1b[38;2;%d;%d;%dm" :
-        "\x1b[48;2;%d;%d;%dm";
+    const int selector = fIsForeground ? 38 : 48;
 
-    DWORD const r = GetRValue(color);
-    DWORD const g = GetGValue(color);
-    DWORD const b = GetBValue(color);
+    BYTE const r = GetRValue(color);
+    BYTE const g = GetGValue(color);
+    BYTE const b = GetBValue(color);
 
-    return _WriteFormattedString(&fmt, r, g, b);
+    return _WriteCsi("m", selector, 2, r, g, b);
 }
 
 // Method Description:
@@ -296,9 +282,7 @@ HRESULT VtEngine::_SetGraphicsRenditionRGBColor(const COLORREF color,
 [[nodiscard]]
 HRESULT VtEngine::_SetGraphicsRenditionDefaultColor(const bool fIsForeground) noexcept
 {
-    const std::string fmt = fIsForeground ? ("\x1b[39m") : ("\x1b[49m");
-
-    return _Write(fmt);
+    return _Write(fIsForeground ? "\x1b[39m" : "\x1b[49m");
 }
 
 // Method Description:
@@ -311,13 +295,12 @@ HRESULT VtEngine::_SetGraphicsRenditionDefaultColor(const bool fIsForeground) no
 [[nodiscard]]
 HRESULT VtEngine::_ResizeWindow(const short sWidth, const short sHeight) noexcept
 {
-    static const std::string resizeFormat = "\x1b[8;%d;%dt";
     if (sWidth < 0 || sHeight < 0)
     {
         return E_INVALIDARG;
     }
 
-    return _WriteFormattedString(&resizeFormat, sHeight, sWidth);
+    return _WriteCsi("t", 8, sHeight, sWidth);
 }
 
 // Method Description:
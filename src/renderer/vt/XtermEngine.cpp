@@ -21,7 +21,9 @@ XtermEngine::XtermEngine(_In_ wil::unique_hfile hPipe,
     _fUseAsciiOnly(fUseAsciiOnly),
     _previousLineWrapped(false),
     _usingUnderLine(false),
-    _needToDisableCursor(false)
+    _needToDisableCursor(false),
+    _frameDiffing(false),
+    _shadow{}
 {
     // Set out initial cursor position to -1, -1. This will force our initial
     //      paint to manually move the cursor to 0, 0, not just ignore it.
@@ -43,6 +45,11 @@ HRESULT XtermEngine::StartPaint() noexcept
 {
     RETURN_IF_FAILED(VtEngine::StartPaint());
 
+    if (_frameHeldBack)
+    {
+        return S_FALSE;
+    }
+
     _trace.TraceLastText(_lastText);
 
     if (_firstPaint)
@@ -55,6 +62,7 @@ HRESULT XtermEngine::StartPaint() noexcept
         RETURN_IF_FAILED(_ClearScreen());
         _clearedAllThisFrame = true;
         _firstPaint = false;
+        _InvalidateShadow();
     }
     else
     {
@@ -68,6 +76,12 @@ HRESULT XtermEngine::StartPaint() noexcept
             // solution, see that work item for a description why.
             RETURN_IF_FAILED(_ClearScreen());
             _clearedAllThisFrame = true;
+            _InvalidateShadow();
+
+            // The bounding rect of what's invalid covers the whole viewport,
+            //      but some rows between its edges might not be invalid themselves.
+            //      They've been cleared now too, so they need to be repainted.
+            RETURN_IF_FAILED(_InvalidCombine(_lastViewport.ToOrigin()));
         }
     }
 
@@ -325,6 +339,16 @@ HRESULT XtermEngine::ScrollFrame() noexcept
         }
     }
 
+    if (SUCCEEDED(hr))
+    {
+        _ScrollShadow(dy);
+    }
+    else
+    {
+        // We don't know how much of the scroll made it to the terminal.
+        _InvalidateShadow();
+    }
+
     return hr;
 }
 
@@ -389,12 +413,300 @@ HRESULT XtermEngine::InvalidateScroll(const COORD* const pcoordDelta) noexcept
 HRESULT XtermEngine::PaintBufferLine(std::basic_string_view<Cluster> const clusters,
                                      const COORD coord,
                                      const bool /*trimLeft*/) noexcept
+{
+    return _frameDiffing ?
+        _PaintChangedClusters(clusters, coord) :
+        _PaintClusters(clusters, coord);
+}
+
+// Routine Description:
+// - Writes the clusters to the pipe, in either ascii-only or utf-8, depending
+//      on our mode.
+// Arguments:
+// - clusters - text and column counts for each piece of text.
+// - coord - character coordinate target to render within viewport
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]]
+HRESULT XtermEngine::_PaintClusters(std::basic_string_view<Cluster> const clusters,
+                                    const COORD coord) noexcept
 {
     return _fUseAsciiOnly ?
         VtEngine::_PaintAsciiBufferLine(clusters, coord) :
         VtEngine::_PaintUtf8BufferLine(clusters, coord);
 }
 
+// Routine Description:
+// - Draws one line of the buffer, but only writes the clusters that are
+//      different from what we've already written to the terminal, according to
+//      our shadow copy of it. The cursor is moved forward over the unchanged
+//      spans, unless the span is short enough that it's cheaper to just write
+//      it again.
+// Arguments:
+// - clusters - text and column counts for each piece of text.
+// - coord - character coordinate target to render within viewport
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
+[[nodiscard]]
+HRESULT XtermEngine::_PaintChangedClusters(std::basic_string_view<Cluster> const clusters,
+                                           const COORD coord) noexcept
+{
+    if (coord.Y < _virtualTop)
+    {
+        return S_OK;
+    }
+
+    try
+    {
+        const size_t width = _lastViewport.Width();
+        const size_t height = _lastViewport.Height();
+        if (_shadow.size() != width * height)
+        {
+            _shadow.clear();
+            _shadow.resize(width * height);
+        }
+
+        if (coord.X < 0 || static_cast<size_t>(coord.Y) >= height)
+        {
+            // We can't keep track of anything outside the viewport.
+            return _PaintClusters(clusters, coord);
+        }
+
+        const size_t rowStart = coord.Y * width;
+        size_t x = coord.X;
+        size_t i = 0;
+        while (i < clusters.size())
+        {
+            // Skip over whatever's already on the screen.
+            if (_ShadowMatches(rowStart, x, clusters.at(i)))
+            {
+                x += clusters.at(i).GetColumns();
+                i++;
+                continue;
+            }
+
+            // Find the end of this run of changes. Unchanged gaps that are
+            //      too short to be worth moving the cursor over are included.
+            const size_t runStart = i;
+            const size_t runX = x;
+            size_t runEnd = i;
+            size_t gapColumns = 0;
+            while (i < clusters.size())
+            {
+                const auto columns = clusters.at(i).GetColumns();
+                if (_ShadowMatches(rowStart, x, clusters.at(i)))
+                {
+                    gapColumns += columns;
+                    if (gapColumns > CURSOR_FORWARD_STRING_LENGTH)
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    gapColumns = 0;
+                    runEnd = i + 1;
+                }
+                x += columns;
+                i++;
+            }
+
+            const std::basic_string_view<Cluster> run{ clusters.data() + runStart, runEnd - runStart };
+            RETURN_IF_FAILED(_PaintClusters(run, { gsl::narrow<SHORT>(runX), coord.Y }));
+            _UpdateShadow(rowStart, runX, run);
+        }
+
+        return S_OK;
+    }
+    CATCH_RETURN();
+}
+
+// Routine Description:
+// - Returns true if the cluster, drawn with the current brushes at column x of
+//      the row starting at rowStart, is already on the terminal.
+// Arguments:
+// - rowStart - index of the first cell of the row in _shadow
+// - x - column the cluster would be drawn at
+// - cluster - the text to check
+// Return Value:
+// - true if we don't need to write the cluster again.
+bool XtermEngine::_ShadowMatches(const size_t rowStart,
+                                 const size_t x,
+                                 const Cluster& cluster) const
+{
+    const size_t width = _lastViewport.Width();
+    const auto columns = cluster.GetColumns();
+    if (columns == 0 || x + columns > width)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < columns; i++)
+    {
+        const auto& cell = _shadow.at(rowStart + x + i);
+        const auto text = i == 0 ? cluster.GetText() : std::wstring_view{};
+        if (!cell.isKnown ||
+            cell.columns != (i == 0 ? columns : 0) ||
+            cell.text != text ||
+            cell.foreground != _LastFG ||
+            cell.background != _LastBG ||
+            cell.isBold != _lastWasBold ||
+            cell.isUnderlined != _usingUnderLine)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Routine Description:
+// - Records that we've written the clusters with the current brushes, starting
+//      at column x of the row starting at rowStart.
+// Arguments:
+// - rowStart - index of the first cell of the row in _shadow
+// - x - column the clusters were drawn at
+// - clusters - the text that was written
+// Return Value:
+// - <none>
+void XtermEngine::_UpdateShadow(const size_t rowStart,
+                                size_t x,
+                                std::basic_string_view<Cluster> const clusters)
+{
+    const size_t width = _lastViewport.Width();
+
+    // If we wrote over half of a wide glyph, the other half is gone too, and
+    //      we don't know what the terminal put there instead.
+    if (x > 0 && x < width && _shadow.at(rowStart + x).isKnown && _shadow.at(rowStart + x).columns == 0)
+    {
+        _shadow.at(rowStart + x - 1).isKnown = false;
+    }
+
+    for (const auto& cluster : clusters)
+    {
+        const auto columns = cluster.GetColumns();
+        for (size_t i = 0; i < columns && x + i < width; i++)
+        {
+            auto& cell = _shadow.at(rowStart + x + i);
+            if (i == 0)
+            {
+                cell.text.assign(cluster.GetText());
+            }
+            else
+            {
+                cell.text.clear();
+            }
+            cell.columns = i == 0 ? columns : 0;
+            cell.foreground = _LastFG;
+            cell.background = _LastBG;
+            cell.isBold = _lastWasBold;
+            cell.isUnderlined = _usingUnderLine;
+            cell.isKnown = true;
+        }
+        x += columns;
+    }
+
+    if (x < width && _shadow.at(rowStart + x).isKnown && _shadow.at(rowStart + x).columns == 0)
+    {
+        _shadow.at(rowStart + x).isKnown = false;
+    }
+}
+
+// Routine Description:
+// - Moves the rows of our shadow copy of the terminal by dy rows, the same way
+//      ScrollFrame moved the terminal's contents. The rows that scrolled into
+//      view aren't known.
+// Arguments:
+// - dy - the number of rows the contents moved down by. Negative to move up.
+// Return Value:
+// - <none>
+void XtermEngine::_ScrollShadow(const short dy) noexcept
+{
+    const size_t width = _lastViewport.Width();
+    const size_t height = _lastViewport.Height();
+    if (dy == 0 || _shadow.size() != width * height)
+    {
+        // If the shadow doesn't match the viewport, it'll be reset on the
+        //      next paint anyways.
+        return;
+    }
+
+    const size_t absDy = static_cast<size_t>(abs(dy));
+    if (absDy >= height)
+    {
+        _InvalidateShadow();
+        return;
+    }
+
+    const auto shift = absDy * width;
+    if (dy < 0)
+    {
+        std::move(_shadow.begin() + shift, _shadow.end(), _shadow.begin());
+        std::for_each(_shadow.end() - shift, _shadow.end(), [](auto& cell) { cell.isKnown = false; });
+    }
+    else
+    {
+        std::move_backward(_shadow.begin(), _shadow.end() - shift, _shadow.end());
+        std::for_each(_shadow.begin(), _shadow.begin() + shift, [](auto& cell) { cell.isKnown = false; });
+    }
+}
+
+// Routine Description:
+// - Forgets everything we know about the contents of the terminal, so that the
+//      next frame will write every cell it paints.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void XtermEngine::_InvalidateShadow() noexcept
+{
+    for (auto& cell : _shadow)
+    {
+        cell.isKnown = false;
+    }
+}
+
+// Routine Description:
+// - Turns frame diffing on or off. While on, we keep a copy of every cell we've
+//      written to the terminal, and PaintBufferLine only writes the ones that
+//      changed.
+// Arguments:
+// - enabled - true to only write what's changed.
+// Return Value:
+// - <none>
+void XtermEngine::SetFrameDiffing(const bool enabled) noexcept
+{
+    _frameDiffing = enabled;
+    if (!enabled)
+    {
+        _shadow.clear();
+        _shadow.shrink_to_fit();
+    }
+    else
+    {
+        _InvalidateShadow();
+    }
+}
+
+// Routine Description:
+// - Updates the viewport, like VtEngine::UpdateViewport. If the size of the
+//      viewport changed, the terminal might have moved its contents around, so
+//      our shadow copy of it can't be trusted anymore.
+// Arguments:
+// - srNewViewport - The bounds of the new viewport.
+// Return Value:
+// - HRESULT S_OK
+[[nodiscard]]
+HRESULT XtermEngine::UpdateViewport(const SMALL_RECT srNewViewport) noexcept
+{
+    const auto oldView = _lastViewport;
+    const auto hr = VtEngine::UpdateViewport(srNewViewport);
+    if (oldView.Width() != _lastViewport.Width() || oldView.Height() != _lastViewport.Height())
+    {
+        _InvalidateShadow();
+    }
+    return hr;
+}
+
 // Method Description:
 // - Wrapper for ITerminalOutputConnection. Write either an ascii-only, or a
 //      proper utf-8 string, depending on our mode.
@@ -405,6 +717,9 @@ HRESULT XtermEngine::PaintBufferLine(std::basic_string_view<Cluster> const clust
 [[nodiscard]]
 HRESULT XtermEngine::WriteTerminalW(const std::wstring& wstr) noexcept
 {
+    // We don't know what this did to the terminal's contents.
+    _InvalidateShadow();
+
     return _fUseAsciiOnly ?
         VtEngine::_WriteTerminalAscii(wstr) :
         VtEngine::_WriteTerminalUtf8(wstr);
@@ -60,7 +60,30 @@ namespace Microsoft::Console::Render
         [[nodiscard]]
         HRESULT WriteTerminalW(_In_ const std::wstring& str) noexcept override;
 
+        [[nodiscard]]
+        HRESULT UpdateViewport(const SMALL_RECT srNewViewport) noexcept override;
+
+        void SetFrameDiffing(const bool enabled) noexcept;
+
+        // Moving the cursor forward takes at least this many characters
+        //      ("\x1b[2C"). Unchanged spans shorter than this are cheaper to
+        //      repaint than to skip over.
+        static const size_t CURSOR_FORWARD_STRING_LENGTH = 4;
+
     protected:
+        // What we last wrote to one cell of the terminal. The trailing cells of
+        //      a wide glyph have no text and zero columns.
+        struct ShadowCell
+        {
+            std::wstring text;
+            size_t columns;
+            COLORREF foreground;
+            COLORREF background;
+            bool isBold;
+            bool isUnderlined;
+            bool isKnown;
+        };
+
         const COLORREF* const _ColorTable;
         const WORD _cColorTable;
         const bool _fUseAsciiOnly;
@@ -68,6 +91,27 @@ namespace Microsoft::Console::Render
         bool _usingUnderLine;
         bool _needToDisableCursor;
 
+        // When frame diffing, PaintBufferLine only writes the clusters that
+        //      differ from what's already in _shadow.
+        bool _frameDiffing;
+        std::vector<ShadowCell> _shadow;
+
+        [[nodiscard]]
+        HRESULT _PaintClusters(std::basic_string_view<Cluster> const clusters,
+                               const COORD coord) noexcept;
+        [[nodiscard]]
+        HRESULT _PaintChangedClusters(std::basic_string_view<Cluster> const clusters,
+                                      const COORD coord) noexcept;
+
+        bool _ShadowMatches(const size_t rowStart,
+                            const size_t x,
+                            const Cluster& cluster) const;
+        void _UpdateShadow(const size_t rowStart,
+                           size_t x,
+                           std::basic_string_view<Cluster> const clusters);
+        void _ScrollShadow(const short dy) noexcept;
+        void _InvalidateShadow() noexcept;
+
         [[nodiscard]]
         HRESULT _MoveCursor(const COORD coord) noexcept override;
 
@@ -128,13 +128,18 @@ HRESULT VtEngine::InvalidateCircling(_Out_ bool* const pForcePaint) noexcept
 [[nodiscard]]
 HRESULT VtEngine::PrepareForTeardown(_Out_ bool* const pForcePaint) noexcept
 {
+    // The last frame can't be held back, and has to be written before we go.
+    _tearingDown = true;
     *pForcePaint = true;
     return S_OK;
 }
 
 // Routine Description:
 // - Helper to combine the given rectangle into the invalid region to be
-//      updated on the next paint
+//      updated on the next paint. Besides the bounding rectangle of everything
+//      that's invalid, we keep track of the invalid columns of each row, so
+//      two small changes far apart don't cause everything between them to be
+//      repainted.
 // Expects EXCLUSIVE rectangles.
 // Arguments:
 // - invalid - A viewport containing the character region that should be
@@ -157,6 +162,15 @@ HRESULT VtEngine::_InvalidCombine(const Viewport invalid) noexcept
     // Ensure invalid areas remain within bounds of window.
     RETURN_IF_FAILED(_InvalidRestrict());
 
+    SMALL_RECT rows = invalid.ToExclusive();
+    if (_lastViewport.ToOrigin().TrimToViewport(&rows))
+    {
+        for (auto row = rows.Top; row < rows.Bottom; row++)
+        {
+            _InvalidRowCombine(row, rows.Left, rows.Right);
+        }
+    }
+
     return S_OK;
 }
 
@@ -182,6 +196,23 @@ HRESULT VtEngine::_InvalidOffset(const COORD* const pCoord) noexcept
 
             // Ensure invalid areas remain within bounds of window.
             RETURN_IF_FAILED(_InvalidRestrict());
+
+            // Do the same to each row. Walk the rows against the direction of
+            //      the scroll, so that each row is read before it's updated.
+            const int height = gsl::narrow<int>(_invalidRows.size());
+            const int width = _lastViewport.Width();
+            for (int i = 0; i < height; i++)
+            {
+                const int row = pCoord->Y > 0 ? height - 1 - i : i;
+                const int source = row - pCoord->Y;
+                if (source >= 0 && source < height)
+                {
+                    const auto moved = _invalidRows.at(source);
+                    const int left = std::max(moved.left + pCoord->X, 0);
+                    const int right = std::min(moved.right + pCoord->X, width);
+                    _InvalidRowCombine(row, gsl::narrow_cast<SHORT>(left), gsl::narrow_cast<SHORT>(right));
+                }
+            }
         }
         CATCH_RETURN();
     }
@@ -204,5 +235,40 @@ HRESULT VtEngine::_InvalidRestrict() noexcept
 
     _invalidRect = Viewport::FromExclusive(oldInvalid);
 
+    // Keep one span for each row of the viewport, in case it's changed size.
+    try
+    {
+        _invalidRows.resize(_lastViewport.Height(), InvalidSpan{ 0, 0 });
+    }
+    CATCH_RETURN();
+
     return S_OK;
 }
+
+// Routine Description:
+// - Helper to extend the invalid span of a single row to also cover the
+//      columns [left, right).
+// Arguments:
+// - row - The row of the viewport to invalidate. Must be within _invalidRows.
+// - left - The first column to invalidate.
+// - right - One past the last column to invalidate.
+// Return Value:
+// - <none>
+void VtEngine::_InvalidRowCombine(const size_t row, const SHORT left, const SHORT right) noexcept
+{
+    if (left >= right)
+    {
+        return;
+    }
+
+    auto& span = _invalidRows[row];
+    if (span.left >= span.right)
+    {
+        span = { left, right };
+    }
+    else
+    {
+        span.left = std::min(span.left, left);
+        span.right = std::max(span.right, right);
+    }
+}
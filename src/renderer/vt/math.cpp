@@ -27,6 +27,45 @@ SMALL_RECT VtEngine::GetDirtyRectInChars()
     return dirty;
 }
 
+// Routine Description:
+// - Gets the areas of the frame that need to be repainted, in characters.
+//      Each row only contributes the columns that were invalidated on it, and
+//      rows that weren't invalidated at all are skipped. Neighboring rows that
+//      are dirty in the same columns are combined into one rectangle.
+// Arguments:
+// - <none>
+// Return Value:
+// - The areas of the frame to repaint. These are Inclusive rects.
+std::vector<SMALL_RECT> VtEngine::GetDirtyArea()
+{
+    std::vector<SMALL_RECT> dirty;
+    const SHORT width = _lastViewport.Width();
+    const SHORT height = gsl::narrow<SHORT>(_invalidRows.size());
+    for (SHORT row = std::max<SHORT>(_virtualTop, 0); row < height; row++)
+    {
+        const auto& span = _invalidRows.at(row);
+        const SHORT right = std::min(span.right, width);
+        if (span.left >= right)
+        {
+            continue;
+        }
+
+        const SHORT rightInclusive = gsl::narrow_cast<SHORT>(right - 1);
+        if (!dirty.empty() &&
+            dirty.back().Bottom == row - 1 &&
+            dirty.back().Left == span.left &&
+            dirty.back().Right == rightInclusive)
+        {
+            dirty.back().Bottom = row;
+        }
+        else
+        {
+            dirty.push_back({ span.left, row, rightInclusive, row });
+        }
+    }
+    return dirty;
+}
+
 // Routine Description:
 // - Uses the currently selected font to determine how wide the given character will be when renderered.
 // - NOTE: Only supports determining half-width/full-width status for CJK-type languages (e.g. is it 1 character wide or 2. a.k.a. is it a rectangle or square.)
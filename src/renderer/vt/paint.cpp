@@ -26,6 +26,32 @@ HRESULT VtEngine::StartPaint() noexcept
         return S_FALSE;
     }
 
+    // If the terminal hasn't read our last frame yet, don't queue another one
+    //      up behind it. Everything stays invalid, so all the frames we skip
+    //      are painted as one, once the pipe writer catches up and asks us
+    //      to repaint.
+    // A frame for circling the buffer can't be held back though, since the
+    //      rows that scroll off are gone once it's done. Wait for the writer
+    //      to catch up instead.
+    _frameHeldBack = false;
+    if (!_tearingDown && _pipeWriter)
+    {
+        if (_circled)
+        {
+            LOG_IF_FAILED(_pipeWriter->WaitForDrain());
+        }
+        else
+        {
+            _frameHeldBack = _pipeWriter->HoldFrameIfBehind();
+        }
+    }
+
+    if (_frameHeldBack)
+    {
+        _quickReturn = true;
+        return S_FALSE;
+    }
+
     // If there's nothing to do, quick return
     bool somethingToDo = _fInvalidRectUsed ||
         (_scrollDelta.X != 0 || _scrollDelta.Y != 0) ||
@@ -53,6 +79,7 @@ HRESULT VtEngine::EndPaint() noexcept
     _trace.TraceEndPaint();
 
     _invalidRect = Viewport::Empty();
+    _invalidRows.clear();
     _fInvalidRectUsed = false;
     _scrollDelta = {0};
     _clearedAllThisFrame = false;
@@ -6,10 +6,6 @@
 #include "../../inc/conattrs.hpp"
 #include "../../types/inc/convert.hpp"
 
-// For _vcprintf
-#include <conio.h>
-#include <stdarg.h>
-
 #pragma hdrstop
 
 using namespace Microsoft::Console;
@@ -29,13 +25,14 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
                    const IDefaultColorProvider& colorProvider,
                    const Viewport initialViewport) :
     RenderEngineBase(),
-    _hFile(std::move(pipe)),
+    _pipeWriter{ nullptr },
     _colorProvider(colorProvider),
     _LastFG(INVALID_COLOR),
     _LastBG(INVALID_COLOR),
     _lastWasBold(false),
     _lastViewport(initialViewport),
     _invalidRect(Viewport::Empty()),
+    _invalidRows{},
     _fInvalidRectUsed(false),
     _lastRealCursor({0}),
     _lastText({0}),
@@ -50,6 +47,8 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
     _firstPaint(true),
     _skipCursor(false),
     _pipeBroken(false),
+    _frameHeldBack(false),
+    _tearingDown(false),
     _exitResult{ S_OK },
     _terminalOwner{ nullptr },
     _newBottomLine{ false },
@@ -58,11 +57,17 @@ VtEngine::VtEngine(_In_ wil::unique_hfile pipe,
 {
 #ifndef UNIT_TESTING
     // When unit testing, we can instantiate a VtEngine without a pipe.
-    THROW_HR_IF(E_HANDLE, _hFile.get() == INVALID_HANDLE_VALUE);
+    THROW_HR_IF(E_HANDLE, pipe.get() == INVALID_HANDLE_VALUE);
 #else
     // member is only defined when UNIT_TESTING is.
     _usingTestCallback = false;
 #endif
+
+    if (pipe.get() != INVALID_HANDLE_VALUE)
+    {
+        _pipeWriter = std::make_unique<VtPipeWriter>(std::move(pipe));
+        THROW_IF_FAILED(_pipeWriter->Start());
+    }
 }
 
 // Method Description:
@@ -94,11 +99,19 @@ HRESULT VtEngine::_Write(std::string_view const str) noexcept
     CATCH_RETURN();
 }
 
+// Method Description:
+// - Hands everything written so far to the pipe writer, which writes it to
+//      the pipe on its own thread. When we're tearing down, this waits for
+//      the write to be done, since there won't be another chance to make it.
+// Arguments:
+// - <none>
+// Return Value:
+// - S_OK or suitable HRESULT error from writing pipe.
 [[nodiscard]]
 HRESULT VtEngine::_Flush() noexcept
 {
 #ifdef UNIT_TESTING
-    if (_hFile.get() == INVALID_HANDLE_VALUE)
+    if (!_pipeWriter)
     {
         // Do not flush during Unit Testing because we won't have a valid file.
         return S_OK;
@@ -107,11 +120,15 @@ HRESULT VtEngine::_Flush() noexcept
 
     if (!_pipeBroken)
     {
-        bool fSuccess = !!WriteFile(_hFile.get(), _buffer.data(), static_cast<DWORD>(_buffer.size()), nullptr, nullptr);
+        HRESULT hr = _pipeWriter->Submit(_buffer);
+        if (SUCCEEDED(hr) && _tearingDown)
+        {
+            hr = _pipeWriter->WaitForDrain();
+        }
         _buffer.clear();
-        if (!fSuccess)
+        if (FAILED(hr))
         {
-            _exitResult = HRESULT_FROM_WIN32(GetLastError());
+            _exitResult = hr;
             _pipeBroken = true;
             if (_terminalOwner)
             {
@@ -177,42 +194,6 @@ HRESULT VtEngine::_WriteTerminalAscii(const std::wstring& wstr) noexcept
     return _Write(needed);
 }
 
-// Method Description:
-// - Helper for calling _Write with a string for formatting a sequence. Used
-//      extensively by VtSequences.cpp
-// Arguments:
-// - pFormat: the pointer to the string to write to the pipe.
-// - ...: a va_list of args to format the string with.
-// Return Value:
-// - S_OK, E_INVALIDARG for a invalid format string, or suitable HRESULT error
-//      from writing pipe.
-[[nodiscard]]
-HRESULT VtEngine::_WriteFormattedString(const std::string* const pFormat, ...) noexcept
-{
-
-    HRESULT hr = E_FAIL;
-    va_list argList;
-    va_start(argList, pFormat);
-
-    int cchNeeded = _scprintf(pFormat->c_str(), argList);
-    // -1 is the _scprintf error case https://msdn.microsoft.com/en-us/library/t32cf9tb.aspx
-    if (cchNeeded > -1)
-    {
-        wistd::unique_ptr<char[]> psz = wil::make_unique_nothrow<char[]>(cchNeeded + 1);
-        RETURN_IF_NULL_ALLOC(psz);
-
-        int cchWritten = _vsnprintf_s(psz.get(), cchNeeded + 1, cchNeeded, pFormat->c_str(), argList);
-        hr = _Write({ psz.get(), gsl::narrow<size_t>(cchWritten) });
-    }
-    else
-    {
-        hr = E_INVALIDARG;
-    }
-
-    va_end(argList);
-    return hr;
-}
-
 // Method Description:
 // - This method will update the active font on the current device context
 //      Does nothing for vt, the font is handed by the terminal.
@@ -420,6 +401,33 @@ void VtEngine::SetTerminalOwner(Microsoft::Console::ITerminalOwner* const termin
     _terminalOwner = terminalOwner;
 }
 
+// Method Description:
+// - Sets the function to call when a frame we held back because the terminal
+//      was slow to read can be painted now. See StartPaint.
+// Arguments:
+// - pfn - the function to call. It's called on the pipe writer's thread.
+// Return Value:
+// - <none>
+void VtEngine::SetRepaintCallback(std::function<void()> pfn)
+{
+    if (_pipeWriter)
+    {
+        _pipeWriter->SetRepaintCallback(std::move(pfn));
+    }
+}
+
+// Method Description:
+// - Gets how much we've written to the pipe, and how long we had to wait for
+//      the terminal to read it.
+// Arguments:
+// - <none>
+// Return Value:
+// - the pipe writer's counters
+VtPipeWriter::Counters VtEngine::GetWriterCounters() const noexcept
+{
+    return _pipeWriter ? _pipeWriter->GetCounters() : VtPipeWriter::Counters{};
+}
+
 // Method Description:
 // - sends a sequence to request the end terminal to tell us the
 //      cursor position. The terminal will reply back on the vt input handle.
@@ -21,6 +21,7 @@ Author(s):
 #include "../../inc/ITerminalOwner.hpp"
 #include "../../types/inc/Viewport.hpp"
 #include "tracing.hpp"
+#include "VtPipeWriter.hpp"
 #include <string>
 #include <functional>
 
@@ -103,6 +104,7 @@ namespace Microsoft::Console::Render
                                 const int iDpi) noexcept override;
 
         SMALL_RECT GetDirtyRectInChars() override;
+        std::vector<SMALL_RECT> GetDirtyArea() override;
         [[nodiscard]]
         HRESULT GetFontSize(_Out_ COORD* const pFontSize) noexcept override;
         [[nodiscard]]
@@ -123,9 +125,19 @@ namespace Microsoft::Console::Render
         virtual HRESULT WriteTerminalW(const std::wstring& str) noexcept = 0;
 
         void SetTerminalOwner(Microsoft::Console::ITerminalOwner* const terminalOwner);
+        void SetRepaintCallback(std::function<void()> pfn);
+        VtPipeWriter::Counters GetWriterCounters() const noexcept;
 
     protected:
-        wil::unique_hfile _hFile;
+        // The columns [left, right) of a single row of the viewport that need
+        //      to be repainted. The row is clean if left >= right.
+        struct InvalidSpan
+        {
+            SHORT left;
+            SHORT right;
+        };
+
+        std::unique_ptr<VtPipeWriter> _pipeWriter;
         std::string _buffer;
 
         const Microsoft::Console::IDefaultColorProvider& _colorProvider;
@@ -136,6 +148,7 @@ namespace Microsoft::Console::Render
 
         Microsoft::Console::Types::Viewport _lastViewport;
         Microsoft::Console::Types::Viewport _invalidRect;
+        std::vector<InvalidSpan> _invalidRows;
 
         bool _fInvalidRectUsed;
         COORD _lastRealCursor;
@@ -157,6 +170,8 @@ namespace Microsoft::Console::Render
         COORD _deferredCursorPos;
 
         bool _pipeBroken;
+        bool _frameHeldBack;
+        bool _tearingDown;
         HRESULT _exitResult;
         Microsoft::Console::ITerminalOwner* _terminalOwner;
 
@@ -164,8 +179,111 @@ namespace Microsoft::Console::Render
 
         [[nodiscard]]
         HRESULT _Write(std::string_view const str) noexcept;
-        [[nodiscard]]
-        HRESULT _WriteFormattedString(const std::string* const pFormat, ...) noexcept;
+
+        // Method Description:
+        // - Writes a control sequence with integer parameters, like
+        //      "\x1b[12;34H" from _WriteCsi("H", 12, 34). This is used for
+        //      every cursor move and color change, so it's formatted into a
+        //      buffer on the stack, sized at compile time to fit the longest
+        //      sequence the parameters' types allow, and written with a single
+        //      _Write. Nothing is allocated.
+        // Arguments:
+        // - final - the characters that end the sequence
+        // - params - the parameters, written in order, separated by ';'
+        // Return Value:
+        // - S_OK if we succeeded, else an appropriate HRESULT for failing to allocate or write.
+        template<size_t N, typename... Params>
+        [[nodiscard]]
+        HRESULT _WriteCsi(const char (&final)[N], const Params... params) noexcept
+        {
+            static_assert((std::is_integral_v<Params> && ...), "CSI parameters must be integers");
+
+            // The introducer, then each parameter with its sign and separator,
+            //      then the final characters without their null.
+            char sequence[2 + (0 + ... + s_MaxCsiParamLength<Params>) + N - 1];
+            char* it = sequence;
+            *it++ = '\x1b';
+            *it++ = '[';
+
+            [[maybe_unused]] size_t index = 0;
+            ((it = s_FormatCsiParam(it, params, index++ != 0)), ...);
+
+            for (size_t i = 0; i < N - 1; i++)
+            {
+                *it++ = final[i];
+            }
+
+            return _Write({ sequence, static_cast<size_t>(it - sequence) });
+        }
+
+        // The most characters a parameter of the given type can take up,
+        //      including a minus sign and the separator before it.
+        template<typename T>
+        static constexpr size_t s_MaxCsiParamLength = std::numeric_limits<T>::digits10 + 3;
+
+        // Every two-digit number, so that s_FormatCsiParam can write two
+        //      digits at a time.
+        static constexpr char s_DigitPairs[] = "0001020304050607080910111213141516171819"
+                                               "2021222324252627282930313233343536373839"
+                                               "4041424344454647484950515253545556575859"
+                                               "6061626364656667686970717273747576777879"
+                                               "8081828384858687888990919293949596979899";
+
+        // Method Description:
+        // - Writes a single parameter of a control sequence in decimal.
+        // Arguments:
+        // - it - where to write the parameter. Must have room for s_MaxCsiParamLength<T>.
+        // - value - the parameter
+        // - separate - true if a ';' should come before the parameter
+        // Return Value:
+        // - a pointer to just after the parameter
+        template<typename T>
+        static char* s_FormatCsiParam(char* it, const T value, const bool separate) noexcept
+        {
+            if (separate)
+            {
+                *it++ = ';';
+            }
+
+            // Widen first, so that negating the smallest value doesn't overflow.
+            auto magnitude = static_cast<uint64_t>(value);
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (value < 0)
+                {
+                    *it++ = '-';
+                    magnitude = 0 - magnitude;
+                }
+            }
+
+            // Fill in the digits from the right, two at a time.
+            char digits[std::numeric_limits<uint64_t>::digits10 + 1];
+            char* const end = digits + ARRAYSIZE(digits);
+            char* first = end;
+            while (magnitude >= 100)
+            {
+                const auto pair = static_cast<size_t>(magnitude % 100) * 2;
+                magnitude /= 100;
+                *--first = s_DigitPairs[pair + 1];
+                *--first = s_DigitPairs[pair];
+            }
+            if (magnitude >= 10)
+            {
+                const auto pair = static_cast<size_t>(magnitude) * 2;
+                *--first = s_DigitPairs[pair + 1];
+                *--first = s_DigitPairs[pair];
+            }
+            else
+            {
+                *--first = static_cast<char>('0' + magnitude);
+            }
+
+            while (first != end)
+            {
+                *it++ = *first++;
+            }
+            return it;
+        }
         [[nodiscard]]
         HRESULT _Flush() noexcept;
 
@@ -176,6 +294,7 @@ namespace Microsoft::Console::Render
         HRESULT _InvalidOffset(const COORD* const ppt) noexcept;
         [[nodiscard]]
         HRESULT _InvalidRestrict() noexcept;
+        void _InvalidRowCombine(const size_t row, const SHORT left, const SHORT right) noexcept;
         bool _AllIsInvalid() const;
 
         [[nodiscard]]
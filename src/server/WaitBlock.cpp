@@ -114,7 +114,7 @@ bool ConsoleWaitBlock::Notify(const WaitTerminationReason TerminationReason)
     DWORD dwControlKeyState;
     bool fIsUnicode = true;
 
-    std::deque<std::unique_ptr<IInputEvent>> outEvents;
+    std::vector<INPUT_RECORD> outRecords;
     // TODO: MSFT 14104228 - get rid of this void* and get the data
     // out of the read wait object properly.
     void* pOutputData = nullptr;
@@ -127,7 +127,7 @@ bool ConsoleWaitBlock::Notify(const WaitTerminationReason TerminationReason)
     {
         CONSOLE_GETCONSOLEINPUT_MSG* a = &(_WaitReplyMessage.u.consoleMsgL1.GetConsoleInput);
         fIsUnicode = !!a->Unicode;
-        pOutputData = &outEvents;
+        pOutputData = &outRecords;
         break;
     }
     case API_NUMBER_READCONSOLE:
@@ -171,15 +171,10 @@ bool ConsoleWaitBlock::Notify(const WaitTerminationReason TerminationReason)
             }
 
             INPUT_RECORD* const pRecordBuffer = static_cast<INPUT_RECORD* const>(buffer);
-            a->NumRecords = static_cast<ULONG>(outEvents.size());
+            a->NumRecords = static_cast<ULONG>(outRecords.size());
             for (size_t i = 0; i < a->NumRecords; ++i)
             {
-                if (outEvents.empty())
-                {
-                    break;
-                }
-                pRecordBuffer[i] = outEvents.front()->ToInputRecord();
-                outEvents.pop_front();
+                pRecordBuffer[i] = outRecords[i];
             }
 
         }
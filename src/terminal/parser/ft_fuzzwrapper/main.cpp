@@ -58,18 +58,22 @@ int __cdecl wmain(int argc, wchar_t* argv[])
 
         wprintf(L"Opening file '%s'...\r\n", argv[1]);
         hFile = _wfopen(argv[1], L"r");
+        // Read the whole payload first and hand it over as one string, so the
+        // fuzzed input goes through the same ground state scanning as real output.
+        std::wstring payload;
         wchar_t wch;
         bool fGotChar = GetChar(&wch);
-
-        StateMachine machine(new OutputStateMachineEngine(new EchoDispatch));
-
-        wprintf(L"Sending characters to state machine...\r\n");
         while (fGotChar)
         {
-            machine.ProcessCharacter(wch);
+            payload.push_back(wch);
             fGotChar = GetChar(&wch);
         }
 
+        StateMachine machine(new OutputStateMachineEngine(new EchoDispatch));
+
+        wprintf(L"Sending characters to state machine...\r\n");
+        machine.ProcessString(payload);
+
         if (hFile)
         {
             fclose(hFile);
@@ -6,6 +6,11 @@
 #include "stateMachine.hpp"
 
 #include "ascii.hpp"
+#include "../../inc/unicode.hpp"
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+#include <emmintrin.h>
+#endif
 
 using namespace Microsoft::Console::VirtualTerminal;
 
@@ -25,7 +30,9 @@ StateMachine::StateMachine(IStateMachineEngine* const pEngine) :
     // rgusParams Initialized below
     _sOscNextChar(0),
     _sOscParam(0),
-    _currRunLength(0)
+    _currRunLength(0),
+    _fProcessIndividually(false),
+    _cchUtf8Partial(0)
 {
     ZeroMemory(_pwchOscStringBuffer, sizeof(_pwchOscStringBuffer));
     ZeroMemory(_rgusParams, sizeof(_rgusParams));
@@ -49,11 +56,81 @@ IStateMachineEngine& StateMachine::Engine() noexcept
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsActionableFromGround(const wchar_t wch)
+constexpr bool StateMachine::s_IsActionableFromGround(const wchar_t wch) noexcept
 {
     return (wch <= AsciiChars::US) || s_IsC1Csi(wch) || s_IsDelete(wch);
 }
 
+// Routine Description:
+// - Finds the first character in the given range that s_IsActionableFromGround
+//   would stop on, checking one character at a time.
+// Arguments:
+// - pwchBegin - Start of the range to scan.
+// - pwchEnd - One past the end of the range to scan.
+// Return Value:
+// - Pointer to the first actionable character, or pwchEnd if there is none.
+const wchar_t* StateMachine::s_FindActionableFromGroundScalar(const wchar_t* const pwchBegin,
+                                                              const wchar_t* const pwchEnd) noexcept
+{
+    const wchar_t* pwch = pwchBegin;
+    while (pwch < pwchEnd && !s_IsActionableFromGround(*pwch))
+    {
+        pwch++;
+    }
+    return pwch;
+}
+
+// Routine Description:
+// - Finds the first character in the given range that s_IsActionableFromGround
+//   would stop on. On x86/x64 this checks 8 characters at a time with SSE2
+//   and only falls back to the scalar check for the tail of the range.
+//   Long runs of plain text between escape sequences are the common case for
+//   output, so this is where ProcessString spends most of its time.
+// Arguments:
+// - pwchBegin - Start of the range to scan.
+// - pwchEnd - One past the end of the range to scan.
+// Return Value:
+// - Pointer to the first actionable character, or pwchEnd if there is none.
+const wchar_t* StateMachine::s_FindActionableFromGround(const wchar_t* const pwchBegin,
+                                                        const wchar_t* const pwchEnd) noexcept
+{
+    const wchar_t* pwch = pwchBegin;
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+    static_assert(sizeof(wchar_t) == sizeof(uint16_t));
+    constexpr size_t cchPerVector = sizeof(__m128i) / sizeof(wchar_t);
+
+    // C0 codes are 0x00-0x1F. Saturating subtract of 0x1F leaves exactly those lanes at zero.
+    const __m128i c0Limit = _mm_set1_epi16(AsciiChars::US);
+    const __m128i del = _mm_set1_epi16(AsciiChars::DEL);
+    const __m128i c1Csi = _mm_set1_epi16(L'\x9b');
+    const __m128i zero = _mm_setzero_si128();
+
+    while (static_cast<size_t>(pwchEnd - pwch) >= cchPerVector)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pwch));
+
+        const __m128i isC0 = _mm_cmpeq_epi16(_mm_subs_epu16(chars, c0Limit), zero);
+        const __m128i isDel = _mm_cmpeq_epi16(chars, del);
+        const __m128i isC1Csi = _mm_cmpeq_epi16(chars, c1Csi);
+        const __m128i isActionable = _mm_or_si128(isC0, _mm_or_si128(isDel, isC1Csi));
+
+        // Two mask bits per character (one per byte of each 16-bit lane).
+        const unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(isActionable));
+        if (mask != 0)
+        {
+            unsigned long bitIndex;
+            _BitScanForward(&bitIndex, mask);
+            return pwch + (bitIndex / sizeof(wchar_t));
+        }
+
+        pwch += cchPerVector;
+    }
+#endif
+
+    return s_FindActionableFromGroundScalar(pwch, pwchEnd);
+}
+
 // Routine Description:
 // - Determines if a character belongs to the C0 escape range.
 //   This is character sequences less than a space character (null, backspace, new line, etc.)
@@ -62,7 +139,7 @@ bool StateMachine::s_IsActionableFromGround(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsC0Code(const wchar_t wch)
+constexpr bool StateMachine::s_IsC0Code(const wchar_t wch) noexcept
 {
     return (wch >= AsciiChars::NUL && wch <= AsciiChars::ETB) ||
            wch == AsciiChars::EM ||
@@ -88,7 +165,7 @@ bool StateMachine::s_IsC0Code(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsC1Csi(const wchar_t wch)
+constexpr bool StateMachine::s_IsC1Csi(const wchar_t wch) noexcept
 {
     return wch == L'\x9b';
 }
@@ -102,7 +179,7 @@ bool StateMachine::s_IsC1Csi(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsIntermediate(const wchar_t wch)
+constexpr bool StateMachine::s_IsIntermediate(const wchar_t wch) noexcept
 {
     return wch >= L' ' && wch <= L'/'; // 0x20 - 0x2F
 }
@@ -113,7 +190,7 @@ bool StateMachine::s_IsIntermediate(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsDelete(const wchar_t wch)
+constexpr bool StateMachine::s_IsDelete(const wchar_t wch) noexcept
 {
     return wch == AsciiChars::DEL;
 }
@@ -125,7 +202,7 @@ bool StateMachine::s_IsDelete(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsEscape(const wchar_t wch)
+constexpr bool StateMachine::s_IsEscape(const wchar_t wch) noexcept
 {
     return wch == AsciiChars::ESC;
 }
@@ -137,7 +214,7 @@ bool StateMachine::s_IsEscape(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiIndicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiIndicator(const wchar_t wch) noexcept
 {
     return wch == L'['; // 0x5B
 }
@@ -150,7 +227,7 @@ bool StateMachine::s_IsCsiIndicator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiDelimiter(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiDelimiter(const wchar_t wch) noexcept
 {
     return wch == L';'; // 0x3B
 }
@@ -162,7 +239,7 @@ bool StateMachine::s_IsCsiDelimiter(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiParamValue(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiParamValue(const wchar_t wch) noexcept
 {
     return wch >= L'0' && wch <= L'9'; // 0x30 - 0x39
 }
@@ -174,7 +251,7 @@ bool StateMachine::s_IsCsiParamValue(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch) noexcept
 {
     return wch == L'<' || wch == L'=' || wch == L'>' || wch == L'?'; // 0x3C - 0x3F
 }
@@ -185,7 +262,7 @@ bool StateMachine::s_IsCsiPrivateMarker(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsCsiInvalid(const wchar_t wch)
+constexpr bool StateMachine::s_IsCsiInvalid(const wchar_t wch) noexcept
 {
     return wch == L':'; // 0x3A
 }
@@ -199,7 +276,7 @@ bool StateMachine::s_IsCsiInvalid(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsSs3Indicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsSs3Indicator(const wchar_t wch) noexcept
 {
     return wch == L'O'; // 0x4F
 }
@@ -211,7 +288,7 @@ bool StateMachine::s_IsSs3Indicator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscIndicator(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscIndicator(const wchar_t wch) noexcept
 {
     return wch == L']'; // 0x5D
 }
@@ -224,7 +301,7 @@ bool StateMachine::s_IsOscIndicator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscDelimiter(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscDelimiter(const wchar_t wch) noexcept
 {
     return wch == L';'; // 0x3B
 }
@@ -237,7 +314,7 @@ bool StateMachine::s_IsOscDelimiter(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscParamValue(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscParamValue(const wchar_t wch) noexcept
 {
     return s_IsNumber(wch); // 0x30 - 0x39
 }
@@ -248,7 +325,7 @@ bool StateMachine::s_IsOscParamValue(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscTerminationInitiator(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscTerminationInitiator(const wchar_t wch) noexcept
 {
     return wch == AsciiChars::ESC;
 }
@@ -259,7 +336,7 @@ bool StateMachine::s_IsOscTerminationInitiator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscInvalid(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscInvalid(const wchar_t wch) noexcept
 {
     return wch <= L'\x17' ||
            wch == L'\x19' ||
@@ -273,7 +350,7 @@ bool StateMachine::s_IsOscInvalid(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsOscTerminator(const wchar_t wch)
+constexpr bool StateMachine::s_IsOscTerminator(const wchar_t wch) noexcept
 {
     return wch == L'\x7' || wch == L'\x9C'; // Bell character or C1 terminator
 }
@@ -284,7 +361,7 @@ bool StateMachine::s_IsOscTerminator(const wchar_t wch)
 // - wch - Character to check.
 // Return Value:
 // - True if it is. False if it isn't.
-bool StateMachine::s_IsNumber(const wchar_t wch)
+constexpr bool StateMachine::s_IsNumber(const wchar_t wch) noexcept
 {
     return wch >= L'0' && wch <= L'9'; // 0x30 - 0x39
 }
@@ -790,456 +867,479 @@ void StateMachine::_EnterSs3Param()
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the Ground state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Handle a C1 Control Sequence Introducer
-//   3. Print all other characters
+// - Determines if a character is one of the "from anywhere" events, which are
+//   handled the same way in every state instead of as an event in the
+//   current state: CAN and SUB, and ESC (except in an OSC string, where ESC
+//   begins the string terminator).
 // Arguments:
-// - wch - Character that triggered the event
+// - state - The state the character was seen in.
+// - wch - Character to check.
 // Return Value:
-// - <none>
-void StateMachine::_EventGround(const wchar_t wch)
+// - True if the character is handled the same way in every state.
+constexpr bool StateMachine::s_IsAnywhereEvent(const VTStates state, const wchar_t wch) noexcept
 {
-    _trace.TraceOnEvent(L"Ground");
-    if (s_IsC0Code(wch) || s_IsDelete(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsC1Csi(wch))
-    {
-        _EnterCsiEntry();
-    }
-    else
-    {
-        _ActionPrint(wch);
-    }
+    return wch == AsciiChars::CAN ||
+           wch == AsciiChars::SUB ||
+           (s_IsEscape(wch) && state != VTStates::OscString);
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the Escape state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Enter Control Sequence state
-//   5. Dispatch an Escape action.
+// - Works out what the state machine should do with a character while in the
+//   given state, by walking the same character class predicates the vt100.net
+//   state diagram is described in. This is only ever run at compile time to
+//   generate s_rgTransitions (and by the unit tests, through
+//   s_ComputeTransitionNoTable, to time the table against it).
+//   Events are handled in this order:
+//   1. "From anywhere" events: CAN and SUB execute and return to Ground, and
+//      ESC starts a new escape sequence (except in an OSC string, where ESC
+//      begins the string terminator).
+//   2. Then the character is handled as an event in the current state:
+//      - Ground: Execute C0 control characters, enter a C1 CSI, print all other characters.
+//      - Escape: Execute C0 control characters, ignore Delete, collect intermediates,
+//        enter CSI, OSC or SS3 sequences, and dispatch everything else as an escape.
+//      - EscapeIntermediate: Execute C0 control characters, collect intermediates,
+//        ignore Delete, and dispatch everything else as an escape.
+//      - CsiEntry: Execute C0 control characters, ignore Delete, collect intermediates,
+//        ignore the whole sequence on an invalid character, store parameters,
+//        collect private markers, and dispatch everything else as a control sequence.
+//      - CsiIntermediate: Execute C0 control characters, collect intermediates,
+//        ignore Delete, ignore the sequence on any parameter character, and
+//        dispatch everything else as a control sequence.
+//      - CsiIgnore: Execute C0 control characters, ignore everything that could
+//        still be part of the sequence, and return to Ground on anything else.
+//      - CsiParam: Execute C0 control characters, ignore Delete, store parameters,
+//        collect intermediates, ignore the sequence on an invalid character or
+//        private marker, and dispatch everything else as a control sequence.
+//      - OscParam: Return to Ground on a terminator, collect the numeric param,
+//        move to the OscString state on a delimiter, and ignore everything else.
+//      - OscString: Dispatch on a terminator, wait for the second character of
+//        an ESC terminator, ignore invalid characters and collect everything else.
+//      - OscTermination: Dispatch the OSC string on any character.
+//      - Ss3Entry: Execute C0 control characters, ignore Delete, ignore the
+//        sequence on an invalid character, store parameters, and dispatch
+//        everything else as a SS3 sequence.
+//      - Ss3Param: Execute C0 control characters, ignore Delete, store parameters,
+//        ignore the sequence on an invalid character or private marker, and
+//        dispatch everything else as a SS3 sequence.
+//   SS3 sequences are structurally the same as CSI sequences, just with a
+//      different initiation. It's safe to reuse CSI's functions for
+//      determining if a character is a parameter, delimiter, or invalid, and
+//      to go into the CSI ignore state, because both SS3 and CSI sequences
+//      ignore characters the same way.
 // Arguments:
+// - state - The state the character was seen in.
 // - wch - Character that triggered the event
 // Return Value:
-// - <none>
-void StateMachine::_EventEscape(const wchar_t wch)
+// - The action to take for the character, and the state to enter afterwards, if any.
+constexpr StateMachine::VTTransition StateMachine::s_ComputeTransition(const VTStates state, const wchar_t wch) noexcept
 {
-    _trace.TraceOnEvent(L"Escape");
-    if (s_IsC0Code(wch))
+    const auto stay = [state](const VTActions action) {
+        return VTTransition{ action, state, false };
+    };
+    const auto enter = [](const VTActions action, const VTStates nextState) {
+        return VTTransition{ action, nextState, true };
+    };
+
+    // Process "from anywhere" events first.
+    if (s_IsAnywhereEvent(state, wch))
     {
-        if (_pEngine->DispatchControlCharsFromEscape())
+        // Don't go to escape from the OSC string state - ESC can be used to
+        //      terminate OSC strings. s_IsAnywhereEvent leaves that case out.
+        return s_IsEscape(wch) ? enter(VTActions::None, VTStates::Escape) :
+                                 enter(VTActions::Execute, VTStates::Ground);
+    }
+
+    // Then pass to the current state as an event
+    switch (state)
+    {
+    case VTStates::Ground:
+        if (s_IsC0Code(wch) || s_IsDelete(wch))
         {
-            _ActionExecuteFromEscape(wch);
-            _EnterGround();
+            return stay(VTActions::Execute);
         }
-        else
+        else if (s_IsC1Csi(wch))
         {
-            _ActionExecute(wch);
+            return enter(VTActions::None, VTStates::CsiEntry);
         }
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-        _EnterEscapeIntermediate();
-    }
-    else if (s_IsCsiIndicator(wch))
-    {
-        _EnterCsiEntry();
-    }
-    else if (s_IsOscIndicator(wch))
-    {
-        _EnterOscParam();
-    }
-    else if (s_IsSs3Indicator(wch))
-    {
-        _EnterSs3Entry();
-    }
-    else
-    {
-        _ActionEscDispatch(wch);
-        _EnterGround();
+        return stay(VTActions::Print);
+    case VTStates::Escape:
+        if (s_IsC0Code(wch))
+        {
+            // Whether this returns to Ground depends on the engine, see _DispatchAction.
+            return stay(VTActions::ExecuteFromEscape);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsIntermediate(wch))
+        {
+            return enter(VTActions::Collect, VTStates::EscapeIntermediate);
+        }
+        else if (s_IsCsiIndicator(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiEntry);
+        }
+        else if (s_IsOscIndicator(wch))
+        {
+            return enter(VTActions::None, VTStates::OscParam);
+        }
+        else if (s_IsSs3Indicator(wch))
+        {
+            return enter(VTActions::None, VTStates::Ss3Entry);
+        }
+        return enter(VTActions::EscDispatch, VTStates::Ground);
+    case VTStates::EscapeIntermediate:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsIntermediate(wch))
+        {
+            return stay(VTActions::Collect);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        return enter(VTActions::EscDispatch, VTStates::Ground);
+    case VTStates::CsiEntry:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsIntermediate(wch))
+        {
+            return enter(VTActions::Collect, VTStates::CsiIntermediate);
+        }
+        else if (s_IsCsiInvalid(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiIgnore);
+        }
+        else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
+        {
+            return enter(VTActions::Param, VTStates::CsiParam);
+        }
+        else if (s_IsCsiPrivateMarker(wch))
+        {
+            return enter(VTActions::Collect, VTStates::CsiParam);
+        }
+        return enter(VTActions::CsiDispatch, VTStates::Ground);
+    case VTStates::CsiIntermediate:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsIntermediate(wch))
+        {
+            return stay(VTActions::Collect);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiIgnore);
+        }
+        return enter(VTActions::CsiDispatch, VTStates::Ground);
+    case VTStates::CsiIgnore:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsDelete(wch) ||
+                 s_IsIntermediate(wch) ||
+                 s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        return enter(VTActions::None, VTStates::Ground);
+    case VTStates::CsiParam:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
+        {
+            return stay(VTActions::Param);
+        }
+        else if (s_IsIntermediate(wch))
+        {
+            return enter(VTActions::Collect, VTStates::CsiIntermediate);
+        }
+        else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiIgnore);
+        }
+        return enter(VTActions::CsiDispatch, VTStates::Ground);
+    case VTStates::OscParam:
+        if (s_IsOscTerminator(wch))
+        {
+            return enter(VTActions::None, VTStates::Ground);
+        }
+        else if (s_IsOscParamValue(wch))
+        {
+            return stay(VTActions::OscParam);
+        }
+        else if (s_IsOscDelimiter(wch))
+        {
+            return enter(VTActions::None, VTStates::OscString);
+        }
+        return stay(VTActions::Ignore);
+    case VTStates::OscString:
+        if (s_IsOscTerminator(wch))
+        {
+            return enter(VTActions::OscDispatch, VTStates::Ground);
+        }
+        else if (s_IsOscTerminationInitiator(wch))
+        {
+            return enter(VTActions::None, VTStates::OscTermination);
+        }
+        else if (s_IsOscInvalid(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        return stay(VTActions::OscPut);
+    case VTStates::OscTermination:
+        return enter(VTActions::OscDispatch, VTStates::Ground);
+    case VTStates::Ss3Entry:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsCsiInvalid(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiIgnore);
+        }
+        else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
+        {
+            return enter(VTActions::Param, VTStates::Ss3Param);
+        }
+        return enter(VTActions::Ss3Dispatch, VTStates::Ground);
+    case VTStates::Ss3Param:
+        if (s_IsC0Code(wch))
+        {
+            return stay(VTActions::Execute);
+        }
+        else if (s_IsDelete(wch))
+        {
+            return stay(VTActions::Ignore);
+        }
+        else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
+        {
+            return stay(VTActions::Param);
+        }
+        else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
+        {
+            return enter(VTActions::None, VTStates::CsiIgnore);
+        }
+        return enter(VTActions::Ss3Dispatch, VTStates::Ground);
+    default:
+        return stay(VTActions::None);
     }
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the EscapeIntermediate state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Dispatch an Escape action.
+// - Generates the dense transition table: one entry for every state and every
+//   character from 0x00 to s_wchTransitionTableMax. Every character above that
+//   behaves exactly like s_wchTransitionTableMax, so they share its column.
 // Arguments:
-// - wch - Character that triggered the event
-// Return Value:
 // - <none>
-void StateMachine::_EventEscapeIntermediate(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"EscapeIntermediate");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else
-    {
-        _ActionEscDispatch(wch);
-        _EnterGround();
-    }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiEntry state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Store parameter data
-//   6. Collect Control Sequence Private markers
-//   7. Dispatch a control sequence with parameters for action
-// Arguments:
-// - wch - Character that triggered the event
 // Return Value:
-// - <none>
-void StateMachine::_EventCsiEntry(const wchar_t wch)
+// - The transition table.
+constexpr StateMachine::TransitionTable StateMachine::s_BuildTransitionTable() noexcept
 {
-    _trace.TraceOnEvent(L"CsiEntry");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiIntermediate();
-    }
-    else if (s_IsCsiInvalid(wch))
+    TransitionTable table{};
+    for (size_t state = 0; state < s_cStates; state++)
     {
-        _EnterCsiIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-        _EnterCsiParam();
-    }
-    else if (s_IsCsiPrivateMarker(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiParam();
-    }
-    else
-    {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
+        for (size_t wch = 0; wch <= s_wchTransitionTableMax; wch++)
+        {
+            table[state][wch] = s_ComputeTransition(static_cast<VTStates>(state), static_cast<wchar_t>(wch));
+        }
     }
+    return table;
 }
 
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiIntermediate state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Dispatch a control sequence with parameters for action
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventCsiIntermediate(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"CsiIntermediate");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else
-    {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
-    }
-}
+constexpr StateMachine::TransitionTable StateMachine::s_rgTransitions = StateMachine::s_BuildTransitionTable();
 
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiIgnore state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Return to Ground
-// Arguments:
-// - wch - Character that triggered the event
-// Return Value:
-// - <none>
-void StateMachine::_EventCsiIgnore(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"CsiIgnore");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiInvalid(wch) || s_IsCsiDelimiter(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _ActionIgnore();
-    }
-    else
-    {
-        _EnterGround();
-    }
-}
+const std::array<const wchar_t*, StateMachine::s_cStates> StateMachine::s_rgStateNames = {
+    L"Ground",
+    L"Escape",
+    L"EscapeIntermediate",
+    L"CsiEntry",
+    L"CsiIntermediate",
+    L"CsiIgnore",
+    L"CsiParam",
+    L"OscParam",
+    L"OscString",
+    L"OscTermination",
+    L"Ss3Entry",
+    L"Ss3Param"
+};
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiParam state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Collect Intermediate characters
-//   4. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   5. Store parameter data
-//   6. Dispatch a control sequence with parameters for action
+// - Checks that every character above the end of the table, all the way up to
+//   0xFFFF, really does behave like the last column of the table.
+//   This is too much work for the compiler to do in a static_assert, so the
+//   unit tests run it instead.
 // Arguments:
-// - wch - Character that triggered the event
-// Return Value:
 // - <none>
-void StateMachine::_EventCsiParam(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"CsiParam");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-    }
-    else if (s_IsIntermediate(wch))
-    {
-        _ActionCollect(wch);
-        _EnterCsiIntermediate();
-    }
-    else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else
-    {
-        _ActionCsiDispatch(wch);
-        _EnterGround();
-    }
-}
-
-// Routine Description:
-// - Processes a character event into an Action that occurs while in the OscParam state.
-//   Events in this state will:
-//   1. Collect numeric values into an Osc Param
-//   2. Move to the OscString state on a delimiter
-//   3. Ignore everything else.
-// Arguments:
-// - wch - Character that triggered the event
 // Return Value:
-// - <none>
-void StateMachine::_EventOscParam(const wchar_t wch)
+// - True if the last column of the table can stand in for all larger characters.
+constexpr bool StateMachine::s_IsTransitionTableComplete() noexcept
 {
-    _trace.TraceOnEvent(L"OscParam");
-    if (s_IsOscTerminator(wch))
+    for (size_t state = 0; state < s_cStates; state++)
     {
-        _EnterGround();
-    }
-    else if (s_IsOscParamValue(wch))
-    {
-        _ActionOscParam(wch);
-    }
-    else if (s_IsOscDelimiter(wch))
-    {
-        _EnterOscString();
-    }
-    else
-    {
-        _ActionIgnore();
+        const auto expected = s_rgTransitions[state][s_wchTransitionTableMax];
+        for (unsigned int wch = s_wchTransitionTableMax + 1; wch <= 0xFFFF; wch++)
+        {
+            const auto actual = s_ComputeTransition(static_cast<VTStates>(state), static_cast<wchar_t>(wch));
+            if (actual.action != expected.action ||
+                actual.nextState != expected.nextState ||
+                actual.fEnterState != expected.fEnterState)
+            {
+                return false;
+            }
+        }
     }
+    return true;
 }
 
 // Routine Description:
-// - Processes a character event into a Action that occurs while in the OscParam state.
-//   Events in this state will:
-//   1. Trigger the OSC action associated with the param on an OscTerminator
-//   2. If we see a ESC, enter the OscTermination state. We'll wait for one
-//      more character before we dispatch the string.
-//   3. Ignore OscInvalid characters.
-//   4. Collect everything else into the OscString
+// - Looks up what the state machine should do with a character while in the given state.
 // Arguments:
+// - state - The state the character was seen in.
 // - wch - Character that triggered the event
 // Return Value:
-// - <none>
-void StateMachine::_EventOscString(const wchar_t wch)
+// - The action to take for the character, and the state to enter afterwards, if any.
+StateMachine::VTTransition StateMachine::s_LookupTransition(const VTStates state, const wchar_t wch) noexcept
 {
-    _trace.TraceOnEvent(L"OscString");
-    if (s_IsOscTerminator(wch))
-    {
-        _ActionOscDispatch(wch);
-        _EnterGround();
-    }
-    else if (s_IsOscTerminationInitiator(wch))
-    {
-        _EnterOscTermination();
-    }
-    else if (s_IsOscInvalid(wch))
-    {
-        _ActionIgnore();
-    }
-    else
-    {
-        // add this character to our OSC string
-        _ActionOscPut(wch);
-    }
+    // Characters above s_wchTransitionTableMax all behave the same way. See s_IsTransitionTableComplete.
+    return s_rgTransitions[static_cast<size_t>(state)][std::min(wch, s_wchTransitionTableMax)];
 }
 
 // Routine Description:
-// - Handle the two-character termination of a OSC sequence.
-//   Events in this state will:
-//   1. Trigger the OSC action associated with the param on an OscTerminator
+// - Works out what the state machine should do with a character by evaluating
+//   the character class predicates directly, without the transition table.
+//   This is what ProcessCharacter used to do for every character, and is kept
+//   for the unit tests to time the table against.
 // Arguments:
+// - state - The state the character was seen in.
 // - wch - Character that triggered the event
 // Return Value:
-// - <none>
-void StateMachine::_EventOscTermination(const wchar_t wch)
+// - The action to take for the character, and the state to enter afterwards, if any.
+StateMachine::VTTransition StateMachine::s_ComputeTransitionNoTable(const VTStates state, const wchar_t wch) noexcept
 {
-    _trace.TraceOnEvent(L"OscTermination");
-
-    _ActionOscDispatch(wch);
-    _EnterGround();
+    return s_ComputeTransition(state, wch);
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the Ss3Entry state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   4. Store parameter data
-//   5. Dispatch a control sequence with parameters for action
-//  SS3 sequences are structurally the same as CSI sequences, just with a
-//      different initiation. It's safe to reuse CSI's functions for
-//      determining if a character is a parameter, delimiter, or invalid.
+// - Performs the action the transition table picked for a character.
 // Arguments:
+// - action - The action to take.
 // - wch - Character that triggered the event
 // Return Value:
 // - <none>
-void StateMachine::_EventSs3Entry(const wchar_t wch)
+void StateMachine::_DispatchAction(const VTActions action, const wchar_t wch)
 {
-    _trace.TraceOnEvent(L"Ss3Entry");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiInvalid(wch))
-    {
-        // It's safe for us to go into the CSI ignore here, because both SS3 and
-        //      CSI sequences ignore characters the same way.
-        _EnterCsiIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-        _EnterSs3Param();
-    }
-    else
+    switch (action)
     {
-        _ActionSs3Dispatch(wch);
-        _EnterGround();
+    case VTActions::Execute:
+        return _ActionExecute(wch);
+    case VTActions::ExecuteFromEscape:
+        // C0 characters following an escape are only a complete sequence if
+        //      the engine wants them to be.
+        if (_pEngine->DispatchControlCharsFromEscape())
+        {
+            _ActionExecuteFromEscape(wch);
+            _EnterGround();
+        }
+        else
+        {
+            _ActionExecute(wch);
+        }
+        return;
+    case VTActions::Print:
+        return _ActionPrint(wch);
+    case VTActions::EscDispatch:
+        return _ActionEscDispatch(wch);
+    case VTActions::Collect:
+        return _ActionCollect(wch);
+    case VTActions::Param:
+        return _ActionParam(wch);
+    case VTActions::CsiDispatch:
+        return _ActionCsiDispatch(wch);
+    case VTActions::OscParam:
+        return _ActionOscParam(wch);
+    case VTActions::OscPut:
+        return _ActionOscPut(wch);
+    case VTActions::OscDispatch:
+        return _ActionOscDispatch(wch);
+    case VTActions::Ss3Dispatch:
+        return _ActionSs3Dispatch(wch);
+    case VTActions::Ignore:
+        return _ActionIgnore();
+    case VTActions::None:
+    default:
+        return;
     }
 }
 
 // Routine Description:
-// - Processes a character event into an Action that occurs while in the CsiParam state.
-//   Events in this state will:
-//   1. Execute C0 control characters
-//   2. Ignore Delete characters
-//   3. Begin to ignore all remaining parameters when an invalid character is detected (CsiIgnore)
-//   4. Store parameter data
-//   5. Dispatch a control sequence with parameters for action
+// - Moves the state machine into the given state, running that state's entry actions.
 // Arguments:
-// - wch - Character that triggered the event
+// - state - The state to enter.
 // Return Value:
 // - <none>
-void StateMachine::_EventSs3Param(const wchar_t wch)
-{
-    _trace.TraceOnEvent(L"Ss3Param");
-    if (s_IsC0Code(wch))
-    {
-        _ActionExecute(wch);
-    }
-    else if (s_IsDelete(wch))
-    {
-        _ActionIgnore();
-    }
-    else if (s_IsCsiParamValue(wch) || s_IsCsiDelimiter(wch))
-    {
-        _ActionParam(wch);
-    }
-    else if (s_IsCsiInvalid(wch) || s_IsCsiPrivateMarker(wch))
-    {
-        _EnterCsiIgnore();
-    }
-    else
-    {
-        _ActionSs3Dispatch(wch);
-        _EnterGround();
+void StateMachine::_EnterState(const VTStates state)
+{
+    switch (state)
+    {
+    case VTStates::Ground:
+        return _EnterGround();
+    case VTStates::Escape:
+        return _EnterEscape();
+    case VTStates::EscapeIntermediate:
+        return _EnterEscapeIntermediate();
+    case VTStates::CsiEntry:
+        return _EnterCsiEntry();
+    case VTStates::CsiIntermediate:
+        return _EnterCsiIntermediate();
+    case VTStates::CsiIgnore:
+        return _EnterCsiIgnore();
+    case VTStates::CsiParam:
+        return _EnterCsiParam();
+    case VTStates::OscParam:
+        return _EnterOscParam();
+    case VTStates::OscString:
+        return _EnterOscString();
+    case VTStates::OscTermination:
+        return _EnterOscTermination();
+    case VTStates::Ss3Entry:
+        return _EnterSs3Entry();
+    case VTStates::Ss3Param:
+        return _EnterSs3Param();
+    default:
+        return;
     }
 }
 
 // Routine Description:
 // - Entry to the state machine. Takes characters one by one and processes them according to the state machine rules.
+//   Which action to take and which state to go to next is a single lookup in s_rgTransitions.
 // Arguments:
 // - wch - New character to operate upon
 // Return Value:
@@ -1248,51 +1348,18 @@ void StateMachine::ProcessCharacter(const wchar_t wch)
 {
     _trace.TraceCharInput(wch);
 
-    // Process "from anywhere" events first.
-    if (wch == AsciiChars::CAN ||
-        wch == AsciiChars::SUB)
-    {
-        _ActionExecute(wch);
-        _EnterGround();
-    }
-    else if (s_IsEscape(wch) && _state != VTStates::OscString)
+    if (!s_IsAnywhereEvent(_state, wch))
     {
-        // Don't go to escape from the OSC string state - ESC can be used to
-        //      terminate OSC strings.
-        _EnterEscape();
+        _trace.TraceOnEvent(s_rgStateNames[static_cast<size_t>(_state)]);
     }
-    else
+
+    const VTTransition transition = s_LookupTransition(_state, wch);
+
+    _DispatchAction(transition.action, wch);
+
+    if (transition.fEnterState)
     {
-        // Then pass to the current state as an event
-        switch (_state)
-        {
-        case VTStates::Ground:
-            return _EventGround(wch);
-        case VTStates::Escape:
-            return _EventEscape(wch);
-        case VTStates::EscapeIntermediate:
-            return _EventEscapeIntermediate(wch);
-        case VTStates::CsiEntry:
-            return _EventCsiEntry(wch);
-        case VTStates::CsiIntermediate:
-            return _EventCsiIntermediate(wch);
-        case VTStates::CsiIgnore:
-            return _EventCsiIgnore(wch);
-        case VTStates::CsiParam:
-            return _EventCsiParam(wch);
-        case VTStates::OscParam:
-            return _EventOscParam(wch);
-        case VTStates::OscString:
-            return _EventOscString(wch);
-        case VTStates::OscTermination:
-            return _EventOscTermination(wch);
-        case VTStates::Ss3Entry:
-            return _EventSs3Entry(wch);
-        case VTStates::Ss3Param:
-            return _EventSs3Param(wch);
-        default:
-            return;
-        }
+        _EnterState(transition.nextState);
     }
 }
 // Method Description:
@@ -1334,64 +1401,170 @@ void StateMachine::ProcessString(const wchar_t* const rgwch, const size_t cch)
     _pwchSequenceStart = rgwch;
     _currRunLength = 0;
 
-    // This should be static, because if one string starts a sequence, and the next finishes it,
-    //   we want the partial sequence state to persist.
-    static bool s_fProcessIndividually = false;
+    const wchar_t* const pwchEnd = rgwch + cch;
 
-    for(size_t cchCharsRemaining = cch; cchCharsRemaining > 0; cchCharsRemaining--)
+    while (_pwchCurr < pwchEnd)
     {
-        if (s_fProcessIndividually)
+        if (!_fProcessIndividually)
         {
-            // If we're processing characters individually, send it to the state machine.
-            ProcessCharacter(*_pwchCurr);
-            _pwchCurr++;
-            if (_state == VTStates::Ground)  // Then check if we're back at ground. If we are, the next character (pwchCurr)
-            {                                //   is the start of the next run of characters that might be printable.
-                s_fProcessIndividually = false;
-                _pwchSequenceStart = _pwchCurr;
-                _currRunLength = 0;
+            // Skip ahead over every printable character in one go, adding them all to the current run to be printed.
+            const wchar_t* const pwchActionable = s_FindActionableFromGround(_pwchCurr, pwchEnd);
+            _currRunLength += pwchActionable - _pwchCurr;
+            _pwchCurr = pwchActionable;
+
+            if (_pwchCurr == pwchEnd)
+            {
+                break;
             }
         }
-        else
+
+        _ProcessNextCharacter();
+    }
+
+    _ProcessEndOfString();
+}
+
+void StateMachine::ProcessString(const std::wstring& wstr)
+{
+    return ProcessString(wstr.c_str(), wstr.length());
+}
+
+// Routine Description:
+// - Entry to the state machine for UTF-8 text, such as the bytes read from a pty.
+//   Escape sequences and control characters are recognized on the bytes
+//   themselves. Runs of printable ASCII are widened straight into a buffer the
+//   state machine keeps between calls, and only other characters go through a
+//   full UTF-8 decode. A multi-byte character split across two calls is held
+//   until the next call completes it.
+// Arguments:
+// - utf8 - The UTF-8 text to operate upon
+// Return Value:
+// - <none>
+void StateMachine::ProcessUtf8(const std::string_view utf8)
+{
+    if (utf8.empty())
+    {
+        return;
+    }
+
+    // Every byte decodes to at most one UTF-16 code unit (a four byte sequence
+    //      becomes a surrogate pair), counting bytes held over from the last
+    //      call. Reserving that up front means the buffer never moves while
+    //      we're pointing into it below.
+    _wstrUtf8Decoded.clear();
+    _wstrUtf8Decoded.reserve(utf8.size() + _cchUtf8Partial);
+
+    _pwchCurr = _wstrUtf8Decoded.data();
+    _pwchSequenceStart = _pwchCurr;
+    _currRunLength = 0;
+
+    const char* const pchEnd = utf8.data() + utf8.size();
+    const char* pch = utf8.data();
+    while (pch < pchEnd)
+    {
+        if (!_fProcessIndividually && _cchUtf8Partial == 0)
         {
-            if (s_IsActionableFromGround(*_pwchCurr))  // If the current char is the start of an escape sequence, or should be executed in ground state...
+            // Printable ASCII is the same in UTF-16, just wider. Add all of it to the current run to be printed.
+            const char* const pchRunStart = pch;
+            while (pch < pchEnd && s_IsPrintableAscii(*pch))
             {
-                FAIL_FAST_IF(!(_pwchSequenceStart + _currRunLength <= rgwch + cch));
-                _pEngine->ActionPrintString(_pwchSequenceStart, _currRunLength); // ... print all the chars leading up to it as part of the run...
-                _trace.DispatchPrintRunTrace(_pwchSequenceStart, _currRunLength);
-                s_fProcessIndividually = true; // begin processing future characters individually...
-                _currRunLength = 0;
-                _pwchSequenceStart = _pwchCurr;
-                ProcessCharacter(*_pwchCurr); // ... Then process the character individually.
-                if (_state == VTStates::Ground)  // If the character took us right back to ground, start another run after it.
-                {
-                    s_fProcessIndividually = false;
-                    _pwchSequenceStart = _pwchCurr + 1;
-                    _currRunLength = 0;
-                }
+                _wstrUtf8Decoded.push_back(static_cast<wchar_t>(*pch));
+                pch++;
             }
-            else
+            _currRunLength += pch - pchRunStart;
+            _pwchCurr += pch - pchRunStart;
+
+            if (pch == pchEnd)
             {
-                _currRunLength++; // Otherwise, add this char to the current run to be printed.
+                break;
             }
-            _pwchCurr++;
+        }
+
+        // Anything else, we decode one character at a time and pass through the state machine.
+        wchar_t rgwch[2];
+        size_t cwch = 0;
+        pch += _DecodeUtf8(std::string_view(pch, pchEnd - pch), rgwch, cwch);
+        for (size_t i = 0; i < cwch; i++)
+        {
+            _wstrUtf8Decoded.push_back(rgwch[i]);
+            _ProcessNextCharacter();
         }
     }
 
+    _ProcessEndOfString();
+}
+
+// Routine Description:
+// - Processes the character at _pwchCurr as part of a string, then moves past it.
+//   In the ground state, printable characters are only added to the current
+//     run. Anything else prints the run so far and then goes through the
+//     state machine, as does every character until we return to the ground state.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_ProcessNextCharacter()
+{
+    if (_fProcessIndividually)
+    {
+        // If we're processing characters individually, send it to the state machine.
+        ProcessCharacter(*_pwchCurr);
+        _pwchCurr++;
+        if (_state == VTStates::Ground)  // Then check if we're back at ground. If we are, the next character (pwchCurr)
+        {                                //   is the start of the next run of characters that might be printable.
+            _fProcessIndividually = false;
+            _pwchSequenceStart = _pwchCurr;
+            _currRunLength = 0;
+        }
+    }
+    else if (!s_IsActionableFromGround(*_pwchCurr))
+    {
+        _currRunLength++;
+        _pwchCurr++;
+    }
+    else
+    {
+        // The current char is the start of an escape sequence, or should be executed in ground state...
+        _pEngine->ActionPrintString(_pwchSequenceStart, _currRunLength); // ... print all the chars leading up to it as part of the run...
+        _trace.DispatchPrintRunTrace(_pwchSequenceStart, _currRunLength);
+        _fProcessIndividually = true; // begin processing future characters individually...
+        _currRunLength = 0;
+        _pwchSequenceStart = _pwchCurr;
+        ProcessCharacter(*_pwchCurr); // ... Then process the character individually.
+        if (_state == VTStates::Ground)  // If the character took us right back to ground, start another run after it.
+        {
+            _fProcessIndividually = false;
+            _pwchSequenceStart = _pwchCurr + 1;
+            _currRunLength = 0;
+        }
+        _pwchCurr++;
+    }
+}
+
+// Routine Description:
+// - Finishes processing a string: prints the last run of printable
+//     characters, or if we're in the middle of a sequence and the engine asks
+//     for it, dispatches the partial sequence.
+// Arguments:
+// - <none>
+// Return Value:
+// - <none>
+void StateMachine::_ProcessEndOfString()
+{
     // If we're at the end of the string and have remaining un-printed characters,
-    if (!s_fProcessIndividually && _currRunLength > 0)
+    if (!_fProcessIndividually && _currRunLength > 0)
     {
         // print the rest of the characters in the string
         _pEngine->ActionPrintString(_pwchSequenceStart, _currRunLength);
         _trace.DispatchPrintRunTrace(_pwchSequenceStart, _currRunLength);
 
     }
-    else if (s_fProcessIndividually)
+    else if (_fProcessIndividually && _pwchCurr > _pwchSequenceStart)
     {
         if (_pEngine->FlushAtEndOfString())
         {
             // Reset our state, and put all but the last char in again.
-            ResetState();
+            _EnterGround();
             // Chars to flush are [pwchSequenceStart, pwchCurr)
             const wchar_t* pwch = _pwchSequenceStart;
             for (; pwch < _pwchCurr-1; pwch++)
@@ -1426,15 +1599,151 @@ void StateMachine::ProcessString(const wchar_t* const rgwch, const size_t cch)
     }
 }
 
-void StateMachine::ProcessString(const std::wstring& wstr)
+// Routine Description:
+// - Determines if a UTF-8 byte is a printable ASCII character, one that
+//   would just be added to the current run in the ground state.
+// Arguments:
+// - ch - Byte to check.
+// Return Value:
+// - True if it is. False if it isn't.
+bool StateMachine::s_IsPrintableAscii(const char ch) noexcept
 {
-    return ProcessString(wstr.c_str(), wstr.length());
+    return ch >= ' ' && ch < static_cast<char>(AsciiChars::DEL);
+}
+
+// Routine Description:
+// - Decodes the next character from UTF-8 text, continuing a character
+//   left incomplete at the end of the previous call if there is one.
+//   If the text ends before the character does, its bytes are held for the next call.
+// Arguments:
+// - utf8 - The remaining text. Must not be empty.
+// - rgwch - Receives the UTF-16 code units of the character.
+// - cwch - Receives the number of code units written, which is 0 if the character is incomplete.
+// Return Value:
+// - The number of bytes of utf8 used.
+size_t StateMachine::_DecodeUtf8(const std::string_view utf8, wchar_t (&rgwch)[2], size_t& cwch) noexcept
+{
+    // Put any bytes held over from the last call in front of the new ones.
+    char rgch[s_cchUtf8Max];
+    const size_t cchHeld = _cchUtf8Partial;
+    std::copy_n(_rgchUtf8Partial, cchHeld, rgch);
+    const size_t cchNew = std::min(utf8.size(), s_cchUtf8Max - cchHeld);
+    std::copy_n(utf8.data(), cchNew, rgch + cchHeld);
+
+    const size_t cchSequence = s_DecodeUtf8Sequence(std::string_view(rgch, cchHeld + cchNew), rgwch, cwch);
+    if (cchSequence == 0)
+    {
+        // We've run out of text. Hold on to what we have until the next call.
+        std::copy_n(rgch, cchHeld + cchNew, _rgchUtf8Partial);
+        _cchUtf8Partial = cchHeld + cchNew;
+        cwch = 0;
+        return cchNew;
+    }
+
+    _cchUtf8Partial = 0;
+    return cchSequence - cchHeld;
+}
+
+// Routine Description:
+// - Decodes a single UTF-8 encoded character into UTF-16.
+//   Invalid sequences are replaced with U+FFFD, one for each maximal
+//   subpart of an invalid sequence, as recommended by the Unicode standard
+//   (see "U+FFFD Substitution of Maximal Subparts" in chapter 3).
+// Arguments:
+// - utf8 - Text starting with the character to decode. Must not be empty.
+// - rgwch - Receives the UTF-16 code units of the character.
+// - cwch - Receives the number of code units written.
+// Return Value:
+// - The number of bytes used, or 0 if the text ends before the character does.
+size_t StateMachine::s_DecodeUtf8Sequence(const std::string_view utf8, wchar_t (&rgwch)[2], size_t& cwch) noexcept
+{
+    const auto byteAt = [&](const size_t i) {
+        return static_cast<unsigned char>(utf8[i]);
+    };
+
+    const unsigned char lead = byteAt(0);
+    size_t cchExpected = 0;
+    unsigned int codepoint = 0;
+    // The allowed range of the second byte is narrower than the usual
+    //      0x80-0xBF for some lead bytes, to exclude overlong encodings,
+    //      surrogates, and anything past U+10FFFF.
+    unsigned char secondMin = 0x80;
+    unsigned char secondMax = 0xBF;
+
+    if (lead < 0x80)
+    {
+        rgwch[0] = static_cast<wchar_t>(lead);
+        cwch = 1;
+        return 1;
+    }
+    else if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        cchExpected = 2;
+        codepoint = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        cchExpected = 3;
+        codepoint = lead & 0x0F;
+        secondMin = lead == 0xE0 ? 0xA0 : 0x80;
+        secondMax = lead == 0xED ? 0x9F : 0xBF;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        cchExpected = 4;
+        codepoint = lead & 0x07;
+        secondMin = lead == 0xF0 ? 0x90 : 0x80;
+        secondMax = lead == 0xF4 ? 0x8F : 0xBF;
+    }
+
+    size_t cch = 1;
+    if (cchExpected != 0)
+    {
+        for (; cch < cchExpected; cch++)
+        {
+            if (cch >= utf8.size())
+            {
+                // Everything so far is valid, we just don't have the rest of it yet.
+                cwch = 0;
+                return 0;
+            }
+
+            const unsigned char trail = byteAt(cch);
+            if (trail < (cch == 1 ? secondMin : 0x80) ||
+                trail > (cch == 1 ? secondMax : 0xBF))
+            {
+                break;
+            }
+            codepoint = (codepoint << 6) | (trail & 0x3F);
+        }
+    }
+
+    if (cch != cchExpected)
+    {
+        // An invalid lead byte, or a sequence cut short by an invalid trail byte.
+        rgwch[0] = UNICODE_REPLACEMENT;
+        cwch = 1;
+    }
+    else if (codepoint < 0x10000)
+    {
+        rgwch[0] = static_cast<wchar_t>(codepoint);
+        cwch = 1;
+    }
+    else
+    {
+        codepoint -= 0x10000;
+        rgwch[0] = static_cast<wchar_t>(0xD800 + (codepoint >> 10));
+        rgwch[1] = static_cast<wchar_t>(0xDC00 + (codepoint & 0x3FF));
+        cwch = 2;
+    }
+    return cch;
 }
 
 // Routine Description:
 // - Wherever the state machine is, whatever it's going, go back to ground.
 //     This is used by conhost to "jiggle the handle" - when VT support is
-//     turned off, we don't want any bad state left over for the next input it's turned on for
+//     turned off, we don't want any bad state left over for the next input it's turned on for.
+//     That includes the start of a UTF-8 character held from the last call to ProcessUtf8.
 // Arguments:
 // - <none>
 // Return Value:
@@ -1442,4 +1751,6 @@ void StateMachine::ProcessString(const std::wstring& wstr)
 void StateMachine::ResetState()
 {
     _EnterGround();
+    _fProcessIndividually = false;
+    _cchUtf8Partial = 0;
 }
@@ -17,7 +17,9 @@ Abstract:
 #include "IStateMachineEngine.hpp"
 #include "telemetry.hpp"
 #include "tracing.hpp"
+#include <array>
 #include <memory>
+#include <string_view>
 
 namespace Microsoft::Console::VirtualTerminal
 {
@@ -34,6 +36,7 @@ namespace Microsoft::Console::VirtualTerminal
         void ProcessCharacter(const wchar_t wch);
         void ProcessString(const wchar_t* const rgwch, const size_t cch);
         void ProcessString(const std::wstring& wstr);
+        void ProcessUtf8(const std::string_view utf8);
 
         void ResetState();
 
@@ -47,27 +50,88 @@ namespace Microsoft::Console::VirtualTerminal
         static const short s_cOscStringMaxLength = 256;
 
     private:
-        static bool s_IsActionableFromGround(const wchar_t wch);
-        static bool s_IsC0Code(const wchar_t wch);
-        static bool s_IsC1Csi(const wchar_t wch);
-        static bool s_IsIntermediate(const wchar_t wch);
-        static bool s_IsDelete(const wchar_t wch);
-        static bool s_IsEscape(const wchar_t wch);
-        static bool s_IsCsiIndicator(const wchar_t wch);
-        static bool s_IsCsiDelimiter(const wchar_t wch);
-        static bool s_IsCsiParamValue(const wchar_t wch);
-        static bool s_IsCsiPrivateMarker(const wchar_t wch);
-        static bool s_IsCsiInvalid(const wchar_t wch);
-        static bool s_IsOscIndicator(const wchar_t wch);
-        static bool s_IsOscDelimiter(const wchar_t wch);
-        static bool s_IsOscParamValue(const wchar_t wch);
-        static bool s_IsOscInvalid(const wchar_t wch);
-        static bool s_IsOscTerminator(const wchar_t wch);
-        static bool s_IsOscTerminationInitiator(const wchar_t wch);
+        enum class VTStates : unsigned char
+        {
+            Ground,
+            Escape,
+            EscapeIntermediate,
+            CsiEntry,
+            CsiIntermediate,
+            CsiIgnore,
+            CsiParam,
+            OscParam,
+            OscString,
+            OscTermination,
+            Ss3Entry,
+            Ss3Param
+        };
+
+        enum class VTActions : unsigned char
+        {
+            None,
+            Execute,
+            ExecuteFromEscape,
+            Print,
+            EscDispatch,
+            Collect,
+            Param,
+            CsiDispatch,
+            OscParam,
+            OscPut,
+            OscDispatch,
+            Ss3Dispatch,
+            Ignore
+        };
+
+        // What to do with a character in a given state: the action to take,
+        // followed by entering nextState if fEnterState is set.
+        struct VTTransition
+        {
+            VTActions action;
+            VTStates nextState;
+            bool fEnterState;
+        };
+
+        static constexpr size_t s_cStates = static_cast<size_t>(VTStates::Ss3Param) + 1;
+        // All characters above this behave the same way in every state.
+        static constexpr wchar_t s_wchTransitionTableMax = L'\xA0';
+
+        using TransitionTable = std::array<std::array<VTTransition, s_wchTransitionTableMax + 1>, s_cStates>;
+        static const TransitionTable s_rgTransitions;
+
+        // The name of each state, for tracing the events in it.
+        static const std::array<const wchar_t*, s_cStates> s_rgStateNames;
+
+        static constexpr bool s_IsAnywhereEvent(const VTStates state, const wchar_t wch) noexcept;
+        static constexpr VTTransition s_ComputeTransition(const VTStates state, const wchar_t wch) noexcept;
+        static constexpr TransitionTable s_BuildTransitionTable() noexcept;
+        static constexpr bool s_IsTransitionTableComplete() noexcept;
+        static VTTransition s_LookupTransition(const VTStates state, const wchar_t wch) noexcept;
+        static VTTransition s_ComputeTransitionNoTable(const VTStates state, const wchar_t wch) noexcept;
+
+        static constexpr bool s_IsActionableFromGround(const wchar_t wch) noexcept;
+        static const wchar_t* s_FindActionableFromGround(const wchar_t* const pwchBegin, const wchar_t* const pwchEnd) noexcept;
+        static const wchar_t* s_FindActionableFromGroundScalar(const wchar_t* const pwchBegin, const wchar_t* const pwchEnd) noexcept;
+        static constexpr bool s_IsC0Code(const wchar_t wch) noexcept;
+        static constexpr bool s_IsC1Csi(const wchar_t wch) noexcept;
+        static constexpr bool s_IsIntermediate(const wchar_t wch) noexcept;
+        static constexpr bool s_IsDelete(const wchar_t wch) noexcept;
+        static constexpr bool s_IsEscape(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiIndicator(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiDelimiter(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiParamValue(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiPrivateMarker(const wchar_t wch) noexcept;
+        static constexpr bool s_IsCsiInvalid(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscIndicator(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscDelimiter(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscParamValue(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscInvalid(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscTerminator(const wchar_t wch) noexcept;
+        static constexpr bool s_IsOscTerminationInitiator(const wchar_t wch) noexcept;
         static bool s_IsDesignateCharsetIndicator(const wchar_t wch);
         static bool s_IsCharsetCode(const wchar_t wch);
-        static bool s_IsNumber(const wchar_t wch);
-        static bool s_IsSs3Indicator(const wchar_t wch);
+        static constexpr bool s_IsNumber(const wchar_t wch) noexcept;
+        static constexpr bool s_IsSs3Indicator(const wchar_t wch) noexcept;
 
         void _ActionExecute(const wchar_t wch);
         void _ActionExecuteFromEscape(const wchar_t wch);
@@ -97,34 +161,16 @@ namespace Microsoft::Console::VirtualTerminal
         void _EnterSs3Entry();
         void _EnterSs3Param();
 
-        void _EventGround(const wchar_t wch);
-        void _EventEscape(const wchar_t wch);
-        void _EventEscapeIntermediate(const wchar_t wch);
-        void _EventCsiEntry(const wchar_t wch);
-        void _EventCsiIntermediate(const wchar_t wch);
-        void _EventCsiIgnore(const wchar_t wch);
-        void _EventCsiParam(const wchar_t wch);
-        void _EventOscParam(const wchar_t wch);
-        void _EventOscString(const wchar_t wch);
-        void _EventOscTermination(const wchar_t wch);
-        void _EventSs3Entry(const wchar_t wch);
-        void _EventSs3Param(const wchar_t wch);
-
-        enum class VTStates
-        {
-            Ground,
-            Escape,
-            EscapeIntermediate,
-            CsiEntry,
-            CsiIntermediate,
-            CsiIgnore,
-            CsiParam,
-            OscParam,
-            OscString,
-            OscTermination,
-            Ss3Entry,
-            Ss3Param
-        };
+        static constexpr size_t s_cchUtf8Max = 4;
+        static bool s_IsPrintableAscii(const char ch) noexcept;
+        static size_t s_DecodeUtf8Sequence(const std::string_view utf8, wchar_t (&rgwch)[2], size_t& cwch) noexcept;
+        size_t _DecodeUtf8(const std::string_view utf8, wchar_t (&rgwch)[2], size_t& cwch) noexcept;
+
+        void _ProcessNextCharacter();
+        void _ProcessEndOfString();
+
+        void _DispatchAction(const VTActions action, const wchar_t wch);
+        void _EnterState(const VTStates state);
 
         Microsoft::Console::VirtualTerminal::ParserTracing _trace;
 
@@ -151,5 +197,15 @@ namespace Microsoft::Console::VirtualTerminal
         const wchar_t* _pwchSequenceStart;
         size_t _currRunLength;
 
+        // If one string starts a sequence, and the next finishes it, we want
+        // the partial sequence state to persist between calls.
+        bool _fProcessIndividually;
+
+        // The start of a UTF-8 character that was split across two calls to
+        // ProcessUtf8, and the buffer ProcessUtf8 decodes into.
+        char _rgchUtf8Partial[s_cchUtf8Max];
+        size_t _cchUtf8Partial;
+        std::wstring _wstrUtf8Decoded;
+
     };
 }
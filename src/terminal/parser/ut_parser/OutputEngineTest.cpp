@@ -3,6 +3,7 @@
 
 #include "precomp.h"
 #include <wextestclass.h>
+#include <chrono>
 #include "../../inc/consoletaeftemplates.hpp"
 
 #include "stateMachine.hpp"
@@ -49,6 +50,33 @@ public:
     }
 };
 
+// Records everything printed or executed into a single log, so that two
+// different ways of feeding the same input to the state machine can be compared.
+class RecordingDispatch final : public TermDispatch
+{
+public:
+    virtual void Execute(const wchar_t wchControl) override
+    {
+        _log.push_back(L'<');
+        _log.push_back(wchControl);
+        _log.push_back(L'>');
+    }
+
+    virtual void Print(const wchar_t wchPrintable) override
+    {
+        _log.push_back(wchPrintable);
+    }
+
+    virtual void PrintString(const wchar_t* const rgwch, const size_t cch) override
+    {
+        _log.append(rgwch, cch);
+        _printStringCalls++;
+    }
+
+    std::wstring _log;
+    size_t _printStringCalls = 0;
+};
+
 class Microsoft::Console::VirtualTerminal::OutputEngineTest final
 {
     TEST_CLASS(OutputEngineTest);
@@ -544,6 +572,468 @@ class Microsoft::Console::VirtualTerminal::OutputEngineTest final
         mach.ProcessCharacter(L'J');
         VERIFY_ARE_EQUAL(mach._state, StateMachine::VTStates::Ground);
     }
+
+    TEST_METHOD(TestGroundScannerMatchesScalar)
+    {
+        const std::wstring actionable{ L'\x0', AsciiChars::BEL, AsciiChars::BS, AsciiChars::LF, AsciiChars::CR, AsciiChars::ESC, AsciiChars::US, AsciiChars::DEL, L'\x9b' };
+        const std::wstring printable{ L' ', L'a', L'~', L'\x80', L'\x9a', L'\x9c', L'\x3042', L'\xffff' };
+
+        Log::Comment(L"No actionable characters at all, for lengths around the vector width.");
+        for (size_t length = 0; length < 40; length++)
+        {
+            std::wstring text;
+            for (size_t i = 0; i < length; i++)
+            {
+                text.push_back(printable[i % printable.size()]);
+            }
+
+            const auto pwchBegin = text.data();
+            const auto pwchEnd = text.data() + text.size();
+            VERIFY_ARE_EQUAL(length, static_cast<size_t>(StateMachine::s_FindActionableFromGround(pwchBegin, pwchEnd) - pwchBegin));
+            VERIFY_ARE_EQUAL(length, static_cast<size_t>(StateMachine::s_FindActionableFromGroundScalar(pwchBegin, pwchEnd) - pwchBegin));
+        }
+
+        Log::Comment(L"One actionable character at every position.");
+        for (const auto wchActionable : actionable)
+        {
+            for (size_t length = 1; length < 40; length++)
+            {
+                for (size_t pos = 0; pos < length; pos++)
+                {
+                    std::wstring text;
+                    for (size_t i = 0; i < length; i++)
+                    {
+                        text.push_back(printable[i % printable.size()]);
+                    }
+                    text[pos] = wchActionable;
+
+                    const auto pwchBegin = text.data();
+                    const auto pwchEnd = text.data() + text.size();
+                    VERIFY_ARE_EQUAL(pos, static_cast<size_t>(StateMachine::s_FindActionableFromGround(pwchBegin, pwchEnd) - pwchBegin));
+                    VERIFY_ARE_EQUAL(pos, static_cast<size_t>(StateMachine::s_FindActionableFromGroundScalar(pwchBegin, pwchEnd) - pwchBegin));
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(TestProcessStringMatchesProcessCharacter)
+    {
+        const std::wstring text = L"Hello World\r\n"
+                                  L"0123456789abcdefghijklmnopqrstuvwxyz\x7\x7f"
+                                  L"\x1b[1;31mred\x1b[0m\tplain\x9b" L"2Jcleared\x1b]0;title\x7"
+                                  L"\x3042\x3044\x3046 after a long run of text that spans several vectors\b\r\n";
+
+        RecordingDispatch* pStringDispatch = new RecordingDispatch;
+        StateMachine stringMach(new OutputStateMachineEngine(pStringDispatch));
+        stringMach.ProcessString(text);
+
+        RecordingDispatch* pCharDispatch = new RecordingDispatch;
+        StateMachine charMach(new OutputStateMachineEngine(pCharDispatch));
+        for (const auto wch : text)
+        {
+            charMach.ProcessCharacter(wch);
+        }
+
+        VERIFY_ARE_EQUAL(pCharDispatch->_log, pStringDispatch->_log);
+        VERIFY_ARE_EQUAL(StateMachine::VTStates::Ground, stringMach._state);
+
+        Log::Comment(L"Runs of printable text should be handed over whole, not one character at a time.");
+        VERIFY_IS_LESS_THAN(pStringDispatch->_printStringCalls, static_cast<size_t>(16));
+    }
+
+    TEST_METHOD(GroundScannerPerformance)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Mostly ASCII text, like a build log, with a line break every 120 characters.
+        std::wstring text;
+        text.reserve(4 * 1024 * 1024);
+        while (text.size() < text.capacity() - 128)
+        {
+            for (wchar_t wch = L' '; wch < L' ' + 118; wch++)
+            {
+                text.push_back(wch < AsciiChars::DEL ? wch : L'x');
+            }
+            text.append(L"\r\n");
+        }
+
+        const auto pwchEnd = text.data() + text.size();
+        const auto countBreaks = [&](auto&& scanner) {
+            size_t count = 0;
+            for (auto pwch = scanner(text.data(), pwchEnd); pwch < pwchEnd; pwch = scanner(pwch + 1, pwchEnd))
+            {
+                count++;
+            }
+            return count;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        const auto scalarCount = countBreaks(StateMachine::s_FindActionableFromGroundScalar);
+        const auto scalarTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        const auto vectorCount = countBreaks(StateMachine::s_FindActionableFromGround);
+        const auto vectorTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        VERIFY_ARE_EQUAL(scalarCount, vectorCount);
+        Log::Comment(NoThrowString().Format(L"Scanned %zu characters. Scalar: %lld us. Vectorized: %lld us.",
+                                            text.size(),
+                                            scalarTime,
+                                            vectorTime));
+
+        start = std::chrono::steady_clock::now();
+        StateMachine mach(new OutputStateMachineEngine(new DummyDispatch));
+        mach.ProcessString(text);
+        const auto processTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"ProcessString took %lld us.", processTime));
+    }
+
+    // The classes of characters that the VT100.net state diagram tells apart.
+    enum class CharClass
+    {
+        C0, // 0x00-0x17, 0x19 and 0x1C-0x1F, except BEL
+        Bel, // 0x07
+        CanSub, // 0x18 and 0x1A
+        Esc, // 0x1B
+        Intermediate, // 0x20-0x2F
+        Digit, // 0x30-0x39
+        Colon, // 0x3A
+        Semicolon, // 0x3B
+        PrivateMarker, // 0x3C-0x3F
+        Ss3Indicator, // 0x4F 'O'
+        CsiIndicator, // 0x5B '['
+        OscIndicator, // 0x5D ']'
+        Final, // the rest of 0x40-0x7E
+        Del, // 0x7F
+        C1Csi, // 0x9B
+        C1St, // 0x9C
+        Other // everything else, printable
+    };
+
+    static CharClass s_ClassifyForGolden(const unsigned int wch)
+    {
+        switch (wch)
+        {
+        case 0x07: return CharClass::Bel;
+        case 0x18:
+        case 0x1A: return CharClass::CanSub;
+        case 0x1B: return CharClass::Esc;
+        case 0x3A: return CharClass::Colon;
+        case 0x3B: return CharClass::Semicolon;
+        case 0x4F: return CharClass::Ss3Indicator;
+        case 0x5B: return CharClass::CsiIndicator;
+        case 0x5D: return CharClass::OscIndicator;
+        case 0x7F: return CharClass::Del;
+        case 0x9B: return CharClass::C1Csi;
+        case 0x9C: return CharClass::C1St;
+        }
+
+        return wch <= 0x1F ? CharClass::C0 :
+               wch <= 0x2F ? CharClass::Intermediate :
+               wch <= 0x39 ? CharClass::Digit :
+               wch <= 0x3F ? CharClass::PrivateMarker :
+               wch <= 0x7E ? CharClass::Final :
+                             CharClass::Other;
+    }
+
+    // Written out by hand from the VT100.net state diagram (with this
+    // parser's deviations from it), rather than from the predicates the
+    // transition table is built from, so the test doesn't just check the
+    // table against itself.
+    static StateMachine::VTTransition s_GoldenTransition(const StateMachine::VTStates state, const CharClass cls)
+    {
+        using S = StateMachine::VTStates;
+        using A = StateMachine::VTActions;
+        using C = CharClass;
+
+        const auto stay = [state](const A action) { return StateMachine::VTTransition{ action, state, false }; };
+        const auto enter = [](const A action, const S nextState) { return StateMachine::VTTransition{ action, nextState, true }; };
+
+        if (cls == C::CanSub)
+        {
+            return enter(A::Execute, S::Ground);
+        }
+        if (cls == C::Esc && state != S::OscString)
+        {
+            return enter(A::None, S::Escape);
+        }
+
+        switch (state)
+        {
+        case S::Ground:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: case C::Del: return stay(A::Execute);
+            case C::C1Csi: return enter(A::None, S::CsiEntry);
+            default: return stay(A::Print);
+            }
+        case S::Escape:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::ExecuteFromEscape);
+            case C::Del: return stay(A::Ignore);
+            case C::Intermediate: return enter(A::Collect, S::EscapeIntermediate);
+            case C::CsiIndicator: return enter(A::None, S::CsiEntry);
+            case C::OscIndicator: return enter(A::None, S::OscParam);
+            case C::Ss3Indicator: return enter(A::None, S::Ss3Entry);
+            default: return enter(A::EscDispatch, S::Ground);
+            }
+        case S::EscapeIntermediate:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Intermediate: return stay(A::Collect);
+            case C::Del: return stay(A::Ignore);
+            default: return enter(A::EscDispatch, S::Ground);
+            }
+        case S::CsiEntry:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Del: return stay(A::Ignore);
+            case C::Intermediate: return enter(A::Collect, S::CsiIntermediate);
+            case C::Colon: return enter(A::None, S::CsiIgnore);
+            case C::Digit: case C::Semicolon: return enter(A::Param, S::CsiParam);
+            case C::PrivateMarker: return enter(A::Collect, S::CsiParam);
+            default: return enter(A::CsiDispatch, S::Ground);
+            }
+        case S::CsiIntermediate:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Intermediate: return stay(A::Collect);
+            case C::Del: return stay(A::Ignore);
+            case C::Digit: case C::Colon: case C::Semicolon: case C::PrivateMarker: return enter(A::None, S::CsiIgnore);
+            default: return enter(A::CsiDispatch, S::Ground);
+            }
+        case S::CsiIgnore:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Del: case C::Intermediate: case C::Digit: case C::Colon: case C::Semicolon: case C::PrivateMarker: return stay(A::Ignore);
+            default: return enter(A::None, S::Ground);
+            }
+        case S::CsiParam:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Del: return stay(A::Ignore);
+            case C::Digit: case C::Semicolon: return stay(A::Param);
+            case C::Intermediate: return enter(A::Collect, S::CsiIntermediate);
+            case C::Colon: case C::PrivateMarker: return enter(A::None, S::CsiIgnore);
+            default: return enter(A::CsiDispatch, S::Ground);
+            }
+        case S::OscParam:
+            switch (cls)
+            {
+            case C::Bel: case C::C1St: return enter(A::None, S::Ground);
+            case C::Digit: return stay(A::OscParam);
+            case C::Semicolon: return enter(A::None, S::OscString);
+            default: return stay(A::Ignore);
+            }
+        case S::OscString:
+            switch (cls)
+            {
+            case C::Bel: case C::C1St: return enter(A::OscDispatch, S::Ground);
+            case C::Esc: return enter(A::None, S::OscTermination);
+            case C::C0: return stay(A::Ignore);
+            default: return stay(A::OscPut);
+            }
+        case S::OscTermination:
+            return enter(A::OscDispatch, S::Ground);
+        case S::Ss3Entry:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Del: return stay(A::Ignore);
+            case C::Colon: return enter(A::None, S::CsiIgnore);
+            case C::Digit: case C::Semicolon: return enter(A::Param, S::Ss3Param);
+            default: return enter(A::Ss3Dispatch, S::Ground);
+            }
+        case S::Ss3Param:
+            switch (cls)
+            {
+            case C::C0: case C::Bel: return stay(A::Execute);
+            case C::Del: return stay(A::Ignore);
+            case C::Digit: case C::Semicolon: return stay(A::Param);
+            case C::Colon: case C::PrivateMarker: return enter(A::None, S::CsiIgnore);
+            default: return enter(A::Ss3Dispatch, S::Ground);
+            }
+        default:
+            return stay(A::None);
+        }
+    }
+
+    TEST_METHOD(TestTransitionTableMatchesGolden)
+    {
+        Log::Comment(L"Every character in every state should get the transition the state diagram gives it.");
+        size_t mismatches = 0;
+        for (size_t state = 0; state < StateMachine::s_cStates; state++)
+        {
+            for (unsigned int wch = 0; wch <= 0xFFFF; wch++)
+            {
+                const auto fromTable = StateMachine::s_LookupTransition(static_cast<StateMachine::VTStates>(state), static_cast<wchar_t>(wch));
+                const auto golden = s_GoldenTransition(static_cast<StateMachine::VTStates>(state), s_ClassifyForGolden(wch));
+                if (fromTable.action != golden.action ||
+                    fromTable.nextState != golden.nextState ||
+                    fromTable.fEnterState != golden.fEnterState)
+                {
+                    Log::Comment(NoThrowString().Format(L"Mismatch in state %zu for character 0x%x", state, wch));
+                    mismatches++;
+                }
+            }
+        }
+        VERIFY_ARE_EQUAL(static_cast<size_t>(0), mismatches);
+    }
+
+    TEST_METHOD(TestTransitionTableCoversAllCharacters)
+    {
+        Log::Comment(L"Every character above the end of the table should behave like its last column.");
+        VERIFY_IS_TRUE(StateMachine::s_IsTransitionTableComplete());
+    }
+
+    TEST_METHOD(TestProcessUtf8MatchesProcessString)
+    {
+        // The same text as UTF-8 and UTF-16, with escape sequences, a C1 CSI,
+        // and characters that are two, three and four bytes long in UTF-8.
+        const std::string utf8 = "Hello World\r\n"
+                                 "\x1b[1;31mred\x1b[0m\tplain\xc2\x9b" "2Jcleared\x1b]0;t\xc3\xaftle\x7"
+                                 "\xe3\x81\x82\xe3\x81\x84 \xf0\x9f\x98\x80 after\x7f\b\r\n";
+        const std::wstring utf16 = L"Hello World\r\n"
+                                   L"\x1b[1;31mred\x1b[0m\tplain\x9b" L"2Jcleared\x1b]0;t\xeftle\x7"
+                                   L"\x3042\x3044 \xd83d\xde00 after\x7f\b\r\n";
+
+        RecordingDispatch* pStringDispatch = new RecordingDispatch;
+        StateMachine stringMach(new OutputStateMachineEngine(pStringDispatch));
+        stringMach.ProcessString(utf16);
+
+        Log::Comment(L"All of the text in one call.");
+        {
+            RecordingDispatch* pUtf8Dispatch = new RecordingDispatch;
+            StateMachine utf8Mach(new OutputStateMachineEngine(pUtf8Dispatch));
+            utf8Mach.ProcessUtf8(utf8);
+            VERIFY_ARE_EQUAL(pStringDispatch->_log, pUtf8Dispatch->_log);
+            VERIFY_ARE_EQUAL(StateMachine::VTStates::Ground, utf8Mach._state);
+        }
+
+        Log::Comment(L"The text split in two at every possible byte, including the middle of characters and sequences.");
+        for (size_t split = 1; split < utf8.size(); split++)
+        {
+            RecordingDispatch* pUtf8Dispatch = new RecordingDispatch;
+            StateMachine utf8Mach(new OutputStateMachineEngine(pUtf8Dispatch));
+            utf8Mach.ProcessUtf8(std::string_view(utf8).substr(0, split));
+            utf8Mach.ProcessUtf8(std::string_view(utf8).substr(split));
+            VERIFY_ARE_EQUAL(pStringDispatch->_log, pUtf8Dispatch->_log);
+        }
+
+        Log::Comment(L"The text one byte at a time.");
+        {
+            RecordingDispatch* pUtf8Dispatch = new RecordingDispatch;
+            StateMachine utf8Mach(new OutputStateMachineEngine(pUtf8Dispatch));
+            for (const auto ch : utf8)
+            {
+                utf8Mach.ProcessUtf8(std::string_view(&ch, 1));
+            }
+            VERIFY_ARE_EQUAL(pStringDispatch->_log, pUtf8Dispatch->_log);
+        }
+    }
+
+    TEST_METHOD(TestProcessUtf8InvalidSequences)
+    {
+        const auto decode = [](const std::string_view utf8) {
+            RecordingDispatch* pDispatch = new RecordingDispatch;
+            StateMachine mach(new OutputStateMachineEngine(pDispatch));
+            mach.ProcessUtf8(utf8);
+            return pDispatch->_log;
+        };
+
+        Log::Comment(L"Bytes that can never start a character.");
+        VERIFY_ARE_EQUAL(std::wstring(L"a\xfffd\xfffd\xfffd" L"b"), decode("a\x80\xc0\xff" "b"));
+
+        Log::Comment(L"Overlong encodings, surrogates and code points past U+10FFFF are replaced a byte at a time.");
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd\xfffd"), decode("\xc1\xbf"));
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd\xfffd\xfffd"), decode("\xe0\x80\xaf"));
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd\xfffd\xfffd"), decode("\xed\xa0\x80"));
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd\xfffd\xfffd\xfffd"), decode("\xf4\x90\x80\x80"));
+
+        Log::Comment(L"A character cut short is replaced once, and whatever cut it short is still processed.");
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd" L"a"), decode("\xe3\x81" "a"));
+        VERIFY_ARE_EQUAL(std::wstring(L"\xfffd<\r>"), decode("\xf0\x9f\x98\r"));
+    }
+
+    TEST_METHOD(TestResetStateDropsPartialUtf8)
+    {
+        RecordingDispatch* pDispatch = new RecordingDispatch;
+        StateMachine mach(new OutputStateMachineEngine(pDispatch));
+
+        Log::Comment(L"The start of a character held from before a reset shouldn't be completed by the next write.");
+        mach.ProcessUtf8("a\xe3\x81");
+        mach.ResetState();
+        mach.ProcessUtf8("\x82" "b");
+
+        VERIFY_ARE_EQUAL(std::wstring(L"a\xfffd" L"b"), pDispatch->_log);
+        VERIFY_ARE_EQUAL(StateMachine::VTStates::Ground, mach._state);
+    }
+
+    TEST_METHOD(TransitionTablePerformance)
+    {
+        BEGIN_TEST_METHOD_PROPERTIES()
+            TEST_METHOD_PROPERTY(L"IsPerfTest", L"true")
+        END_TEST_METHOD_PROPERTIES()
+
+        // Approximations of what full screen applications write: an editor
+        // redrawing lines with syntax colors, a process monitor repainting
+        // meters, and a multiplexer status line inside a scrolling region.
+        const std::wstring vim = L"\x1b[?25l\x1b[12;1H\x1b[38;5;130m  12 \x1b[m\x1b[38;5;81mint\x1b[m main()\x1b[K\x1b[13;1H\x1b[38;5;130m  13 \x1b[m{\x1b[K\x1b[?25h";
+        const std::wstring htop = L"\x1b[2;3H\x1b[1m\x1b[36m1\x1b[m\x1b[1m[\x1b[32m||||\x1b[31m||\x1b[30;1m      \x1b[37;1m 12.5%\x1b[m\x1b[1m]\x1b[m\x1b[3;3H\x1b[48;2;0;95;135m  PID USER \x1b[0m";
+        const std::wstring tmux = L"\x1b" L"7\x1b[1;23r\x1b[23;1H\r\n\x1b[24;1H\x1b[30m\x1b[42m[0] 0:bash*\x1b[K\x1b]0;tmux\x7\x1b[39m\x1b[49m\x1b" L"8";
+
+        std::wstring text;
+        text.reserve(4 * 1024 * 1024);
+        while (text.size() < text.capacity() - 512)
+        {
+            text.append(vim);
+            text.append(htop);
+            text.append(tmux);
+        }
+
+        const auto walkStates = [&](auto&& getTransition) {
+            auto state = StateMachine::VTStates::Ground;
+            size_t transitions = 0;
+            for (const auto wch : text)
+            {
+                const auto transition = getTransition(state, wch);
+                if (transition.fEnterState)
+                {
+                    state = transition.nextState;
+                    transitions++;
+                }
+            }
+            return transitions;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        const auto predicateTransitions = walkStates(StateMachine::s_ComputeTransitionNoTable);
+        const auto predicateTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        const auto tableTransitions = walkStates(StateMachine::s_LookupTransition);
+        const auto tableTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+        VERIFY_ARE_EQUAL(predicateTransitions, tableTransitions);
+        Log::Comment(NoThrowString().Format(L"Classified %zu characters. Predicates: %lld us. Table: %lld us.",
+                                            text.size(),
+                                            predicateTime,
+                                            tableTime));
+
+        start = std::chrono::steady_clock::now();
+        StateMachine mach(new OutputStateMachineEngine(new DummyDispatch));
+        mach.ProcessString(text);
+        const auto processTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"ProcessString took %lld us.", processTime));
+    }
 };
 
 class StatefulDispatch final : public TermDispatch
@@ -0,0 +1,173 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// RenderBenchmark replays a captured VT stream through the Terminal's
+// StateMachine and the Renderer, painting into a RecordingRenderEngine that
+// doesn't draw anything. It reports how fast the renderer went, so that
+// renderer regressions show up without needing a real window.
+//
+// Usage: RenderBenchmark.exe <capture file> [columns rows [bytes per frame]]
+//
+// The capture is the raw UTF-8 output of a client application, like what you'd
+// get from `script` or from tee'ing a pty. It's fed to the Terminal a chunk at
+// a time, and a frame is painted after each chunk, as if each chunk was one
+// read from the pty.
+
+#include <LibraryIncludes.h>
+
+#include <chrono>
+#include <fstream>
+#include <numeric>
+
+#include "../../cascadia/TerminalCore/Terminal.hpp"
+#include "../../renderer/base/renderer.hpp"
+#include "../../renderer/inc/RecordingRenderEngine.hpp"
+
+using namespace Microsoft::Terminal::Core;
+using namespace Microsoft::Console::Render;
+
+using Clock = std::chrono::steady_clock;
+
+// Every allocation made by the process is counted, so we can tell how many
+// were made while painting.
+static std::atomic<size_t> s_allocations{ 0 };
+
+void* __cdecl operator new(size_t size)
+{
+    s_allocations++;
+    if (void* const p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void __cdecl operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+// The Renderer usually paints from its own thread whenever it's notified. We
+// want to paint synchronously, after each chunk of input, so this thread
+// ignores the notifications, and we call PaintFrame ourselves.
+class ManualRenderThread final : public IRenderThread
+{
+public:
+    void NotifyPaint() override {}
+    void NotifyInput() override {}
+    void EnablePainting() override {}
+    void WaitForPaintCompletionAndDisable(const DWORD /*dwTimeoutMs*/) override {}
+    void SetFrameInterval(const std::chrono::milliseconds /*interval*/) noexcept override {}
+    RenderThreadCounters GetCounters() const noexcept override { return {}; }
+};
+
+static double s_ToMicroseconds(const Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+static Clock::duration s_Percentile(const std::vector<Clock::duration>& sorted, const size_t percentile)
+{
+    const auto index = std::min(sorted.size() - 1, sorted.size() * percentile / 100);
+    return sorted.at(index);
+}
+
+int __cdecl wmain(int argc, WCHAR* argv[])
+{
+    if (argc != 2 && argc != 4 && argc != 5)
+    {
+        wprintf(L"Usage: %s <capture file> [columns rows [bytes per frame]]\n", argv[0]);
+        return 1;
+    }
+
+    const SHORT columns = argc >= 4 ? gsl::narrow<SHORT>(_wtoi(argv[2])) : 120;
+    const SHORT rows = argc >= 4 ? gsl::narrow<SHORT>(_wtoi(argv[3])) : 30;
+    const size_t chunkSize = argc >= 5 ? gsl::narrow<size_t>(_wtoi(argv[4])) : 4096;
+    if (columns <= 0 || rows <= 0 || chunkSize == 0)
+    {
+        wprintf(L"The size of the terminal and of each chunk must be positive.\n");
+        return 1;
+    }
+
+    std::ifstream file{ argv[1], std::ios::binary };
+    if (!file)
+    {
+        wprintf(L"Couldn't open %s\n", argv[1]);
+        return 1;
+    }
+    const std::string capture{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+    Terminal terminal;
+    RecordingRenderEngine engine;
+    IRenderEngine* engines[]{ &engine };
+    Renderer renderer{ &terminal, engines, ARRAYSIZE(engines), std::make_unique<ManualRenderThread>() };
+    terminal.Create({ columns, rows }, 9001, renderer);
+
+    const size_t chunks = (capture.size() + chunkSize - 1) / chunkSize;
+    std::vector<Clock::duration> frameTimes;
+    frameTimes.reserve(chunks);
+
+    size_t paintAllocations = 0;
+    size_t bufferLineCalls = 0;
+    size_t brushCalls = 0;
+    size_t cursorCalls = 0;
+
+    const auto start = Clock::now();
+    for (size_t offset = 0; offset < capture.size(); offset += chunkSize)
+    {
+        const auto length = std::min(chunkSize, capture.size() - offset);
+        terminal.WriteUtf8({ capture.data() + offset, length });
+
+        const auto allocationsBefore = s_allocations.load();
+        const auto frameStart = Clock::now();
+        LOG_IF_FAILED(renderer.PaintFrame());
+        const auto frameTime = Clock::now() - frameStart;
+        paintAllocations += s_allocations.load() - allocationsBefore;
+
+        // If nothing changed, the engine didn't paint, and this isn't a frame.
+        if (!engine.GetFrames().empty())
+        {
+            frameTimes.push_back(frameTime);
+            for (const auto& call : engine.GetCalls())
+            {
+                switch (call.kind)
+                {
+                case RecordingRenderEngine::CallKind::PaintBufferLine:
+                    bufferLineCalls++;
+                    break;
+                case RecordingRenderEngine::CallKind::UpdateDrawingBrushes:
+                    brushCalls++;
+                    break;
+                case RecordingRenderEngine::CallKind::PaintCursor:
+                    cursorCalls++;
+                    break;
+                }
+            }
+        }
+        engine.Clear();
+    }
+    const auto total = Clock::now() - start;
+
+    if (frameTimes.empty())
+    {
+        wprintf(L"Nothing was painted.\n");
+        return 1;
+    }
+
+    const auto frames = frameTimes.size();
+    const auto paintTime = std::accumulate(frameTimes.begin(), frameTimes.end(), Clock::duration{});
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    wprintf(L"%zu bytes, %zu frames of %dx%d\n", capture.size(), frames, columns, rows);
+    wprintf(L"frames/sec:        %.1f\n", frames / std::chrono::duration<double>(paintTime).count());
+    wprintf(L"bytes/sec:         %.0f\n", capture.size() / std::chrono::duration<double>(total).count());
+    wprintf(L"allocations/frame: %.1f\n", static_cast<double>(paintAllocations) / frames);
+    wprintf(L"p50 frame:         %.1f us\n", s_ToMicroseconds(s_Percentile(frameTimes, 50)));
+    wprintf(L"p99 frame:         %.1f us\n", s_ToMicroseconds(s_Percentile(frameTimes, 99)));
+    wprintf(L"calls/frame:       %.1f PaintBufferLine, %.1f UpdateDrawingBrushes, %.1f PaintCursor\n",
+            static_cast<double>(bufferLineCalls) / frames,
+            static_cast<double>(brushCalls) / frames,
+            static_cast<double>(cursorCalls) / frames);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT license.
+#
+# Generates the codepoint width lookup tables in src/types/CodepointWidthDetector.cpp
+# from the Unicode Character Database's EastAsianWidth.txt.
+#
+# Usage: python GenerateCodepointWidthTables.py EastAsianWidth.txt > tables.txt
+#
+# Then replace the "Generated codepoint width tables" region of
+# CodepointWidthDetector.cpp with the output.
+#
+# Every codepoint gets one of the CodepointWidth values:
+#   F, W      -> Wide
+#   A         -> Ambiguous
+#   N, Na, H  -> Narrow
+#   unlisted  -> Invalid
+# The values are packed 2 bits apiece into 128 codepoint leaf blocks. Identical
+# blocks are stored once, and are found through two levels of byte indices.
+
+import sys
+
+NARROW, WIDE, AMBIGUOUS, INVALID = 0, 1, 2, 3
+WIDTHS = {'F': WIDE, 'W': WIDE, 'A': AMBIGUOUS, 'N': NARROW, 'Na': NARROW, 'H': NARROW}
+
+CODEPOINT_MAX = 0x10FFFF
+LEAF_SHIFT = 7
+MIDDLE_SHIFT = 5
+LEAF_SIZE = 1 << LEAF_SHIFT
+MIDDLE_SIZE = 1 << MIDDLE_SHIFT
+CODEPOINTS_PER_BYTE = 4
+
+
+def read_widths(path):
+    widths = [INVALID] * (CODEPOINT_MAX + 1)
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            codepoints, width = (part.strip() for part in line.split(';'))
+            first, _, last = codepoints.partition('..')
+            first = int(first, 16)
+            last = int(last, 16) if last else first
+            for codepoint in range(first, last + 1):
+                widths[codepoint] = WIDTHS[width]
+    return widths
+
+
+def dedupe(values, size):
+    blocks = {}
+    indices = []
+    for i in range(0, len(values), size):
+        indices.append(blocks.setdefault(tuple(values[i:i + size]), len(blocks)))
+    if len(blocks) > 256:
+        raise ValueError('too many unique blocks to index with a byte')
+    return indices, list(blocks)
+
+
+def pack(leaf):
+    return [sum(leaf[i + j] << (j * 2) for j in range(CODEPOINTS_PER_BYTE))
+            for i in range(0, len(leaf), CODEPOINTS_PER_BYTE)]
+
+
+def format_row(values):
+    return ', '.join('0x%02x' % value for value in values)
+
+
+def main():
+    widths = read_widths(sys.argv[1])
+    leafIndices, leaves = dedupe(widths, LEAF_SIZE)
+    stage1, middles = dedupe(leafIndices, MIDDLE_SIZE)
+
+    print('// Generated by tools/GenerateCodepointWidthTables.py. Don\'t edit by hand.')
+    print('static constexpr size_t s_leafShift = %d;' % LEAF_SHIFT)
+    print('static constexpr size_t s_middleShift = %d;' % MIDDLE_SHIFT)
+    print()
+    print('static constexpr std::array<BYTE, %d> s_stage1{' % len(stage1))
+    for i in range(0, len(stage1), 16):
+        print('    %s,' % format_row(stage1[i:i + 16]))
+    print('};')
+    print()
+    print('static constexpr std::array<std::array<BYTE, %d>, %d> s_stage2{ {' % (MIDDLE_SIZE, len(middles)))
+    for middle in middles:
+        print('    { %s },' % format_row(middle))
+    print('} };')
+    print()
+    print('static constexpr std::array<std::array<BYTE, %d>, %d> s_stage3{ {' % (LEAF_SIZE // CODEPOINTS_PER_BYTE, len(leaves)))
+    for leaf in leaves:
+        print('    { %s },' % format_row(pack(leaf)))
+    print('} };')
+
+
+if __name__ == '__main__':
+    main()